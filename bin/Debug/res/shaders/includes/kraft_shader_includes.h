@@ -0,0 +1,2 @@
+#define KRAFT_RENDERER__OBJECT_PICKING_DEPTH_ARRAY_SCALE 512
+#define KRAFT_RENDERER__MAX_GLOBAL_TEXTURES 1024
\ No newline at end of file
@@ -296,14 +296,14 @@ bool Init()
 #if 0
     kraft::Entity Sprite2D = EditorState::Ptr->CurrentWorld->CreateEntity("Sprite2D", WorldRoot);
     Sprite2D.AddComponent<MeshComponent>(
-        kraft::MaterialSystem::CreateMaterialFromFile("res/materials/simple_2d.kmt"), kraft::GeometrySystem::GetDefault2DGeometry()->DrawData
+        kraft::MaterialSystem::CreateMaterialFromFile("res/materials/simple_2d.kmt"), kraft::GeometrySystem::GetDefault2DGeometry()
     );
     Sprite2D.GetComponent<TransformComponent>().SetScale(50.0f);
 #endif
 
     Entity plane = EditorState::Ptr->CurrentWorld->CreateEntity("plane", WorldRoot);
     auto&  mesh = plane.AddComponent<MeshComponent>();
-    mesh.DrawData = GeometrySystem::GetDefaultGeometry()->DrawData;
+    mesh.SetGeometry(GeometrySystem::GetDefaultGeometry());
     mesh.MaterialInstance = MaterialSystem::CreateMaterialFromFile(S("res/materials/plane.kmt"));
     plane.GetComponent<TransformComponent>().SetTransform(Vec3fZero, { DegToRadians(-90.0f), 0.0f, 0.0f }, Vec3f(100.0f));
 
@@ -328,13 +328,12 @@ bool Init()
             {
                 kraft::Entity  TestMesh = EditorState::Ptr->CurrentWorld->CreateEntity(VikingRoom->NodeHierarchy[VikingRoom->SubMeshes[i].NodeIdx].Name, VikingRoomMeshParent);
                 MeshComponent& Mesh = TestMesh.AddComponent<MeshComponent>();
-                Mesh.DrawData = VikingRoom->SubMeshes[i].Geometry->DrawData;
+                Mesh.SetGeometry(VikingRoom->SubMeshes[i].Geometry);
                 Mesh.MaterialInstance = kraft::MaterialSystem::CreateMaterialFromFile(S("res/materials/simple_3d.kmt"));
 
                 kraft::TransformComponent& Transform = TestMesh.GetComponent<TransformComponent>();
                 VikingRoom->SubMeshes[i].Transform.Decompose(Transform.Position, Transform.Rotation, Transform.Scale);
                 Transform.ComputeModelMatrix();
-                Transform.Set(EditorState::Ptr->CurrentWorld->GetWorldSpaceTransformMatrix(TestMesh));
             }
         }
     }
@@ -350,7 +349,7 @@ bool Init()
     {
         kraft::Entity  TestMesh = EditorState::Ptr->CurrentWorld->CreateEntity(VikingRoom->NodeHierarchy[VikingRoom->SubMeshes[i].NodeIdx].Name, VikingRoomMeshParent);
         MeshComponent& Mesh = TestMesh.AddComponent<MeshComponent>();
-        Mesh.DrawData = VikingRoom->SubMeshes[i].Geometry->DrawData;
+        Mesh.SetGeometry(VikingRoom->SubMeshes[i].Geometry);
         Mesh.MaterialInstance = kraft::MaterialSystem::CreateMaterialFromFile(S("res/materials/simple_3d.kmt"));
 
         kraft::TransformComponent& Transform = TestMesh.GetComponent<TransformComponent>();
@@ -366,7 +365,7 @@ bool Init()
     {
         kraft::Entity  TestMesh = EditorState::Ptr->CurrentWorld->CreateEntity(VikingRoom->NodeHierarchy[VikingRoom->SubMeshes[i].NodeIdx].Name, VikingRoomMeshParent);
         MeshComponent& Mesh = TestMesh.AddComponent<MeshComponent>();
-        Mesh.DrawData = VikingRoom->SubMeshes[i].Geometry->DrawData;
+        Mesh.SetGeometry(VikingRoom->SubMeshes[i].Geometry);
         Mesh.MaterialInstance = kraft::MaterialSystem::CreateMaterialFromFile(S("res/materials/simple_3d.kmt"));
 
         kraft::TransformComponent& Transform = TestMesh.GetComponent<TransformComponent>();
@@ -384,7 +383,7 @@ bool Init()
     {
         kraft::Entity  TestMesh = EditorState::Ptr->CurrentWorld->CreateEntity(Chair->NodeHierarchy[Chair->SubMeshes[i].NodeIdx].Name, VikingRoomMeshParent);
         MeshComponent& Mesh = TestMesh.AddComponent<MeshComponent>();
-        Mesh.DrawData = Chair->SubMeshes[i].Geometry->DrawData;
+        Mesh.SetGeometry(Chair->SubMeshes[i].Geometry);
         Mesh.MaterialInstance = kraft::MaterialSystem::CreateMaterialFromFile(S("res/materials/simple_3d.kmt"));
 
         kraft::TransformComponent& Transform = TestMesh.GetComponent<TransformComponent>();
@@ -405,7 +404,7 @@ bool Init()
         {
             kraft::MeshT&  SubMesh = RogueSkeleton->SubMeshes[Node.MeshIdx];
             MeshComponent& Mesh = NodeEntity.AddComponent<MeshComponent>();
-            Mesh.DrawData = SubMesh.Geometry->DrawData;
+            Mesh.SetGeometry(SubMesh.Geometry);
             Mesh.MaterialInstance = kraft::MaterialSystem::CreateMaterialFromFile("res/materials/simple_3d.kmt");
 
             if (SubMesh.Textures.Length > 0)
@@ -436,7 +435,7 @@ bool Init()
     {
         kraft::Entity  TestMesh = EditorState::Ptr->CurrentWorld->CreateEntity(RogueSkeleton->NodeHierarchy[RogueSkeleton->SubMeshes[i].NodeIdx].Name, MeshParent);
         MeshComponent& Mesh = TestMesh.AddComponent<MeshComponent>();
-        Mesh.DrawData = RogueSkeleton->SubMeshes[i].Geometry->DrawData;
+        Mesh.SetGeometry(RogueSkeleton->SubMeshes[i].Geometry);
         Mesh.MaterialInstance = kraft::MaterialSystem::CreateMaterialFromFile(S("res/materials/simple_3d.kmt"));
 
         if (RogueSkeleton->SubMeshes[i].Textures.Length > 0)
@@ -447,7 +446,6 @@ bool Init()
         kraft::TransformComponent& Transform = TestMesh.GetComponent<TransformComponent>();
         RogueSkeleton->SubMeshes[i].Transform.Decompose(Transform.Position, Transform.Rotation, Transform.Scale);
         Transform.ComputeModelMatrix();
-        Transform.Set(EditorState::Ptr->CurrentWorld->GetWorldSpaceTransformMatrix(TestMesh));
     }
 #endif
     // const float ObjectCount = 0.0f;
@@ -480,6 +478,7 @@ bool Init()
     InitImguiWidgets();
 
     ObjectPickingShader = kraft::ShaderSystem::AcquireShader(S("res/shaders/object_picking.kfx.bkfx"));
+    kraft::ShaderSystem::WaitForShader(ObjectPickingShader);
 
     return true;
 }
@@ -718,14 +717,14 @@ void Run()
                 for (auto EntityHandle : Group)
                 {
                     auto [Transform, Mesh] = Group.get<kraft::TransformComponent, kraft::MeshComponent>(EntityHandle);
+                    auto WorldTransform = EditorState::Ptr->CurrentWorld->GetRegistry().try_get<kraft::WorldTransformComponent>(EntityHandle);
 
-                    // DummyDrawData.Model = EditorState::Ptr->CurrentWorld->GetWorldSpaceTransformMatrix(kraft::Entity(EntityHandle, EditorState::Ptr->CurrentWorld));
-                    DummyDrawData.Model = Transform.ModelMatrix;
+                    DummyDrawData.Model = WorldTransform ? WorldTransform->WorldMatrix : Transform.ModelMatrix;
                     DummyDrawData.MousePosition = EditorState::Ptr->ObjectPickingRenderSurface.RelativeMousePosition;
                     DummyDrawData.EntityId = (u32)EntityHandle;
 
                     kraft::g_Renderer->ApplyLocalShaderProperties(ObjectPickingShader, &DummyDrawData);
-                    kraft::g_Renderer->DrawGeometry(Mesh.DrawData);
+                    kraft::g_Renderer->DrawGeometry(Mesh.GetDrawData());
                 }
             }
             EditorState::Ptr->ObjectPickingRenderSurface.End();
@@ -431,7 +431,6 @@ void DrawImGuiWidgets(bool refresh)
         }
 
         auto  SelectedEntity = EditorState::Ptr->GetSelectedEntity();
-        auto& Transform = SelectedEntity.GetComponent<kraft::TransformComponent>();
 
         ImGuizmo::SetOrthographic(Camera.ProjectionType == kraft::CameraProjectionType::Orthographic);
         ImGuizmo::SetDrawlist();
@@ -445,7 +444,7 @@ void DrawImGuiWidgets(bool refresh)
         //     ImGui::GetColorU32(ImVec4(1, 1, 0, 1))
         // );
 
-        kraft::Mat4f EntityWorldTransform = Transform.ModelMatrix; // EditorState::Ptr->CurrentWorld->GetWorldSpaceTransformMatrix(SelectedEntity);
+        kraft::Mat4f EntityWorldTransform = EditorState::Ptr->CurrentWorld->GetWorldSpaceTransformMatrix(SelectedEntity);
         ImGuizmo::Manipulate(
             Camera.ViewMatrix._data, Camera.ProjectionMatrix._data, GizmoState.CurrentOperation, GizmoState.Mode, EntityWorldTransform, nullptr, GizmoState.Snap ? GizmoState.Snapping._data : nullptr
         );
@@ -453,19 +452,28 @@ void DrawImGuiWidgets(bool refresh)
 
         if (ImGuizmo::IsUsing())
         {
-            // kraft::Entity ParentEntity = EditorState::Ptr->CurrentWorld->GetEntity(SelectedEntity.GetParent());
-            // kraft::Mat4f  EntityParentWorldTransform = ParentEntity.GetComponent<kraft::TransformComponent>().ModelMatrix;//EditorState::Ptr->CurrentWorld->GetWorldSpaceTransformMatrix(ParentEntity);
-            // kraft::Mat4f  EntityLocalTransform = EntityWorldTransform * kraft::Inverse(EntityParentWorldTransform);
+            // The gizmo works in world space, the transform component stores the transform relative to the parent
+            kraft::Mat4f EntityLocalTransform = EntityWorldTransform;
+            if (SelectedEntity.GetParent() != kraft::EntityHandleInvalid)
+            {
+                kraft::Entity ParentEntity = EditorState::Ptr->CurrentWorld->GetEntity(SelectedEntity.GetParent());
+                kraft::Mat4f  EntityParentWorldTransform = EditorState::Ptr->CurrentWorld->GetWorldSpaceTransformMatrix(ParentEntity);
+                EntityLocalTransform = EntityWorldTransform * kraft::Inverse(EntityParentWorldTransform);
+            }
 
-            // EntityLocalTransform.Decompose(Translation, Rotation, Scale);
-            EntityWorldTransform.Decompose(Translation, Rotation, Scale);
+            EntityLocalTransform.Decompose(Translation, Rotation, Scale);
         }
     }
 
     ImGui::End();
     ImGui::PopStyleVar();
 
-    Transform.SetTransform(Translation, Rotation, Scale);
+    // Only touch the transform when something was edited, every change invalidates the world transforms of the whole subtree
+    if (!kraft::Vec3fCompare(Translation, Transform.Position, 0.0f) || !kraft::Vec3fCompare(Rotation, Transform.Rotation, 0.0f) ||
+        !kraft::Vec3fCompare(Scale, Transform.Scale, 0.0f))
+    {
+        Transform.SetTransform(Translation, Rotation, Scale);
+    }
 
     static bool ShowDemoWindow = true;
     ImGui::ShowDemoWindow(&ShowDemoWindow);
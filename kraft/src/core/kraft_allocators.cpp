@@ -4,31 +4,102 @@
 
 namespace kraft {
 
+static void ArenaCommit(ArenaAllocator* Block, u64 Size)
+{
+    if (!Platform::MemCommit(Block->base_ptr + Block->committed, Size))
+    {
+        KFATAL("[Arena]: Failed to commit %llu bytes", Size);
+        KASSERT(false);
+    }
+
+    Block->committed += Size;
+    g_MemoryStats.Allocated += Size;
+    g_MemoryStats.AllocationsByTag[Block->tag] += Size;
+}
+
+static void ArenaDecommit(ArenaAllocator* Block, u64 NewCommitted)
+{
+    u64 Size = Block->committed - NewCommitted;
+    Platform::MemDecommit(Block->base_ptr + NewCommitted, Size);
+
+    Block->committed = NewCommitted;
+    g_MemoryStats.Allocated -= Size;
+    g_MemoryStats.AllocationsByTag[Block->tag] -= Size;
+}
+
+// Reserves the address space for a single block and commits just enough of it to hold the header
+static ArenaAllocator* ArenaCreateBlock(const ArenaCreateOptions& Options, u64 ReserveSize)
+{
+    u8* Memory = (u8*)Platform::MemReserve(ReserveSize);
+    if (!Memory)
+    {
+        KFATAL("[Arena]: Failed to reserve %llu bytes", ReserveSize);
+        return nullptr;
+    }
+
+    if (Options.LargePages && ReserveSize >= KRAFT_SIZE_MB(2))
+    {
+        Platform::MemAdviseHugePages(Memory, ReserveSize);
+    }
+
+    u64 InitialCommit = Options.CommitSize < ReserveSize ? Options.CommitSize : ReserveSize;
+    if (!Platform::MemCommit(Memory, InitialCommit))
+    {
+        KFATAL("[Arena]: Failed to commit %llu bytes", InitialCommit);
+        Platform::MemRelease(Memory, ReserveSize);
+        return nullptr;
+    }
+
+    g_MemoryStats.Allocated += InitialCommit;
+    g_MemoryStats.AllocationsByTag[Options.Tag] += InitialCommit;
+
+    ArenaAllocator* Block = (ArenaAllocator*)Memory;
+    Block->current = Block;
+    Block->prev = nullptr;
+    Block->tag = Options.Tag;
+    Block->base_ptr = Memory;
+    Block->capacity = ReserveSize;
+    Block->committed = InitialCommit;
+    Block->base_position = 0;
+    Block->position = sizeof(ArenaAllocator);
+    Block->options = Options;
+
+    return Block;
+}
+
+static void ArenaReleaseBlock(ArenaAllocator* Block)
+{
+    g_MemoryStats.Allocated -= Block->committed;
+    g_MemoryStats.AllocationsByTag[Block->tag] -= Block->committed;
+
+    Platform::MemRelease(Block->base_ptr, Block->capacity);
+}
+
 ArenaAllocator* CreateArena(ArenaCreateOptions Options)
 {
+    u64 PageSize = Platform::GetPageSize();
     Options.ChunkSize = AlignPow2(Options.ChunkSize, Options.Alignment);
-    u64 ActualSize = sizeof(ArenaAllocator) + Options.ChunkSize;
-    u8* Memory = (u8*)Malloc(ActualSize, kraft::MEMORY_TAG_NONE, true);
-    MemSet(Memory, 0, Options.ChunkSize);
+    Options.ChunkSize = AlignPow2(Options.ChunkSize, PageSize);
+    Options.CommitSize = AlignPow2(Options.CommitSize, PageSize);
+    KASSERT(Options.CommitSize >= sizeof(ArenaAllocator));
 
-    ArenaAllocator* OutArena = (ArenaAllocator*)Memory;
-    OutArena->base_ptr = Memory + sizeof(ArenaAllocator);
-    OutArena->base_position = 0;
-    OutArena->options = Options;
-    OutArena->capacity = Options.ChunkSize;
-    OutArena->position = sizeof(ArenaAllocator);
-
-    return OutArena;
+    return ArenaCreateBlock(Options, Options.ChunkSize);
 }
 
 void DestroyArena(ArenaAllocator* Arena)
 {
-    Free(Arena, Arena->capacity, MEMORY_TAG_NONE);
+    ArenaAllocator* Block = Arena->current;
+    while (Block)
+    {
+        ArenaAllocator* Prev = Block->prev;
+        ArenaReleaseBlock(Block);
+        Block = Prev;
+    }
 }
 
 void ArenaPop(ArenaAllocator* arena, u64 size)
 {
-    u64 new_position = arena->position - size;
+    u64 new_position = ArenaPosition(arena) - size;
     ArenaPopToPosition(arena, new_position);
 
     // KDEBUG("Deallocated %d bytes from arena", size);
@@ -36,8 +107,44 @@ void ArenaPop(ArenaAllocator* arena, u64 size)
 
 void ArenaPopToPosition(ArenaAllocator* arena, u64 position)
 {
-    arena->position = position;
-    KASSERT(arena->position >= sizeof(ArenaAllocator));
+    KASSERT(position >= sizeof(ArenaAllocator));
+
+    // Release every block that lies entirely above the new position
+    ArenaAllocator* current = arena->current;
+    while (current->base_position >= position && current->prev)
+    {
+        ArenaAllocator* prev = current->prev;
+        ArenaReleaseBlock(current);
+        current = prev;
+    }
+
+    arena->current = current;
+
+    u64 new_position = position - current->base_position;
+    if (new_position < sizeof(ArenaAllocator))
+    {
+        new_position = sizeof(ArenaAllocator);
+    }
+
+    // The position may point into the unused tail of a block that was skipped over when chaining
+    if (new_position > current->position)
+    {
+        new_position = current->position;
+    }
+
+#if KRAFT_MEMORY_DEBUG
+    // Set the popped region to some garbage so we never read legit values from it
+    MemSet(current->base_ptr + new_position, 0xfc, current->position - new_position);
+#endif
+
+    current->position = new_position;
+
+    // Keep the pages below the high-water mark around for reuse, give everything above back to the OS
+    u64 high_water_mark = AlignPow2(new_position, current->options.CommitSize) + current->options.DecommitThreshold;
+    if (current->committed > high_water_mark)
+    {
+        ArenaDecommit(current, high_water_mark);
+    }
 }
 
 String8 ArenaPushString8Empty(ArenaAllocator* arena, u64 size)
@@ -77,14 +184,47 @@ char* ArenaPushString(ArenaAllocator* arena, const char* src, u64 length)
 
 void* ArenaAllocator::Push(u64 size, u64 alignment, bool zero)
 {
-    u64 start_position = AlignPow2(this->position, alignment);
-    u64 end_position = start_position + size;
+    ArenaAllocator* current = this->current;
+    u64             start_position = AlignPow2(current->position, alignment);
+    u64             end_position = start_position + size;
+
+    // Chain a new block if this one has run out of address space
+    if (end_position > current->capacity)
+    {
+        u64 reserve_size = current->options.ChunkSize;
+        u64 required_size = AlignPow2(sizeof(ArenaAllocator), alignment) + size;
+        if (required_size > reserve_size)
+        {
+            reserve_size = AlignPow2(required_size, current->options.CommitSize);
+        }
+
+        ArenaAllocator* block = ArenaCreateBlock(current->options, reserve_size);
+        KASSERT(block);
+
+        block->base_position = current->base_position + current->capacity;
+        block->prev = current;
+        this->current = block;
+
+        current = block;
+        start_position = AlignPow2(current->position, alignment);
+        end_position = start_position + size;
+    }
+
+    // Commit more pages if needed
+    if (end_position > current->committed)
+    {
+        u64 new_committed = AlignPow2(end_position, current->options.CommitSize);
+        if (new_committed > current->capacity)
+        {
+            new_committed = current->capacity;
+        }
+
+        ArenaCommit(current, new_committed - current->committed);
+    }
 
-    // TODO: Stretch
-    KASSERT(end_position <= this->capacity);
-    this->position = end_position;
+    current->position = end_position;
 
-    u8* address_into_the_arena = this->base_ptr + start_position;
+    u8* address_into_the_arena = current->base_ptr + start_position;
     if (zero)
     {
         MemZero(address_into_the_arena, size);
@@ -96,7 +236,7 @@ void* ArenaAllocator::Push(u64 size, u64 alignment, bool zero)
 
 u64 ArenaPosition(ArenaAllocator* arena)
 {
-    return arena->base_position + arena->position;
+    return arena->current->base_position + arena->current->position;
 }
 
 TempArena TempBegin(ArenaAllocator* arena)
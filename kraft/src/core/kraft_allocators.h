@@ -2,6 +2,7 @@
 
 #define KRAFT_SIZE_KB(Size) Size * 1024
 #define KRAFT_SIZE_MB(Size) KRAFT_SIZE_KB(Size) * 1024
+#define KRAFT_SIZE_GB(Size) KRAFT_SIZE_MB(Size) * 1024
 
 #define KRAFT_MEMORY_DEBUG 1
 
@@ -11,17 +12,40 @@ enum MemoryTag : int;
 
 struct ArenaCreateOptions
 {
+    // Size of the virtual address range reserved for each block of the arena.
+    // When a block runs out, a new block is chained to it.
     u64       ChunkSize = 64;
     u64       Alignment = 64;
     MemoryTag Tag = (MemoryTag)0;
+
+    // Granularity at which reserved pages are committed as the arena grows
+    u64 CommitSize = KRAFT_SIZE_KB(64);
+
+    // Committed memory above this much past the current position is given back
+    // to the OS when the arena is popped
+    u64 DecommitThreshold = KRAFT_SIZE_MB(4);
+
+    // Ask the OS to back the arena with transparent huge pages (Linux only).
+    // Only applied to blocks that are at least 2 MiB large.
+    bool LargePages = false;
 };
 
-// TODO: Arena->Next
 struct ArenaAllocator
 {
-    MemoryTag          tag;
-    u8*                base_ptr;
-    u64                capacity = 0;
+    // Only valid for the first block in the chain
+    ArenaAllocator* current;
+
+    // The block before this one in the chain
+    ArenaAllocator* prev;
+
+    MemoryTag tag;
+    u8*       base_ptr;
+
+    // Bytes reserved and committed for this block
+    u64 capacity = 0;
+    u64 committed;
+
+    // Position of this block relative to the start of the whole chain
     u64                base_position;
     u64                position;
     ArenaCreateOptions options;
@@ -37,16 +61,7 @@ struct TempArena
 #if KRAFT_MEMORY_DEBUG
     ~TempArena()
     {
-        KASSERTM(arena->position == position, "ScratchEnd not called!");
-
-        // Set the original region to some garbage so we never read legit values from it
-        for (u64 i = 0; i < arena->position; i += 4)
-        {
-            arena->base_ptr[position + i + 0] = 0xfc;
-            arena->base_ptr[position + i + 1] = 0xfc;
-            arena->base_ptr[position + i + 2] = 0xfc;
-            arena->base_ptr[position + i + 3] = 0xfc;
-        }
+        KASSERTM(arena->current->base_position + arena->current->position == position, "ScratchEnd not called!");
     }
 #endif
 };
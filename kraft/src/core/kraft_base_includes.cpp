@@ -2,6 +2,7 @@
 #include "kraft_allocators.cpp"
 #include "kraft_strings.cpp"
 #include "kraft_thread_context.cpp"
+#include "kraft_jobs.cpp"
 #include "kraft_time.cpp"
 #include "kraft_log.cpp"
 #include "kraft_asserts.cpp"
@@ -5,6 +5,7 @@
 #include "kraft_allocators.h"
 #include "kraft_strings.h"
 #include "kraft_thread_context.h"
+#include "kraft_jobs.h"
 #include "kraft_time.h"
 #include "kraft_log.h"
 #include "kraft_input.h"
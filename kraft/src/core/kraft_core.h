@@ -175,6 +175,23 @@ typedef String8 buffer;
 #endif
 #endif
 
+// SIMD
+// AVX is only used when the compiler targets it (-mavx, /arch:AVX); SSE2 is part of every x64 target and NEON of every
+// arm64 target. Define KRAFT_NO_SIMD to force the scalar code paths.
+#if !defined(KRAFT_NO_SIMD)
+#if defined(__AVX__)
+#define KRAFT_SIMD_AVX
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KRAFT_SIMD_SSE
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define KRAFT_SIMD_NEON
+#endif
+#endif
+
 // Some forward declares for most-used types
 namespace kraft {
 template<typename T, u64 InternalBufferSize>
@@ -63,6 +63,7 @@ bool Engine::Init(const EngineConfig* config)
     Platform::Init(&Engine::config);
     EventSystem::Init(arena);
     InputSystem::Init();
+    JobSystem::Init({ .WorkerCount = config->worker_thread_count });
 
 #if defined(KRAFT_GUI_APP)
     EventSystem::Listen(EventType::EVENT_TYPE_WINDOW_RESIZE, nullptr, WindowResizeListener);
@@ -79,6 +80,7 @@ bool Engine::Init(const EngineConfig* config)
 bool Engine::Tick()
 {
     Time::Update();
+    JobSystem::RunMainThreadJobs();
 
 #if defined(KRAFT_GUI_APP)
     InputSystem::Update();
@@ -105,6 +107,7 @@ void Engine::Destroy()
 {
     KINFO("[Engine]: Shutting down...");
 
+    JobSystem::Shutdown();
     InputSystem::Shutdown();
     EventSystem::Shutdown();
     Platform::Shutdown();
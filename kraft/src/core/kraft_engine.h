@@ -10,6 +10,9 @@ struct EngineConfig
     char**  argv = 0;
     String8 application_name = {};
     bool    console_app = false;
+
+    // Number of job system worker threads; 0 spawns one per core
+    u32 worker_thread_count = 0;
 };
 
 struct KRAFT_API Engine
@@ -0,0 +1,444 @@
+#include "kraft_jobs.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace kraft {
+
+struct Job
+{
+    JobFunction Function;
+    void*       UserData;
+    JobCounter* Counter;
+};
+
+// Chase-Lev work-stealing deque
+// The owning thread pushes and pops at the bottom, every other thread steals from the top.
+// See "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al, 2013)
+//
+// Jobs are stored by value in the slot their position maps to. A slot is only written again once `bottom` wraps
+// around to it, which IsFull() rules out while the job in it is still queued. A thief that copies a slot the owner is
+// writing to has lost the race for it already, its CAS on `top` fails and the copy is thrown away.
+struct JobDeque
+{
+    alignas(64) std::atomic<i64> top;
+    alignas(64) std::atomic<i64> bottom;
+    alignas(64) Job entries[KRAFT_JOB_QUEUE_SIZE];
+
+    // Only valid on the owning thread
+    bool IsFull()
+    {
+        i64 b = bottom.load(std::memory_order_relaxed);
+        i64 t = top.load(std::memory_order_acquire);
+        return b - t >= KRAFT_JOB_QUEUE_SIZE;
+    }
+
+    void Push(const Job& job)
+    {
+        i64 b = bottom.load(std::memory_order_relaxed);
+        entries[b & (KRAFT_JOB_QUEUE_SIZE - 1)] = job;
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    // Jobs are copied out before the slot is claimed; once `top` moves past a slot the owner is free to reuse it
+    bool Pop(Job* out)
+    {
+        i64 b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        i64 t = top.load(std::memory_order_relaxed);
+
+        if (t > b)
+        {
+            // Empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        *out = entries[b & (KRAFT_JOB_QUEUE_SIZE - 1)];
+        if (t == b)
+        {
+            // Last item, race against the thieves for it
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+
+        return true;
+    }
+
+    bool Steal(Job* out)
+    {
+        i64 t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        i64 b = bottom.load(std::memory_order_acquire);
+
+        if (t >= b)
+        {
+            return false;
+        }
+
+        // If the CAS fails another thief got here first and whatever we copied is thrown away
+        *out = entries[t & (KRAFT_JOB_QUEUE_SIZE - 1)];
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+};
+
+struct JobWorker
+{
+    JobDeque deque;
+
+    std::thread thread;
+    u32         index;
+};
+
+struct JobSystemState
+{
+    ArenaAllocator* arena;
+    JobWorker*      workers;
+    u32             thread_count;
+
+    std::atomic<bool> running;
+
+    // Used to put idle workers to sleep
+    std::mutex              wake_mutex;
+    std::condition_variable wake_condition;
+    std::atomic<i32>        queued_job_count;
+
+    // Main-thread-only jobs
+    std::mutex main_thread_mutex;
+    Job        main_thread_jobs[KRAFT_JOB_QUEUE_SIZE];
+    u64        main_thread_jobs_read;
+    u64        main_thread_jobs_write;
+};
+
+static JobSystemState* job_system_state = nullptr;
+
+kraft_thread_internal u32 job_thread_index;
+
+struct ParallelForBatch
+{
+    ParallelForFunction function;
+    void*               user_data;
+    u32                 start;
+    u32                 end;
+};
+
+static void ExecuteJob(const Job& job)
+{
+    job.Function(job.UserData);
+    if (job.Counter)
+    {
+        job.Counter->value.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+// Tries to grab a single job, first from the calling thread's own deque and then from everybody else's
+static bool FindJob(u32 thread_index, Job* out)
+{
+    JobWorker* self = &job_system_state->workers[thread_index];
+    if (self->deque.Pop(out))
+    {
+        job_system_state->queued_job_count.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    u32 thread_count = job_system_state->thread_count;
+    for (u32 i = 1; i < thread_count; i++)
+    {
+        JobWorker* victim = &job_system_state->workers[(thread_index + i) % thread_count];
+        if (victim->deque.Steal(out))
+        {
+            job_system_state->queued_job_count.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool RunOneMainThreadJob()
+{
+    Job job;
+    {
+        std::lock_guard<std::mutex> lock(job_system_state->main_thread_mutex);
+        if (job_system_state->main_thread_jobs_read == job_system_state->main_thread_jobs_write)
+        {
+            return false;
+        }
+
+        job = job_system_state->main_thread_jobs[job_system_state->main_thread_jobs_read % KRAFT_JOB_QUEUE_SIZE];
+        job_system_state->main_thread_jobs_read++;
+    }
+
+    ExecuteJob(job);
+    return true;
+}
+
+static void WorkerThreadMain(JobWorker* worker)
+{
+    job_thread_index = worker->index;
+
+    ThreadContext* thread_context = CreateThreadContext();
+    SetCurrentThreadContext(thread_context);
+
+    while (job_system_state->running.load(std::memory_order_acquire))
+    {
+        Job job;
+        if (FindJob(worker->index, &job))
+        {
+            ExecuteJob(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(job_system_state->wake_mutex);
+        job_system_state->wake_condition.wait(lock, [] {
+            return !job_system_state->running.load(std::memory_order_acquire) || job_system_state->queued_job_count.load(std::memory_order_acquire) > 0;
+        });
+    }
+
+    DestroyThreadContext(thread_context);
+}
+
+bool JobSystem::Init(JobSystemOptions options)
+{
+    KASSERT(job_system_state == nullptr);
+
+    u32 worker_count = options.WorkerCount;
+    if (worker_count == 0)
+    {
+        u32 core_count = std::thread::hardware_concurrency();
+        worker_count = core_count > 1 ? core_count - 1 : 1;
+    }
+
+    ArenaAllocator* arena = CreateArena({ .ChunkSize = KRAFT_SIZE_MB(64), .Alignment = 64 });
+    void*           memory = ArenaPush(arena, JobSystemState);
+    job_system_state = new (memory) JobSystemState();
+    job_system_state->arena = arena;
+    job_system_state->thread_count = worker_count + 1;
+    job_system_state->running.store(true);
+
+    // Slot 0 belongs to the main thread, it never gets a thread of its own
+    job_system_state->workers = (JobWorker*)arena->Push(sizeof(JobWorker) * job_system_state->thread_count, 64, true);
+    for (u32 i = 0; i < job_system_state->thread_count; i++)
+    {
+        JobWorker* worker = new (&job_system_state->workers[i]) JobWorker();
+        worker->index = i;
+    }
+
+    job_thread_index = 0;
+    for (u32 i = 1; i < job_system_state->thread_count; i++)
+    {
+        JobWorker* worker = &job_system_state->workers[i];
+        worker->thread = std::thread(WorkerThreadMain, worker);
+    }
+
+    KINFO("[JobSystem]: Started %d worker threads", worker_count);
+
+    return true;
+}
+
+void JobSystem::Shutdown()
+{
+    if (!job_system_state)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(job_system_state->wake_mutex);
+        job_system_state->running.store(false, std::memory_order_release);
+    }
+
+    job_system_state->wake_condition.notify_all();
+
+    for (u32 i = 1; i < job_system_state->thread_count; i++)
+    {
+        JobWorker* worker = &job_system_state->workers[i];
+        worker->thread.join();
+        worker->~JobWorker();
+    }
+
+    ArenaAllocator* arena = job_system_state->arena;
+    job_system_state->~JobSystemState();
+    DestroyArena(arena);
+    job_system_state = nullptr;
+
+    KINFO("[JobSystem]: Shutdown complete");
+}
+
+u32 JobSystem::GetThreadCount()
+{
+    return job_system_state->thread_count;
+}
+
+u32 JobSystem::GetCurrentThreadIndex()
+{
+    return job_thread_index;
+}
+
+bool JobSystem::IsMainThread()
+{
+    return job_thread_index == 0;
+}
+
+void JobSystem::Submit(JobDescription job)
+{
+    Submit(&job, 1);
+}
+
+void JobSystem::Submit(const JobDescription* jobs, u32 count)
+{
+    JobWorker* self = &job_system_state->workers[job_thread_index];
+    u32        queued = 0;
+
+    for (u32 i = 0; i < count; i++)
+    {
+        const JobDescription* description = &jobs[i];
+        KASSERT(description->Function);
+
+        if (description->Counter)
+        {
+            description->Counter->value.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (description->MainThreadOnly)
+        {
+            std::lock_guard<std::mutex> lock(job_system_state->main_thread_mutex);
+            KASSERTM(job_system_state->main_thread_jobs_write - job_system_state->main_thread_jobs_read < KRAFT_JOB_QUEUE_SIZE, "Main thread job queue is full");
+
+            job_system_state->main_thread_jobs[job_system_state->main_thread_jobs_write % KRAFT_JOB_QUEUE_SIZE] = {
+                .Function = description->Function,
+                .UserData = description->UserData,
+                .Counter = description->Counter,
+            };
+
+            job_system_state->main_thread_jobs_write++;
+            continue;
+        }
+
+        Job job = {
+            .Function = description->Function,
+            .UserData = description->UserData,
+            .Counter = description->Counter,
+        };
+
+        // The deque is full; run the job right here instead of dropping it.
+        // This also guarantees that we never overwrite a slot that is still queued.
+        if (self->deque.IsFull())
+        {
+            ExecuteJob(job);
+            continue;
+        }
+
+        job_system_state->queued_job_count.fetch_add(1, std::memory_order_release);
+        self->deque.Push(job);
+
+        queued++;
+    }
+
+    if (queued > 0)
+    {
+        // Taking the lock makes sure a worker that just checked the queue can't miss this wakeup
+        {
+            std::lock_guard<std::mutex> lock(job_system_state->wake_mutex);
+        }
+
+        if (queued == 1)
+            job_system_state->wake_condition.notify_one();
+        else
+            job_system_state->wake_condition.notify_all();
+    }
+}
+
+bool JobSystem::IsDone(JobCounter* counter)
+{
+    return counter->value.load(std::memory_order_acquire) == 0;
+}
+
+void JobSystem::WaitForCounter(JobCounter* counter)
+{
+    u32 thread_index = job_thread_index;
+    while (!IsDone(counter))
+    {
+        if (thread_index == 0 && RunOneMainThreadJob())
+        {
+            continue;
+        }
+
+        Job job;
+        if (FindJob(thread_index, &job))
+        {
+            ExecuteJob(job);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+static void ParallelForJob(void* user_data)
+{
+    ParallelForBatch* batch = (ParallelForBatch*)user_data;
+    batch->function(batch->user_data, batch->start, batch->end);
+}
+
+void JobSystem::ParallelFor(u32 count, u32 batch_size, ParallelForFunction function, void* user_data)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    if (batch_size == 0)
+    {
+        batch_size = 1;
+    }
+
+    u32 batch_count = (count + batch_size - 1) / batch_size;
+    if (batch_count == 1)
+    {
+        function(user_data, 0, count);
+        return;
+    }
+
+    TempArena         scratch = ScratchBegin(0, 0);
+    ParallelForBatch* batches = ArenaPushArrayNoZero(scratch.arena, ParallelForBatch, batch_count);
+    JobDescription*   jobs = ArenaPushArrayNoZero(scratch.arena, JobDescription, batch_count);
+    JobCounter        counter;
+
+    for (u32 i = 0; i < batch_count; i++)
+    {
+        u32 start = i * batch_size;
+        u32 end = start + batch_size;
+        batches[i] = {
+            .function = function,
+            .user_data = user_data,
+            .start = start,
+            .end = end > count ? count : end,
+        };
+
+        jobs[i] = {
+            .Function = ParallelForJob,
+            .UserData = &batches[i],
+            .Counter = &counter,
+        };
+    }
+
+    Submit(jobs, batch_count);
+    WaitForCounter(&counter);
+
+    ScratchEnd(scratch);
+}
+
+void JobSystem::RunMainThreadJobs()
+{
+    KASSERT(job_thread_index == 0);
+    while (RunOneMainThreadJob())
+    {
+    }
+}
+
+} // namespace kraft
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+
+#define KRAFT_JOB_QUEUE_SIZE 4096
+
+namespace kraft {
+
+typedef void (*JobFunction)(void* user_data);
+typedef void (*ParallelForFunction)(void* user_data, u32 start, u32 end);
+
+// Every job submitted with a counter increments it by one and decrements it once done,
+// so waiting on a counter means waiting on the whole group of jobs.
+struct JobCounter
+{
+    std::atomic<i32> value = 0;
+};
+
+struct JobDescription
+{
+    JobFunction Function = nullptr;
+    void*       UserData = nullptr;
+    JobCounter* Counter = nullptr;
+
+    // Main-thread-only jobs are never picked up by workers.
+    // They run in RunMainThreadJobs() or while the main thread is waiting on a counter.
+    bool MainThreadOnly = false;
+};
+
+struct JobSystemOptions
+{
+    // Number of worker threads to spawn in addition to the main thread.
+    // 0 means one worker per core, minus the main thread.
+    u32 WorkerCount = 0;
+};
+
+// Jobs may only be submitted and waited on from the main thread or from inside other jobs
+namespace JobSystem {
+
+bool Init(JobSystemOptions options);
+void Shutdown();
+
+// Total number of threads that execute jobs, including the main thread
+u32 GetThreadCount();
+
+// Index of the calling thread; 0 is the main thread
+u32  GetCurrentThreadIndex();
+bool IsMainThread();
+
+void Submit(JobDescription job);
+void Submit(const JobDescription* jobs, u32 count);
+
+bool IsDone(JobCounter* counter);
+
+// Runs other jobs on the calling thread until the counter hits zero
+void WaitForCounter(JobCounter* counter);
+
+// Splits [0, count) into batches of `batch_size` and runs them across all threads.
+// Blocks until every batch has finished.
+void ParallelFor(u32 count, u32 batch_size, ParallelForFunction function, void* user_data);
+
+// Executes every main-thread-only job queued so far. Must be called from the main thread.
+void RunMainThreadJobs();
+
+} // namespace JobSystem
+
+} // namespace kraft
@@ -9,6 +9,14 @@
 
 #include "core/kraft_core.h"
 
+#if defined(KRAFT_SIMD_AVX)
+#include <immintrin.h>
+#elif defined(KRAFT_SIMD_SSE)
+#include <emmintrin.h>
+#elif defined(KRAFT_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
 //
 // Useful defines
 //
@@ -769,6 +777,69 @@ private:
 typedef Matrix<f32, 4, 4> Mat4f;
 typedef Matrix<f32, 4, 4> mat4;
 
+// The generic Decompose for f32, kept as the scalar reference that DecomposeMat4f is checked against
+KRAFT_INLINE static void DecomposeScalar(const Mat4f& M, Vec3f& Translation, Vec3f& Rotation, Vec3f& Scale)
+{
+    Mat4f CopyM = M;
+    Scale._data[0] = CopyM.V.Right.Length();
+    Scale._data[1] = CopyM.V.Up.Length();
+    Scale._data[2] = CopyM.V.Dir.Length();
+
+    CopyM.OrthoNormalize();
+
+    Rotation._data[0] = atan2f(CopyM._data4x4[1][2], CopyM._data4x4[2][2]);
+    Rotation._data[1] = atan2f(-CopyM._data4x4[0][2], Sqrt(CopyM._data4x4[1][2] * CopyM._data4x4[1][2] + CopyM._data4x4[2][2] * CopyM._data4x4[2][2]));
+    Rotation._data[2] = atan2f(CopyM._data4x4[0][1], CopyM._data4x4[0][0]);
+
+    Translation = Vec3f{ CopyM.V.Position.x, CopyM.V.Position.y, CopyM.V.Position.z };
+}
+
+// Same as the generic Decompose, but the scale and the normalization of the three axes are done in one go
+KRAFT_INLINE static void DecomposeMat4f(const Mat4f& M, Vec3f& Translation, Vec3f& Rotation, Vec3f& Scale)
+{
+#if defined(KRAFT_SIMD_SSE)
+    __m128 Right = _mm_loadu_ps(M._data + 0);
+    __m128 Up = _mm_loadu_ps(M._data + 4);
+    __m128 Dir = _mm_loadu_ps(M._data + 8);
+    __m128 W = _mm_setzero_ps();
+
+    // Transposed, the squared lengths of the axes are simple adds
+    __m128 X = Right, Y = Up, Z = Dir;
+    _MM_TRANSPOSE4_PS(X, Y, Z, W);
+    __m128 Lengths = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(X, X), _mm_mul_ps(Y, Y)), _mm_mul_ps(Z, Z)));
+
+    f32 L[4];
+    _mm_storeu_ps(L, Lengths);
+    Scale = Vec3f{ L[0], L[1], L[2] };
+
+    // Rows of the rotation part, only the elements the angles need are kept
+    f32 R0[4], R1[4], R2[4];
+    _mm_storeu_ps(R0, _mm_div_ps(Right, _mm_shuffle_ps(Lengths, Lengths, _MM_SHUFFLE(0, 0, 0, 0))));
+    _mm_storeu_ps(R1, _mm_div_ps(Up, _mm_shuffle_ps(Lengths, Lengths, _MM_SHUFFLE(1, 1, 1, 1))));
+    _mm_storeu_ps(R2, _mm_div_ps(Dir, _mm_shuffle_ps(Lengths, Lengths, _MM_SHUFFLE(2, 2, 2, 2))));
+
+    Rotation._data[0] = atan2f(R1[2], R2[2]);
+    Rotation._data[1] = atan2f(-R0[2], Sqrt(R1[2] * R1[2] + R2[2] * R2[2]));
+    Rotation._data[2] = atan2f(R0[1], R0[0]);
+
+    Translation = Vec3f{ M._data4x4[3][0], M._data4x4[3][1], M._data4x4[3][2] };
+#else
+    DecomposeScalar(M, Translation, Rotation, Scale);
+#endif
+}
+
+template<>
+KRAFT_INLINE void Mat4f::Decompose(Vec3f& Translation, Vec3f& Rotation, Vec3f& Scale)
+{
+    DecomposeMat4f(*this, Translation, Rotation, Scale);
+}
+
+template<>
+KRAFT_INLINE void Mat4f::Decompose(const Mat4f& M, Vec3f& Translation, Vec3f& Rotation, Vec3f& Scale)
+{
+    DecomposeMat4f(M, Translation, Rotation, Scale);
+}
+
 // Matrix multiplication
 template<typename T, int rows, int cols>
 Matrix<T, rows, cols> operator*(const Matrix<T, rows, cols>& a, const Matrix<T, rows, cols>& b)
@@ -952,7 +1023,7 @@ Matrix<T, 4, 4> Inverse(const Matrix<T, 4, 4>& Input)
         // Subtract this row from others to make the rest of column j zero
         for (int i = 0; i < 4; ++i)
         {
-            if ((i != j) && (abs(a[i][j]) > math::Epsilon)) // Skip rows with zero already in this column
+            if ((i != j) && (Abs(a[i][j]) > math::Epsilon)) // Skip rows with zero already in this column
             {
                 T scale = -a[i][j];
                 for (int k = 0; k < 4; k++)
@@ -1026,6 +1097,292 @@ Matrix<T, 4, 4> Inverse(const Matrix<T, 4, 4>& Input)
 #endif
 }
 
+// Inverse of a matrix that only has a linear part (rotation, scale, shear) and a translation, much cheaper than the
+// general inverse. The last column has to be (0, 0, 0, 1).
+template<typename T>
+Matrix<T, 4, 4> AffineInverse(const Matrix<T, 4, 4>& In)
+{
+    // With rows r0, r1, r2 the inverse of the 3x3 part has the columns (r1 x r2), (r2 x r0), (r0 x r1) over the determinant
+    Vector<T, 3> R0 = { In[0][0], In[0][1], In[0][2] };
+    Vector<T, 3> R1 = { In[1][0], In[1][1], In[1][2] };
+    Vector<T, 3> R2 = { In[2][0], In[2][1], In[2][2] };
+    Vector<T, 3> C0 = Cross(R1, R2);
+    Vector<T, 3> C1 = Cross(R2, R0);
+    Vector<T, 3> C2 = Cross(R0, R1);
+    T            InvDeterminant = T(1) / Dot(R0, C0);
+
+    Matrix<T, 4, 4> Out(Identity);
+    for (int i = 0; i < 3; i++)
+    {
+        Out[i][0] = C0[i] * InvDeterminant;
+        Out[i][1] = C1[i] * InvDeterminant;
+        Out[i][2] = C2[i] * InvDeterminant;
+    }
+
+    for (int j = 0; j < 3; j++)
+    {
+        Out[3][j] = -(In[3][0] * Out[0][j] + In[3][1] * Out[1][j] + In[3][2] * Out[2][j]);
+    }
+
+    return Out;
+}
+
+// Transforms a point, as the row vector (p, 1), by the matrix. There is no perspective divide.
+template<typename T>
+Vector<T, 3> TransformPoint(const Matrix<T, 4, 4>& M, Vector<T, 3> P)
+{
+    Vector<T, 3> Out;
+    for (int j = 0; j < 3; j++)
+        Out[j] = P[0] * M[0][j] + P[1] * M[1][j] + P[2] * M[2][j] + M[3][j];
+
+    return Out;
+}
+
+// Transforms a direction, as the row vector (v, 0), by the matrix; the translation is ignored
+template<typename T>
+Vector<T, 3> TransformVector(const Matrix<T, 4, 4>& M, Vector<T, 3> V)
+{
+    Vector<T, 3> Out;
+    for (int j = 0; j < 3; j++)
+        Out[j] = V[0] * M[0][j] + V[1] * M[1][j] + V[2] * M[2][j];
+
+    return Out;
+}
+
+//
+// f32 4x4 overloads, implemented with the widest instruction set enabled at compile time. Being plain functions, they
+// are picked over the templates above, which stay around as the scalar reference (call them with an explicit
+// template argument, `Inverse<f32>(M)`, to compare against). With KRAFT_NO_SIMD they forward to the templates.
+// NEON only covers the multiply and the transforms; Inverse, AffineInverse and Decompose use the scalar code there.
+//
+
+#if defined(KRAFT_SIMD_SSE)
+// Row i of the product is the sum of the rows of b, weighted by the elements of row i of a
+KRAFT_INLINE static __m128 SSELinearCombine(__m128 Weights, __m128 B0, __m128 B1, __m128 B2, __m128 B3)
+{
+    __m128 Result = _mm_mul_ps(_mm_shuffle_ps(Weights, Weights, _MM_SHUFFLE(0, 0, 0, 0)), B0);
+    Result = _mm_add_ps(Result, _mm_mul_ps(_mm_shuffle_ps(Weights, Weights, _MM_SHUFFLE(1, 1, 1, 1)), B1));
+    Result = _mm_add_ps(Result, _mm_mul_ps(_mm_shuffle_ps(Weights, Weights, _MM_SHUFFLE(2, 2, 2, 2)), B2));
+    Result = _mm_add_ps(Result, _mm_mul_ps(_mm_shuffle_ps(Weights, Weights, _MM_SHUFFLE(3, 3, 3, 3)), B3));
+    return Result;
+}
+
+// 2x2 matrices packed as (m00, m01, m10, m11); used by the block inverse below
+KRAFT_INLINE static __m128 SSEMat2Mul(__m128 A, __m128 B)
+{
+    return _mm_add_ps(
+        _mm_mul_ps(A, _mm_shuffle_ps(B, B, _MM_SHUFFLE(3, 0, 3, 0))), _mm_mul_ps(_mm_shuffle_ps(A, A, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(B, B, _MM_SHUFFLE(1, 2, 1, 2)))
+    );
+}
+
+// Adjugate(A) * B
+KRAFT_INLINE static __m128 SSEMat2AdjMul(__m128 A, __m128 B)
+{
+    return _mm_sub_ps(
+        _mm_mul_ps(_mm_shuffle_ps(A, A, _MM_SHUFFLE(0, 0, 3, 3)), B), _mm_mul_ps(_mm_shuffle_ps(A, A, _MM_SHUFFLE(2, 2, 1, 1)), _mm_shuffle_ps(B, B, _MM_SHUFFLE(1, 0, 3, 2)))
+    );
+}
+
+// A * Adjugate(B)
+KRAFT_INLINE static __m128 SSEMat2MulAdj(__m128 A, __m128 B)
+{
+    return _mm_sub_ps(
+        _mm_mul_ps(A, _mm_shuffle_ps(B, B, _MM_SHUFFLE(0, 3, 0, 3))), _mm_mul_ps(_mm_shuffle_ps(A, A, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(B, B, _MM_SHUFFLE(1, 2, 1, 2)))
+    );
+}
+
+KRAFT_INLINE static __m128 SSECross(__m128 A, __m128 B)
+{
+    __m128 AYZX = _mm_shuffle_ps(A, A, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 BYZX = _mm_shuffle_ps(B, B, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 C = _mm_sub_ps(_mm_mul_ps(A, BYZX), _mm_mul_ps(AYZX, B));
+    return _mm_shuffle_ps(C, C, _MM_SHUFFLE(3, 0, 2, 1));
+}
+#endif
+
+KRAFT_INLINE Mat4f operator*(const Mat4f& a, const Mat4f& b)
+{
+    Mat4f out;
+#if defined(KRAFT_SIMD_AVX)
+    // Two rows of the result per register, each 128 bit lane works on its own row
+    __m256 B0 = _mm256_broadcast_ps((const __m128*)(b._data + 0));
+    __m256 B1 = _mm256_broadcast_ps((const __m128*)(b._data + 4));
+    __m256 B2 = _mm256_broadcast_ps((const __m128*)(b._data + 8));
+    __m256 B3 = _mm256_broadcast_ps((const __m128*)(b._data + 12));
+    for (int i = 0; i < 16; i += 8)
+    {
+        __m256 A = _mm256_loadu_ps(a._data + i);
+        __m256 Result = _mm256_mul_ps(_mm256_shuffle_ps(A, A, _MM_SHUFFLE(0, 0, 0, 0)), B0);
+        Result = _mm256_add_ps(Result, _mm256_mul_ps(_mm256_shuffle_ps(A, A, _MM_SHUFFLE(1, 1, 1, 1)), B1));
+        Result = _mm256_add_ps(Result, _mm256_mul_ps(_mm256_shuffle_ps(A, A, _MM_SHUFFLE(2, 2, 2, 2)), B2));
+        Result = _mm256_add_ps(Result, _mm256_mul_ps(_mm256_shuffle_ps(A, A, _MM_SHUFFLE(3, 3, 3, 3)), B3));
+        _mm256_storeu_ps(out._data + i, Result);
+    }
+#elif defined(KRAFT_SIMD_SSE)
+    __m128 B0 = _mm_loadu_ps(b._data + 0);
+    __m128 B1 = _mm_loadu_ps(b._data + 4);
+    __m128 B2 = _mm_loadu_ps(b._data + 8);
+    __m128 B3 = _mm_loadu_ps(b._data + 12);
+    for (int i = 0; i < 16; i += 4)
+    {
+        _mm_storeu_ps(out._data + i, SSELinearCombine(_mm_loadu_ps(a._data + i), B0, B1, B2, B3));
+    }
+#elif defined(KRAFT_SIMD_NEON)
+    float32x4_t B0 = vld1q_f32(b._data + 0);
+    float32x4_t B1 = vld1q_f32(b._data + 4);
+    float32x4_t B2 = vld1q_f32(b._data + 8);
+    float32x4_t B3 = vld1q_f32(b._data + 12);
+    for (int i = 0; i < 16; i += 4)
+    {
+        float32x4_t A = vld1q_f32(a._data + i);
+        float32x4_t Result = vmulq_laneq_f32(B0, A, 0);
+        Result = vfmaq_laneq_f32(Result, B1, A, 1);
+        Result = vfmaq_laneq_f32(Result, B2, A, 2);
+        Result = vfmaq_laneq_f32(Result, B3, A, 3);
+        vst1q_f32(out._data + i, Result);
+    }
+#else
+    out = operator*<f32>(a, b);
+#endif
+
+    return out;
+}
+
+KRAFT_INLINE Mat4f Inverse(const Mat4f& In)
+{
+#if defined(KRAFT_SIMD_SSE)
+    // Block inverse; the matrix is split into the 2x2 matrices | A B |
+    //                                                         | C D |
+    __m128 Row0 = _mm_loadu_ps(In._data + 0);
+    __m128 Row1 = _mm_loadu_ps(In._data + 4);
+    __m128 Row2 = _mm_loadu_ps(In._data + 8);
+    __m128 Row3 = _mm_loadu_ps(In._data + 12);
+
+    __m128 A = _mm_movelh_ps(Row0, Row1);
+    __m128 B = _mm_movehl_ps(Row1, Row0);
+    __m128 C = _mm_movelh_ps(Row2, Row3);
+    __m128 D = _mm_movehl_ps(Row3, Row2);
+
+    // (|A|, |B|, |C|, |D|)
+    __m128 SubDeterminants = _mm_sub_ps(
+        _mm_mul_ps(_mm_shuffle_ps(Row0, Row2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(Row1, Row3, _MM_SHUFFLE(3, 1, 3, 1))),
+        _mm_mul_ps(_mm_shuffle_ps(Row0, Row2, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(Row1, Row3, _MM_SHUFFLE(2, 0, 2, 0)))
+    );
+    __m128 DetA = _mm_shuffle_ps(SubDeterminants, SubDeterminants, _MM_SHUFFLE(0, 0, 0, 0));
+    __m128 DetB = _mm_shuffle_ps(SubDeterminants, SubDeterminants, _MM_SHUFFLE(1, 1, 1, 1));
+    __m128 DetC = _mm_shuffle_ps(SubDeterminants, SubDeterminants, _MM_SHUFFLE(2, 2, 2, 2));
+    __m128 DetD = _mm_shuffle_ps(SubDeterminants, SubDeterminants, _MM_SHUFFLE(3, 3, 3, 3));
+
+    __m128 D_C = SSEMat2AdjMul(D, C);
+    __m128 A_B = SSEMat2AdjMul(A, B);
+    __m128 X = _mm_sub_ps(_mm_mul_ps(DetD, A), SSEMat2Mul(B, D_C));
+    __m128 W = _mm_sub_ps(_mm_mul_ps(DetA, D), SSEMat2Mul(C, A_B));
+    __m128 Y = _mm_sub_ps(_mm_mul_ps(DetB, C), SSEMat2MulAdj(D, A_B));
+    __m128 Z = _mm_sub_ps(_mm_mul_ps(DetC, B), SSEMat2MulAdj(A, D_C));
+
+    // |M| = |A||D| + |B||C| - tr((A#B)(D#C))
+    __m128 Trace = _mm_mul_ps(A_B, _mm_shuffle_ps(D_C, D_C, _MM_SHUFFLE(3, 1, 2, 0)));
+    Trace = _mm_add_ps(Trace, _mm_movehl_ps(Trace, Trace));
+    Trace = _mm_add_ps(Trace, _mm_shuffle_ps(Trace, Trace, _MM_SHUFFLE(1, 1, 1, 1)));
+    Trace = _mm_shuffle_ps(Trace, Trace, _MM_SHUFFLE(0, 0, 0, 0));
+    __m128 Determinant = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(DetA, DetD), _mm_mul_ps(DetB, DetC)), Trace);
+
+    __m128 InvDeterminant = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), Determinant);
+    X = _mm_mul_ps(X, InvDeterminant);
+    Y = _mm_mul_ps(Y, InvDeterminant);
+    Z = _mm_mul_ps(Z, InvDeterminant);
+    W = _mm_mul_ps(W, InvDeterminant);
+
+    // The adjugate of every block is folded into the final shuffle
+    Mat4f Out;
+    _mm_storeu_ps(Out._data + 0, _mm_shuffle_ps(X, Y, _MM_SHUFFLE(1, 3, 1, 3)));
+    _mm_storeu_ps(Out._data + 4, _mm_shuffle_ps(X, Y, _MM_SHUFFLE(0, 2, 0, 2)));
+    _mm_storeu_ps(Out._data + 8, _mm_shuffle_ps(Z, W, _MM_SHUFFLE(1, 3, 1, 3)));
+    _mm_storeu_ps(Out._data + 12, _mm_shuffle_ps(Z, W, _MM_SHUFFLE(0, 2, 0, 2)));
+    return Out;
+#else
+    return Inverse<f32>(In);
+#endif
+}
+
+KRAFT_INLINE Mat4f AffineInverse(const Mat4f& In)
+{
+#if defined(KRAFT_SIMD_SSE)
+    __m128 R0 = _mm_loadu_ps(In._data + 0);
+    __m128 R1 = _mm_loadu_ps(In._data + 4);
+    __m128 R2 = _mm_loadu_ps(In._data + 8);
+    __m128 T = _mm_loadu_ps(In._data + 12);
+
+    __m128 C0 = SSECross(R1, R2);
+    __m128 C1 = SSECross(R2, R0);
+    __m128 C2 = SSECross(R0, R1);
+
+    __m128 Dot = _mm_mul_ps(R0, C0);
+    Dot = _mm_add_ps(_mm_add_ps(_mm_shuffle_ps(Dot, Dot, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(Dot, Dot, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(Dot, Dot, _MM_SHUFFLE(2, 2, 2, 2)));
+    __m128 InvDeterminant = _mm_div_ps(_mm_set1_ps(1.0f), Dot);
+
+    // The cross products are the columns of the inverse; the cross product of two vectors with w = 0 also has w = 0
+    __m128 Inv0 = _mm_mul_ps(C0, InvDeterminant);
+    __m128 Inv1 = _mm_mul_ps(C1, InvDeterminant);
+    __m128 Inv2 = _mm_mul_ps(C2, InvDeterminant);
+    __m128 Inv3 = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(Inv0, Inv1, Inv2, Inv3);
+
+    __m128 Translation = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(T, T, _MM_SHUFFLE(0, 0, 0, 0)), Inv0), _mm_mul_ps(_mm_shuffle_ps(T, T, _MM_SHUFFLE(1, 1, 1, 1)), Inv1)),
+        _mm_mul_ps(_mm_shuffle_ps(T, T, _MM_SHUFFLE(2, 2, 2, 2)), Inv2)
+    );
+
+    Mat4f Out;
+    _mm_storeu_ps(Out._data + 0, Inv0);
+    _mm_storeu_ps(Out._data + 4, Inv1);
+    _mm_storeu_ps(Out._data + 8, Inv2);
+    _mm_storeu_ps(Out._data + 12, _mm_sub_ps(_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f), Translation));
+    return Out;
+#else
+    return AffineInverse<f32>(In);
+#endif
+}
+
+KRAFT_INLINE Vec3f TransformPoint(const Mat4f& M, Vec3f P)
+{
+#if defined(KRAFT_SIMD_SSE)
+    __m128 Result = SSELinearCombine(
+        _mm_setr_ps(P.x, P.y, P.z, 1.0f), _mm_loadu_ps(M._data + 0), _mm_loadu_ps(M._data + 4), _mm_loadu_ps(M._data + 8), _mm_loadu_ps(M._data + 12)
+    );
+    f32 Out[4];
+    _mm_storeu_ps(Out, Result);
+    return Vec3f{ Out[0], Out[1], Out[2] };
+#elif defined(KRAFT_SIMD_NEON)
+    float32x4_t Result = vmulq_n_f32(vld1q_f32(M._data + 0), P.x);
+    Result = vfmaq_n_f32(Result, vld1q_f32(M._data + 4), P.y);
+    Result = vfmaq_n_f32(Result, vld1q_f32(M._data + 8), P.z);
+    Result = vaddq_f32(Result, vld1q_f32(M._data + 12));
+    return Vec3f{ vgetq_lane_f32(Result, 0), vgetq_lane_f32(Result, 1), vgetq_lane_f32(Result, 2) };
+#else
+    return TransformPoint<f32>(M, P);
+#endif
+}
+
+KRAFT_INLINE Vec3f TransformVector(const Mat4f& M, Vec3f V)
+{
+#if defined(KRAFT_SIMD_SSE)
+    __m128 Result = SSELinearCombine(
+        _mm_setr_ps(V.x, V.y, V.z, 0.0f), _mm_loadu_ps(M._data + 0), _mm_loadu_ps(M._data + 4), _mm_loadu_ps(M._data + 8), _mm_setzero_ps()
+    );
+    f32 Out[4];
+    _mm_storeu_ps(Out, Result);
+    return Vec3f{ Out[0], Out[1], Out[2] };
+#elif defined(KRAFT_SIMD_NEON)
+    float32x4_t Result = vmulq_n_f32(vld1q_f32(M._data + 0), V.x);
+    Result = vfmaq_n_f32(Result, vld1q_f32(M._data + 4), V.y);
+    Result = vfmaq_n_f32(Result, vld1q_f32(M._data + 8), V.z);
+    return Vec3f{ vgetq_lane_f32(Result, 0), vgetq_lane_f32(Result, 1), vgetq_lane_f32(Result, 2) };
+#else
+    return TransformVector<f32>(M, V);
+#endif
+}
+
 template<typename T, int rows, int cols>
 void PrintMatrix(Matrix<T, rows, cols> in)
 {
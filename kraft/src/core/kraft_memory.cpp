@@ -132,23 +132,24 @@ KRAFT_API void PrintDebugMemoryInfo()
     const size_t mib = kib * kib;
     const size_t gib = mib * kib;
 
-    if (g_MemoryStats.Allocated > gib)
+    u64 allocated = g_MemoryStats.Allocated.load();
+    if (allocated > gib)
     {
-        KINFO("Total memory usage - %.3f GB", g_MemoryStats.Allocated / (float)gib);
+        KINFO("Total memory usage - %.3f GB", allocated / (float)gib);
     }
-    else if (g_MemoryStats.Allocated > mib)
+    else if (allocated > mib)
     {
-        KINFO("Total memory usage - %.3f MB", g_MemoryStats.Allocated / (float)mib);
+        KINFO("Total memory usage - %.3f MB", allocated / (float)mib);
     }
     else
     {
-        KINFO("Total memory usage - %.3f KB", g_MemoryStats.Allocated / (float)kib);
+        KINFO("Total memory usage - %.3f KB", allocated / (float)kib);
     }
 
     KINFO("Memory Stats: ");
     for (int i = 0; i < MemoryTag::MEMORY_TAG_NUM_COUNT; i++)
     {
-        KINFO("\t[%s]: %d bytes", g_TagStrings[i], g_MemoryStats.AllocationsByTag[i]);
+        KINFO("\t[%s]: %d bytes", g_TagStrings[i], g_MemoryStats.AllocationsByTag[i].load());
     }
 }
 
@@ -160,10 +161,11 @@ KRAFT_API MemoryStatsOutput GetMemoryStats()
     const u64 mib = kib * kib;
     const u64 gib = mib * kib;
 
-    Output.AllocatedBytes = g_MemoryStats.Allocated;
-    Output.AllocatedKiB = g_MemoryStats.Allocated / (float)kib;
-    Output.AllocatedMiB = g_MemoryStats.Allocated / (float)mib;
-    Output.AllocatedGiB = g_MemoryStats.Allocated / (float)gib;
+    u64 allocated = g_MemoryStats.Allocated.load();
+    Output.AllocatedBytes = allocated;
+    Output.AllocatedKiB = allocated / (float)kib;
+    Output.AllocatedMiB = allocated / (float)mib;
+    Output.AllocatedGiB = allocated / (float)gib;
 
     return Output;
 }
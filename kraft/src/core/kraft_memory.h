@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 namespace kraft {
 
 enum MemoryTag : int
@@ -25,10 +27,11 @@ enum MemoryTag : int
 static const char g_TagStrings[MEMORY_TAG_NUM_COUNT][255] = { "UNKNOWN        ", "STRING         ", "ARRAY          ", "BUFFER         ", "RENDERER       ", "FILE_BUFFER    ", "TEXTURE        ",
                                                               "TEXTURE_SYSTEM ", "MATERIAL_SYSTEM", "GEOMETRY_SYSTEM", "SHADER_SYSTEM  ", "SHADER_FX      ", "RESOURCE_POOL  ", "ASSET_DATABASE " };
 
+// Updated from every thread that allocates, hence the atomics
 struct MemoryStats
 {
-    u64 Allocated = 0;
-    u64 AllocationsByTag[MEMORY_TAG_NUM_COUNT] = { 0 };
+    std::atomic<u64> Allocated = 0;
+    std::atomic<u64> AllocationsByTag[MEMORY_TAG_NUM_COUNT] = {};
 
     ~MemoryStats();
 };
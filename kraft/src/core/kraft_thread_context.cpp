@@ -21,8 +21,9 @@ kraft_internal ThreadContext* CreateThreadContext()
 
 kraft_internal void DestroyThreadContext(ThreadContext* ctx)
 {
-    DestroyArena(ctx->scratch_arenas[0]);
+    // The context itself lives in the first arena, so that one has to go last
     DestroyArena(ctx->scratch_arenas[1]);
+    DestroyArena(ctx->scratch_arenas[0]);
 }
 
 kraft_internal void SetCurrentThreadContext(ThreadContext* ctx)
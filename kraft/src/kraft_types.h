@@ -37,7 +37,12 @@ struct RendererOptions
     u16                 TextureCacheSize = 512;
     u16                 MaxMaterials = 1024;
     u16                 MaterialBufferSize = 64; // Maximum size of a single material in bytes
+    u32                 MaxInstancesPerFrame = 16384; // Instances that instanced draws can use in a single frame
+    u32                 MaxSpritesPerFrame = 65536; // Quads that sprite batches can draw in a single frame
+    bool                GPUCulling = false; // Frustum and occlusion culling of instanced draws on the GPU, for surfaces with a sampled depth attachment
+    bool                ParallelRecording = true; // Record the draws of large surfaces on the job threads, see KRAFT_RENDERER_RECORDING_CHUNK_SIZE
     u8                  MSAASamples = 1;         // 1 = no MSAA, 2/4/8 = MSAA sample count
+    const char*         PipelineCachePath = "pipeline_cache.bin"; // Relative to the working directory, nullptr disables the on-disk cache
 };
 
 #endif
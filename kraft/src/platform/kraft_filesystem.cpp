@@ -124,14 +124,14 @@ bool ReadAllBytes(FileHandle* handle, u8** out_buffer, u64* bytes_read)
     return true;
 }
 
-buffer ReadAllBytes(ArenaAllocator* arena, FileHandle* handle)
+buffer ReadAllBytes(ArenaAllocator* arena, FileHandle* handle, u64 alignment)
 {
     fseek(handle->Handle, 0, SEEK_END);
     u64 size = ftell(handle->Handle);
     rewind(handle->Handle);
 
     buffer output = {};
-    output.ptr = ArenaPushArray(arena, u8, size);
+    output.ptr = (u8*)arena->Push(size, alignment, true);
     output.count = size;
 
     size_t read = fread(output.ptr, 1, size, handle->Handle);
@@ -140,7 +140,7 @@ buffer ReadAllBytes(ArenaAllocator* arena, FileHandle* handle)
     return output;
 }
 
-buffer ReadAllBytes(ArenaAllocator* arena, String8 path)
+buffer ReadAllBytes(ArenaAllocator* arena, String8 path, u64 alignment)
 {
     FileHandle handle = {};
     if (!OpenFile(path, FILE_OPEN_MODE_READ, true, &handle))
@@ -148,7 +148,7 @@ buffer ReadAllBytes(ArenaAllocator* arena, String8 path)
         return {};
     }
 
-    buffer result = ReadAllBytes(arena, &handle);
+    buffer result = ReadAllBytes(arena, &handle, alignment);
     CloseFile(&handle);
 
     return result;
@@ -265,6 +265,15 @@ u64 GetFileModifiedTime(String8 path)
 #endif
 }
 
+bool MakeDirectory(String8 path)
+{
+#ifdef KRAFT_PLATFORM_WINDOWS
+    return CreateDirectoryA((const char*)path.ptr, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+    return mkdir((const char*)path.ptr, 0755) == 0 || errno == EEXIST;
+#endif
+}
+
 String8 PathJoin(ArenaAllocator* arena, String8 path1, String8 path2)
 {
     String8 result = {};
@@ -75,11 +75,13 @@ KRAFT_API String8 AbsolutePath(ArenaAllocator* arena, String8 path);
 // out_buffer, if null is allocated and must be freed by the caller
 KRAFT_API bool ReadAllBytes(FileHandle* handle, u8** out_buffer, u64* bytes_read = nullptr);
 
-// Reads all data from the given file handle and returns a buffer allocated in the provided arena
-KRAFT_API buffer ReadAllBytes(ArenaAllocator* arena, FileHandle* handle);
+// Reads all data from the given file handle and returns a buffer allocated in the provided arena, starting at a
+// multiple of [`alignment`]
+KRAFT_API buffer ReadAllBytes(ArenaAllocator* arena, FileHandle* handle, u64 alignment = 1);
 
-// Reads all data from the file at [`path`] and returns a buffer allocated in the provided arena
-KRAFT_API buffer ReadAllBytes(ArenaAllocator* arena, String8 path);
+// Reads all data from the file at [`path`] and returns a buffer allocated in the provided arena, starting at a
+// multiple of [`alignment`]
+KRAFT_API buffer ReadAllBytes(ArenaAllocator* arena, String8 path, u64 alignment = 1);
 
 // Writes the provided [`buffer`] of [`size`] to the file [`handle`]
 KRAFT_API bool WriteFile(FileHandle* handle, const u8* buffer, u64 size);
@@ -88,6 +90,10 @@ KRAFT_API bool WriteFile(FileHandle* handle, const u8* buffer, u64 size);
 // Returns 0 if the file doesn't exist or an error occurs
 KRAFT_API u64 GetFileModifiedTime(String8 path);
 
+// Creates the directory at [`path`], its parent has to exist already
+// Returns true if the directory exists afterwards
+KRAFT_API bool MakeDirectory(String8 path);
+
 // Platform dependent APIs
 KRAFT_API u32       GetFileCount(String8 path);
 KRAFT_API Directory ReadDir(ArenaAllocator* arena, String8 path);
@@ -101,6 +101,14 @@ struct KRAFT_API Platform
     static void* MemSet(void* region, int value, u64 size);
     static int   MemCmp(const void* a, const void* b, u64 size);
 
+    // Virtual Memory
+    static u64   GetPageSize();
+    static void* MemReserve(u64 size);
+    static bool  MemCommit(void* region, u64 size);
+    static void  MemDecommit(void* region, u64 size);
+    static void  MemRelease(void* region, u64 size);
+    static void  MemAdviseHugePages(void* region, u64 size);
+
     // Console
     // Foreground colors
     static const int ConsoleColorBlack;
@@ -8,6 +8,7 @@
 
 #include <stdlib.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <string.h>
 #include <stdio.h>
 #include <time.h>
@@ -111,6 +112,42 @@ int Platform::MemCmp(const void* a, const void* b, uint64_t size)
     return memcmp(a, b, size);
 }
 
+// ------------------------------------------
+// Virtual Memory Specific Functions
+// ------------------------------------------
+
+u64 Platform::GetPageSize()
+{
+    return (u64)sysconf(_SC_PAGESIZE);
+}
+
+void* Platform::MemReserve(u64 size)
+{
+    void* region = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return region == MAP_FAILED ? nullptr : region;
+}
+
+bool Platform::MemCommit(void* region, u64 size)
+{
+    return mprotect(region, size, PROT_READ | PROT_WRITE) == 0;
+}
+
+void Platform::MemDecommit(void* region, u64 size)
+{
+    madvise(region, size, MADV_DONTNEED);
+    mprotect(region, size, PROT_NONE);
+}
+
+void Platform::MemRelease(void* region, u64 size)
+{
+    munmap(region, size);
+}
+
+void Platform::MemAdviseHugePages(void* region, u64 size)
+{
+    madvise(region, size, MADV_HUGEPAGE);
+}
+
 // ------------------------------------------
 // Console Specific Functions
 // ------------------------------------------
@@ -7,6 +7,7 @@
 #include <GLFW/glfw3.h>
 
 #include <unistd.h>
+#include <sys/mman.h>
 #include <memory>
 #include <mach/mach_time.h>
 
@@ -113,6 +114,42 @@ int Platform::MemCmp(const void* a, const void* b, uint64_t size)
     return memcmp(a, b, size);
 }
 
+// ------------------------------------------
+// Virtual Memory Specific Functions
+// ------------------------------------------
+
+u64 Platform::GetPageSize()
+{
+    return (u64)sysconf(_SC_PAGESIZE);
+}
+
+void* Platform::MemReserve(u64 size)
+{
+    void* region = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return region == MAP_FAILED ? nullptr : region;
+}
+
+bool Platform::MemCommit(void* region, u64 size)
+{
+    return mprotect(region, size, PROT_READ | PROT_WRITE) == 0;
+}
+
+void Platform::MemDecommit(void* region, u64 size)
+{
+    madvise(region, size, MADV_DONTNEED);
+    mprotect(region, size, PROT_NONE);
+}
+
+void Platform::MemRelease(void* region, u64 size)
+{
+    munmap(region, size);
+}
+
+void Platform::MemAdviseHugePages(void* region, u64 size)
+{
+    // Transparent huge pages are not exposed on macOS
+}
+
 // ------------------------------------------
 // Console Specific Functions
 // ------------------------------------------
@@ -178,6 +178,43 @@ int Platform::MemCmp(const void* a, const void* b, uint64_t size)
     return memcmp(a, b, size);
 }
 
+// ------------------------------------------
+// Virtual Memory Specific Functions
+// ------------------------------------------
+
+u64 Platform::GetPageSize()
+{
+    SYSTEM_INFO SystemInfo;
+    GetSystemInfo(&SystemInfo);
+
+    return SystemInfo.dwPageSize;
+}
+
+void* Platform::MemReserve(u64 size)
+{
+    return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+bool Platform::MemCommit(void* region, u64 size)
+{
+    return VirtualAlloc(region, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+}
+
+void Platform::MemDecommit(void* region, u64 size)
+{
+    VirtualFree(region, size, MEM_DECOMMIT);
+}
+
+void Platform::MemRelease(void* region, u64 size)
+{
+    VirtualFree(region, 0, MEM_RELEASE);
+}
+
+void Platform::MemAdviseHugePages(void* region, u64 size)
+{
+    // Large pages on windows require SeLockMemoryPrivilege and have to be requested at reservation time
+}
+
 // ------------------------------------------
 // Console Specific Functions
 // ------------------------------------------
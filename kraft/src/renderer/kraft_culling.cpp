@@ -0,0 +1,228 @@
+#include "kraft_culling.h"
+
+#include <renderer/kraft_renderer_types.h>
+
+#include <cfloat>
+
+#if defined(KRAFT_SIMD_AVX)
+#include <immintrin.h>
+#elif defined(KRAFT_SIMD_SSE)
+#include <emmintrin.h>
+#endif
+
+namespace kraft::r {
+
+Frustum FrustumFromViewProjection(const Mat4f& m)
+{
+    // Our matrices transform row vectors, so clip = p * m and every clip space coordinate is a dot product with
+    // a column of the matrix. The near plane is extracted for a [-w, w] depth range, which is also a valid
+    // (if slightly looser) plane for projections that map depth to [0, w].
+    Vec4f column[4];
+    for (int i = 0; i < 4; i++)
+    {
+        column[i] = Vec4f{ m[0][i], m[1][i], m[2][i], m[3][i] };
+    }
+
+    Frustum frustum;
+    frustum.Planes[Frustum::Left] = column[3] + column[0];
+    frustum.Planes[Frustum::Right] = column[3] - column[0];
+    frustum.Planes[Frustum::Bottom] = column[3] + column[1];
+    frustum.Planes[Frustum::Top] = column[3] - column[1];
+    frustum.Planes[Frustum::Near] = column[3] + column[2];
+    frustum.Planes[Frustum::Far] = column[3] - column[2];
+
+    for (int i = 0; i < Frustum::Count; i++)
+    {
+        Vec4f& plane = frustum.Planes[i];
+        f32    length = Sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+
+        // A degenerate projection leaves the plane at zero, which never culls anything
+        if (length > 0.0f)
+        {
+            plane = plane * (1.0f / length);
+        }
+    }
+
+    return frustum;
+}
+
+// Largest scale of the transform along any of its axes
+static KRAFT_INLINE f32 MaxScale(const Mat4f& m)
+{
+    f32 max_scale_squared = 0.0f;
+    for (int row = 0; row < 3; row++)
+    {
+        f32 scale_squared = m[row][0] * m[row][0] + m[row][1] * m[row][1] + m[row][2] * m[row][2];
+        max_scale_squared = math::Max(max_scale_squared, scale_squared);
+    }
+
+    return Sqrt(max_scale_squared);
+}
+
+void WriteWorldBounds(const GeometryBounds& bounds, const Mat4f& m, CullingBounds* out, u32 index)
+{
+    if (!bounds.IsValid())
+    {
+        out->CenterX[index] = m[3][0];
+        out->CenterY[index] = m[3][1];
+        out->CenterZ[index] = m[3][2];
+        out->ExtentX[index] = FLT_MAX;
+        out->ExtentY[index] = FLT_MAX;
+        out->ExtentZ[index] = FLT_MAX;
+        out->Radius[index] = FLT_MAX;
+        return;
+    }
+
+    const Vec3f& c = bounds.Center;
+    const Vec3f& e = bounds.Extents;
+
+    out->CenterX[index] = c.x * m[0][0] + c.y * m[1][0] + c.z * m[2][0] + m[3][0];
+    out->CenterY[index] = c.x * m[0][1] + c.y * m[1][1] + c.z * m[2][1] + m[3][1];
+    out->CenterZ[index] = c.x * m[0][2] + c.y * m[1][2] + c.z * m[2][2] + m[3][2];
+
+    // Extents of the box that encloses the transformed box
+    out->ExtentX[index] = e.x * Abs(m[0][0]) + e.y * Abs(m[1][0]) + e.z * Abs(m[2][0]);
+    out->ExtentY[index] = e.x * Abs(m[0][1]) + e.y * Abs(m[1][1]) + e.z * Abs(m[2][1]);
+    out->ExtentZ[index] = e.x * Abs(m[0][2]) + e.y * Abs(m[1][2]) + e.z * Abs(m[2][2]);
+
+    // The sphere grows with the largest scale of the transform
+    out->Radius[index] = bounds.Radius * MaxScale(m);
+}
+
+Vec4f WorldBoundingSphere(const GeometryBounds& bounds, const Mat4f& m)
+{
+    if (!bounds.IsValid())
+    {
+        return Vec4f{ m[3][0], m[3][1], m[3][2], -1.0f };
+    }
+
+    const Vec3f& c = bounds.Center;
+    return Vec4f{
+        c.x * m[0][0] + c.y * m[1][0] + c.z * m[2][0] + m[3][0],
+        c.x * m[0][1] + c.y * m[1][1] + c.z * m[2][1] + m[3][1],
+        c.x * m[0][2] + c.y * m[1][2] + c.z * m[2][2] + m[3][2],
+        bounds.Radius * MaxScale(m),
+    };
+}
+
+static KRAFT_INLINE bool IsVisibleScalar(const Frustum& frustum, const CullingBounds& bounds, u32 i)
+{
+    for (int p = 0; p < Frustum::Count; p++)
+    {
+        const Vec4f& plane = frustum.Planes[p];
+        f32          distance = plane.x * bounds.CenterX[i] + plane.y * bounds.CenterY[i] + plane.z * bounds.CenterZ[i] + plane.w;
+        f32          box_radius = Abs(plane.x) * bounds.ExtentX[i] + Abs(plane.y) * bounds.ExtentY[i] + Abs(plane.z) * bounds.ExtentZ[i];
+        if (distance < -math::Min(box_radius, bounds.Radius[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static KRAFT_INLINE u32 WriteVisibilityMask(u32 mask, u32 lanes, u8* out_visible)
+{
+    u32 visible_count = 0;
+    for (u32 lane = 0; lane < lanes; lane++)
+    {
+        u8 visible = (mask >> lane) & 1;
+        out_visible[lane] = visible;
+        visible_count += visible;
+    }
+
+    return visible_count;
+}
+
+u32 CullBounds(const Frustum& frustum, const CullingBounds& bounds, u32 start, u32 end, u8* out_visible)
+{
+    u32 visible_count = 0;
+    u32 i = start;
+
+#if defined(KRAFT_SIMD_AVX)
+    const __m256 avx_sign_mask = _mm256_set1_ps(-0.0f);
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 center_x = _mm256_loadu_ps(bounds.CenterX + i);
+        __m256 center_y = _mm256_loadu_ps(bounds.CenterY + i);
+        __m256 center_z = _mm256_loadu_ps(bounds.CenterZ + i);
+        __m256 extent_x = _mm256_loadu_ps(bounds.ExtentX + i);
+        __m256 extent_y = _mm256_loadu_ps(bounds.ExtentY + i);
+        __m256 extent_z = _mm256_loadu_ps(bounds.ExtentZ + i);
+        __m256 radius = _mm256_loadu_ps(bounds.Radius + i);
+
+        __m256 outside = _mm256_setzero_ps();
+        for (int p = 0; p < Frustum::Count; p++)
+        {
+            const Vec4f& plane = frustum.Planes[p];
+            __m256       normal_x = _mm256_set1_ps(plane.x);
+            __m256       normal_y = _mm256_set1_ps(plane.y);
+            __m256       normal_z = _mm256_set1_ps(plane.z);
+
+            __m256 distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(normal_x, center_x), _mm256_mul_ps(normal_y, center_y)),
+                _mm256_add_ps(_mm256_mul_ps(normal_z, center_z), _mm256_set1_ps(plane.w))
+            );
+
+            __m256 box_radius = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(avx_sign_mask, normal_x), extent_x), _mm256_mul_ps(_mm256_andnot_ps(avx_sign_mask, normal_y), extent_y)),
+                _mm256_mul_ps(_mm256_andnot_ps(avx_sign_mask, normal_z), extent_z)
+            );
+
+            __m256 negative_radius = _mm256_xor_ps(_mm256_min_ps(box_radius, radius), avx_sign_mask);
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, negative_radius, _CMP_LT_OQ));
+        }
+
+        u32 visible_mask = ~(u32)_mm256_movemask_ps(outside) & 0xFF;
+        visible_count += WriteVisibilityMask(visible_mask, 8, out_visible + i);
+    }
+#endif
+
+#if defined(KRAFT_SIMD_SSE)
+    const __m128 sse_sign_mask = _mm_set1_ps(-0.0f);
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 center_x = _mm_loadu_ps(bounds.CenterX + i);
+        __m128 center_y = _mm_loadu_ps(bounds.CenterY + i);
+        __m128 center_z = _mm_loadu_ps(bounds.CenterZ + i);
+        __m128 extent_x = _mm_loadu_ps(bounds.ExtentX + i);
+        __m128 extent_y = _mm_loadu_ps(bounds.ExtentY + i);
+        __m128 extent_z = _mm_loadu_ps(bounds.ExtentZ + i);
+        __m128 radius = _mm_loadu_ps(bounds.Radius + i);
+
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < Frustum::Count; p++)
+        {
+            const Vec4f& plane = frustum.Planes[p];
+            __m128       normal_x = _mm_set1_ps(plane.x);
+            __m128       normal_y = _mm_set1_ps(plane.y);
+            __m128       normal_z = _mm_set1_ps(plane.z);
+
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(normal_x, center_x), _mm_mul_ps(normal_y, center_y)), _mm_add_ps(_mm_mul_ps(normal_z, center_z), _mm_set1_ps(plane.w))
+            );
+
+            __m128 box_radius = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sse_sign_mask, normal_x), extent_x), _mm_mul_ps(_mm_andnot_ps(sse_sign_mask, normal_y), extent_y)),
+                _mm_mul_ps(_mm_andnot_ps(sse_sign_mask, normal_z), extent_z)
+            );
+
+            __m128 negative_radius = _mm_xor_ps(_mm_min_ps(box_radius, radius), sse_sign_mask);
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negative_radius));
+        }
+
+        u32 visible_mask = ~(u32)_mm_movemask_ps(outside) & 0xF;
+        visible_count += WriteVisibilityMask(visible_mask, 4, out_visible + i);
+    }
+#endif
+
+    for (; i < end; i++)
+    {
+        out_visible[i] = IsVisibleScalar(frustum, bounds, i) ? 1 : 0;
+        visible_count += out_visible[i];
+    }
+
+    return visible_count;
+}
+
+} // namespace kraft::r
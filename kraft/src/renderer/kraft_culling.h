@@ -0,0 +1,55 @@
+#pragma once
+
+#include "core/kraft_core.h"
+#include "core/kraft_math.h"
+
+namespace kraft::r {
+
+struct GeometryBounds;
+
+// Inward facing, normalized planes; a point is inside a plane when Dot(plane.xyz, point) + plane.w >= 0
+struct Frustum
+{
+    enum Plane
+    {
+        Left,
+        Right,
+        Bottom,
+        Top,
+        Near,
+        Far,
+        Count
+    };
+
+    Vec4f Planes[Count];
+};
+
+// World space bounds stored as a structure of arrays, so the culling code can test several objects at once
+struct CullingBounds
+{
+    f32* CenterX;
+    f32* CenterY;
+    f32* CenterZ;
+    f32* ExtentX;
+    f32* ExtentY;
+    f32* ExtentZ;
+    f32* Radius;
+};
+
+// Extracts the frustum planes from a view * projection matrix
+Frustum FrustumFromViewProjection(const Mat4f& view_projection);
+
+// Transforms object space bounds by a model matrix and stores the world space box and sphere at `index`.
+// Bounds that aren't valid become infinitely large so they are never culled.
+void WriteWorldBounds(const GeometryBounds& bounds, const Mat4f& model, CullingBounds* out, u32 index);
+
+// World space bounding sphere of object space bounds as (center, radius). The radius is negative when the bounds
+// aren't valid.
+Vec4f WorldBoundingSphere(const GeometryBounds& bounds, const Mat4f& model);
+
+// Tests the objects in [start, end) against the frustum and writes 1 to `out_visible` for every object that is
+// at least partially inside, 0 otherwise. An object is culled when either its box or its sphere is completely
+// behind one of the planes. Returns the number of visible objects.
+u32 CullBounds(const Frustum& frustum, const CullingBounds& bounds, u32 start, u32 end, u8* out_visible);
+
+} // namespace kraft::r
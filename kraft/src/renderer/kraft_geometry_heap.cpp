@@ -0,0 +1,271 @@
+#include "kraft_geometry_heap.h"
+
+#include <containers/kraft_array.h>
+#include <containers/kraft_hashmap.h>
+#include <core/kraft_asserts.h>
+#include <core/kraft_math.h>
+
+namespace kraft::r {
+
+template<typename T>
+static void ArrayInsertAt(Array<T>& array, u64 index, const T& value)
+{
+    array.Push(value);
+    for (u64 i = array.Length - 1; i > index; i--)
+    {
+        array[i] = array[i - 1];
+    }
+
+    array[index] = value;
+}
+
+template<typename T>
+static void ArrayRemoveAt(Array<T>& array, u64 index)
+{
+    for (u64 i = index; i + 1 < array.Length; i++)
+    {
+        array[i] = array[i + 1];
+    }
+
+    array.Length--;
+}
+
+static KRAFT_INLINE u64 AlignUpTo(u64 value, u64 alignment)
+{
+    return ((value + alignment - 1) / alignment) * alignment;
+}
+
+// Index of the first free range that starts after `offset`
+static u64 FindFreeRangeInsertionIndex(const GeometryHeap* heap, u64 offset)
+{
+    u64 low = 0;
+    u64 high = heap->FreeRanges.Length;
+    while (low < high)
+    {
+        u64 mid = (low + high) / 2;
+        if (heap->FreeRanges[mid].Offset < offset)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+static void InsertFreeRange(GeometryHeap* heap, u64 offset, u64 size)
+{
+    if (size == 0)
+        return;
+
+    u64  index = FindFreeRangeInsertionIndex(heap, offset);
+    bool merged_with_prev = false;
+    if (index > 0)
+    {
+        GeometryHeapRange& prev = heap->FreeRanges[index - 1];
+        KASSERT(prev.Offset + prev.Size <= offset);
+        if (prev.Offset + prev.Size == offset)
+        {
+            prev.Size += size;
+            merged_with_prev = true;
+        }
+    }
+
+    if (index < heap->FreeRanges.Length)
+    {
+        GeometryHeapRange& next = heap->FreeRanges[index];
+        KASSERT(offset + size <= next.Offset);
+        if (offset + size == next.Offset)
+        {
+            if (merged_with_prev)
+            {
+                heap->FreeRanges[index - 1].Size += next.Size;
+                ArrayRemoveAt(heap->FreeRanges, index);
+            }
+            else
+            {
+                next.Offset = offset;
+                next.Size += size;
+            }
+
+            return;
+        }
+    }
+
+    if (!merged_with_prev)
+    {
+        ArrayInsertAt(heap->FreeRanges, index, { offset, size });
+    }
+}
+
+void GeometryHeapInit(GeometryHeap* heap, u64 capacity)
+{
+    heap->Capacity = capacity;
+    heap->UsedBytes = 0;
+    heap->FreeRanges.Clear();
+    heap->Allocations.Clear();
+    heap->AllocationIndices.clear();
+    InsertFreeRange(heap, 0, capacity);
+}
+
+bool GeometryHeapAllocate(GeometryHeap* heap, u64 size, u64 alignment, const void* owner, u64* out_offset)
+{
+    KASSERT(size > 0 && alignment > 0);
+
+    // Best fit, smallest range that can hold the aligned allocation
+    u64 best_index = (u64)-1;
+    u64 best_size = (u64)-1;
+    for (u64 i = 0; i < heap->FreeRanges.Length; i++)
+    {
+        const GeometryHeapRange& range = heap->FreeRanges[i];
+        u64                      aligned_offset = AlignUpTo(range.Offset, alignment);
+        if (aligned_offset + size <= range.Offset + range.Size && range.Size < best_size)
+        {
+            best_index = i;
+            best_size = range.Size;
+        }
+    }
+
+    if (best_index == (u64)-1)
+        return false;
+
+    GeometryHeapRange range = heap->FreeRanges[best_index];
+    ArrayRemoveAt(heap->FreeRanges, best_index);
+
+    u64 offset = AlignUpTo(range.Offset, alignment);
+    InsertFreeRange(heap, range.Offset, offset - range.Offset);
+    InsertFreeRange(heap, offset + size, range.Offset + range.Size - (offset + size));
+
+    GeometryHeapAllocation allocation = {
+        .Offset = offset,
+        .Size = size,
+        .Alignment = alignment,
+        .Owner = owner,
+    };
+
+    KASSERT(heap->AllocationIndices.find(owner) == heap->AllocationIndices.end());
+    heap->AllocationIndices[owner] = (u32)heap->Allocations.Length;
+    heap->Allocations.Push(allocation);
+    heap->UsedBytes += size;
+
+    *out_offset = offset;
+    return true;
+}
+
+GeometryHeapAllocation* GeometryHeapFind(GeometryHeap* heap, const void* owner)
+{
+    auto it = heap->AllocationIndices.find(owner);
+    if (it == heap->AllocationIndices.end())
+        return nullptr;
+
+    return &heap->Allocations[it->second];
+}
+
+bool GeometryHeapFree(GeometryHeap* heap, const void* owner)
+{
+    auto it = heap->AllocationIndices.find(owner);
+    if (it == heap->AllocationIndices.end())
+        return false;
+
+    u32                    index = it->second;
+    GeometryHeapAllocation allocation = heap->Allocations[index];
+    heap->AllocationIndices.erase(it);
+
+    // The last allocation takes the freed slot
+    u64 last = heap->Allocations.Length - 1;
+    if (index != last)
+    {
+        heap->Allocations[index] = heap->Allocations[last];
+        heap->AllocationIndices[heap->Allocations[index].Owner] = index;
+    }
+
+    heap->Allocations.Length--;
+    InsertFreeRange(heap, allocation.Offset, allocation.Size);
+    heap->UsedBytes -= allocation.Size;
+
+    return true;
+}
+
+void GeometryHeapGrow(GeometryHeap* heap, u64 new_capacity)
+{
+    KASSERT(new_capacity > heap->Capacity);
+
+    InsertFreeRange(heap, heap->Capacity, new_capacity - heap->Capacity);
+    heap->Capacity = new_capacity;
+}
+
+// Heapsort on the offsets, compaction is rare but the allocations can be in any order by then
+static void SiftDownAllocation(Array<GeometryHeapAllocation>& allocations, u64 root, u64 count)
+{
+    while (2 * root + 1 < count)
+    {
+        u64 child = 2 * root + 1;
+        if (child + 1 < count && allocations[child + 1].Offset > allocations[child].Offset)
+            child++;
+
+        if (allocations[root].Offset >= allocations[child].Offset)
+            return;
+
+        GeometryHeapAllocation temp = allocations[root];
+        allocations[root] = allocations[child];
+        allocations[child] = temp;
+        root = child;
+    }
+}
+
+static void SortAllocationsByOffset(GeometryHeap* heap)
+{
+    Array<GeometryHeapAllocation>& allocations = heap->Allocations;
+    u64                            count = allocations.Length;
+    for (u64 i = count / 2; i > 0; i--)
+    {
+        SiftDownAllocation(allocations, i - 1, count);
+    }
+
+    for (u64 end = count; end > 1; end--)
+    {
+        GeometryHeapAllocation temp = allocations[0];
+        allocations[0] = allocations[end - 1];
+        allocations[end - 1] = temp;
+        SiftDownAllocation(allocations, 0, end - 1);
+    }
+
+    for (u64 i = 0; i < count; i++)
+    {
+        heap->AllocationIndices[allocations[i].Owner] = (u32)i;
+    }
+}
+
+void GeometryHeapCompact(GeometryHeap* heap, GeometryHeapMoveFunction move, void* user_data)
+{
+    SortAllocationsByOffset(heap);
+
+    // The alignment padding in front of each allocation is the only free space left behind
+    heap->FreeRanges.Clear();
+
+    u64 offset = 0;
+    for (u64 i = 0; i < heap->Allocations.Length; i++)
+    {
+        GeometryHeapAllocation& allocation = heap->Allocations[i];
+        u64                     new_offset = AlignUpTo(offset, allocation.Alignment);
+        move(user_data, allocation, new_offset);
+
+        InsertFreeRange(heap, offset, new_offset - offset);
+        allocation.Offset = new_offset;
+        offset = new_offset + allocation.Size;
+    }
+
+    InsertFreeRange(heap, offset, heap->Capacity - offset);
+}
+
+u64 GeometryHeapLargestFreeRange(const GeometryHeap* heap)
+{
+    u64 largest = 0;
+    for (u64 i = 0; i < heap->FreeRanges.Length; i++)
+    {
+        largest = math::Max(largest, heap->FreeRanges[i].Size);
+    }
+
+    return largest;
+}
+
+} // namespace kraft::r
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "core/kraft_core.h"
+
+namespace kraft::r {
+
+struct GeometryHeapRange
+{
+    u64 Offset;
+    u64 Size;
+};
+
+struct GeometryHeapAllocation
+{
+    u64         Offset;
+    u64         Size;
+    u64         Alignment;
+    const void* Owner;
+};
+
+// CPU side book-keeping for sub-allocating ranges of a single GPU buffer (the global vertex and index buffers).
+// Free ranges are kept sorted by offset, so a range that is given back coalesces with its free neighbours.
+// Allocations are unordered and indexed by owner, finding or freeing one doesn't walk the others.
+// Alignments don't have to be powers of two, vertex ranges are aligned to the vertex size.
+struct GeometryHeap
+{
+    u64                           Capacity = 0;
+    u64                           UsedBytes = 0;
+    Array<GeometryHeapRange>      FreeRanges;
+    Array<GeometryHeapAllocation> Allocations;
+    FlatHashMap<const void*, u32> AllocationIndices; // Owner -> index into Allocations
+};
+
+void GeometryHeapInit(GeometryHeap* heap, u64 capacity);
+
+// Best-fit allocation; returns false if no free range is large enough
+bool GeometryHeapAllocate(GeometryHeap* heap, u64 size, u64 alignment, const void* owner, u64* out_offset);
+
+// Gives the range owned by `owner` back to the heap; returns false if the owner has no allocation
+bool GeometryHeapFree(GeometryHeap* heap, const void* owner);
+
+GeometryHeapAllocation* GeometryHeapFind(GeometryHeap* heap, const void* owner);
+
+// Appends [Capacity, new_capacity) to the free space
+void GeometryHeapGrow(GeometryHeap* heap, u64 new_capacity);
+
+// Packs every allocation towards the start of the heap, in offset order, and rewrites their offsets.
+// Leaves the allocations sorted by offset.
+// `move` is called for every allocation with its old offset before the new one is stored, so the
+// caller can copy the data over to the new location.
+typedef void (*GeometryHeapMoveFunction)(void* user_data, const GeometryHeapAllocation& allocation, u64 new_offset);
+void GeometryHeapCompact(GeometryHeap* heap, GeometryHeapMoveFunction move, void* user_data);
+
+u64 GeometryHeapLargestFreeRange(const GeometryHeap* heap);
+
+} // namespace kraft::r
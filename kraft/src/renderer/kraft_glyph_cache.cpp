@@ -0,0 +1,241 @@
+namespace kraft {
+namespace r {
+
+static void MarkGlyphCacheDirty(GlyphCache* cache, u32 x0, u32 y0, u32 x1, u32 y1)
+{
+    if (cache->dirty_x0 >= cache->dirty_x1)
+    {
+        cache->dirty_x0 = x0;
+        cache->dirty_y0 = y0;
+        cache->dirty_x1 = x1;
+        cache->dirty_y1 = y1;
+        return;
+    }
+
+    cache->dirty_x0 = math::Min(cache->dirty_x0, x0);
+    cache->dirty_y0 = math::Min(cache->dirty_y0, y0);
+    cache->dirty_x1 = math::Max(cache->dirty_x1, x1);
+    cache->dirty_y1 = math::Max(cache->dirty_y1, y1);
+}
+
+GlyphCache* CreateGlyphCache(ArenaAllocator* arena, u32 width, u32 height)
+{
+    // Entries store their position in 16 bits
+    KASSERT(width <= 0xFFFF && height <= 0xFFFF);
+    KASSERT(height >= KRAFT_GLYPH_CACHE_SHELF_HEIGHT);
+
+    GlyphCache* cache = ArenaPush(arena, GlyphCache);
+    new (cache) GlyphCache;
+    cache->width = width;
+    cache->height = height;
+    cache->pixels = ArenaPushArray(arena, u8, width * height);
+    cache->shelf_count = height / KRAFT_GLYPH_CACHE_SHELF_HEIGHT;
+    cache->shelves = ArenaPushArray(arena, GlyphCacheShelf, cache->shelf_count);
+    for (u32 i = 0; i < cache->shelf_count; i++)
+    {
+        GlyphCacheShelf* shelf = &cache->shelves[i];
+        shelf->nodes = ArenaPushArrayNoZero(arena, stbrp_node, width);
+        shelf->y = i * KRAFT_GLYPH_CACHE_SHELF_HEIGHT;
+        stbrp_init_target(&shelf->packer, width, KRAFT_GLYPH_CACHE_SHELF_HEIGHT, shelf->nodes, width);
+    }
+
+    cache->texture = TextureSystem::AcquireTextureWithData(String8Raw("GlyphCache"), cache->pixels, width, height, 1);
+
+    return cache;
+}
+
+void DestroyGlyphCache(GlyphCache* cache)
+{
+    r::ResourceManager->DestroyTexture(cache->texture);
+    cache->~GlyphCache();
+}
+
+static void EvictGlyphCacheShelf(GlyphCache* cache, u32 shelf_index)
+{
+    GlyphCacheShelf* shelf = &cache->shelves[shelf_index];
+
+    TempArena scratch = ScratchBegin(0, 0);
+    u64*      evicted = ArenaPushArrayNoZero(scratch.arena, u64, shelf->glyph_count);
+    u32       evicted_count = 0;
+    for (auto& it : cache->glyphs)
+    {
+        if (it.second.shelf == shelf_index)
+        {
+            KASSERT(evicted_count < shelf->glyph_count);
+            evicted[evicted_count++] = it.first;
+        }
+    }
+
+    for (u32 i = 0; i < evicted_count; i++)
+    {
+        cache->glyphs.erase(evicted[i]);
+    }
+
+    ScratchEnd(scratch);
+
+    stbrp_init_target(&shelf->packer, cache->width, KRAFT_GLYPH_CACHE_SHELF_HEIGHT, shelf->nodes, cache->width);
+    shelf->glyph_count = 0;
+
+    // The packer leaves gaps between glyphs, the old glyphs would show through them at the edges of the new ones
+    MemSet(cache->pixels + shelf->y * cache->width, 0, cache->width * KRAFT_GLYPH_CACHE_SHELF_HEIGHT);
+    MarkGlyphCacheDirty(cache, 0, shelf->y, cache->width, shelf->y + KRAFT_GLYPH_CACHE_SHELF_HEIGHT);
+}
+
+// Finds room for the rect in one of the shelves, evicting the least recently used shelf if none has any. Shelves
+// used in `frame` are left alone; their glyphs are already in the frame's sprites.
+static bool PackGlyph(GlyphCache* cache, stbrp_rect* rect, u64 frame, u32* shelf_index)
+{
+    for (u32 i = 0; i < cache->shelf_count; i++)
+    {
+        if (stbrp_pack_rects(&cache->shelves[i].packer, rect, 1))
+        {
+            *shelf_index = i;
+            return true;
+        }
+    }
+
+    u32 oldest = cache->shelf_count;
+    for (u32 i = 0; i < cache->shelf_count; i++)
+    {
+        const GlyphCacheShelf& shelf = cache->shelves[i];
+        if (shelf.last_used < frame && (oldest == cache->shelf_count || shelf.last_used < cache->shelves[oldest].last_used))
+        {
+            oldest = i;
+        }
+    }
+
+    if (oldest == cache->shelf_count)
+        return false;
+
+    EvictGlyphCacheShelf(cache, oldest);
+    if (!stbrp_pack_rects(&cache->shelves[oldest].packer, rect, 1))
+        return false;
+
+    *shelf_index = oldest;
+    return true;
+}
+
+const GlyphCacheEntry* GetCachedGlyph(GlyphCache* cache, const Font* font, u32 glyph_index)
+{
+    u64 key = ((u64)font->id << 32) | glyph_index;
+    u64 frame = g_Renderer->GetFrameNumber();
+
+    auto it = cache->glyphs.find(key);
+    if (it != cache->glyphs.end())
+    {
+        cache->shelves[it->second.shelf].last_used = frame;
+        return &it->second;
+    }
+
+    const stbtt_fontinfo* info = &font->stb_font_info;
+    if (stbtt_IsGlyphEmpty(info, (int)glyph_index))
+        return nullptr;
+
+    // Glyphs that wouldn't fit in a shelf at the usual size, like tall accented capitals, are rasterized smaller. The
+    // distance field scales, so they are drawn at the same size as the rest.
+    int box_x0, box_y0, box_x1, box_y1;
+    stbtt_GetGlyphBox(info, (int)glyph_index, &box_x0, &box_y0, &box_x1, &box_y1);
+
+    f32 scale = font->pixel_height_scale * KRAFT_GLYPH_CACHE_SDF_SIZE;
+    f32 max_height = (f32)(KRAFT_GLYPH_CACHE_SHELF_HEIGHT - 2 * KRAFT_GLYPH_CACHE_SDF_PADDING - 2);
+    f32 max_width = (f32)(cache->width - 2 * KRAFT_GLYPH_CACHE_SDF_PADDING - 2);
+    if ((box_y1 - box_y0) * scale > max_height)
+    {
+        scale = max_height / (f32)(box_y1 - box_y0);
+    }
+
+    if ((box_x1 - box_x0) * scale > max_width)
+    {
+        scale = max_width / (f32)(box_x1 - box_x0);
+    }
+
+    int width, height, xoff, yoff;
+    u8* sdf = stbtt_GetGlyphSDF(
+        info,
+        scale,
+        (int)glyph_index,
+        KRAFT_GLYPH_CACHE_SDF_PADDING,
+        128,
+        128.0f / KRAFT_GLYPH_CACHE_SDF_PADDING,
+        &width,
+        &height,
+        &xoff,
+        &yoff
+    );
+
+    if (!sdf)
+        return nullptr;
+
+    // One pixel of gutter to the right and below, so filtering at the edges of the glyph doesn't pick up its neighbours
+    stbrp_rect rect = { .w = width + 1, .h = height + 1 };
+    u32        shelf_index;
+    if (!PackGlyph(cache, &rect, frame, &shelf_index))
+    {
+        stbtt_FreeSDF(sdf, nullptr);
+        if (cache->full_reported_frame != frame)
+        {
+            KWARN("[GetCachedGlyph]: The glyphs drawn in this frame don't fit in the %dx%d glyph cache", cache->width, cache->height);
+            cache->full_reported_frame = frame;
+        }
+
+        return nullptr;
+    }
+
+    GlyphCacheShelf* shelf = &cache->shelves[shelf_index];
+    u32              x = (u32)rect.x;
+    u32              y = shelf->y + (u32)rect.y;
+    for (int row = 0; row < height; row++)
+    {
+        u8* dst = cache->pixels + (y + row) * cache->width + x;
+        MemCpy(dst, sdf + row * width, width);
+        dst[width] = 0;
+    }
+
+    MemSet(cache->pixels + (y + height) * cache->width + x, 0, width + 1);
+    MarkGlyphCacheDirty(cache, x, y, x + width + 1, y + height + 1);
+    stbtt_FreeSDF(sdf, nullptr);
+
+    shelf->glyph_count++;
+    shelf->last_used = frame;
+
+    // stb_truetype measures the bitmap from the pen position with y down
+    GlyphCacheEntry* entry = &cache->glyphs[key];
+    *entry = GlyphCacheEntry{
+        .x = (u16)x,
+        .y = (u16)y,
+        .width = (u16)width,
+        .height = (u16)height,
+        .x0 = xoff / scale,
+        .y0 = -(yoff + height) / scale,
+        .x1 = (xoff + width) / scale,
+        .y1 = -yoff / scale,
+        .shelf = shelf_index,
+    };
+
+    return entry;
+}
+
+void UploadGlyphCache(GlyphCache* cache)
+{
+    if (cache->dirty_x0 >= cache->dirty_x1)
+        return;
+
+    u32        width = cache->dirty_x1 - cache->dirty_x0;
+    u32        height = cache->dirty_y1 - cache->dirty_y0;
+    BufferView staging_buf = r::ResourceManager->CreateTempBuffer((u64)width * height);
+    for (u32 row = 0; row < height; row++)
+    {
+        MemCpy(staging_buf.Ptr + row * width, cache->pixels + (cache->dirty_y0 + row) * cache->width + cache->dirty_x0, width);
+    }
+
+    if (!r::ResourceManager->UploadTextureRegion(cache->texture, staging_buf.GPUBuffer, staging_buf.Offset, cache->dirty_x0, cache->dirty_y0, width, height))
+    {
+        KERROR("[UploadGlyphCache]: Failed to upload the glyph cache");
+    }
+
+    cache->dirty_x0 = 0;
+    cache->dirty_x1 = 0;
+}
+
+} // namespace r
+} // namespace kraft
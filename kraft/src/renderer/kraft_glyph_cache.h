@@ -0,0 +1,97 @@
+#pragma once
+
+#include "stb/stb_rect_pack.h"
+#include "stb/stb_truetype.h"
+
+// Pixel height glyphs are rasterized at; the distance field is scaled to every other size in the shader
+#define KRAFT_GLYPH_CACHE_SDF_SIZE 32
+
+// Atlas pixels around the outline the distance field reaches out to
+#define KRAFT_GLYPH_CACHE_SDF_PADDING 4
+
+// Height of the shelves the atlas is split into. Glyphs taller than a shelf are rasterized at a smaller size.
+#define KRAFT_GLYPH_CACHE_SHELF_HEIGHT 48
+
+namespace kraft {
+namespace r {
+
+struct GlyphCache;
+
+// A font whose glyphs are rasterized into a glyph cache the first time they are drawn. Loading it only parses the font
+// tables, and since the glyphs are stored as distance fields the same cache entries serve every size the font is drawn
+// at. Lengths are in font units; multiply them by `pixel_height_scale` and the size in pixels to get pixels.
+struct Font
+{
+    GlyphCache* cache;
+    f32         pixel_height_scale;
+    f32         ascent;
+    f32         descent;
+    f32         line_gap;
+
+    // Identifies the font in the glyph and text layout caches
+    u32 id;
+
+    // Internal-use
+    stbtt_fontinfo stb_font_info;
+};
+
+// Where a glyph is in the atlas, and the box it covers relative to the pen position, in font units with y up. The box
+// includes the padding of the distance field.
+struct GlyphCacheEntry
+{
+    u16 x;
+    u16 y;
+    u16 width;
+    u16 height;
+    f32 x0;
+    f32 y0;
+    f32 x1;
+    f32 y1;
+    u32 shelf;
+};
+
+// A row of the atlas; glyphs are packed into it with stb_rect_pack and evicted together
+struct GlyphCacheShelf
+{
+    stbrp_context packer;
+    stbrp_node*   nodes;
+    u32           y;
+    u32           glyph_count;
+    u64           last_used; // Frame one of its glyphs was last drawn in
+};
+
+// Single channel atlas shared by all the fonts drawn through it. Once it is full, the glyphs of the shelf that was used
+// least recently make room for new ones; shelves used in the current frame are never evicted, so every glyph drawn in a
+// frame has to fit at the same time.
+struct GlyphCache
+{
+    Handle<Texture>                   texture;
+    u32                               width;
+    u32                               height;
+    u8*                               pixels; // Copy of the atlas the dirty region is uploaded from
+    GlyphCacheShelf*                  shelves;
+    u32                               shelf_count;
+    FlatHashMap<u64, GlyphCacheEntry> glyphs;
+
+    // Region written to since the last upload, empty if x0 >= x1
+    u32 dirty_x0;
+    u32 dirty_y0;
+    u32 dirty_x1;
+    u32 dirty_y1;
+
+    u64 full_reported_frame;
+};
+
+// `width` and `height` are the size of the atlas in pixels
+GlyphCache* CreateGlyphCache(ArenaAllocator* arena, u32 width, u32 height);
+void        DestroyGlyphCache(GlyphCache* cache);
+
+// Returns the glyph's entry, rasterizing it if it isn't in the cache. Returns nullptr for glyphs without an outline and
+// when there is no room left for the glyph in this frame. The entry stays valid until the glyph cache is used again.
+const GlyphCacheEntry* GetCachedGlyph(GlyphCache* cache, const Font* font, u32 glyph_index);
+
+// Uploads the part of the atlas written since the last upload. DrawText calls this after adding its glyphs.
+void UploadGlyphCache(GlyphCache* cache);
+
+} // namespace r
+} // namespace kraft
@@ -0,0 +1,413 @@
+#include "kraft_gpu_culling.h"
+
+#include <core/kraft_asserts.h>
+#include <core/kraft_log.h>
+#include <core/kraft_memory.h>
+#include <renderer/kraft_culling.h>
+#include <renderer/kraft_renderer_frontend.h>
+#include <renderer/kraft_renderer_types.h>
+#include <renderer/kraft_resource_manager.h>
+#include <resources/kraft_resource_types.h>
+#include <systems/kraft_shader_system.h>
+
+#include <cstddef>
+
+namespace kraft::r {
+
+#define KRAFT_GPU_CULLING_FRAMES_IN_FLIGHT 3
+
+// Laid out like CullingParams in gpu_culling.kfx (std140)
+struct GPUCullingParams
+{
+    Mat4f                   ViewProjection;
+    Vec4f                   FrustumPlanes[Frustum::Count];
+    DispatchIndirectCommand Dispatch; // Arguments of the early pass, written once the instance count is known
+    u32                     _pad0;
+    u32                     FirstInstance;
+    u32                     InstanceCount;
+    u32                     LateCommandOffset;
+    u32                     DepthTextureId; // Sampler index in the top 4 bits, like material textures
+    u32                     DepthWidth;
+    u32                     DepthHeight;
+    u32                     HiZLevelCount;
+    u32                     _pad1;
+    u32                     HiZLevels[KRAFT_GPU_CULLING_MAX_HIZ_LEVELS][4]; // Width, height and offset into the pyramid
+};
+
+// Push constants are always pushed whole
+struct GPUCullingPushConstants
+{
+    u32 SurfaceIndex;
+    u32 Pass;
+    u32 Level;
+    u32 _pad[29];
+};
+
+static_assert(sizeof(GPUCullingPushConstants) == 128, "GPUCullingPushConstants has to match the push constant size");
+
+struct GPUCullingSurface
+{
+    u32             Index;
+    bool            InUse;
+    u32             Width;
+    u32             Height;
+    Handle<Texture> DepthTexture;
+    u32             DepthTextureId;
+
+    // Visibility bits of every object id, followed by the levels of the Hi-Z pyramid. Only the GPU ever touches it;
+    // the bits start out undefined, which at worst draws a few objects in the early pass that the late pass would
+    // have drawn anyway.
+    Handle<Buffer> Data;
+    u32            HiZLevelCount;
+    u32            HiZLevels[KRAFT_GPU_CULLING_MAX_HIZ_LEVELS][4];
+
+    GPUCullingStats Stats;
+};
+
+struct GPUCullingState
+{
+    RendererBackend* Backend;
+    Shader*          Shader;
+    u32              VariantIndex;
+    u32              MaxInstances;
+    u32              FrameIndex;
+
+    Handle<Buffer>    ParamsBuffers[KRAFT_GPU_CULLING_FRAMES_IN_FLIGHT];
+    Handle<Buffer>    CullObjectBuffers[KRAFT_GPU_CULLING_FRAMES_IN_FLIGHT];
+    Handle<Buffer>    CulledInstanceBuffers[KRAFT_GPU_CULLING_FRAMES_IN_FLIGHT];
+    Handle<Buffer>    StatsBuffers[KRAFT_GPU_CULLING_FRAMES_IN_FLIGHT];
+    u32               CulledSurfaces[KRAFT_GPU_CULLING_FRAMES_IN_FLIGHT]; // Bitmask of the slots each frame culled
+    GPUCullingSurface Surfaces[KRAFT_GPU_CULLING_MAX_SURFACES];
+} gpu_culling_state;
+
+bool InitGPUCulling(RendererBackend* backend, u32 max_instances)
+{
+    gpu_culling_state.Shader = ShaderSystem::AcquireShader(String8Raw("res/shaders/gpu_culling.kfx.bkfx"), false);
+    if (!gpu_culling_state.Shader)
+    {
+        KERROR("[InitGPUCulling]: Failed to load the culling shader, GPU culling is disabled");
+        return false;
+    }
+
+    // Bound straight through the backend, which doesn't check for readiness
+    ShaderSystem::WaitForShader(gpu_culling_state.Shader);
+
+    i32 variant_index = ShaderSystem::FindVariantIndex(gpu_culling_state.Shader, String8Raw("Cull"));
+    if (variant_index < 0)
+    {
+        KERROR("[InitGPUCulling]: The culling shader has no 'Cull' variant, GPU culling is disabled");
+        ShaderSystem::ReleaseShader(gpu_culling_state.Shader);
+        gpu_culling_state.Shader = nullptr;
+        return false;
+    }
+
+    gpu_culling_state.Backend = backend;
+    gpu_culling_state.VariantIndex = (u32)variant_index;
+    gpu_culling_state.MaxInstances = max_instances;
+
+    u64 host_memory_flags = MEMORY_PROPERTY_FLAGS_HOST_VISIBLE | MEMORY_PROPERTY_FLAGS_HOST_COHERENT;
+    u64 upload_memory_flags = host_memory_flags;
+    if (g_Device->supports_device_local_host_visible)
+    {
+        upload_memory_flags |= MEMORY_PROPERTY_FLAGS_DEVICE_LOCAL;
+    }
+
+    for (int i = 0; i < KRAFT_GPU_CULLING_FRAMES_IN_FLIGHT; i++)
+    {
+        gpu_culling_state.ParamsBuffers[i] = ResourceManager->CreateBuffer({
+            .DebugName = "GPUCullingParams",
+            .Size = sizeof(GPUCullingParams) * KRAFT_GPU_CULLING_MAX_SURFACES,
+            .UsageFlags = BUFFER_USAGE_FLAGS_UNIFORM_BUFFER | BUFFER_USAGE_FLAGS_INDIRECT_BUFFER,
+            .MemoryPropertyFlags = upload_memory_flags,
+            .SharingMode = SharingMode::Exclusive,
+            .MapMemory = true,
+        });
+
+        gpu_culling_state.CullObjectBuffers[i] = ResourceManager->CreateBuffer({
+            .DebugName = "GPUCullObjects",
+            .Size = sizeof(GPUCullObject) * max_instances,
+            .UsageFlags = BUFFER_USAGE_FLAGS_STORAGE_BUFFER,
+            .MemoryPropertyFlags = upload_memory_flags,
+            .SharingMode = SharingMode::Exclusive,
+            .MapMemory = true,
+        });
+
+        gpu_culling_state.CulledInstanceBuffers[i] = ResourceManager->CreateBuffer({
+            .DebugName = "GPUCulledInstanceBuffer",
+            .Size = sizeof(InstanceData) * max_instances * 2,
+            .UsageFlags = BUFFER_USAGE_FLAGS_STORAGE_BUFFER,
+            .MemoryPropertyFlags = MEMORY_PROPERTY_FLAGS_DEVICE_LOCAL,
+            .SharingMode = SharingMode::Exclusive,
+        });
+
+        // Read back on the CPU, so it stays out of device local memory
+        gpu_culling_state.StatsBuffers[i] = ResourceManager->CreateBuffer({
+            .DebugName = "GPUCullingStats",
+            .Size = sizeof(GPUCullingStats) * KRAFT_GPU_CULLING_MAX_SURFACES,
+            .UsageFlags = BUFFER_USAGE_FLAGS_STORAGE_BUFFER,
+            .MemoryPropertyFlags = host_memory_flags,
+            .SharingMode = SharingMode::Exclusive,
+            .MapMemory = true,
+        });
+
+        MemZero(ResourceManager->GetBufferData(gpu_culling_state.StatsBuffers[i]), sizeof(GPUCullingStats) * KRAFT_GPU_CULLING_MAX_SURFACES);
+    }
+
+    for (u32 i = 0; i < KRAFT_GPU_CULLING_MAX_SURFACES; i++)
+    {
+        gpu_culling_state.Surfaces[i].Index = i;
+    }
+
+    return true;
+}
+
+void ShutdownGPUCulling()
+{
+    if (!gpu_culling_state.Shader)
+        return;
+
+    for (u32 i = 0; i < KRAFT_GPU_CULLING_MAX_SURFACES; i++)
+    {
+        if (gpu_culling_state.Surfaces[i].InUse)
+        {
+            DestroyGPUCullingSurface(&gpu_culling_state.Surfaces[i]);
+        }
+    }
+
+    for (int i = 0; i < KRAFT_GPU_CULLING_FRAMES_IN_FLIGHT; i++)
+    {
+        ResourceManager->DestroyBuffer(gpu_culling_state.ParamsBuffers[i]);
+        ResourceManager->DestroyBuffer(gpu_culling_state.CullObjectBuffers[i]);
+        ResourceManager->DestroyBuffer(gpu_culling_state.CulledInstanceBuffers[i]);
+        ResourceManager->DestroyBuffer(gpu_culling_state.StatsBuffers[i]);
+    }
+
+    // The shader is left to the shader system, which shuts down before the renderer
+    MemZero(&gpu_culling_state, sizeof(gpu_culling_state));
+}
+
+GPUCullingSurface* CreateGPUCullingSurface(const RenderSurface& surface)
+{
+    KASSERT(gpu_culling_state.Shader);
+    KASSERTM(surface.DepthPassTexture, "GPU culling needs a surface with a sampled depth attachment");
+
+    GPUCullingSurface* culling_surface = nullptr;
+    for (u32 i = 0; i < KRAFT_GPU_CULLING_MAX_SURFACES; i++)
+    {
+        if (!gpu_culling_state.Surfaces[i].InUse)
+        {
+            culling_surface = &gpu_culling_state.Surfaces[i];
+            break;
+        }
+    }
+
+    if (!culling_surface)
+    {
+        KWARN("[CreateGPUCullingSurface]: All %d culling slots are in use, '%S' is drawn without GPU culling", KRAFT_GPU_CULLING_MAX_SURFACES, surface.DebugName);
+        return nullptr;
+    }
+
+    // Every level is half of the one before it, rounded up, down to a single texel. The first level is already
+    // half the size of the depth attachment.
+    u32 hiz_size = 0;
+    u32 level_width = surface.Width;
+    u32 level_height = surface.Height;
+    culling_surface->HiZLevelCount = 0;
+    while (culling_surface->HiZLevelCount < KRAFT_GPU_CULLING_MAX_HIZ_LEVELS && (level_width > 1 || level_height > 1))
+    {
+        level_width = (level_width + 1) / 2;
+        level_height = (level_height + 1) / 2;
+
+        u32* level = culling_surface->HiZLevels[culling_surface->HiZLevelCount++];
+        level[0] = level_width;
+        level[1] = level_height;
+        level[2] = hiz_size;
+        level[3] = 0;
+
+        hiz_size += level_width * level_height;
+    }
+
+    culling_surface->Data = ResourceManager->CreateBuffer({
+        .DebugName = "GPUCullingSurface",
+        .Size = sizeof(u32) * (KRAFT_GPU_CULLING_MAX_OBJECT_IDS / 32) + sizeof(f32) * math::Max(hiz_size, 1u),
+        .UsageFlags = BUFFER_USAGE_FLAGS_STORAGE_BUFFER,
+        .MemoryPropertyFlags = MEMORY_PROPERTY_FLAGS_DEVICE_LOCAL,
+        .SharingMode = SharingMode::Exclusive,
+    });
+
+    if (culling_surface->Data.IsInvalid())
+    {
+        KERROR("[CreateGPUCullingSurface]: Failed to create the culling data of '%S'", surface.DebugName);
+        return nullptr;
+    }
+
+    // The pyramid is built from the depth attachment through the global texture array
+    Handle<Texture> depth_texture = surface.DepthPassTexture;
+    gpu_culling_state.Backend->UpdateTextures(&depth_texture, 1);
+
+    culling_surface->InUse = true;
+    culling_surface->Width = surface.Width;
+    culling_surface->Height = surface.Height;
+    culling_surface->DepthTexture = depth_texture;
+    culling_surface->DepthTextureId = ((u32)surface.TextureSampler.GetIndex() << 28) | ((u32)depth_texture.GetIndex() & 0x0FFFFFFFu);
+    culling_surface->Stats = {};
+
+    return culling_surface;
+}
+
+void DestroyGPUCullingSurface(GPUCullingSurface* culling_surface)
+{
+    if (!culling_surface || !culling_surface->InUse)
+        return;
+
+    ResourceManager->DestroyBuffer(culling_surface->Data);
+    culling_surface->InUse = false;
+
+    for (int i = 0; i < KRAFT_GPU_CULLING_FRAMES_IN_FLIGHT; i++)
+    {
+        gpu_culling_state.CulledSurfaces[i] &= ~(1u << culling_surface->Index);
+    }
+}
+
+void GPUCullingPrepareFrame(u32 frame_index)
+{
+    KASSERT(frame_index < KRAFT_GPU_CULLING_FRAMES_IN_FLIGHT);
+    gpu_culling_state.FrameIndex = frame_index;
+
+    // The backend has waited for the frame that used these buffers last, so its counters are final
+    GPUCullingStats* stats = (GPUCullingStats*)ResourceManager->GetBufferData(gpu_culling_state.StatsBuffers[frame_index]);
+    for (u32 i = 0; i < KRAFT_GPU_CULLING_MAX_SURFACES; i++)
+    {
+        if (gpu_culling_state.CulledSurfaces[frame_index] & (1u << i))
+        {
+            gpu_culling_state.Surfaces[i].Stats = stats[i];
+        }
+    }
+
+    MemZero(stats, sizeof(GPUCullingStats) * KRAFT_GPU_CULLING_MAX_SURFACES);
+    gpu_culling_state.CulledSurfaces[frame_index] = 0;
+}
+
+GPUCullObject* GetGPUCullObjects()
+{
+    return (GPUCullObject*)ResourceManager->GetBufferData(gpu_culling_state.CullObjectBuffers[gpu_culling_state.FrameIndex]);
+}
+
+Handle<Buffer> GetGPUCulledInstanceBuffer()
+{
+    return gpu_culling_state.CulledInstanceBuffers[gpu_culling_state.FrameIndex];
+}
+
+static GPUCullingParams* GetGPUCullingParams(const GPUCullingSurface* culling_surface)
+{
+    GPUCullingParams* params = (GPUCullingParams*)ResourceManager->GetBufferData(gpu_culling_state.ParamsBuffers[gpu_culling_state.FrameIndex]);
+    return params + culling_surface->Index;
+}
+
+// Binds the culling shader and every buffer it reads or writes
+static void BindGPUCullingShader(RenderSurface* surface, GPUCullingPass::Enum pass, u32 level, Handle<Buffer> instance_buffer, Handle<Buffer> indirect_buffer)
+{
+    u32            frame_index = gpu_culling_state.FrameIndex;
+    Handle<Buffer> storage_buffers[] = {
+        instance_buffer,
+        gpu_culling_state.CullObjectBuffers[frame_index],
+        gpu_culling_state.CulledInstanceBuffers[frame_index],
+        indirect_buffer,
+        surface->Culling->Data,
+        gpu_culling_state.StatsBuffers[frame_index],
+    };
+
+    RendererBackend* backend = gpu_culling_state.Backend;
+    backend->UseShader(gpu_culling_state.Shader, gpu_culling_state.VariantIndex);
+    backend->CmdPushStorageBuffers(gpu_culling_state.Shader, gpu_culling_state.ParamsBuffers[frame_index], storage_buffers, KRAFT_C_ARRAY_SIZE(storage_buffers));
+
+    GPUCullingPushConstants push_constants = {
+        .SurfaceIndex = surface->Culling->Index,
+        .Pass = pass,
+        .Level = level,
+    };
+    backend->ApplyLocalShaderProperties(gpu_culling_state.Shader, &push_constants);
+}
+
+void BeginGPUCulling(RenderSurface* surface, const Mat4f& view_projection, u32 first_instance, Handle<Buffer> instance_buffer, Handle<Buffer> indirect_buffer)
+{
+    GPUCullingSurface* culling_surface = surface->Culling;
+    KASSERT(culling_surface && culling_surface->InUse);
+
+    Frustum           frustum = FrustumFromViewProjection(view_projection);
+    GPUCullingParams* params = GetGPUCullingParams(culling_surface);
+    params->ViewProjection = view_projection;
+    MemCpy(params->FrustumPlanes, frustum.Planes, sizeof(params->FrustumPlanes));
+    params->Dispatch = { 0, 1, 1 };
+    params->FirstInstance = first_instance;
+    params->InstanceCount = 0;
+    params->LateCommandOffset = gpu_culling_state.MaxInstances;
+    params->DepthTextureId = culling_surface->DepthTextureId;
+    params->DepthWidth = culling_surface->Width;
+    params->DepthHeight = culling_surface->Height;
+    params->HiZLevelCount = culling_surface->HiZLevelCount;
+    MemCpy(params->HiZLevels, culling_surface->HiZLevels, sizeof(params->HiZLevels));
+
+    gpu_culling_state.CulledSurfaces[gpu_culling_state.FrameIndex] |= 1u << culling_surface->Index;
+
+    RendererBackend* backend = gpu_culling_state.Backend;
+    backend->PrepareSurface(surface);
+
+    // Last frame's late pass wrote the visibility bits this pass reads
+    backend->PipelineBarrier(PIPELINE_ACCESS_FLAGS_COMPUTE_WRITE, PIPELINE_ACCESS_FLAGS_COMPUTE_READ | PIPELINE_ACCESS_FLAGS_COMPUTE_WRITE);
+
+    BindGPUCullingShader(surface, GPUCullingPass::Early, 0, instance_buffer, indirect_buffer);
+    backend->DispatchIndirect(
+        gpu_culling_state.ParamsBuffers[gpu_culling_state.FrameIndex],
+        sizeof(GPUCullingParams) * culling_surface->Index + offsetof(GPUCullingParams, Dispatch)
+    );
+
+    backend->PipelineBarrier(PIPELINE_ACCESS_FLAGS_COMPUTE_WRITE, PIPELINE_ACCESS_FLAGS_INDIRECT_READ | PIPELINE_ACCESS_FLAGS_VERTEX_READ);
+}
+
+void EndGPUCulling(RenderSurface* surface, u32 instance_count, Handle<Buffer> instance_buffer, Handle<Buffer> indirect_buffer)
+{
+    GPUCullingSurface* culling_surface = surface->Culling;
+    KASSERT(culling_surface && culling_surface->InUse);
+
+    u32               group_count = (instance_count + KRAFT_GPU_CULLING_GROUP_SIZE - 1) / KRAFT_GPU_CULLING_GROUP_SIZE;
+    GPUCullingParams* params = GetGPUCullingParams(culling_surface);
+    params->Dispatch.GroupCountX = group_count;
+    params->InstanceCount = instance_count;
+
+    GPUCullingStats* stats = (GPUCullingStats*)ResourceManager->GetBufferData(gpu_culling_state.StatsBuffers[gpu_culling_state.FrameIndex]);
+    stats[culling_surface->Index].ObjectCount = instance_count;
+
+    // Nothing was culled, the visibility of last frame stays as it is
+    if (instance_count == 0)
+        return;
+
+    RendererBackend* backend = gpu_culling_state.Backend;
+    backend->SuspendSurface(surface);
+
+    for (u32 level = 0; level < culling_surface->HiZLevelCount; level++)
+    {
+        const u32* hiz_level = culling_surface->HiZLevels[level];
+        BindGPUCullingShader(surface, GPUCullingPass::BuildHiZ, level, instance_buffer, indirect_buffer);
+        backend->Dispatch((hiz_level[0] * hiz_level[1] + KRAFT_GPU_CULLING_GROUP_SIZE - 1) / KRAFT_GPU_CULLING_GROUP_SIZE, 1, 1);
+        backend->PipelineBarrier(PIPELINE_ACCESS_FLAGS_COMPUTE_WRITE, PIPELINE_ACCESS_FLAGS_COMPUTE_READ);
+    }
+
+    BindGPUCullingShader(surface, GPUCullingPass::Late, 0, instance_buffer, indirect_buffer);
+    backend->Dispatch(group_count, 1, 1);
+    backend->PipelineBarrier(
+        PIPELINE_ACCESS_FLAGS_COMPUTE_WRITE, PIPELINE_ACCESS_FLAGS_INDIRECT_READ | PIPELINE_ACCESS_FLAGS_VERTEX_READ | PIPELINE_ACCESS_FLAGS_HOST_READ
+    );
+
+    backend->ResumeSurface(surface);
+}
+
+GPUCullingStats GetGPUCullingStats(const GPUCullingSurface* culling_surface)
+{
+    if (!culling_surface)
+        return {};
+
+    return culling_surface->Stats;
+}
+
+} // namespace kraft::r
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "core/kraft_core.h"
+#include "core/kraft_math.h"
+
+namespace kraft::r {
+
+struct RendererBackend;
+struct RenderSurface;
+struct GPUCullingSurface;
+struct Buffer;
+
+template<typename T>
+struct Handle;
+
+// The values below are duplicated in gpu_culling.kfx
+#define KRAFT_GPU_CULLING_MAX_SURFACES   4
+#define KRAFT_GPU_CULLING_MAX_HIZ_LEVELS 16
+
+// Visibility is tracked per object id (the entity id of the renderable); ids above this share bits
+#define KRAFT_GPU_CULLING_MAX_OBJECT_IDS (1 << 20)
+#define KRAFT_GPU_CULLING_GROUP_SIZE     64
+
+namespace GPUCullingPass {
+enum Enum : u32
+{
+    Early = 0,    // Draws what was visible last frame and is still inside the frustum
+    BuildHiZ = 1, // Builds one level of the Hi-Z pyramid from the early draws' depth
+    Late = 2,     // Draws what became visible, tested against the pyramid, and records visibility for the next frame
+};
+} // namespace GPUCullingPass
+
+// Culling input of an instance, parallel to the instance buffer. Laid out like CullObject in gpu_culling.kfx (std430).
+struct GPUCullObject
+{
+    Vec4f BoundingSphere; // World space (center, radius); never culled when the radius is negative
+    u32   CommandIndex;   // Early draw command the instance belongs to; its late command is LateCommandOffset after it
+    u32   ObjectId;
+    u32   _pad[2];
+};
+
+// Counters of the last culled frame of a surface. They are read back once the frame has finished on the GPU, so they
+// lag behind by the number of frames in flight.
+struct GPUCullingStats
+{
+    u32 ObjectCount;
+    u32 EarlyVisibleCount;
+    u32 LateVisibleCount;
+    u32 FrustumCulledCount;
+    u32 OcclusionCulledCount;
+    u32 _pad[3];
+};
+
+// Loads the culling shader and creates the per-frame buffers for up to `max_instances` instances per frame. Needs the
+// shader system, so the renderer calls it when the first surface that can be culled is created. Returns false when
+// GPU culling can't be used, surfaces are then drawn without it.
+bool InitGPUCulling(RendererBackend* backend, u32 max_instances);
+void ShutdownGPUCulling();
+
+// Culling state of a surface: the Hi-Z pyramid and the visibility of its objects. The surface needs a sampled depth
+// attachment. Returns nullptr when every culling slot is taken.
+GPUCullingSurface* CreateGPUCullingSurface(const RenderSurface& surface);
+void               DestroyGPUCullingSurface(GPUCullingSurface* culling_surface);
+
+// Reads back the stats of the frame that last used `frame_index` and resets them
+void GPUCullingPrepareFrame(u32 frame_index);
+
+// This frame's culling input, indexed like the instance buffer
+GPUCullObject* GetGPUCullObjects();
+
+// Instances that survived culling; instanced draws of culled surfaces read their per-instance data from here.
+// Early draws use [0, max_instances), late draws the same offsets after max_instances.
+Handle<Buffer> GetGPUCulledInstanceBuffer();
+
+// Records the early culling pass ahead of the surface's draws, must be called before the surface begins.
+// The instances of the surface start at `first_instance`; their count is only known once the draws have been
+// recorded, so the pass is dispatched indirectly with arguments written by EndGPUCulling.
+void BeginGPUCulling(
+    RenderSurface*     surface,
+    const Mat4f&       view_projection,
+    u32                first_instance,
+    Handle<Buffer>     instance_buffer,
+    Handle<Buffer>     indirect_buffer
+);
+
+// Builds the Hi-Z pyramid from the early draws and records the late culling pass. The surface is suspended while
+// the passes run and resumed afterwards, the late draws can be recorded right after.
+void EndGPUCulling(RenderSurface* surface, u32 instance_count, Handle<Buffer> instance_buffer, Handle<Buffer> indirect_buffer);
+
+GPUCullingStats GetGPUCullingStats(const GPUCullingSurface* culling_surface);
+
+} // namespace kraft::r
@@ -0,0 +1,484 @@
+#include "kraft_occlusion_culling.h"
+
+#include <core/kraft_allocators.h>
+#include <core/kraft_jobs.h>
+#include <renderer/kraft_culling.h>
+
+#include <cfloat>
+#include <cmath>
+
+#if defined(KRAFT_SIMD_AVX)
+#include <immintrin.h>
+#elif defined(KRAFT_SIMD_SSE)
+#include <emmintrin.h>
+#endif
+
+namespace kraft::r {
+
+#define KRAFT_OCCLUSION_FULL_MASK 0xFFFFFFFFu
+
+// Vertices closer to the camera plane than this are treated as crossing it
+#define KRAFT_OCCLUSION_MIN_W 1e-5f
+
+// Occluders set up by a single job
+#define KRAFT_OCCLUSION_SETUP_BATCH_SIZE 8
+
+// Screen space setup of an occluder triangle, shared by every band that draws it
+struct OcclusionTriangle
+{
+    // Edge functions a * x + b * y + c, non-negative inside the triangle
+    f32 EdgeA[3];
+    f32 EdgeB[3];
+    f32 EdgeC[3];
+
+    // Depth plane a * x + b * y + c and the farthest depth of the vertices
+    f32 DepthA;
+    f32 DepthB;
+    f32 DepthC;
+    f32 DepthMax;
+
+    // Tiles touched by the bounding rectangle; empty when MinTileY > MaxTileY
+    u32 MinTileX;
+    u32 MaxTileX;
+    u32 MinTileY;
+    u32 MaxTileY;
+};
+
+OcclusionBuffer CreateOcclusionBuffer(ArenaAllocator* arena, u32 width, u32 height)
+{
+    OcclusionBuffer buffer;
+    buffer.TilesX = math::Max(1u, (width + KRAFT_OCCLUSION_TILE_WIDTH - 1) / KRAFT_OCCLUSION_TILE_WIDTH);
+    buffer.TilesY = math::Max(1u, (height + KRAFT_OCCLUSION_TILE_HEIGHT - 1) / KRAFT_OCCLUSION_TILE_HEIGHT);
+    buffer.Width = buffer.TilesX * KRAFT_OCCLUSION_TILE_WIDTH;
+    buffer.Height = buffer.TilesY * KRAFT_OCCLUSION_TILE_HEIGHT;
+    buffer.Tiles = ArenaPushArrayNoZero(arena, OcclusionTile, buffer.TilesX * buffer.TilesY);
+    ClearOcclusionBuffer(&buffer);
+
+    return buffer;
+}
+
+void ClearOcclusionBuffer(OcclusionBuffer* buffer)
+{
+    u32 tile_count = buffer->TilesX * buffer->TilesY;
+    for (u32 i = 0; i < tile_count; i++)
+    {
+        buffer->Tiles[i] = { .ZMax0 = FLT_MAX, .ZMax1 = 0.0f, .Mask = 0 };
+    }
+}
+
+// Clip space to (pixel x, pixel y, z / w). Pixel centers are at half coordinates.
+static KRAFT_INLINE Vec3f OcclusionClipToScreen(const OcclusionBuffer* buffer, Vec4f clip)
+{
+    f32 inv_w = 1.0f / clip.w;
+    return Vec3f{
+        (clip.x * inv_w * 0.5f + 0.5f) * (f32)buffer->Width,
+        (clip.y * inv_w * 0.5f + 0.5f) * (f32)buffer->Height,
+        clip.z * inv_w,
+    };
+}
+
+static KRAFT_INLINE Vec4f OcclusionTransform(const Mat4f& m, Vec3f p)
+{
+    return Vec4f{
+        p.x * m[0][0] + p.y * m[1][0] + p.z * m[2][0] + m[3][0],
+        p.x * m[0][1] + p.y * m[1][1] + p.z * m[2][1] + m[3][1],
+        p.x * m[0][2] + p.y * m[1][2] + p.z * m[2][2] + m[3][2],
+        p.x * m[0][3] + p.y * m[1][3] + p.z * m[2][3] + m[3][3],
+    };
+}
+
+static void SetupOcclusionTriangle(const OcclusionBuffer* buffer, Vec4f c0, Vec4f c1, Vec4f c2, OcclusionTriangle* out)
+{
+    out->MinTileY = 1;
+    out->MaxTileY = 0;
+
+    // Clipping against the near plane isn't worth it for occluders, the triangle is dropped instead
+    if (c0.w < KRAFT_OCCLUSION_MIN_W || c1.w < KRAFT_OCCLUSION_MIN_W || c2.w < KRAFT_OCCLUSION_MIN_W)
+        return;
+
+    Vec3f v[3] = { OcclusionClipToScreen(buffer, c0), OcclusionClipToScreen(buffer, c1), OcclusionClipToScreen(buffer, c2) };
+    f32   area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+    if (Abs(area) < 1e-6f)
+        return;
+
+    // Occluders are drawn from both sides, the winding is flipped so the edge functions are positive inside
+    if (area < 0.0f)
+    {
+        math::Swap(v[1], v[2]);
+        area = -area;
+    }
+
+    f32 min_x = math::Max(math::Min(v[0].x, math::Min(v[1].x, v[2].x)), 0.0f);
+    f32 max_x = math::Min(math::Max(v[0].x, math::Max(v[1].x, v[2].x)), (f32)buffer->Width - 1.0f);
+    f32 min_y = math::Max(math::Min(v[0].y, math::Min(v[1].y, v[2].y)), 0.0f);
+    f32 max_y = math::Min(math::Max(v[0].y, math::Max(v[1].y, v[2].y)), (f32)buffer->Height - 1.0f);
+    if (min_x > max_x || min_y > max_y)
+        return;
+
+    for (int i = 0; i < 3; i++)
+    {
+        const Vec3f& a = v[i];
+        const Vec3f& b = v[(i + 1) % 3];
+        out->EdgeA[i] = a.y - b.y;
+        out->EdgeB[i] = b.x - a.x;
+        out->EdgeC[i] = a.x * b.y - b.x * a.y;
+    }
+
+    // z / w is linear in screen space, so depth across the triangle is a plane
+    f32 inv_area = 1.0f / area;
+    out->DepthA = ((v[1].z - v[0].z) * (v[2].y - v[0].y) - (v[2].z - v[0].z) * (v[1].y - v[0].y)) * inv_area;
+    out->DepthB = ((v[1].x - v[0].x) * (v[2].z - v[0].z) - (v[2].x - v[0].x) * (v[1].z - v[0].z)) * inv_area;
+    out->DepthC = v[0].z - out->DepthA * v[0].x - out->DepthB * v[0].y;
+    out->DepthMax = math::Max(v[0].z, math::Max(v[1].z, v[2].z));
+
+    out->MinTileX = (u32)min_x / KRAFT_OCCLUSION_TILE_WIDTH;
+    out->MaxTileX = (u32)max_x / KRAFT_OCCLUSION_TILE_WIDTH;
+    out->MinTileY = (u32)min_y / KRAFT_OCCLUSION_TILE_HEIGHT;
+    out->MaxTileY = (u32)max_y / KRAFT_OCCLUSION_TILE_HEIGHT;
+}
+
+// Coverage mask of the pixel centers of a tile, bit (y * 8 + x) for the pixel at (x, y) of the tile
+static KRAFT_INLINE u32 OcclusionTileCoverage(const OcclusionTriangle& tri, f32 tile_x, f32 tile_y)
+{
+    u32 mask = 0;
+
+#if defined(KRAFT_SIMD_AVX)
+    __m256 px = _mm256_add_ps(_mm256_set1_ps(tile_x), _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f));
+    __m256 step[3];
+    for (int e = 0; e < 3; e++)
+    {
+        step[e] = _mm256_mul_ps(_mm256_set1_ps(tri.EdgeA[e]), px);
+    }
+
+    for (int row = 0; row < KRAFT_OCCLUSION_TILE_HEIGHT; row++)
+    {
+        f32    py = tile_y + (f32)row + 0.5f;
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int e = 0; e < 3; e++)
+        {
+            __m256 value = _mm256_add_ps(step[e], _mm256_set1_ps(tri.EdgeB[e] * py + tri.EdgeC[e]));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(value, _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+
+        mask |= (u32)_mm256_movemask_ps(inside) << (row * KRAFT_OCCLUSION_TILE_WIDTH);
+    }
+#elif defined(KRAFT_SIMD_SSE)
+    __m128 px_lo = _mm_add_ps(_mm_set1_ps(tile_x), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+    __m128 px_hi = _mm_add_ps(_mm_set1_ps(tile_x), _mm_setr_ps(4.5f, 5.5f, 6.5f, 7.5f));
+    __m128 step_lo[3];
+    __m128 step_hi[3];
+    for (int e = 0; e < 3; e++)
+    {
+        __m128 a = _mm_set1_ps(tri.EdgeA[e]);
+        step_lo[e] = _mm_mul_ps(a, px_lo);
+        step_hi[e] = _mm_mul_ps(a, px_hi);
+    }
+
+    for (int row = 0; row < KRAFT_OCCLUSION_TILE_HEIGHT; row++)
+    {
+        f32    py = tile_y + (f32)row + 0.5f;
+        __m128 inside_lo = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        __m128 inside_hi = inside_lo;
+        for (int e = 0; e < 3; e++)
+        {
+            __m128 row_value = _mm_set1_ps(tri.EdgeB[e] * py + tri.EdgeC[e]);
+            inside_lo = _mm_and_ps(inside_lo, _mm_cmpge_ps(_mm_add_ps(step_lo[e], row_value), _mm_setzero_ps()));
+            inside_hi = _mm_and_ps(inside_hi, _mm_cmpge_ps(_mm_add_ps(step_hi[e], row_value), _mm_setzero_ps()));
+        }
+
+        u32 row_mask = (u32)_mm_movemask_ps(inside_lo) | ((u32)_mm_movemask_ps(inside_hi) << 4);
+        mask |= row_mask << (row * KRAFT_OCCLUSION_TILE_WIDTH);
+    }
+#else
+    for (int row = 0; row < KRAFT_OCCLUSION_TILE_HEIGHT; row++)
+    {
+        f32 py = tile_y + (f32)row + 0.5f;
+        for (int column = 0; column < KRAFT_OCCLUSION_TILE_WIDTH; column++)
+        {
+            f32  px = tile_x + (f32)column + 0.5f;
+            bool inside = true;
+            for (int e = 0; e < 3; e++)
+            {
+                inside &= tri.EdgeA[e] * px + tri.EdgeB[e] * py + tri.EdgeC[e] >= 0.0f;
+            }
+
+            mask |= (u32)inside << (row * KRAFT_OCCLUSION_TILE_WIDTH + column);
+        }
+    }
+#endif
+
+    return mask;
+}
+
+// Farthest depth of the triangle over the pixel centers of a tile. The plane is linear, so it is found at one of the
+// corners; it can't be farther than the farthest vertex either, which keeps slivers from extrapolating too far.
+static KRAFT_INLINE f32 OcclusionTileDepth(const OcclusionTriangle& tri, f32 tile_x, f32 tile_y)
+{
+    f32 x0 = tile_x + 0.5f;
+    f32 x1 = tile_x + (f32)KRAFT_OCCLUSION_TILE_WIDTH - 0.5f;
+    f32 y0 = tile_y + 0.5f;
+    f32 y1 = tile_y + (f32)KRAFT_OCCLUSION_TILE_HEIGHT - 0.5f;
+    f32 x = tri.DepthA > 0.0f ? x1 : x0;
+    f32 y = tri.DepthB > 0.0f ? y1 : y0;
+
+    return math::Min(tri.DepthA * x + tri.DepthB * y + tri.DepthC, tri.DepthMax);
+}
+
+// Merges a triangle into a tile, see OcclusionTile
+static KRAFT_INLINE void UpdateOcclusionTile(OcclusionTile* tile, u32 coverage, f32 depth)
+{
+    // Nothing in the tile gets closer
+    if (depth >= tile->ZMax0)
+        return;
+
+    // When the triangle is a lot closer than the working layer, that layer is dropped rather than pushed back. Its
+    // pixels fall back to the reference layer, which bounds every pixel of the tile.
+    if (tile->Mask == 0 || tile->ZMax1 - depth > tile->ZMax0 - tile->ZMax1)
+    {
+        tile->Mask = 0;
+        tile->ZMax1 = depth;
+    }
+    else
+    {
+        tile->ZMax1 = math::Max(tile->ZMax1, depth);
+    }
+
+    tile->Mask |= coverage;
+    if (tile->Mask == KRAFT_OCCLUSION_FULL_MASK)
+    {
+        tile->ZMax0 = tile->ZMax1;
+        tile->ZMax1 = 0.0f;
+        tile->Mask = 0;
+    }
+}
+
+struct OcclusionRasterJobData
+{
+    OcclusionBuffer*    Buffer;
+    const Mat4f*        ViewProjection;
+    const OccluderMesh* Occluders;
+    const u32*          TriangleOffsets;
+    const u32*          VertexOffsets;
+    Vec4f*              ClipVertices;
+    OcclusionTriangle*  Triangles;
+    u32                 TriangleCount;
+};
+
+static void OcclusionSetupJob(void* user_data, u32 start, u32 end)
+{
+    OcclusionRasterJobData* data = (OcclusionRasterJobData*)user_data;
+    for (u32 i = start; i < end; i++)
+    {
+        const OccluderMesh& occluder = data->Occluders[i];
+        Mat4f               model_view_projection = *occluder.ModelMatrix * *data->ViewProjection;
+        Vec4f*              clip = data->ClipVertices + data->VertexOffsets[i];
+        for (u32 j = 0; j < occluder.VertexCount; j++)
+        {
+            clip[j] = OcclusionTransform(model_view_projection, occluder.Vertices[j]);
+        }
+
+        OcclusionTriangle* triangles = data->Triangles + data->TriangleOffsets[i];
+        for (u32 j = 0; j + 2 < occluder.IndexCount; j += 3)
+        {
+            KASSERT(occluder.Indices[j] < occluder.VertexCount && occluder.Indices[j + 1] < occluder.VertexCount && occluder.Indices[j + 2] < occluder.VertexCount);
+            SetupOcclusionTriangle(data->Buffer, clip[occluder.Indices[j]], clip[occluder.Indices[j + 1]], clip[occluder.Indices[j + 2]], &triangles[j / 3]);
+        }
+    }
+}
+
+// Draws every triangle into the tile rows [start, end), in submission order
+static void OcclusionRasterJob(void* user_data, u32 start, u32 end)
+{
+    OcclusionRasterJobData* data = (OcclusionRasterJobData*)user_data;
+    OcclusionBuffer*        buffer = data->Buffer;
+    for (u32 i = 0; i < data->TriangleCount; i++)
+    {
+        const OcclusionTriangle& tri = data->Triangles[i];
+        if (tri.MinTileY > tri.MaxTileY)
+            continue;
+
+        u32 first_row = math::Max(tri.MinTileY, start);
+        u32 last_row = math::Min(tri.MaxTileY, end - 1);
+        for (u32 tile_y = first_row; tile_y <= last_row; tile_y++)
+        {
+            OcclusionTile* row = buffer->Tiles + tile_y * buffer->TilesX;
+            for (u32 tile_x = tri.MinTileX; tile_x <= tri.MaxTileX; tile_x++)
+            {
+                f32 x = (f32)(tile_x * KRAFT_OCCLUSION_TILE_WIDTH);
+                f32 y = (f32)(tile_y * KRAFT_OCCLUSION_TILE_HEIGHT);
+                u32 coverage = OcclusionTileCoverage(tri, x, y);
+                if (coverage == 0)
+                    continue;
+
+                UpdateOcclusionTile(&row[tile_x], coverage, OcclusionTileDepth(tri, x, y));
+            }
+        }
+    }
+}
+
+void RasterizeOccluders(OcclusionBuffer* buffer, const Mat4f& view_projection, const OccluderMesh* occluders, u32 count)
+{
+    if (count == 0)
+        return;
+
+    TempArena Scratch = ScratchBegin(0, 0);
+    u32*      triangle_offsets = ArenaPushArrayNoZero(Scratch.arena, u32, count);
+    u32*      vertex_offsets = ArenaPushArrayNoZero(Scratch.arena, u32, count);
+    u32       triangle_count = 0;
+    u32       vertex_count = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+        triangle_offsets[i] = triangle_count;
+        vertex_offsets[i] = vertex_count;
+        triangle_count += occluders[i].IndexCount / 3;
+        vertex_count += occluders[i].VertexCount;
+    }
+
+    if (triangle_count == 0)
+    {
+        ScratchEnd(Scratch);
+        return;
+    }
+
+    OcclusionRasterJobData data;
+    data.Buffer = buffer;
+    data.ViewProjection = &view_projection;
+    data.Occluders = occluders;
+    data.TriangleOffsets = triangle_offsets;
+    data.VertexOffsets = vertex_offsets;
+    data.ClipVertices = ArenaPushArrayNoZero(Scratch.arena, Vec4f, vertex_count);
+    data.Triangles = ArenaPushArrayNoZero(Scratch.arena, OcclusionTriangle, triangle_count);
+    data.TriangleCount = triangle_count;
+
+    JobSystem::ParallelFor(count, KRAFT_OCCLUSION_SETUP_BATCH_SIZE, OcclusionSetupJob, &data);
+
+    // A few bands per thread, so a band full of triangles doesn't hold up the others
+    u32 band_count = JobSystem::GetThreadCount() * 4;
+    u32 rows_per_band = math::Max(1u, (buffer->TilesY + band_count - 1) / band_count);
+    JobSystem::ParallelFor(buffer->TilesY, rows_per_band, OcclusionRasterJob, &data);
+
+    ScratchEnd(Scratch);
+}
+
+bool IsOccluded(const OcclusionBuffer& buffer, const Mat4f& view_projection, Vec3f center, Vec3f extents)
+{
+    f32 min_x = FLT_MAX;
+    f32 max_x = -FLT_MAX;
+    f32 min_y = FLT_MAX;
+    f32 max_y = -FLT_MAX;
+    f32 nearest = FLT_MAX;
+    for (int i = 0; i < 8; i++)
+    {
+        Vec3f corner = {
+            center.x + ((i & 1) ? extents.x : -extents.x),
+            center.y + ((i & 2) ? extents.y : -extents.y),
+            center.z + ((i & 4) ? extents.z : -extents.z),
+        };
+
+        Vec4f clip = OcclusionTransform(view_projection, corner);
+        if (clip.w < KRAFT_OCCLUSION_MIN_W)
+            return false;
+
+        Vec3f screen = OcclusionClipToScreen(&buffer, clip);
+        min_x = math::Min(min_x, screen.x);
+        max_x = math::Max(max_x, screen.x);
+        min_y = math::Min(min_y, screen.y);
+        max_y = math::Max(max_y, screen.y);
+        nearest = math::Min(nearest, screen.z);
+    }
+
+    // Every pixel the rectangle touches, whether or not it covers the pixel's center
+    // Clamped before the conversion, boxes close to the camera plane project very far out
+    f32 width = (f32)buffer.Width;
+    f32 height = (f32)buffer.Height;
+    i32 first_x = math::Max((i32)floorf(math::Clamp(min_x, -1.0f, width)), 0);
+    i32 last_x = math::Min((i32)floorf(math::Clamp(max_x, -1.0f, width)), (i32)buffer.Width - 1);
+    i32 first_y = math::Max((i32)floorf(math::Clamp(min_y, -1.0f, height)), 0);
+    i32 last_y = math::Min((i32)floorf(math::Clamp(max_y, -1.0f, height)), (i32)buffer.Height - 1);
+    if (first_x > last_x || first_y > last_y)
+        return false;
+
+    for (i32 tile_y = first_y / KRAFT_OCCLUSION_TILE_HEIGHT; tile_y <= last_y / KRAFT_OCCLUSION_TILE_HEIGHT; tile_y++)
+    {
+        // Rows of the tile that the rectangle covers, as a mask of whole rows
+        i32 row_first = math::Max(first_y - tile_y * KRAFT_OCCLUSION_TILE_HEIGHT, 0);
+        i32 row_last = math::Min(last_y - tile_y * KRAFT_OCCLUSION_TILE_HEIGHT, KRAFT_OCCLUSION_TILE_HEIGHT - 1);
+        u32 row_mask = 0;
+        for (i32 row = row_first; row <= row_last; row++)
+        {
+            row_mask |= 0xFFu << (row * KRAFT_OCCLUSION_TILE_WIDTH);
+        }
+
+        for (i32 tile_x = first_x / KRAFT_OCCLUSION_TILE_WIDTH; tile_x <= last_x / KRAFT_OCCLUSION_TILE_WIDTH; tile_x++)
+        {
+            i32 column_first = math::Max(first_x - tile_x * KRAFT_OCCLUSION_TILE_WIDTH, 0);
+            i32 column_last = math::Min(last_x - tile_x * KRAFT_OCCLUSION_TILE_WIDTH, KRAFT_OCCLUSION_TILE_WIDTH - 1);
+            u32 column_bits = (0xFFu >> (KRAFT_OCCLUSION_TILE_WIDTH - 1 - column_last)) & (0xFFu << column_first);
+            u32 rect_mask = row_mask & (column_bits * 0x01010101u);
+
+            // Pixels of the working layer are bounded by it, every other pixel by the reference layer
+            const OcclusionTile& tile = buffer.Tiles[tile_y * buffer.TilesX + tile_x];
+            f32                  farthest = (rect_mask & ~tile.Mask) ? tile.ZMax0 : -FLT_MAX;
+            if (rect_mask & tile.Mask)
+            {
+                farthest = math::Max(farthest, tile.ZMax1);
+            }
+
+            if (nearest <= farthest)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+u32 CullOccludedBounds(const OcclusionBuffer& buffer, const Mat4f& view_projection, const CullingBounds& bounds, u32 start, u32 end, u8* visible)
+{
+    u32 occluded_count = 0;
+    for (u32 i = start; i < end; i++)
+    {
+        if (!visible[i])
+            continue;
+
+        Vec3f center = { bounds.CenterX[i], bounds.CenterY[i], bounds.CenterZ[i] };
+        Vec3f extents = { bounds.ExtentX[i], bounds.ExtentY[i], bounds.ExtentZ[i] };
+
+        // Bounds that aren't known are as large as they can get
+        if (extents.x == FLT_MAX)
+            continue;
+
+        if (IsOccluded(buffer, view_projection, center, extents))
+        {
+            visible[i] = 0;
+            occluded_count++;
+        }
+    }
+
+    return occluded_count;
+}
+
+void BuildBoxOccluder(Vec3f center, Vec3f extents, Vec3f* out_vertices, u32* out_indices)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        out_vertices[i] = {
+            center.x + ((i & 1) ? extents.x : -extents.x),
+            center.y + ((i & 2) ? extents.y : -extents.y),
+            center.z + ((i & 4) ? extents.z : -extents.z),
+        };
+    }
+
+    // Two triangles per face; occluders are drawn from both sides, so the winding doesn't matter
+    static const u32 box_indices[36] = {
+        0, 1, 3, 0, 3, 2, // -z
+        4, 6, 7, 4, 7, 5, // +z
+        0, 4, 5, 0, 5, 1, // -y
+        2, 3, 7, 2, 7, 6, // +y
+        0, 2, 6, 0, 6, 4, // -x
+        1, 5, 7, 1, 7, 3, // +x
+    };
+
+    MemCpy(out_indices, box_indices, sizeof(box_indices));
+}
+
+} // namespace kraft::r
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "core/kraft_core.h"
+#include "core/kraft_math.h"
+
+namespace kraft {
+struct ArenaAllocator;
+}
+
+namespace kraft::r {
+
+struct CullingBounds;
+
+// Occluders are rasterized into tiles of 8x4 pixels, one bit of a 32 bit coverage mask per pixel
+#define KRAFT_OCCLUSION_TILE_WIDTH  8
+#define KRAFT_OCCLUSION_TILE_HEIGHT 4
+
+// Default resolution of the occlusion buffer; it doesn't have to match the aspect ratio of the screen
+#define KRAFT_OCCLUSION_BUFFER_WIDTH  256
+#define KRAFT_OCCLUSION_BUFFER_HEIGHT 128
+
+// Depth of a tile stored as two layers. The reference layer (ZMax0) is the farthest depth of every pixel in the tile,
+// the working layer (ZMax1) the farthest depth of the pixels in `Mask` that occluders have been drawn to since the
+// layers were last merged. Once the working layer covers the whole tile it replaces the reference layer.
+struct OcclusionTile
+{
+    f32 ZMax0;
+    f32 ZMax1;
+    u32 Mask;
+};
+
+// Low resolution depth buffer filled with occluders and tested against on the CPU. Depth is z / w of the clip space
+// position, larger is farther.
+struct OcclusionBuffer
+{
+    u32            Width;
+    u32            Height;
+    u32            TilesX;
+    u32            TilesY;
+    OcclusionTile* Tiles;
+};
+
+// Triangle list in object space. Occluders must fit inside the geometry they stand for, everything behind them is
+// assumed to be hidden.
+struct OccluderMesh
+{
+    const Vec3f* Vertices;
+    const u32*   Indices;
+    u32          VertexCount;
+    u32          IndexCount;
+    const Mat4f* ModelMatrix;
+};
+
+// Allocates a buffer of at least `width` x `height` pixels (rounded up to whole tiles) from `arena` and clears it
+OcclusionBuffer CreateOcclusionBuffer(ArenaAllocator* arena, u32 width, u32 height);
+void            ClearOcclusionBuffer(OcclusionBuffer* buffer);
+
+// Rasterizes the occluders into the buffer. The triangles are set up on the worker threads and then drawn by bands
+// of tile rows, so no two threads ever touch the same tile. Triangles that cross the camera plane are skipped, which
+// only makes the buffer less complete. Blocks until every occluder has been drawn.
+void RasterizeOccluders(OcclusionBuffer* buffer, const Mat4f& view_projection, const OccluderMesh* occluders, u32 count);
+
+// Tests the world space box of an object against the buffer. Returns true when every pixel the box covers on screen
+// is closer than its nearest point; boxes that cross the camera plane or leave the screen are never occluded.
+bool IsOccluded(const OcclusionBuffer& buffer, const Mat4f& view_projection, Vec3f center, Vec3f extents);
+
+// Tests the objects in [start, end) that are marked visible in `visible` and sets the occluded ones to 0. Only reads
+// the buffer, so several threads can test at once. Returns the number of objects that were occluded.
+u32 CullOccludedBounds(const OcclusionBuffer& buffer, const Mat4f& view_projection, const CullingBounds& bounds, u32 start, u32 end, u8* visible);
+
+// Writes the 8 vertices and 36 indices of a box, used to build occluders for box-like geometry
+void BuildBoxOccluder(Vec3f center, Vec3f extents, Vec3f* out_vertices, u32* out_indices);
+
+} // namespace kraft::r
@@ -0,0 +1,204 @@
+#include "kraft_render_queue.h"
+
+#include <containers/kraft_array.h>
+#include <core/kraft_allocators.h>
+#include <core/kraft_jobs.h>
+#include <core/kraft_math.h>
+#include <core/kraft_memory.h>
+#include <renderer/kraft_renderer_types.h>
+
+namespace kraft::r {
+
+// Queues smaller than this are sorted on the calling thread, the job overhead isn't worth it
+#define KRAFT_RENDER_QUEUE_PARALLEL_SORT_THRESHOLD 4096
+
+// Smallest number of items a sort job works on
+#define KRAFT_RENDER_QUEUE_SORT_CHUNK_SIZE 2048
+
+#define KRAFT_RENDER_QUEUE_RADIX_BITS    8
+#define KRAFT_RENDER_QUEUE_RADIX_BUCKETS (1 << KRAFT_RENDER_QUEUE_RADIX_BITS)
+
+u16 QuantizeSortDepth(f32 depth)
+{
+    // Also catches NaNs
+    if (!(depth > 0.0f))
+        return 0;
+
+    // Positive floats sort the same way as their bit patterns. Dropping the sign and keeping the next 16 bits
+    // leaves the exponent and 7 bits of mantissa, which is plenty to order draws.
+    u32 bits;
+    MemCpy(&bits, &depth, sizeof(bits));
+
+    return (u16)(bits >> 15);
+}
+
+u64 MakeRenderSortKey(RenderQueueLayer::Enum layer, u32 shader_id, u32 material_id, u32 geometry_hash, f32 depth)
+{
+    u64 shader = (u64)(shader_id & ((1u << KRAFT_RENDER_QUEUE_SHADER_BITS) - 1));
+    u64 material = (u64)(material_id & ((1u << KRAFT_RENDER_QUEUE_MATERIAL_BITS) - 1));
+    u64 geometry = (u64)(geometry_hash & ((1u << KRAFT_RENDER_QUEUE_GEOMETRY_BITS) - 1));
+    u64 quantized_depth = (u64)QuantizeSortDepth(depth);
+
+    u64 key = (u64)layer << KRAFT_RENDER_QUEUE_LAYER_SHIFT;
+    if (layer == RenderQueueLayer::Blended)
+    {
+        // Farthest first
+        u64 inverted_depth = (~quantized_depth) & ((1ull << KRAFT_RENDER_QUEUE_DEPTH_BITS) - 1);
+        key |= inverted_depth << (KRAFT_RENDER_QUEUE_LAYER_SHIFT - KRAFT_RENDER_QUEUE_DEPTH_BITS);
+        key |= shader << (KRAFT_RENDER_QUEUE_MATERIAL_BITS + KRAFT_RENDER_QUEUE_GEOMETRY_BITS);
+        key |= material << KRAFT_RENDER_QUEUE_GEOMETRY_BITS;
+        key |= geometry;
+    }
+    else
+    {
+        key |= shader << (KRAFT_RENDER_QUEUE_MATERIAL_BITS + KRAFT_RENDER_QUEUE_GEOMETRY_BITS + KRAFT_RENDER_QUEUE_DEPTH_BITS);
+        key |= material << (KRAFT_RENDER_QUEUE_GEOMETRY_BITS + KRAFT_RENDER_QUEUE_DEPTH_BITS);
+        key |= geometry << KRAFT_RENDER_QUEUE_DEPTH_BITS;
+        key |= quantized_depth;
+    }
+
+    return key;
+}
+
+void RenderQueuePush(RenderQueue* queue, const Renderable& renderable, u64 key)
+{
+    RenderQueueItem item = {
+        .Key = key,
+        .Index = (u32)queue->Renderables.Length,
+    };
+
+    queue->Renderables.Push(renderable);
+    queue->Items.Push(item);
+}
+
+void RenderQueueClear(RenderQueue* queue)
+{
+    queue->Renderables.Clear();
+    queue->Items.Clear();
+}
+
+struct RadixSortJobData
+{
+    const RenderQueueItem* Src;
+    RenderQueueItem*       Dst;
+    u32                    Count;
+    u32                    ChunkSize;
+    u32                    Shift;
+
+    // One histogram per chunk; turned into the chunk's first output offset for every digit before the scatter
+    u32* Histograms;
+};
+
+static KRAFT_INLINE u32 RadixDigit(u64 key, u32 shift)
+{
+    return (u32)(key >> shift) & (KRAFT_RENDER_QUEUE_RADIX_BUCKETS - 1);
+}
+
+static void RadixHistogramJob(void* user_data, u32 start, u32 end)
+{
+    RadixSortJobData* Data = (RadixSortJobData*)user_data;
+    for (u32 chunk = start; chunk < end; chunk++)
+    {
+        u32* histogram = Data->Histograms + chunk * KRAFT_RENDER_QUEUE_RADIX_BUCKETS;
+        MemZero(histogram, sizeof(u32) * KRAFT_RENDER_QUEUE_RADIX_BUCKETS);
+
+        u32 first = chunk * Data->ChunkSize;
+        u32 last = math::Min(first + Data->ChunkSize, Data->Count);
+        for (u32 i = first; i < last; i++)
+        {
+            histogram[RadixDigit(Data->Src[i].Key, Data->Shift)]++;
+        }
+    }
+}
+
+static void RadixScatterJob(void* user_data, u32 start, u32 end)
+{
+    RadixSortJobData* Data = (RadixSortJobData*)user_data;
+    for (u32 chunk = start; chunk < end; chunk++)
+    {
+        u32* offsets = Data->Histograms + chunk * KRAFT_RENDER_QUEUE_RADIX_BUCKETS;
+
+        u32 first = chunk * Data->ChunkSize;
+        u32 last = math::Min(first + Data->ChunkSize, Data->Count);
+        for (u32 i = first; i < last; i++)
+        {
+            const RenderQueueItem& item = Data->Src[i];
+            Data->Dst[offsets[RadixDigit(item.Key, Data->Shift)]++] = item;
+        }
+    }
+}
+
+void RenderQueueSort(RenderQueue* queue)
+{
+    u32 count = (u32)queue->Items.Length;
+    if (count < 2)
+        return;
+
+    queue->SortScratch.Resize(count);
+
+    // Every chunk is scattered by a single job, so the chunks have to be contiguous and processed in order
+    // within themselves for the sort to stay stable
+    u32 chunk_count = 1;
+    if (count >= KRAFT_RENDER_QUEUE_PARALLEL_SORT_THRESHOLD)
+    {
+        chunk_count = math::Min(JobSystem::GetThreadCount(), count / KRAFT_RENDER_QUEUE_SORT_CHUNK_SIZE);
+        chunk_count = math::Max(chunk_count, 1u);
+    }
+
+    TempArena        scratch = ScratchBegin(0, 0);
+    RadixSortJobData data = {
+        .Src = queue->Items.Data(),
+        .Dst = queue->SortScratch.Data(),
+        .Count = count,
+        .ChunkSize = (count + chunk_count - 1) / chunk_count,
+        .Shift = 0,
+        .Histograms = ArenaPushArrayNoZero(scratch.arena, u32, chunk_count * KRAFT_RENDER_QUEUE_RADIX_BUCKETS),
+    };
+
+    // Bits that are the same in every key don't need a pass; in practice the layer and most of the depth are
+    u64 all_ones = ~0ull;
+    u64 all_zeros = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+        all_ones &= data.Src[i].Key;
+        all_zeros |= data.Src[i].Key;
+    }
+
+    u64 varying_bits = all_ones ^ all_zeros;
+    for (u32 shift = 0; shift < 64; shift += KRAFT_RENDER_QUEUE_RADIX_BITS)
+    {
+        if (RadixDigit(varying_bits, shift) == 0)
+            continue;
+
+        data.Shift = shift;
+        JobSystem::ParallelFor(chunk_count, 1, RadixHistogramJob, &data);
+
+        // Exclusive prefix sum, digit major so that lower chunks come first within a bucket
+        u32 offset = 0;
+        for (u32 digit = 0; digit < KRAFT_RENDER_QUEUE_RADIX_BUCKETS; digit++)
+        {
+            for (u32 chunk = 0; chunk < chunk_count; chunk++)
+            {
+                u32& bucket = data.Histograms[chunk * KRAFT_RENDER_QUEUE_RADIX_BUCKETS + digit];
+                u32  bucket_count = bucket;
+                bucket = offset;
+                offset += bucket_count;
+            }
+        }
+
+        JobSystem::ParallelFor(chunk_count, 1, RadixScatterJob, &data);
+
+        RenderQueueItem* sorted = data.Dst;
+        data.Dst = (RenderQueueItem*)data.Src;
+        data.Src = sorted;
+    }
+
+    if (data.Src != queue->Items.Data())
+    {
+        MemCpy(queue->Items.Data(), data.Src, sizeof(RenderQueueItem) * count);
+    }
+
+    ScratchEnd(scratch);
+}
+
+} // namespace kraft::r
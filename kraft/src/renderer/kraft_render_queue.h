@@ -0,0 +1,57 @@
+#pragma once
+
+#include "core/kraft_core.h"
+
+namespace kraft::r {
+
+struct Renderable;
+
+namespace RenderQueueLayer {
+enum Enum : u8
+{
+    Opaque = 0,
+    Blended = 1,
+    Count
+};
+} // namespace RenderQueueLayer
+
+// Draws are sorted by a single 64 bit key, most significant bits first:
+//
+//   Opaque:  | layer (2) | shader (14) | material (16) | geometry (16) | depth (16)          |
+//   Blended: | layer (2) | inverted depth (16)          | shader (14)   | material (16) | geometry (16) |
+//
+// Opaque draws are grouped by state so consecutive draws share the pipeline and descriptors, and are drawn
+// front to back within a group. Blended draws have to be composited in order, so they are drawn back to front.
+#define KRAFT_RENDER_QUEUE_LAYER_SHIFT    62
+#define KRAFT_RENDER_QUEUE_SHADER_BITS    14
+#define KRAFT_RENDER_QUEUE_MATERIAL_BITS  16
+#define KRAFT_RENDER_QUEUE_GEOMETRY_BITS  16
+#define KRAFT_RENDER_QUEUE_DEPTH_BITS     16
+
+struct RenderQueueItem
+{
+    u64 Key;
+    u32 Index; // Index of the renderable in RenderQueue::Renderables
+};
+
+// Renderables are stored in submission order and never moved, only the small items are sorted
+struct RenderQueue
+{
+    Array<Renderable>      Renderables;
+    Array<RenderQueueItem> Items;
+    Array<RenderQueueItem> SortScratch;
+};
+
+// Maps a view distance to 16 bits that sort in the same order
+u16 QuantizeSortDepth(f32 depth);
+
+u64 MakeRenderSortKey(RenderQueueLayer::Enum layer, u32 shader_id, u32 material_id, u32 geometry_hash, f32 depth);
+
+void RenderQueuePush(RenderQueue* queue, const Renderable& renderable, u64 key);
+
+// Stable radix sort of the items by key; large queues are histogrammed and scattered across the job system
+void RenderQueueSort(RenderQueue* queue);
+
+void RenderQueueClear(RenderQueue* queue);
+
+} // namespace kraft::r
@@ -13,6 +13,7 @@
 #include <renderer/kraft_renderer_types.h>
 #include <world/kraft_world_includes.h>
 
+#include <shaderfx/kraft_shaderfx.h>
 #include <shaderfx/kraft_shaderfx_types.h>
 
 #include <platform/kraft_platform_includes.h>
@@ -26,56 +27,198 @@ r::GPUDevice*        g_Device = nullptr;
 
 namespace kraft::r {
 
-using Renderables = FlatHashMap<ResourceID, Array<Renderable>>;
+// Every surface that begins in a frame draws from its own queue. The queues live for the lifetime of the
+// renderer so their storage is reused from one frame to the next.
+#define KRAFT_MAX_RENDER_SURFACES 16
 
 struct RenderDataT
 {
     RenderSurface Surface;
-    Renderables   Renderables;
+    RenderQueue*  Queue;
 };
 
 struct ResourceManager* ResourceManager = nullptr;
 
+// Buffers replaced by a grow or a compaction may still be read by the frames in flight,
+// they are destroyed once all of those have finished
+#define KRAFT_RETIRED_BUFFER_FRAME_DELAY 4
+
+struct RetiredBuffer
+{
+    Handle<Buffer> buffer;
+    u64            frame_number;
+};
+
+struct GeometryBuffer
+{
+    Handle<Buffer> buffer;
+    GeometryHeap   heap;
+    const char*    debug_name;
+    u64            usage_flags;
+};
+
+// Indirect draws of a culled surface, drawn again with the late commands once the late culling pass has run
+struct LateDrawBatch
+{
+    u32             ShaderId;
+    u32             FirstCommand;
+    u32             CommandCount;
+    IndexType::Enum IndexType;
+};
+
 struct RendererFrontendPrivate
 {
-    Renderables        renderables;
+    RenderQueue        queue;
+    RenderQueue        surface_queues[KRAFT_MAX_RENDER_SURFACES];
     Array<RenderDataT> surfaces;
     RendererBackend*   backend = nullptr;
     int                active_surface = -1;
     int                current_frame_index = -1;
     ArenaAllocator*    arena;
 
-    Handle<Buffer> vertex_buffer;
-    Handle<Buffer> index_buffer;
-    u32            current_vertex_buffer_offset;
-    u32            current_index_buffer_offset;
+    GeometryBuffer       vertex_buffer;
+    GeometryBuffer       index_buffer;
+    Array<RetiredBuffer> retired_buffers;
+    u64                  frame_number;
     Handle<Buffer> global_ubo_buffer;
     Handle<Buffer> materials_gpu_buffer;
     Handle<Buffer> materials_staging_buffer[3];
+
+    // Per-instance data of instanced draws; one persistently mapped buffer per frame in flight
+    Handle<Buffer> instance_buffers[3];
+    InstanceData*  instance_data;
+    u32            instance_count;
+    u32            max_instances;
+    bool           instance_overflow_reported;
+
+    // Draw commands of instanced draws when the device supports multi draw indirect; one per frame in flight.
+    // Every command draws at least one instance, so it never holds more commands than there are instances.
+    Handle<Buffer>              indirect_buffers[3];
+    DrawIndexedIndirectCommand* indirect_commands;
+    u32                         indirect_command_count;
+
+    // Quads of sprite batches; a single persistently mapped ring with a segment of max_sprites for every frame in
+    // flight. Batches reserve their space in the current frame's segment, which starts at sprite_ring_offset.
+    Handle<Buffer>  sprite_buffer;
+    SpriteInstance* sprite_data;
+    u32             sprite_ring_offset;
+    u32             sprite_count;
+    u32             max_sprites;
+    bool            sprite_overflow_reported;
+
+    // Every sprite is an instance of this quad; the vertex shader builds the corners from the vertex index
+    Geometry sprite_quad;
+
+    // GPU culling is set up along with the first surface that can use it, see RendererOptions::GPUCulling.
+    // Indirect draws of culled surfaces are replayed with the late commands once the late pass has run.
+    bool                 gpu_culling_initialized;
+    bool                 gpu_culling_available;
+    Array<LateDrawBatch> late_draw_batches;
 } renderer_data_internal;
 
-void RendererFrontend::Init()
+static void CreateGeometryBuffer(GeometryBuffer* out, const char* debug_name, u64 size, u64 usage_flags)
 {
-    const u64 vertex_buffer_size = sizeof(Vertex3D) * 1024 * 256;
-    renderer_data_internal.vertex_buffer = ResourceManager->CreateBuffer({
-        .DebugName = "GlobalVertexBuffer",
-        .Size = vertex_buffer_size,
-        .UsageFlags = BUFFER_USAGE_FLAGS_STORAGE_BUFFER |
-                      BUFFER_USAGE_FLAGS_TRANSFER_DST, // | BufferUsageFlags::BUFFER_USAGE_FLAGS_SHADER_DEVICE_ADDRESS,
+    // Growing and compacting copy the buffer on the GPU, so it has to be a transfer source as well
+    out->debug_name = debug_name;
+    out->usage_flags = usage_flags | BUFFER_USAGE_FLAGS_TRANSFER_SRC | BUFFER_USAGE_FLAGS_TRANSFER_DST;
+    out->buffer = ResourceManager->CreateBuffer({
+        .DebugName = debug_name,
+        .Size = size,
+        .UsageFlags = out->usage_flags,
         .MemoryPropertyFlags = MEMORY_PROPERTY_FLAGS_DEVICE_LOCAL,
-        // .MemoryAllocationFlags = MemoryAllocateFlags::MEMORY_ALLOCATE_DEVICE_ADDRESS,
     });
 
-    const u64 index_buffer_size = sizeof(u32) * 1024 * 256;
-    renderer_data_internal.index_buffer = ResourceManager->CreateBuffer({
-        .DebugName = "GlobalIndexBuffer",
-        .Size = index_buffer_size,
-        .UsageFlags = BUFFER_USAGE_FLAGS_TRANSFER_DST | BUFFER_USAGE_FLAGS_INDEX_BUFFER,
+    GeometryHeapInit(&out->heap, size);
+}
+
+static void RetireBuffer(Handle<Buffer> buffer)
+{
+    renderer_data_internal.retired_buffers.Push({
+        .buffer = buffer,
+        .frame_number = renderer_data_internal.frame_number,
+    });
+}
+
+static void DestroyRetiredBuffers(bool force)
+{
+    for (u64 i = 0; i < renderer_data_internal.retired_buffers.Length;)
+    {
+        const RetiredBuffer& retired = renderer_data_internal.retired_buffers[i];
+        if (force || retired.frame_number + KRAFT_RETIRED_BUFFER_FRAME_DELAY <= renderer_data_internal.frame_number)
+        {
+            ResourceManager->DestroyBuffer(retired.buffer);
+            renderer_data_internal.retired_buffers.Pop(i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+// Replaces the buffer with a larger one that can fit at least `required_size` more bytes.
+// The old contents are copied over on the GPU, offsets don't change.
+static bool GrowGeometryBuffer(GeometryBuffer* geometry_buffer, u64 required_size)
+{
+    u64 old_capacity = geometry_buffer->heap.Capacity;
+    u64 new_capacity = math::Max(old_capacity * 2, old_capacity + required_size);
+
+    Handle<Buffer> new_buffer = ResourceManager->CreateBuffer({
+        .DebugName = geometry_buffer->debug_name,
+        .Size = new_capacity,
+        .UsageFlags = geometry_buffer->usage_flags,
         .MemoryPropertyFlags = MEMORY_PROPERTY_FLAGS_DEVICE_LOCAL,
     });
 
-    renderer_data_internal.current_vertex_buffer_offset = 0;
-    renderer_data_internal.current_index_buffer_offset = 0;
+    if (new_buffer.IsInvalid())
+    {
+        KERROR("[GrowGeometryBuffer]: Failed to grow '%s' to %llu bytes", geometry_buffer->debug_name, new_capacity);
+        return false;
+    }
+
+    // Pending uploads may still be writing to the old buffer; flush them so the copy sees them
+    // and so nothing recorded after this point has to be ordered against the copy
+    ResourceManager->FlushUploads();
+    ResourceManager->UploadBuffer({
+        .DstBuffer = new_buffer,
+        .SrcBuffer = geometry_buffer->buffer,
+        .SrcSize = old_capacity,
+        .DstOffset = 0,
+        .SrcOffset = 0,
+    });
+    ResourceManager->FlushUploads();
+
+    KDEBUG("[GrowGeometryBuffer]: Grew '%s' from %llu to %llu bytes", geometry_buffer->debug_name, old_capacity, new_capacity);
+
+    RetireBuffer(geometry_buffer->buffer);
+    geometry_buffer->buffer = new_buffer;
+    GeometryHeapGrow(&geometry_buffer->heap, new_capacity);
+
+    return true;
+}
+
+static bool AllocateGeometryRange(GeometryBuffer* geometry_buffer, u64 size, u64 alignment, const void* owner, u64* out_offset)
+{
+    if (GeometryHeapAllocate(&geometry_buffer->heap, size, alignment, owner, out_offset))
+        return true;
+
+    // Worst case the new free space gets `alignment - 1` bytes of padding in front
+    if (!GrowGeometryBuffer(geometry_buffer, size + alignment))
+        return false;
+
+    return GeometryHeapAllocate(&geometry_buffer->heap, size, alignment, owner, out_offset);
+}
+
+void RendererFrontend::Init()
+{
+    // Both buffers start out at this size and grow when they run out of space
+    const u64 vertex_buffer_size = sizeof(Vertex3D) * 1024 * 256;
+    CreateGeometryBuffer(&renderer_data_internal.vertex_buffer, "GlobalVertexBuffer", vertex_buffer_size, BUFFER_USAGE_FLAGS_STORAGE_BUFFER);
+
+    const u64 index_buffer_size = sizeof(u32) * 1024 * 256;
+    CreateGeometryBuffer(&renderer_data_internal.index_buffer, "GlobalIndexBuffer", index_buffer_size, BUFFER_USAGE_FLAGS_INDEX_BUFFER);
+
+    renderer_data_internal.frame_number = 0;
 
     u64 MaterialsBufferSize = this->Settings->MaxMaterials * this->Settings->MaterialBufferSize;
     renderer_data_internal.materials_gpu_buffer = ResourceManager->CreateBuffer({
@@ -98,6 +241,68 @@ void RendererFrontend::Init()
         });
     }
 
+    u64 instance_memory_flags = MemoryPropertyFlags::MEMORY_PROPERTY_FLAGS_HOST_VISIBLE | MemoryPropertyFlags::MEMORY_PROPERTY_FLAGS_HOST_COHERENT;
+    if (g_Device->supports_device_local_host_visible)
+    {
+        instance_memory_flags |= MemoryPropertyFlags::MEMORY_PROPERTY_FLAGS_DEVICE_LOCAL;
+    }
+
+    renderer_data_internal.max_instances = this->Settings->MaxInstancesPerFrame;
+    for (int i = 0; i < KRAFT_C_ARRAY_SIZE(renderer_data_internal.instance_buffers); i++)
+    {
+        renderer_data_internal.instance_buffers[i] = ResourceManager->CreateBuffer({
+            .DebugName = "InstanceBuffer",
+            .Size = sizeof(InstanceData) * renderer_data_internal.max_instances,
+            .UsageFlags = BufferUsageFlags::BUFFER_USAGE_FLAGS_STORAGE_BUFFER,
+            .MemoryPropertyFlags = instance_memory_flags,
+            .SharingMode = SharingMode::Exclusive,
+            .MapMemory = true,
+        });
+    }
+
+    if (g_Device->supports_multi_draw_indirect)
+    {
+        // Culled surfaces keep the commands of their late pass max_instances after the early ones
+        u32 max_indirect_commands = renderer_data_internal.max_instances;
+        if (this->Settings->GPUCulling)
+        {
+            max_indirect_commands *= 2;
+        }
+
+        for (int i = 0; i < KRAFT_C_ARRAY_SIZE(renderer_data_internal.indirect_buffers); i++)
+        {
+            renderer_data_internal.indirect_buffers[i] = ResourceManager->CreateBuffer({
+                .DebugName = "IndirectBuffer",
+                .Size = sizeof(DrawIndexedIndirectCommand) * max_indirect_commands,
+                .UsageFlags = BufferUsageFlags::BUFFER_USAGE_FLAGS_INDIRECT_BUFFER | BufferUsageFlags::BUFFER_USAGE_FLAGS_STORAGE_BUFFER,
+                .MemoryPropertyFlags = instance_memory_flags,
+                .SharingMode = SharingMode::Exclusive,
+                .MapMemory = true,
+            });
+        }
+    }
+
+    renderer_data_internal.max_sprites = this->Settings->MaxSpritesPerFrame;
+    renderer_data_internal.sprite_buffer = ResourceManager->CreateBuffer({
+        .DebugName = "SpriteBuffer",
+        .Size = sizeof(SpriteInstance) * renderer_data_internal.max_sprites * KRAFT_C_ARRAY_SIZE(renderer_data_internal.instance_buffers),
+        .UsageFlags = BufferUsageFlags::BUFFER_USAGE_FLAGS_STORAGE_BUFFER,
+        .MemoryPropertyFlags = instance_memory_flags,
+        .SharingMode = SharingMode::Exclusive,
+        .MapMemory = true,
+    });
+    renderer_data_internal.sprite_data = (SpriteInstance*)ResourceManager->GetBufferData(renderer_data_internal.sprite_buffer);
+
+    // Same winding and corner order as the quads sprite batches used to build on the CPU
+    Vertex2D sprite_quad_vertices[4] = {
+        { .Position = { 1.0f, 1.0f }, .UV = { 1.0f, 1.0f }, .Color = Vec4fOne },
+        { .Position = { 1.0f, 0.0f }, .UV = { 1.0f, 0.0f }, .Color = Vec4fOne },
+        { .Position = { 0.0f, 0.0f }, .UV = { 0.0f, 0.0f }, .Color = Vec4fOne },
+        { .Position = { 0.0f, 1.0f }, .UV = { 0.0f, 1.0f }, .Color = Vec4fOne },
+    };
+    u16 sprite_quad_indices[6] = { 0, 1, 2, 2, 3, 0 };
+    this->CreateGeometry(&renderer_data_internal.sprite_quad, 4, sprite_quad_vertices, sizeof(Vertex2D), 6, sprite_quad_indices, sizeof(u16));
+
     renderer_data_internal.global_ubo_buffer = ResourceManager->CreateBuffer({
         .DebugName = "GlobalUBO",
         .Size = sizeof(GlobalShaderData),
@@ -119,10 +324,34 @@ struct __DrawData
     // u64   vertex_buffer_address;
 } DummyDrawData;
 
+Mat4f GeometryModelMatrix(const Mat4f& model, const GeometryDrawData& draw_data)
+{
+    f32 scale = draw_data.PositionDequantization.w;
+    if (scale == 0.0f)
+        return model;
+
+    // Scale then translate the snorm16 position back into object space, before the model transform
+    Mat4f dequantize(Identity);
+    dequantize._data[0] = scale;
+    dequantize._data[5] = scale;
+    dequantize._data[10] = scale;
+    dequantize[3][0] = draw_data.PositionDequantization.x;
+    dequantize[3][1] = draw_data.PositionDequantization.y;
+    dequantize[3][2] = draw_data.PositionDequantization.z;
+
+    return dequantize * model;
+}
+
 void RendererFrontend::DrawSingle(Shader* shader, GlobalShaderData* ubo, u32 geometry_id)
 {
     KASSERT(renderer_data_internal.current_frame_index >= 0 && renderer_data_internal.current_frame_index < 3);
 
+    // The pipelines are still being created - skip
+    if (!shader->Ready)
+    {
+        return;
+    }
+
     MemCpy(
         (void*)ResourceManager->GetBufferData(renderer_data_internal.global_ubo_buffer),
         (void*)ubo,
@@ -134,8 +363,9 @@ void RendererFrontend::DrawSingle(Shader* shader, GlobalShaderData* ubo, u32 geo
         shader,
         renderer_data_internal.global_ubo_buffer,
         renderer_data_internal.materials_gpu_buffer,
-        renderer_data_internal.vertex_buffer,
-        renderer_data_internal.index_buffer
+        renderer_data_internal.vertex_buffer.buffer,
+        renderer_data_internal.index_buffer.buffer,
+        Handle<Buffer>::Invalid()
     );
 
     DummyDrawData.Model = ScaleMatrix(vec3{ 1920.0f * 1.2f, 945.0f * 1.2f, 1.0f });
@@ -146,83 +376,625 @@ void RendererFrontend::DrawSingle(Shader* shader, GlobalShaderData* ubo, u32 geo
     renderer_data_internal.backend->DrawGeometryData({});
 }
 
-void RendererFrontend::Draw(GlobalShaderData* global_ubo)
+static u64 RenderableSortKey(const Renderable& renderable, const Camera* camera)
 {
-    KASSERT(renderer_data_internal.current_frame_index >= 0 && renderer_data_internal.current_frame_index < 3);
+    const Shader* shader = renderable.MaterialInstance->Shader;
 
-    MemCpy(
-        (void*)ResourceManager->GetBufferData(renderer_data_internal.global_ubo_buffer),
-        (void*)global_ubo,
-        sizeof(GlobalShaderData)
-    );
+    // The variant used for a surface is only known once the surface is drawn, so every variant of a shader sorts
+    // together; the blend state of the first variant decides which layer the draw goes into
+    RenderQueueLayer::Enum layer = RenderQueueLayer::Opaque;
+    if (shader->ShaderEffect.variant_count > 0 && shader->ShaderEffect.variants[0].render_state &&
+        shader->ShaderEffect.variants[0].render_state->blend_enable)
+    {
+        layer = RenderQueueLayer::Blended;
+    }
 
-    for (auto It = renderer_data_internal.renderables.begin(); It != renderer_data_internal.renderables.end(); It++)
+    // Squared distance to the camera; it orders draws the same way as the distance
+    f32 depth = 0.0f;
+    if (camera)
     {
-        Shader* shader = ShaderSystem::BindByID(It->first);
-        if (!shader)
-        {
-            It->second.Clear();
-            continue;
-        }
+        const Mat4f& model = renderable.ModelMatrix;
+        Vec3f        offset = Vec3f{ model[3][0], model[3][1], model[3][2] } - camera->Position;
+        depth = LengthSquared(offset);
+    }
+
+    const GeometryDrawData& draw_data = renderable.DrawData;
+    u32                     geometry_hash = (draw_data.IndexBufferOffset * 2654435761u) ^ draw_data.VertexOffset;
+    geometry_hash ^= geometry_hash >> 16;
+
+    return MakeRenderSortKey(layer, shader->ID, renderable.MaterialInstance->ID, geometry_hash, depth);
+}
+
+static KRAFT_INLINE bool IsInstancedVariant(const Shader* shader, i32 variant_index)
+{
+    return variant_index >= 0 && shader->ShaderEffect.variants[variant_index].instance_buffer != nullptr;
+}
+
+// Draws of the same geometry with the same material can be merged into one instanced draw
+static KRAFT_INLINE bool CanInstanceTogether(const Renderable& a, const Renderable& b)
+{
+    return a.MaterialInstance == b.MaterialInstance && a.DrawData.IndexBufferOffset == b.DrawData.IndexBufferOffset &&
+           a.DrawData.IndexCount == b.DrawData.IndexCount && a.DrawData.VertexOffset == b.DrawData.VertexOffset &&
+           a.DrawData.IndexType == b.DrawData.IndexType;
+}
+
+// Instanced draws recorded into the indirect buffer that haven't been submitted yet
+struct IndirectDrawBatch
+{
+    u32             FirstCommand;
+    u32             CommandCount;
+    IndexType::Enum IndexType;
+};
+
+static void FlushIndirectDrawBatch(IndirectDrawBatch* batch)
+{
+    Handle<Buffer> indirect_buffer = renderer_data_internal.indirect_buffers[renderer_data_internal.current_frame_index];
+    u32            max_draw_count = math::Max(g_Device->max_draw_indirect_count, 1u);
+    while (batch->CommandCount > 0)
+    {
+        u32 draw_count = math::Min(batch->CommandCount, max_draw_count);
+        renderer_data_internal.backend->DrawGeometryIndirect(
+            indirect_buffer, sizeof(DrawIndexedIndirectCommand) * batch->FirstCommand, draw_count, batch->IndexType
+        );
+
+        batch->FirstCommand += draw_count;
+        batch->CommandCount -= draw_count;
+    }
+}
+
+// Keeps the batch around for the late pass before drawing it with the early commands
+static void FlushCulledDrawBatch(IndirectDrawBatch* batch, u32 shader_id)
+{
+    if (batch->CommandCount > 0)
+    {
+        renderer_data_internal.late_draw_batches.Push({
+            .ShaderId = shader_id,
+            .FirstCommand = batch->FirstCommand,
+            .CommandCount = batch->CommandCount,
+            .IndexType = batch->IndexType,
+        });
+    }
+
+    FlushIndirectDrawBatch(batch);
+}
 
+// Runs the rest of the surface's culling and draws what the late pass found visible
+static void EndSurfaceCulling(RenderSurface* surface, Handle<Buffer> global_ubo, u32 first_instance)
+{
+    Handle<Buffer> instance_buffer = renderer_data_internal.instance_buffers[renderer_data_internal.current_frame_index];
+    Handle<Buffer> indirect_buffer = renderer_data_internal.indirect_buffers[renderer_data_internal.current_frame_index];
+    EndGPUCulling(surface, renderer_data_internal.instance_count - first_instance, instance_buffer, indirect_buffer);
+
+    DummyDrawData.MousePosition = surface->RelativeMousePosition;
+    for (u64 i = 0; i < renderer_data_internal.late_draw_batches.Length; i++)
+    {
+        const LateDrawBatch& late_batch = renderer_data_internal.late_draw_batches[i];
+        Shader*              shader = ShaderSystem::BindByID(late_batch.ShaderId);
         renderer_data_internal.backend->ApplyGlobalShaderProperties(
             shader,
-            renderer_data_internal.global_ubo_buffer,
+            global_ubo,
             renderer_data_internal.materials_gpu_buffer,
-            renderer_data_internal.vertex_buffer,
-            renderer_data_internal.index_buffer
+            renderer_data_internal.vertex_buffer.buffer,
+            renderer_data_internal.index_buffer.buffer,
+            GetGPUCulledInstanceBuffer()
         );
+        renderer_data_internal.backend->ApplyLocalShaderProperties(shader, &DummyDrawData);
+
+        IndirectDrawBatch batch = {
+            .FirstCommand = renderer_data_internal.max_instances + late_batch.FirstCommand,
+            .CommandCount = late_batch.CommandCount,
+            .IndexType = late_batch.IndexType,
+        };
+        FlushIndirectDrawBatch(&batch);
+    }
+
+    renderer_data_internal.late_draw_batches.Clear();
+}
+
+// Recording of a range of a render queue. Whole queues are recorded on the main thread, with the cursors pointing at
+// the frame's instance and indirect command counts. Chunks recorded on the job threads get cursors into slices of
+// both buffers reserved for them and their own push constants, so they share nothing with each other.
+struct QueueRecorder
+{
+    RenderSurface* Surface;
+    Handle<Buffer> GlobalUBO;
+    Handle<Buffer> InstanceBuffer;
+    __DrawData*    DrawData;
+    u32*           InstanceCount;
+    u32*           IndirectCommandCount;
+    u32            InstanceLimit;
+    bool           JobThread;
+
+    Shader*           CurrentShader;
+    u32               CurrentShaderId;
+    bool              Instanced;
+    bool              SpritesBound; // The sprite buffer is bound in place of the instance buffer
+    IndirectDrawBatch Batch;
+
+    // Opaque instanced draws of culled surfaces go through the culling passes; their instances are copied to the
+    // culled instance buffer and the commands start out without instances. Blended draws are drawn as they are.
+    bool           Culling;
+    u32            CullingFirstInstance;
+    GPUCullObject* CullObjects;
+};
+
+static void FlushQueueBatch(QueueRecorder* recorder)
+{
+    if (recorder->Culling)
+    {
+        FlushCulledDrawBatch(&recorder->Batch, recorder->CurrentShaderId);
+    }
+    else
+    {
+        FlushIndirectDrawBatch(&recorder->Batch);
+    }
+}
+
+// Sprite draws read their quads from the binding instanced draws read their instances from
+static void BindQueueGlobals(QueueRecorder* recorder, Shader* shader, bool sprites)
+{
+    renderer_data_internal.backend->ApplyGlobalShaderProperties(
+        shader,
+        recorder->GlobalUBO,
+        renderer_data_internal.materials_gpu_buffer,
+        renderer_data_internal.vertex_buffer.buffer,
+        renderer_data_internal.index_buffer.buffer,
+        sprites ? renderer_data_internal.sprite_buffer : recorder->InstanceBuffer
+    );
+
+    recorder->SpritesBound = sprites;
+}
+
+// Binds the surface's variant of the shader and its global descriptors. The shader system keeps the bound shader in
+// global state, so job threads look the variant up themselves. Returns nullptr if the shader doesn't have the variant
+// or its pipelines are still being created.
+static Shader* BindQueueShader(QueueRecorder* recorder, Shader* shader)
+{
+    i32 variant_index = 0;
+    if (recorder->JobThread)
+    {
+        if (!shader->Ready)
+        {
+            return nullptr;
+        }
 
-        auto& objects = It->second;
-        u64   count = objects.Size();
-        if (!count)
+        if (recorder->Surface->VariantName.count > 0)
+        {
+            variant_index = ShaderSystem::FindVariantIndex(shader, recorder->Surface->VariantName);
+            if (variant_index < 0)
+            {
+                return nullptr;
+            }
+        }
+
+        renderer_data_internal.backend->UseShader(shader, (u32)variant_index);
+    }
+    else
+    {
+        shader = ShaderSystem::Bind(shader);
+        if (!shader)
+        {
+            return nullptr;
+        }
+
+        variant_index = ShaderSystem::GetActiveVariantIndex();
+    }
+
+    BindQueueGlobals(recorder, shader, false);
+
+    recorder->Instanced = IsInstancedVariant(shader, variant_index);
+    return shader;
+}
+
+static void ApplyQueueDrawData(QueueRecorder* recorder, Shader* shader, const Renderable& object)
+{
+    __DrawData* draw_data = recorder->DrawData;
+    draw_data->Model = GeometryModelMatrix(object.ModelMatrix, object.DrawData);
+    draw_data->MaterialIdx = object.MaterialInstance->ID;
+    if (recorder->Surface)
+    {
+        draw_data->MousePosition = recorder->Surface->RelativeMousePosition;
+    }
+    draw_data->EntityId = object.EntityId;
+    renderer_data_internal.backend->ApplyLocalShaderProperties(shader, draw_data);
+}
+
+// Draws the quads of a sprite batch as instances of the sprite quad. The quad is drawn with a vertex offset of 0, so the
+// vertex shader gets the corner as gl_VertexIndex and the sprite as gl_InstanceIndex.
+static void DrawSprites(QueueRecorder* recorder, Shader* shader, const Renderable& object)
+{
+    if (!recorder->SpritesBound)
+    {
+        BindQueueGlobals(recorder, shader, true);
+    }
+
+    ApplyQueueDrawData(recorder, shader, object);
+
+    GeometryDrawData quad = renderer_data_internal.sprite_quad.DrawData;
+    quad.VertexOffset = 0;
+    renderer_data_internal.backend->DrawGeometryDataInstanced(quad, object.SpriteCount, object.FirstSprite);
+}
+
+// Records the sorted draws in [start, end). Draws that share a shader end up next to each other, so the pipeline and
+// the global descriptors are only bound when the shader changes. For variants that read their per-instance data from
+// the instance buffer, consecutive draws of the same geometry and material become a single instanced draw, and when
+// the device supports it all the instanced draws of a shader are submitted with one indirect draw. The last batch is
+// left for the caller to flush.
+static void RecordRenderQueue(QueueRecorder* recorder, const RenderQueue* queue, u64 start, u64 end)
+{
+    bool               use_indirect = g_Device->supports_multi_draw_indirect;
+    IndirectDrawBatch* batch = &recorder->Batch;
+    for (u64 i = start; i < end; i++)
+    {
+        const Renderable& object = queue->Renderables[queue->Items[i].Index];
+        u32               shader_id = object.MaterialInstance->Shader->ID;
+        if (recorder->Culling && (queue->Items[i].Key >> KRAFT_RENDER_QUEUE_LAYER_SHIFT) == RenderQueueLayer::Blended)
+        {
+            FlushCulledDrawBatch(batch, recorder->CurrentShaderId);
+            EndSurfaceCulling(recorder->Surface, recorder->GlobalUBO, recorder->CullingFirstInstance);
+
+            recorder->Culling = false;
+            recorder->InstanceBuffer = renderer_data_internal.instance_buffers[renderer_data_internal.current_frame_index];
+            recorder->CurrentShaderId = KRAFT_INVALID_ID;
+        }
+
+        if (shader_id != recorder->CurrentShaderId)
+        {
+            FlushQueueBatch(recorder);
+
+            recorder->CurrentShaderId = shader_id;
+            recorder->CurrentShader = BindQueueShader(recorder, object.MaterialInstance->Shader);
+        }
+
+        // The shader doesn't have the variant this surface draws with, or isn't ready yet
+        Shader* current_shader = recorder->CurrentShader;
+        if (!current_shader)
             continue;
 
-        for (int i = 0; i < count; i++)
+        if (object.SpriteCount > 0)
         {
-            Renderable object = objects[i];
+            FlushQueueBatch(recorder);
+            DrawSprites(recorder, current_shader, object);
+            continue;
+        }
+
+        if (recorder->SpritesBound)
+        {
+            BindQueueGlobals(recorder, current_shader, false);
+        }
+
+        // Indirect draws of a batch share the push constants of the batch's first draw; instanced variants only
+        // read the mouse position from them
+        bool instanced = recorder->Instanced;
+        bool batched = instanced && use_indirect;
+        if (batched && batch->CommandCount > 0 && batch->IndexType != object.DrawData.IndexType)
+        {
+            FlushQueueBatch(recorder);
+        }
 
-            DummyDrawData.Model = object.ModelMatrix;
-            DummyDrawData.MaterialIdx = object.MaterialInstance->ID;
-            // DummyDrawData.MousePosition = Surface.RelativeMousePosition;
-            DummyDrawData.EntityId = object.EntityId;
-            renderer_data_internal.backend->ApplyLocalShaderProperties(shader, &DummyDrawData);
+        if (!batched || batch->CommandCount == 0)
+        {
+            ApplyQueueDrawData(recorder, current_shader, object);
+        }
+
+        if (!instanced)
+        {
             renderer_data_internal.backend->DrawGeometryData(object.DrawData);
+            continue;
+        }
+
+        u64 run_end = i + 1;
+        while (run_end < end && CanInstanceTogether(object, queue->Renderables[queue->Items[run_end].Index]))
+        {
+            run_end++;
+        }
+
+        // Instanced variants can only draw what fits in the instance buffer, the rest of the frame is dropped
+        u32 first_instance = *recorder->InstanceCount;
+        u32 instance_count = (u32)math::Min(run_end - i, (u64)(recorder->InstanceLimit - first_instance));
+        if (instance_count < run_end - i && !renderer_data_internal.instance_overflow_reported)
+        {
+            KWARN("[DrawRenderQueue]: Ran out of instance buffer space (%d instances), raise RendererOptions::MaxInstancesPerFrame", renderer_data_internal.max_instances);
+            renderer_data_internal.instance_overflow_reported = true;
+        }
+
+        InstanceData* instances = renderer_data_internal.instance_data + first_instance;
+        for (u32 j = 0; j < instance_count; j++)
+        {
+            const Renderable& instance = queue->Renderables[queue->Items[i + j].Index];
+            instances[j].Model = GeometryModelMatrix(instance.ModelMatrix, instance.DrawData);
+            instances[j].EntityId = instance.EntityId;
+            instances[j].MaterialIdx = instance.MaterialInstance->ID;
+        }
+
+        // Culled surfaces always draw through the indirect buffer
+        if (recorder->Culling && instance_count > 0)
+        {
+            KASSERT(batched);
+            for (u32 j = 0; j < instance_count; j++)
+            {
+                const Renderable& instance = queue->Renderables[queue->Items[i + j].Index];
+                recorder->CullObjects[first_instance + j] = {
+                    .BoundingSphere = WorldBoundingSphere(instance.Bounds, instance.ModelMatrix),
+                    .CommandIndex = *recorder->IndirectCommandCount,
+                    .ObjectId = instance.EntityId,
+                };
+            }
         }
 
-        objects.Clear();
+        if (instance_count > 0)
+        {
+            *recorder->InstanceCount += instance_count;
+            if (batched)
+            {
+                u32 index_size = object.DrawData.IndexType == IndexType::UInt16 ? sizeof(u16) : sizeof(u32);
+                if (batch->CommandCount == 0)
+                {
+                    batch->FirstCommand = *recorder->IndirectCommandCount;
+                    batch->IndexType = object.DrawData.IndexType;
+                }
+
+                DrawIndexedIndirectCommand command = {
+                    .IndexCount = object.DrawData.IndexCount,
+                    .InstanceCount = instance_count,
+                    .FirstIndex = object.DrawData.IndexBufferOffset / index_size,
+                    .VertexOffset = (i32)object.DrawData.VertexOffset,
+                    .FirstInstance = first_instance,
+                };
+
+                // The culling passes count the instances that survive them
+                if (recorder->Culling)
+                {
+                    DrawIndexedIndirectCommand late_command = command;
+                    late_command.InstanceCount = 0;
+                    late_command.FirstInstance += renderer_data_internal.max_instances;
+                    renderer_data_internal.indirect_commands[renderer_data_internal.max_instances + *recorder->IndirectCommandCount] = late_command;
+
+                    command.InstanceCount = 0;
+                }
+
+                renderer_data_internal.indirect_commands[(*recorder->IndirectCommandCount)++] = command;
+                batch->CommandCount++;
+            }
+            else
+            {
+                renderer_data_internal.backend->DrawGeometryDataInstanced(object.DrawData, instance_count, first_instance);
+            }
+        }
 
-        ShaderSystem::Unbind();
+        i = run_end - 1;
     }
 }
 
+// Sorts the queue, draws it on the calling thread and empties it
+static void DrawRenderQueue(RenderQueue* queue, Handle<Buffer> global_ubo, RenderSurface* surface)
+{
+    RenderQueueSort(queue);
+
+    QueueRecorder recorder = {
+        .Surface = surface,
+        .GlobalUBO = global_ubo,
+        .InstanceBuffer = renderer_data_internal.instance_buffers[renderer_data_internal.current_frame_index],
+        .DrawData = &DummyDrawData,
+        .InstanceCount = &renderer_data_internal.instance_count,
+        .IndirectCommandCount = &renderer_data_internal.indirect_command_count,
+        .InstanceLimit = renderer_data_internal.max_instances,
+        .JobThread = false,
+        .CurrentShader = nullptr,
+        .CurrentShaderId = KRAFT_INVALID_ID,
+        .Instanced = false,
+        .Batch = {},
+        .Culling = surface && surface->Culling,
+        .CullingFirstInstance = renderer_data_internal.instance_count,
+        .CullObjects = nullptr,
+    };
+
+    if (recorder.Culling)
+    {
+        recorder.InstanceBuffer = GetGPUCulledInstanceBuffer();
+        recorder.CullObjects = GetGPUCullObjects();
+    }
+
+    RecordRenderQueue(&recorder, queue, 0, queue->Items.Length);
+
+    FlushQueueBatch(&recorder);
+    if (recorder.Culling)
+    {
+        EndSurfaceCulling(surface, global_ubo, recorder.CullingFirstInstance);
+    }
+
+    ShaderSystem::Unbind();
+    RenderQueueClear(queue);
+}
+
+struct QueueChunkJobData
+{
+    RenderQueue*   Queue;
+    RenderSurface* Surface;
+    u32            ChunkSize;
+    u32            FirstInstance;
+    u32            FirstIndirectCommand;
+};
+
+// Records chunks of a sorted queue into secondary command buffers. Draw i of the queue owns instance FirstInstance + i
+// and indirect command FirstIndirectCommand + i, so what a chunk writes doesn't depend on the chunks before it.
+static void RecordQueueChunkJob(void* user_data, u32 start, u32 end)
+{
+    QueueChunkJobData* data = (QueueChunkJobData*)user_data;
+    for (u32 chunk = start; chunk < end; chunk++)
+    {
+        u64 first = (u64)chunk * data->ChunkSize;
+        u64 last = math::Min(first + data->ChunkSize, (u64)data->Queue->Items.Length);
+        if (!renderer_data_internal.backend->BeginSecondaryCommands(data->Surface, chunk))
+            continue;
+
+        __DrawData draw_data = {};
+        u32        instance_count = data->FirstInstance + (u32)first;
+        u32        indirect_command_count = data->FirstIndirectCommand + (u32)first;
+        QueueRecorder recorder = {
+            .Surface = data->Surface,
+            .GlobalUBO = data->Surface->GlobalUBO,
+            .InstanceBuffer = renderer_data_internal.instance_buffers[renderer_data_internal.current_frame_index],
+            .DrawData = &draw_data,
+            .InstanceCount = &instance_count,
+            .IndirectCommandCount = &indirect_command_count,
+            .InstanceLimit = data->FirstInstance + (u32)last,
+            .JobThread = true,
+            .CurrentShader = nullptr,
+            .CurrentShaderId = KRAFT_INVALID_ID,
+        };
+
+        RecordRenderQueue(&recorder, data->Queue, first, last);
+        FlushIndirectDrawBatch(&recorder.Batch);
+
+        renderer_data_internal.backend->EndSecondaryCommands();
+    }
+}
+
+// Surfaces with enough draws are recorded in chunks on the job threads. Culled surfaces stay on the main thread, since
+// their culling passes are recorded in between the draws.
+static bool CanRecordInParallel(const RenderSurface* surface, const RenderQueue* queue)
+{
+    if (!g_Renderer->Settings->ParallelRecording || !g_Device->supports_parallel_recording || surface->Culling)
+        return false;
+
+    u64 draw_count = queue->Items.Length;
+    if (draw_count < 2 * KRAFT_RENDERER_RECORDING_CHUNK_SIZE)
+        return false;
+
+    // Every draw reserves an instance and an indirect command, whether it ends up using them or not; when they don't
+    // all fit, the serial path drops what doesn't and reports it
+    return renderer_data_internal.instance_count + draw_count <= renderer_data_internal.max_instances;
+}
+
+// Sorts the queue, records it into secondary command buffers on the job threads, executes them in order and empties
+// the queue. The surface must have been begun with BeginParallelSurface.
+static void DrawRenderQueueParallel(RenderQueue* queue, RenderSurface* surface)
+{
+    RenderQueueSort(queue);
+
+    u32 draw_count = (u32)queue->Items.Length;
+    u32 chunk_size = math::Max(
+        (u32)KRAFT_RENDERER_RECORDING_CHUNK_SIZE,
+        (draw_count + KRAFT_RENDERER_MAX_SECONDARY_COMMAND_BUFFERS - 1) / KRAFT_RENDERER_MAX_SECONDARY_COMMAND_BUFFERS
+    );
+    u32 chunk_count = (draw_count + chunk_size - 1) / chunk_size;
+
+    QueueChunkJobData data = {
+        .Queue = queue,
+        .Surface = surface,
+        .ChunkSize = chunk_size,
+        .FirstInstance = renderer_data_internal.instance_count,
+        .FirstIndirectCommand = renderer_data_internal.indirect_command_count,
+    };
+
+    renderer_data_internal.instance_count += draw_count;
+    if (g_Device->supports_multi_draw_indirect)
+    {
+        renderer_data_internal.indirect_command_count += draw_count;
+    }
+
+    JobSystem::ParallelFor(chunk_count, 1, RecordQueueChunkJob, &data);
+    renderer_data_internal.backend->ExecuteSecondaryCommands(surface, chunk_count);
+
+    RenderQueueClear(queue);
+}
+
+void RendererFrontend::Draw(GlobalShaderData* global_ubo)
+{
+    KASSERT(renderer_data_internal.current_frame_index >= 0 && renderer_data_internal.current_frame_index < 3);
+
+    MemCpy(
+        (void*)ResourceManager->GetBufferData(renderer_data_internal.global_ubo_buffer),
+        (void*)global_ubo,
+        sizeof(GlobalShaderData)
+    );
+
+    DrawRenderQueue(&renderer_data_internal.queue, renderer_data_internal.global_ubo_buffer, nullptr);
+}
+
 void RendererFrontend::OnResize(int width, int height)
 {
     KASSERT(renderer_data_internal.backend);
     renderer_data_internal.backend->OnResize(width, height);
 }
 
+u64 RendererFrontend::GetFrameNumber() const
+{
+    return renderer_data_internal.frame_number;
+}
+
 void RendererFrontend::PrepareFrame()
 {
+    renderer_data_internal.frame_number++;
+    DestroyRetiredBuffers(false);
+
     r::ResourceManager->EndFrame(0);
     renderer_data_internal.current_frame_index = renderer_data_internal.backend->PrepareFrame();
 
-    // Upload all the materials
-    u8* buffer_data = ResourceManager->GetBufferData(
-        renderer_data_internal.materials_staging_buffer[renderer_data_internal.current_frame_index]
-    );
-    auto materials = MaterialSystem::GetMaterialsBuffer();
-    u64  materials_buffer_size = this->Settings->MaxMaterials * this->Settings->MaterialBufferSize;
+    renderer_data_internal.instance_data =
+        (InstanceData*)ResourceManager->GetBufferData(renderer_data_internal.instance_buffers[renderer_data_internal.current_frame_index]);
+    renderer_data_internal.instance_count = 0;
+    renderer_data_internal.instance_overflow_reported = false;
 
-    MemCpy(buffer_data, materials, materials_buffer_size);
+    if (g_Device->supports_multi_draw_indirect)
+    {
+        renderer_data_internal.indirect_commands =
+            (DrawIndexedIndirectCommand*)ResourceManager->GetBufferData(renderer_data_internal.indirect_buffers[renderer_data_internal.current_frame_index]);
+        renderer_data_internal.indirect_command_count = 0;
+    }
 
-    ResourceManager->UploadBuffer({
-        .DstBuffer = renderer_data_internal.materials_gpu_buffer,
-        .SrcBuffer = renderer_data_internal.materials_staging_buffer[renderer_data_internal.current_frame_index],
-        .SrcSize = materials_buffer_size,
-        .DstOffset = 0,
-        .SrcOffset = 0,
-    });
+    renderer_data_internal.sprite_ring_offset = renderer_data_internal.max_sprites * renderer_data_internal.current_frame_index;
+    renderer_data_internal.sprite_count = 0;
+    renderer_data_internal.sprite_overflow_reported = false;
+
+    if (renderer_data_internal.gpu_culling_available)
+    {
+        GPUCullingPrepareFrame(renderer_data_internal.current_frame_index);
+    }
+
+    // Upload the materials that changed since the last frame, nothing at all when none did. The ranges are staged at
+    // their own offsets in this frame's staging buffer, which the GPU is done with once the frame's fence was waited on.
+    TempArena            scratch = ScratchBegin(0, 0);
+    MaterialBufferRange* dirty_ranges;
+    u32                  dirty_range_count = MaterialSystem::GetDirtyRanges(scratch.arena, &dirty_ranges);
+    if (dirty_range_count > 0)
+    {
+        Handle<Buffer> staging_buffer = renderer_data_internal.materials_staging_buffer[renderer_data_internal.current_frame_index];
+        u8*            staging_data = ResourceManager->GetBufferData(staging_buffer);
+        const u8*      materials = MaterialSystem::GetMaterialsBuffer();
+        for (u32 i = 0; i < dirty_range_count; i++)
+        {
+            const MaterialBufferRange& range = dirty_ranges[i];
+            MemCpy(staging_data + range.Offset, materials + range.Offset, range.Size);
+
+            ResourceManager->UploadBuffer({
+                .DstBuffer = renderer_data_internal.materials_gpu_buffer,
+                .SrcBuffer = staging_buffer,
+                .SrcSize = range.Size,
+                .DstOffset = range.Offset,
+                .SrcOffset = range.Offset,
+            });
+        }
+
+        MaterialSystem::ClearDirtyMaterials();
+    }
+
+    ScratchEnd(scratch);
+
+    // Shaders whose pipelines finished on the job threads can be drawn with from this frame on
+    ShaderSystem::ProcessPendingShaders();
+
+    // Textures that are still loading sample the default texture; this has to happen before
+    // the dirty textures are written so a texture that finished this frame ends up with its real image
+    auto placeholder_textures = TextureSystem::GetPlaceholderTextures();
+    if (placeholder_textures.Length > 0)
+    {
+        renderer_data_internal.backend->BindPlaceholderTextures(
+            placeholder_textures.Data(), placeholder_textures.Length, TextureSystem::GetDefaultDiffuseTexture()
+        );
+        TextureSystem::ClearPlaceholderTextures();
+    }
 
     // Get all the dirty textures and create descriptor sets for them
     auto dirty_textures = TextureSystem::GetDirtyTextures();
@@ -264,45 +1036,28 @@ bool RendererFrontend::DrawSurfaces()
             sizeof(global_shader_data)
         );
 
-        surface.Begin();
-        for (auto it = surface_render_data.Renderables.begin(); it != surface_render_data.Renderables.end(); it++)
+        // The early culling pass is recorded ahead of the surface's draws
+        if (surface.Culling)
         {
-            Shader* current_shader = ShaderSystem::BindByID(it->first);
-            if (!current_shader)
-            {
-                it->second.Clear();
-                continue;
-            }
-
-            renderer_data_internal.backend->ApplyGlobalShaderProperties(
-                current_shader,
-                surface.GlobalUBO,
-                renderer_data_internal.materials_gpu_buffer,
-                renderer_data_internal.vertex_buffer,
-                renderer_data_internal.index_buffer
+            BeginGPUCulling(
+                &surface,
+                global_shader_data.View * global_shader_data.Projection,
+                renderer_data_internal.instance_count,
+                renderer_data_internal.instance_buffers[renderer_data_internal.current_frame_index],
+                renderer_data_internal.indirect_buffers[renderer_data_internal.current_frame_index]
             );
+        }
 
-            auto& objects = it->second;
-            u64   count = objects.Size();
-            if (!count)
-                continue;
-
-            for (int i = 0; i < count; i++)
-            {
-                Renderable object = objects[i];
-
-                DummyDrawData.Model = object.ModelMatrix;
-                DummyDrawData.MaterialIdx = object.MaterialInstance->ID;
-                DummyDrawData.MousePosition = surface.RelativeMousePosition;
-                DummyDrawData.EntityId = object.EntityId;
-                renderer_data_internal.backend->ApplyLocalShaderProperties(current_shader, &DummyDrawData);
-
-                renderer_data_internal.backend->DrawGeometryData(object.DrawData);
-            }
-
-            objects.Clear();
-
-            ShaderSystem::Unbind();
+        if (CanRecordInParallel(&surface, surface_render_data.Queue))
+        {
+            renderer_data_internal.backend->BeginParallelSurface(&surface);
+            ShaderSystem::SetActiveVariant(surface.VariantName);
+            DrawRenderQueueParallel(surface_render_data.Queue, &surface);
+        }
+        else
+        {
+            surface.Begin();
+            DrawRenderQueue(surface_render_data.Queue, surface.GlobalUBO, &surface);
         }
         surface.End();
     }
@@ -317,42 +1072,37 @@ bool RendererFrontend::DrawSurfaces()
 
 bool RendererFrontend::AddRenderable(const Renderable& renderable)
 {
-    Renderables* renderables = nullptr;
+    RenderQueue* queue = &renderer_data_internal.queue;
     if (renderer_data_internal.active_surface != -1)
     {
-        renderables = &renderer_data_internal.surfaces[renderer_data_internal.active_surface].Renderables;
-    }
-    else
-    {
-        renderables = &renderer_data_internal.renderables;
+        queue = renderer_data_internal.surfaces[renderer_data_internal.active_surface].Queue;
     }
 
-    ResourceID key = renderable.MaterialInstance->Shader->ID;
-    auto       renderable_it = renderables->find(key);
-    if (renderable_it == renderables->end())
-    {
-        auto pair = renderables->insert_or_assign(key, Array<Renderable>());
-        auto it = pair.first;
-        it->second.Reserve(1024);
-        it->second.Push(renderable);
-    }
-    else
-    {
-        renderable_it->second.Push(renderable);
-    }
+    RenderQueuePush(queue, renderable, RenderableSortKey(renderable, this->Camera));
 
     return true;
 }
 
 bool RendererFrontend::AddRenderable(SpriteBatch* batch)
 {
+    if (batch->quad_count == 0)
+        return false;
+
     Renderable renderable = {
         .ModelMatrix = mat4(Identity),
         .MaterialInstance = batch->material,
-        .DrawData = batch->geometry->DrawData,
+        .DrawData = renderer_data_internal.sprite_quad.DrawData,
+        .FirstSprite = batch->first_sprite,
+        .SpriteCount = batch->quad_count,
     };
 
-    return g_Renderer->AddRenderable(renderable);
+    // The rest of the reservation is used by the quads drawn after this
+    batch->sprites += batch->quad_count;
+    batch->first_sprite += batch->quad_count;
+    batch->reserved_count -= batch->quad_count;
+    batch->quad_count = 0;
+
+    return this->AddRenderable(renderable);
 }
 
 void RendererFrontend::BeginMainRenderpass()
@@ -369,9 +1119,9 @@ void RendererFrontend::EndMainRenderpass()
 // API
 //
 
-void RendererFrontend::CreateRenderPipeline(Shader* Shader)
+void RendererFrontend::CreateRenderPipeline(Shader* Shader, JobCounter* Counter)
 {
-    renderer_data_internal.backend->CreateRenderPipeline(Shader);
+    renderer_data_internal.backend->CreateRenderPipeline(Shader, Counter);
 }
 
 void RendererFrontend::DestroyRenderPipeline(Shader* Shader)
@@ -379,9 +1129,16 @@ void RendererFrontend::DestroyRenderPipeline(Shader* Shader)
     renderer_data_internal.backend->DestroyRenderPipeline(Shader);
 }
 
-void RendererFrontend::UseShader(const Shader* Shader, u32 variant_index)
+bool RendererFrontend::UseShader(const Shader* Shader, u32 variant_index)
 {
+    // The pipelines are still being created - skip
+    if (!Shader->Ready)
+    {
+        return false;
+    }
+
     renderer_data_internal.backend->UseShader(Shader, variant_index);
+    return true;
 }
 
 void RendererFrontend::DrawGeometry(const GeometryDrawData& draw_data)
@@ -398,7 +1155,7 @@ void RendererFrontend::ApplyGlobalShaderProperties(
 )
 {
     renderer_data_internal.backend->ApplyGlobalShaderProperties(
-        shader, ubo_buffer, materials_buffer, vertex_buffer, index_buffer
+        shader, ubo_buffer, materials_buffer, vertex_buffer, index_buffer, Handle<Buffer>::Invalid()
     );
 }
 
@@ -417,30 +1174,58 @@ bool RendererFrontend::CreateGeometry(
     const u32   index_size
 )
 {
-    u32 vertex_buffer_offset = renderer_data_internal.current_vertex_buffer_offset;
-    u32 index_buffer_offset = renderer_data_internal.current_index_buffer_offset;
+    // Vertex ranges are aligned to the vertex size so the offset can be passed to the draw as a vertex index
+    u64 vertex_buffer_offset = 0;
+    if (!AllocateGeometryRange(&renderer_data_internal.vertex_buffer, (u64)vertex_size * vertex_count, vertex_size, geometry, &vertex_buffer_offset))
+    {
+        KERROR("[RendererFrontend::CreateGeometry]: Failed to allocate %d vertices", vertex_count);
+        return false;
+    }
 
-    renderer_data_internal.current_vertex_buffer_offset += vertex_size * vertex_count;
-    renderer_data_internal.current_index_buffer_offset += index_size * index_count;
+    u64 index_buffer_offset = 0;
+    if (index_count > 0)
+    {
+        if (!AllocateGeometryRange(&renderer_data_internal.index_buffer, (u64)index_size * index_count, index_size, geometry, &index_buffer_offset))
+        {
+            KERROR("[RendererFrontend::CreateGeometry]: Failed to allocate %d indices", index_count);
+            GeometryHeapFree(&renderer_data_internal.vertex_buffer.heap, geometry);
+            return false;
+        }
+    }
 
     geometry->DrawData.IndexCount = index_count;
-    geometry->DrawData.IndexBufferOffset = index_buffer_offset;
-    geometry->DrawData.VertexOffset = vertex_buffer_offset / vertex_size;
+    geometry->DrawData.IndexBufferOffset = (u32)index_buffer_offset;
+    geometry->DrawData.VertexOffset = (u32)(vertex_buffer_offset / vertex_size);
+    geometry->DrawData.IndexType = index_size == sizeof(u16) ? IndexType::UInt16 : IndexType::UInt32;
 
     return renderer_data_internal.backend->CreateGeometry({
-        .VertexBuffer = renderer_data_internal.vertex_buffer,
-        .VertexBufferOffset = vertex_buffer_offset,
+        .VertexBuffer = renderer_data_internal.vertex_buffer.buffer,
+        .VertexBufferOffset = (u32)vertex_buffer_offset,
         .VertexCount = vertex_count,
         .Vertices = vertices,
         .VertexSize = vertex_size,
-        .IndexBuffer = renderer_data_internal.index_buffer,
-        .IndexBufferOffset = index_buffer_offset,
+        .IndexBuffer = renderer_data_internal.index_buffer.buffer,
+        .IndexBufferOffset = (u32)index_buffer_offset,
         .IndexCount = index_count,
         .Indices = indices,
         .IndexSize = index_size,
     });
 }
 
+// Returns the offset of the geometry's range, moving it somewhere else if the new data doesn't fit
+static bool ReallocateGeometryRange(GeometryBuffer* geometry_buffer, const Geometry* geometry, u64 size, u64 alignment, u64* out_offset)
+{
+    GeometryHeapAllocation* allocation = GeometryHeapFind(&geometry_buffer->heap, geometry);
+    if (allocation && allocation->Size >= size && allocation->Alignment == alignment)
+    {
+        *out_offset = allocation->Offset;
+        return true;
+    }
+
+    GeometryHeapFree(&geometry_buffer->heap, geometry);
+    return AllocateGeometryRange(geometry_buffer, size, alignment, geometry, out_offset);
+}
+
 bool RendererFrontend::UpdateGeometry(
     Geometry*   geometry,
     u32         vertex_count,
@@ -451,26 +1236,123 @@ bool RendererFrontend::UpdateGeometry(
     const u32   index_size
 )
 {
-    // Re-upload to the same offsets
-    u32 vertex_buffer_offset = geometry->DrawData.VertexOffset * vertex_size;
-    u32 index_buffer_offset = geometry->DrawData.IndexBufferOffset;
+    // Re-upload to the same offsets, unless the geometry outgrew its ranges
+    u64 vertex_buffer_offset = 0;
+    if (!ReallocateGeometryRange(&renderer_data_internal.vertex_buffer, geometry, (u64)vertex_size * vertex_count, vertex_size, &vertex_buffer_offset))
+    {
+        KERROR("[RendererFrontend::UpdateGeometry]: Failed to allocate %d vertices", vertex_count);
+        return false;
+    }
+
+    u64 index_buffer_offset = geometry->DrawData.IndexBufferOffset;
+    if (index_count > 0)
+    {
+        if (!ReallocateGeometryRange(&renderer_data_internal.index_buffer, geometry, (u64)index_size * index_count, index_size, &index_buffer_offset))
+        {
+            KERROR("[RendererFrontend::UpdateGeometry]: Failed to allocate %d indices", index_count);
+            return false;
+        }
+    }
 
     geometry->DrawData.IndexCount = index_count;
+    geometry->DrawData.IndexBufferOffset = (u32)index_buffer_offset;
+    geometry->DrawData.VertexOffset = (u32)(vertex_buffer_offset / vertex_size);
+    geometry->DrawData.IndexType = index_size == sizeof(u16) ? IndexType::UInt16 : IndexType::UInt32;
 
     return renderer_data_internal.backend->UpdateGeometry({
-        .VertexBuffer = renderer_data_internal.vertex_buffer,
-        .VertexBufferOffset = vertex_buffer_offset,
+        .VertexBuffer = renderer_data_internal.vertex_buffer.buffer,
+        .VertexBufferOffset = (u32)vertex_buffer_offset,
         .VertexCount = vertex_count,
         .Vertices = vertices,
         .VertexSize = vertex_size,
-        .IndexBuffer = renderer_data_internal.index_buffer,
-        .IndexBufferOffset = index_buffer_offset,
+        .IndexBuffer = renderer_data_internal.index_buffer.buffer,
+        .IndexBufferOffset = (u32)index_buffer_offset,
         .IndexCount = index_count,
         .Indices = indices,
         .IndexSize = index_size,
     });
 }
 
+void RendererFrontend::DestroyGeometry(Geometry* geometry)
+{
+    GeometryHeapFree(&renderer_data_internal.vertex_buffer.heap, geometry);
+    GeometryHeapFree(&renderer_data_internal.index_buffer.heap, geometry);
+}
+
+struct GeometryCompactionContext
+{
+    Handle<Buffer> src_buffer;
+    Handle<Buffer> dst_buffer;
+    bool           vertices;
+};
+
+static void MoveGeometryRange(void* user_data, const GeometryHeapAllocation& allocation, u64 new_offset)
+{
+    GeometryCompactionContext* context = (GeometryCompactionContext*)user_data;
+    ResourceManager->UploadBuffer({
+        .DstBuffer = context->dst_buffer,
+        .SrcBuffer = context->src_buffer,
+        .SrcSize = allocation.Size,
+        .DstOffset = new_offset,
+        .SrcOffset = allocation.Offset,
+    });
+
+    // Owners are always the geometries themselves
+    Geometry* geometry = (Geometry*)allocation.Owner;
+    if (context->vertices)
+    {
+        geometry->DrawData.VertexOffset = (u32)(new_offset / allocation.Alignment);
+    }
+    else
+    {
+        geometry->DrawData.IndexBufferOffset = (u32)new_offset;
+    }
+}
+
+static void CompactGeometryBuffer(GeometryBuffer* geometry_buffer, bool vertices)
+{
+    // Nothing to do if the only free space is already at the end
+    GeometryHeap* heap = &geometry_buffer->heap;
+    if (heap->FreeRanges.Length == 0)
+        return;
+
+    if (heap->FreeRanges.Length == 1 && heap->FreeRanges[0].Offset + heap->FreeRanges[0].Size == heap->Capacity)
+        return;
+
+    Handle<Buffer> new_buffer = ResourceManager->CreateBuffer({
+        .DebugName = geometry_buffer->debug_name,
+        .Size = heap->Capacity,
+        .UsageFlags = geometry_buffer->usage_flags,
+        .MemoryPropertyFlags = MEMORY_PROPERTY_FLAGS_DEVICE_LOCAL,
+    });
+
+    if (new_buffer.IsInvalid())
+    {
+        KERROR("[CompactGeometryBuffer]: Failed to create a new '%s'", geometry_buffer->debug_name);
+        return;
+    }
+
+    ResourceManager->FlushUploads();
+
+    GeometryCompactionContext context = {
+        .src_buffer = geometry_buffer->buffer,
+        .dst_buffer = new_buffer,
+        .vertices = vertices,
+    };
+    GeometryHeapCompact(heap, MoveGeometryRange, &context);
+
+    ResourceManager->FlushUploads();
+
+    RetireBuffer(geometry_buffer->buffer);
+    geometry_buffer->buffer = new_buffer;
+}
+
+void RendererFrontend::CompactGeometryBuffers()
+{
+    CompactGeometryBuffer(&renderer_data_internal.vertex_buffer, true);
+    CompactGeometryBuffer(&renderer_data_internal.index_buffer, false);
+}
+
 RenderSurface RendererFrontend::CreateRenderSurface(
     String8 name,
     u32     width,
@@ -485,6 +1367,7 @@ RenderSurface RendererFrontend::CreateRenderSurface(
         .VariantName = name,
         .Width = width,
         .Height = height,
+        .DepthSampled = has_depth && depth_sample,
     };
 
     RenderPassDescription description = {
@@ -568,13 +1451,32 @@ RenderSurface RendererFrontend::CreateRenderSurface(
         });
     }
 
+    // Culling builds its Hi-Z pyramid from the depth attachment and submits through the indirect buffer
+    if (has_depth && depth_sample && this->Settings->GPUCulling && g_Device->supports_multi_draw_indirect)
+    {
+        if (!renderer_data_internal.gpu_culling_initialized)
+        {
+            renderer_data_internal.gpu_culling_initialized = true;
+            renderer_data_internal.gpu_culling_available = InitGPUCulling(renderer_data_internal.backend, renderer_data_internal.max_instances);
+        }
+
+        if (renderer_data_internal.gpu_culling_available)
+        {
+            surface.Culling = CreateGPUCullingSurface(surface);
+        }
+    }
+
     return surface;
 }
 
 void RendererFrontend::BeginRenderSurface(const RenderSurface& surface)
 {
+    u64 surface_index = renderer_data_internal.surfaces.Length;
+    KASSERTM(surface_index < KRAFT_MAX_RENDER_SURFACES, "Too many render surfaces in a single frame");
+
     renderer_data_internal.surfaces.Push({
         .Surface = surface,
+        .Queue = &renderer_data_internal.surface_queues[surface_index],
     });
 
     renderer_data_internal.active_surface = renderer_data_internal.surfaces.Length - 1;
@@ -600,9 +1502,14 @@ RenderSurface RendererFrontend::ResizeRenderSurface(RenderSurface& surface, u32
         ResourceManager->DestroyTexture(surface.DepthPassTexture);
     }
 
+    if (surface.Culling)
+    {
+        DestroyGPUCullingSurface(surface.Culling);
+    }
+
     // this->CreateCommandBuffers();
     surface = this->CreateRenderSurface(
-        surface.DebugName, width, height, surface.DepthPassTexture != Handle<Texture>::Invalid()
+        surface.DebugName, width, height, true, surface.DepthPassTexture != Handle<Texture>::Invalid(), surface.DepthSampled
     );
     return surface;
 }
@@ -617,6 +1524,65 @@ void RendererFrontend::CmdSetCustomBuffer(Shader* shader, Handle<Buffer> buffer,
     renderer_data_internal.backend->CmdSetCustomBuffer(shader, buffer, set_idx, binding_idx);
 }
 
+void RendererFrontend::CmdSetCustomStorageImage(Shader* shader, Handle<Texture> texture, u32 set_idx, u32 binding_idx)
+{
+    renderer_data_internal.backend->CmdSetCustomStorageImage(shader, texture, set_idx, binding_idx);
+}
+
+void RendererFrontend::BeginComputePass()
+{
+    KASSERTM(renderer_data_internal.current_frame_index >= 0, "Did you forget to call Renderer.PrepareFrame()?");
+    renderer_data_internal.backend->BeginComputePass();
+}
+
+void RendererFrontend::EndComputePass()
+{
+    renderer_data_internal.backend->EndComputePass();
+}
+
+bool RendererFrontend::BindComputeShader(Shader* shader, u32 variant_index)
+{
+    KASSERTM(shaderfx::IsComputeVariant(shader->ShaderEffect.variants[variant_index]), "BindComputeShader needs a ComputeShader variant");
+
+    // The pipelines are still being created - skip
+    if (!shader->Ready)
+    {
+        return false;
+    }
+
+    renderer_data_internal.backend->UseShader(shader, variant_index);
+    renderer_data_internal.backend->ApplyGlobalShaderProperties(
+        shader,
+        renderer_data_internal.global_ubo_buffer,
+        renderer_data_internal.materials_gpu_buffer,
+        renderer_data_internal.vertex_buffer.buffer,
+        renderer_data_internal.index_buffer.buffer,
+        renderer_data_internal.instance_buffers[renderer_data_internal.current_frame_index]
+    );
+
+    return true;
+}
+
+void RendererFrontend::Dispatch(u32 group_count_x, u32 group_count_y, u32 group_count_z)
+{
+    renderer_data_internal.backend->Dispatch(group_count_x, group_count_y, group_count_z);
+}
+
+void RendererFrontend::DispatchIndirect(Handle<Buffer> buffer, u64 offset)
+{
+    renderer_data_internal.backend->DispatchIndirect(buffer, offset);
+}
+
+void RendererFrontend::PipelineBarrier(u32 src_access, u32 dst_access)
+{
+    renderer_data_internal.backend->PipelineBarrier(src_access, dst_access);
+}
+
+void RendererFrontend::TextureBarrier(Handle<Texture> texture, u32 src_access, u32 dst_access)
+{
+    renderer_data_internal.backend->TextureBarrier(texture, src_access, dst_access);
+}
+
 void RenderSurface::Begin()
 {
     renderer_data_internal.backend->BeginSurface(this);
@@ -670,16 +1636,36 @@ RendererFrontend* CreateRendererFrontend(const RendererOptions* Opts)
             VulkanRendererBackend::ApplyGlobalShaderProperties;
         renderer_data_internal.backend->ApplyLocalShaderProperties = VulkanRendererBackend::ApplyLocalShaderProperties;
         renderer_data_internal.backend->UpdateTextures = VulkanRendererBackend::UpdateTextures;
+        renderer_data_internal.backend->BindPlaceholderTextures = VulkanRendererBackend::BindPlaceholderTextures;
         renderer_data_internal.backend->CreateGeometry = VulkanRendererBackend::CreateGeometry;
         renderer_data_internal.backend->UpdateGeometry = VulkanRendererBackend::UpdateGeometry;
         renderer_data_internal.backend->DrawGeometryData = VulkanRendererBackend::DrawGeometryData;
+        renderer_data_internal.backend->DrawGeometryDataInstanced = VulkanRendererBackend::DrawGeometryDataInstanced;
+        renderer_data_internal.backend->DrawGeometryIndirect = VulkanRendererBackend::DrawGeometryIndirect;
 
         // Render Passes
         renderer_data_internal.backend->BeginSurface = VulkanRendererBackend::BeginSurface;
         renderer_data_internal.backend->EndSurface = VulkanRendererBackend::EndSurface;
+        renderer_data_internal.backend->PrepareSurface = VulkanRendererBackend::PrepareSurface;
+        renderer_data_internal.backend->SuspendSurface = VulkanRendererBackend::SuspendSurface;
+        renderer_data_internal.backend->ResumeSurface = VulkanRendererBackend::ResumeSurface;
+        renderer_data_internal.backend->BeginParallelSurface = VulkanRendererBackend::BeginParallelSurface;
+        renderer_data_internal.backend->BeginSecondaryCommands = VulkanRendererBackend::BeginSecondaryCommands;
+        renderer_data_internal.backend->EndSecondaryCommands = VulkanRendererBackend::EndSecondaryCommands;
+        renderer_data_internal.backend->ExecuteSecondaryCommands = VulkanRendererBackend::ExecuteSecondaryCommands;
 
         // Commands
         renderer_data_internal.backend->CmdSetCustomBuffer = VulkanRendererBackend::CmdSetCustomBuffer;
+        renderer_data_internal.backend->CmdSetCustomStorageImage = VulkanRendererBackend::CmdSetCustomStorageImage;
+        renderer_data_internal.backend->CmdPushStorageBuffers = VulkanRendererBackend::CmdPushStorageBuffers;
+        renderer_data_internal.backend->PipelineBarrier = VulkanRendererBackend::PipelineBarrier;
+        renderer_data_internal.backend->TextureBarrier = VulkanRendererBackend::TextureBarrier;
+
+        // Compute
+        renderer_data_internal.backend->BeginComputePass = VulkanRendererBackend::BeginComputePass;
+        renderer_data_internal.backend->EndComputePass = VulkanRendererBackend::EndComputePass;
+        renderer_data_internal.backend->Dispatch = VulkanRendererBackend::Dispatch;
+        renderer_data_internal.backend->DispatchIndirect = VulkanRendererBackend::DispatchIndirect;
     }
     else if (g_Renderer->Settings->Backend == RendererBackendType::RENDERER_BACKEND_TYPE_OPENGL)
     {
@@ -705,6 +1691,9 @@ RendererFrontend* CreateRendererFrontend(const RendererOptions* Opts)
 
 void DestroyRendererFrontend(RendererFrontend* Instance)
 {
+    ClearTextLayoutCache();
+    ShutdownGPUCulling();
+    DestroyRetiredBuffers(true);
     renderer_data_internal.backend->Shutdown();
     MemZero(renderer_data_internal.backend, sizeof(RendererBackend));
 
@@ -714,35 +1703,8 @@ void DestroyRendererFrontend(RendererFrontend* Instance)
 
 SpriteBatch* CreateSpriteBatch(ArenaAllocator* arena, u16 batch_size)
 {
-    u32          vertex_count = batch_size * 4;
-    u32          index_count = batch_size * 6;
     SpriteBatch* batch = ArenaPush(arena, SpriteBatch);
-    batch->vertices = ArenaPushArray(arena, Vertex2D, vertex_count);
-    batch->indices = ArenaPushArray(arena, u32, index_count);
-
-    // We will write the indices once
-    for (u16 i = 0; i < batch_size; i++)
-    {
-        u32 base = i * 4;
-        batch->indices[i * 6 + 0] = base + 0;
-        batch->indices[i * 6 + 1] = base + 1;
-        batch->indices[i * 6 + 2] = base + 2;
-        batch->indices[i * 6 + 3] = base + 2;
-        batch->indices[i * 6 + 4] = base + 3;
-        batch->indices[i * 6 + 5] = base + 0;
-    }
-
-    // Now upload everythang!
-    batch->geometry = GeometrySystem::AcquireGeometryWithData({
-        .VertexCount = vertex_count,
-        .IndexCount = index_count,
-        .VertexSize = sizeof(Vertex2D),
-        .IndexSize = sizeof(u32),
-        .Vertices = batch->vertices,
-        .Indices = batch->indices,
-    });
-    batch->quad_count = 0;
-    batch->max_quad_count = batch_size;
+    batch->max_quad_count = math::Max(batch_size, (u16)1);
 
     return batch;
 }
@@ -751,77 +1713,75 @@ void BeginSpriteBatch(SpriteBatch* batch, Material* material)
 {
     batch->material = material;
     batch->quad_count = 0;
+    batch->reserved_count = 0;
 }
 
-bool DrawQuad(SpriteBatch* batch, vec2 position, vec2 size, vec2 uv_min, vec2 uv_max, vec4 color)
+// Reserves space for the batch's next `max_quad_count` quads in the frame's segment of the sprite buffer, or whatever
+// is left of it. Returns false when the segment is full.
+static bool ReserveSprites(SpriteBatch* batch)
 {
-    if (batch->quad_count == batch->max_quad_count)
+    KASSERTM(renderer_data_internal.current_frame_index >= 0, "Did you forget to call Renderer.PrepareFrame()?");
+
+    u32 available = renderer_data_internal.max_sprites - renderer_data_internal.sprite_count;
+    u32 count = math::Min(batch->max_quad_count, available);
+    if (count == 0)
     {
-        KWARN("[SpriteBatch::DrawQuad]: Batch is already full");
+        if (!renderer_data_internal.sprite_overflow_reported)
+        {
+            KWARN("[SpriteBatch::DrawQuad]: Ran out of sprite buffer space (%d sprites), raise RendererOptions::MaxSpritesPerFrame", renderer_data_internal.max_sprites);
+            renderer_data_internal.sprite_overflow_reported = true;
+        }
+
         return false;
     }
 
-    batch->vertices[batch->quad_count * 4 + 0] = Vertex2D{
-        .Position = { position.x + size.x, position.y + size.y },
-        .UV = { uv_max.x, uv_max.y },
-        .Color = color,
-    };
-
-    batch->vertices[batch->quad_count * 4 + 1] = Vertex2D{
-        .Position = { position.x + size.x, position.y },
-        .UV = { uv_max.x, uv_min.y },
-        .Color = color,
-    };
-
-    batch->vertices[batch->quad_count * 4 + 2] = Vertex2D{
-        .Position = { position.x, position.y },
-        .UV = { uv_min.x, uv_min.y },
-        .Color = color,
-    };
+    batch->first_sprite = renderer_data_internal.sprite_ring_offset + renderer_data_internal.sprite_count;
+    batch->sprites = renderer_data_internal.sprite_data + batch->first_sprite;
+    batch->reserved_count = count;
+    batch->frame_number = renderer_data_internal.frame_number;
+    renderer_data_internal.sprite_count += count;
 
-    batch->vertices[batch->quad_count * 4 + 3] = Vertex2D{
-        .Position = { position.x, position.y + size.y },
-        .UV = { uv_min.x, uv_max.y },
-        .Color = color,
-    };
+    return true;
+}
 
-    batch->quad_count += 1;
+bool DrawQuad(SpriteBatch* batch, vec2 position, vec2 size, vec2 uv_min, vec2 uv_max, vec4 color)
+{
+    return DrawQuad(batch, position, size, 0.0f, uv_min, uv_max, color);
+}
 
-    return true;
+bool DrawQuad(SpriteBatch* batch, vec2 position, vec2 size, f32 rotation, vec2 uv_min, vec2 uv_max, vec4 color)
+{
+    return DrawSprite(
+        batch,
+        SpriteInstance{
+            .Position = position,
+            .Size = size,
+            .UVMin = PackUnorm16x2(uv_min),
+            .UVMax = PackUnorm16x2(uv_max),
+            .Color = PackUnorm8x4(color),
+            .Rotation = rotation,
+        }
+    );
 }
 
-bool DrawQuad(SpriteBatch* batch, vec2 p0, vec2 p1, vec2 p2, vec2 p3, vec2 uv_min, vec2 uv_max, vec4 color)
+bool DrawSprite(SpriteBatch* batch, const SpriteInstance& sprite)
 {
-    if (batch->quad_count == batch->max_quad_count)
+    // A reservation from an earlier frame points at a segment the GPU may be reading from
+    if (batch->reserved_count > 0 && batch->frame_number != renderer_data_internal.frame_number)
     {
-        KWARN("[SpriteBatch::DrawQuad]: Batch is already full");
-        return false;
+        batch->quad_count = 0;
+        batch->reserved_count = 0;
     }
 
-    batch->vertices[batch->quad_count * 4 + 0] = Vertex2D{
-        .Position = p0,
-        .UV = { uv_max.x, uv_max.y },
-        .Color = color,
-    };
-
-    batch->vertices[batch->quad_count * 4 + 1] = Vertex2D{
-        .Position = p1,
-        .UV = { uv_max.x, uv_min.y },
-        .Color = color,
-    };
-
-    batch->vertices[batch->quad_count * 4 + 2] = Vertex2D{
-        .Position = p2,
-        .UV = { uv_min.x, uv_min.y },
-        .Color = color,
-    };
-
-    batch->vertices[batch->quad_count * 4 + 3] = Vertex2D{
-        .Position = p3,
-        .UV = { uv_min.x, uv_max.y },
-        .Color = color,
-    };
+    // A full batch is queued and picks up where it left off
+    if (batch->quad_count == batch->reserved_count)
+    {
+        g_Renderer->AddRenderable(batch);
+        if (!ReserveSprites(batch))
+            return false;
+    }
 
+    batch->sprites[batch->quad_count] = sprite;
     batch->quad_count += 1;
 
     return true;
@@ -829,17 +1789,23 @@ bool DrawQuad(SpriteBatch* batch, vec2 p0, vec2 p1, vec2 p2, vec2 p3, vec2 uv_mi
 
 void EndSpriteBatch(SpriteBatch* batch)
 {
-    g_Renderer->UpdateGeometry(
-        batch->geometry,
-        batch->quad_count * 4,
-        batch->vertices,
-        sizeof(Vertex2D),
-        0,
-        nullptr, // We don't want to update indices again
-        sizeof(u32)
-    );
+    if (batch->reserved_count == 0 || batch->frame_number != renderer_data_internal.frame_number)
+    {
+        batch->quad_count = 0;
+        batch->reserved_count = 0;
+        return;
+    }
+
+    g_Renderer->AddRenderable(batch);
+
+    // Hand back the unused space if nothing was reserved after the batch
+    u32 segment_end = renderer_data_internal.sprite_ring_offset + renderer_data_internal.sprite_count;
+    if (batch->first_sprite + batch->reserved_count == segment_end)
+    {
+        renderer_data_internal.sprite_count -= batch->reserved_count;
+    }
 
-    batch->geometry->DrawData.IndexCount = batch->quad_count * 6;
+    batch->reserved_count = 0;
 }
 
 //
@@ -13,6 +13,7 @@ struct Material;
 struct ShaderUniform;
 struct Texture;
 struct RendererOptions;
+struct JobCounter;
 
 namespace r {
 
@@ -30,14 +31,20 @@ struct GPUDevice;
 template<typename T>
 struct Handle;
 
+struct SpriteInstance;
+
+// Quads drawn with the same material. They are written straight into the frame's sprite buffer and expanded into
+// vertices on the GPU; every `max_quad_count` quads the batch is queued as a single draw into the active surface.
+// Batches are filled on the main thread, in between PrepareFrame and DrawSurfaces.
 struct SpriteBatch
 {
-    Vertex2D* vertices;
-    u32*      indices;
-    Geometry* geometry;
-    Material* material;
-    u16       quad_count;
-    u16       max_quad_count;
+    Material*       material;
+    SpriteInstance* sprites;        // Space reserved for the batch in the frame's sprite buffer
+    u32             first_sprite;   // Index of sprites[0] in the sprite buffer
+    u32             quad_count;     // Quads written to `sprites` that haven't been queued yet
+    u32             reserved_count; // Size of the reservation
+    u32             max_quad_count;
+    u64             frame_number;   // Frame the reservation was made in
 };
 
 struct RendererFrontend
@@ -52,15 +59,20 @@ struct RendererFrontend
     void PrepareFrame();
     bool DrawSurfaces();
     bool AddRenderable(const Renderable& object);
+
+    // Queues the quads drawn into the batch since it was last queued; returns false if there were none
     bool AddRenderable(SpriteBatch* batch);
 
     void BeginMainRenderpass();
     void EndMainRenderpass();
 
+    // Frames prepared so far, incremented by PrepareFrame
+    u64 GetFrameNumber() const;
+
     // API
-    void CreateRenderPipeline(Shader* shader);
+    void CreateRenderPipeline(Shader* shader, JobCounter* counter = nullptr);
     void DestroyRenderPipeline(Shader* shader);
-    void UseShader(const Shader* shader, u32 variant_index = 0);
+    bool UseShader(const Shader* shader, u32 variant_index = 0); // False if the shader isn't ready yet
     void ApplyGlobalShaderProperties(
         Shader*        shader,
         Handle<Buffer> ubo_buffer,
@@ -88,6 +100,13 @@ struct RendererFrontend
         const void* indices,
         const u32   index_size
     );
+    // Gives the geometry's vertex and index ranges back to the global buffers
+    void DestroyGeometry(Geometry* geometry);
+
+    // Moves every geometry towards the start of the global vertex and index buffers and
+    // rewrites their GeometryDrawData. Call it outside of a frame, renderables that were
+    // already added would still point at the old offsets.
+    void CompactGeometryBuffers();
 
     RenderSurface CreateRenderSurface(
         String8 name,
@@ -102,16 +121,42 @@ struct RendererFrontend
     void          EndRenderSurface(const RenderSurface& surface);
 
     void CmdSetCustomBuffer(Shader* shader, Handle<Buffer> buffer, u32 set_idx, u32 binding_idx);
+    void CmdSetCustomStorageImage(Shader* shader, Handle<Texture> texture, u32 set_idx, u32 binding_idx);
+
+    // Compute work is recorded between BeginComputePass and EndComputePass, after PrepareFrame and before the
+    // surfaces and the main render pass that use its results. Dispatches outside of a compute pass are invalid.
+    void BeginComputePass();
+    void EndComputePass();
+
+    // Binds a ComputeShader variant along with the global descriptors, including this frame's instance buffer.
+    // Returns false while the shader's pipelines are still being created, skip the dispatch in that case.
+    bool BindComputeShader(Shader* shader, u32 variant_index = 0);
+    void Dispatch(u32 group_count_x, u32 group_count_y = 1, u32 group_count_z = 1);
+    void DispatchIndirect(Handle<Buffer> buffer, u64 offset = 0);
+
+    // Makes the writes described by `src_access` (PipelineAccessFlags) visible to `dst_access`. Textures also
+    // move to the layout `dst_access` needs; compute writes happen in the general layout.
+    void PipelineBarrier(u32 src_access, u32 dst_access);
+    void TextureBarrier(Handle<Texture> texture, u32 src_access, u32 dst_access);
 };
 
 RendererFrontend* CreateRendererFrontend(const RendererOptions* options);
 void              DestroyRendererFrontend(RendererFrontend* instance);
 
+// Model matrix to draw the geometry with; folds in the position dequantization of Vertex3DPacked meshes
+Mat4f GeometryModelMatrix(const Mat4f& model, const GeometryDrawData& draw_data);
+
+// `batch_size` is the number of quads drawn with a single draw; larger batches are split into several draws
 SpriteBatch* CreateSpriteBatch(ArenaAllocator* arena, u16 batch_size);
 void         BeginSpriteBatch(SpriteBatch* batch, Material* material);
-bool         DrawQuad(SpriteBatch* batch, vec2 position, vec2 size, vec2 uv_min, vec2 uv_max, vec4 color);
-bool         DrawQuad(SpriteBatch* batch, vec2 p0, vec2 p1, vec2 p2, vec2 p3, vec2 uv_min, vec2 uv_max, vec4 color);
-void         EndSpriteBatch(SpriteBatch* batch);
+
+// Returns false if the quad was dropped because the frame's sprite buffer is full, see RendererOptions::MaxSpritesPerFrame
+bool DrawQuad(SpriteBatch* batch, vec2 position, vec2 size, vec2 uv_min, vec2 uv_max, vec4 color);
+bool DrawQuad(SpriteBatch* batch, vec2 position, vec2 size, f32 rotation, vec2 uv_min, vec2 uv_max, vec4 color);
+bool DrawSprite(SpriteBatch* batch, const SpriteInstance& sprite);
+
+// Queues the remaining quads and hands the unused part of the batch's reservation back
+void EndSpriteBatch(SpriteBatch* batch);
 
 } // namespace r
 
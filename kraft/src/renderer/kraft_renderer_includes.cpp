@@ -1,6 +1,12 @@
+#include "kraft_glyph_cache.cpp"
 #include "kraft_text_renderer.cpp"
 #include "kraft_camera.cpp"
 #include "kraft_resource_manager.cpp"
+#include "kraft_geometry_heap.cpp"
+#include "kraft_culling.cpp"
+#include "kraft_occlusion_culling.cpp"
+#include "kraft_render_queue.cpp"
 #include "kraft_renderer_frontend.cpp"
+#include "kraft_gpu_culling.cpp"
 
 #include "vulkan/kraft_vulkan_includes.cpp"
\ No newline at end of file
@@ -1,9 +1,15 @@
 #pragma once
 
 #include "kraft_renderer_types.h"
+#include "kraft_glyph_cache.h"
 #include "kraft_text_renderer.h"
 #include "kraft_camera.h"
 #include "kraft_resource_manager.h"
 #include "kraft_resource_pool.inl"
+#include "kraft_geometry_heap.h"
+#include "kraft_culling.h"
+#include "kraft_occlusion_culling.h"
+#include "kraft_render_queue.h"
 #include "kraft_renderer_frontend.h"
+#include "kraft_gpu_culling.h"
 #include "vulkan/kraft_vulkan_includes.h"
\ No newline at end of file
@@ -14,6 +14,7 @@ struct ShaderUniform;
 struct World;
 struct ArenaAllocator;
 struct RendererOptions;
+struct JobCounter;
 
 namespace r {
 
@@ -21,6 +22,7 @@ struct RenderPass;
 struct CommandBuffer;
 struct Buffer;
 struct RenderSurface;
+struct GPUCullingSurface;
 
 // Templated only for type-safety
 template<typename T>
@@ -105,11 +107,40 @@ struct alignas(16) GlobalShaderData
     };
 };
 
+namespace IndexType {
+enum Enum : u8
+{
+    UInt32,
+    UInt16,
+    Count
+};
+} // namespace IndexType
+
 struct GeometryDrawData
 {
-    u32 IndexCount;
-    u32 IndexBufferOffset; // Byte offset into the index buffer
-    u32 VertexOffset;      // Vertex index offset (VertexBufferOffset / VertexSize)
+    u32             IndexCount;
+    u32             IndexBufferOffset; // Byte offset into the index buffer
+    u32             VertexOffset;      // Vertex index offset (VertexBufferOffset / VertexSize)
+    IndexType::Enum IndexType;
+
+    // Maps the snorm16 positions of a Vertex3DPacked mesh back to object space; xyz = center of the bounds, w = scale.
+    // w is 0 for meshes with full precision positions.
+    Vec4f PositionDequantization = { 0.0f, 0.0f, 0.0f, 0.0f };
+};
+
+// Object space bounds of a geometry; the bounding sphere shares its center with the box
+struct GeometryBounds
+{
+    Vec3f Center = { 0.0f, 0.0f, 0.0f };
+    Vec3f Extents = { 0.0f, 0.0f, 0.0f }; // Half the size of the box along each axis
+
+    // Negative when the bounds are unknown, such geometry is never culled
+    f32 Radius = -1.0f;
+
+    KRAFT_INLINE bool IsValid() const
+    {
+        return Radius >= 0.0f;
+    }
 };
 
 struct GeometryDescription
@@ -133,6 +164,66 @@ struct Renderable
     Material*        MaterialInstance;
     GeometryDrawData DrawData;
     u32              EntityId;
+    GeometryBounds   Bounds; // Object space; renderables without bounds are never culled on the GPU
+
+    // Sprite batch draws; `SpriteCount` sprites from the frame's sprite buffer, starting at `FirstSprite`
+    u32 FirstSprite;
+    u32 SpriteCount;
+};
+
+// Per-instance data of instanced draws, laid out like InstanceData in common.glsl (std430)
+struct InstanceData
+{
+    Mat4f Model;
+    u32   EntityId;
+    u32   MaterialIdx;
+    u32   _pad[2];
+};
+
+// A quad of a sprite batch, laid out like SpriteInstance in sprite.kfx (std430). The vertex shader expands it into the
+// four corners of the quad.
+struct SpriteInstance
+{
+    Vec2f Position; // Corner that `UVMin` maps to
+    Vec2f Size;
+    u32   UVMin;    // unorm16x2
+    u32   UVMax;    // unorm16x2
+    u32   Color;    // unorm8x4, RGBA
+    f32   Rotation; // Radians, around the center of the quad
+};
+
+KRAFT_INLINE static u32 PackUnorm16x2(Vec2f value)
+{
+    u32 x = (u32)(math::Clamp(value.x, 0.0f, 1.0f) * 65535.0f + 0.5f);
+    u32 y = (u32)(math::Clamp(value.y, 0.0f, 1.0f) * 65535.0f + 0.5f);
+    return x | (y << 16);
+}
+
+KRAFT_INLINE static u32 PackUnorm8x4(Vec4f value)
+{
+    u32 r = (u32)(math::Clamp(value.x, 0.0f, 1.0f) * 255.0f + 0.5f);
+    u32 g = (u32)(math::Clamp(value.y, 0.0f, 1.0f) * 255.0f + 0.5f);
+    u32 b = (u32)(math::Clamp(value.z, 0.0f, 1.0f) * 255.0f + 0.5f);
+    u32 a = (u32)(math::Clamp(value.w, 0.0f, 1.0f) * 255.0f + 0.5f);
+    return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+// Laid out like VkDrawIndexedIndirectCommand, so the indirect buffer can be handed to the GPU as is
+struct DrawIndexedIndirectCommand
+{
+    u32 IndexCount;
+    u32 InstanceCount;
+    u32 FirstIndex;
+    i32 VertexOffset;
+    u32 FirstInstance;
+};
+
+// Laid out like VkDispatchIndirectCommand
+struct DispatchIndirectCommand
+{
+    u32 GroupCountX;
+    u32 GroupCountY;
+    u32 GroupCountZ;
 };
 
 struct RenderPacket
@@ -144,6 +235,16 @@ struct RenderPacket
 struct DeviceInfoT
 {};
 
+// Storage buffers that CmdPushStorageBuffers can bind
+#define KRAFT_RENDERER_MAX_PUSHED_STORAGE_BUFFERS 6
+
+// Chunks a surface can be split into when its draws are recorded in parallel
+#define KRAFT_RENDERER_MAX_SECONDARY_COMMAND_BUFFERS 32
+
+// Draws per chunk when a surface is recorded in parallel; surfaces with fewer than two chunks' worth are recorded on
+// the main thread. Chunks grow past this when a surface would need more than KRAFT_RENDERER_MAX_SECONDARY_COMMAND_BUFFERS.
+#define KRAFT_RENDERER_RECORDING_CHUNK_SIZE 256
+
 struct RendererBackend
 {
     bool (*Init)(ArenaAllocator* Arena, RendererOptions* Config);
@@ -155,22 +256,59 @@ struct RendererBackend
 
     // Shader
     void (*UseShader)(const Shader* Shader, u32 VariantIndex);
-    void (*ApplyGlobalShaderProperties)(Shader* shader, Handle<Buffer> ubo_buffer, Handle<Buffer> materials_buffer, Handle<Buffer> vertex_buffer, Handle<Buffer> index_buffer);
+    void (*ApplyGlobalShaderProperties)(Shader* shader, Handle<Buffer> ubo_buffer, Handle<Buffer> materials_buffer, Handle<Buffer> vertex_buffer, Handle<Buffer> index_buffer, Handle<Buffer> instance_buffer);
     void (*ApplyLocalShaderProperties)(Shader* ActiveShader, void* Data);
-    void (*CreateRenderPipeline)(Shader* Shader);
+    void (*CreateRenderPipeline)(Shader* Shader, JobCounter* Counter);
     void (*DestroyRenderPipeline)(Shader* Shader);
     void (*UpdateTextures)(Handle<Texture>* textures, u64 texture_count);
 
+    // Points the descriptors of `textures` at `placeholder` until their real data has been uploaded
+    void (*BindPlaceholderTextures)(Handle<Texture>* textures, u64 texture_count, Handle<Texture> placeholder);
+
     // Geometry
     void (*DrawGeometryData)(GeometryDrawData draw_data);
+
+    // Draws `instance_count` instances; gl_InstanceIndex starts at `first_instance`
+    void (*DrawGeometryDataInstanced)(GeometryDrawData draw_data, u32 instance_count, u32 first_instance);
+    void (*DrawGeometryIndirect)(Handle<Buffer> indirect_buffer, u64 offset, u32 draw_count, IndexType::Enum index_type);
     bool (*CreateGeometry)(const GeometryDescription& description);
     bool (*UpdateGeometry)(const GeometryDescription& description);
 
     // Render Passes
+    // Starts recording the surface's commands without beginning rendering, so compute work that its draws depend on
+    // can be recorded first. BeginSurface is optional after it.
+    void (*PrepareSurface)(RenderSurface* surface);
     void (*BeginSurface)(RenderSurface* surface);
     void (*EndSurface)(RenderSurface* surface);
 
+    // Ends rendering midway through a surface so compute work can read its depth, and picks it back up afterwards
+    void (*SuspendSurface)(RenderSurface* surface);
+    void (*ResumeSurface)(RenderSurface* surface);
+
+    // Parallel recording. BeginParallelSurface begins rendering with every draw coming from secondary command buffers;
+    // each chunk is recorded between BeginSecondaryCommands and EndSecondaryCommands on any job thread, with the
+    // calling thread's own command pool, and ExecuteSecondaryCommands runs slots [0, count) in order on the main thread.
+    void (*BeginParallelSurface)(RenderSurface* surface);
+    bool (*BeginSecondaryCommands)(const RenderSurface* surface, u32 slot);
+    void (*EndSecondaryCommands)();
+    void (*ExecuteSecondaryCommands)(RenderSurface* surface, u32 count);
+
     void (*CmdSetCustomBuffer)(Shader* shader, Handle<Buffer> buffer, u32 set_idx, u32 binding_idx);
+    void (*CmdSetCustomStorageImage)(Shader* shader, Handle<Texture> texture, u32 set_idx, u32 binding_idx);
+
+    // Pushes set 0 with `uniform_buffer` at binding 0 and `storage_buffers` from binding 2 onwards, in place of the
+    // global buffers. Only compute shaders see the bindings past the instance buffer.
+    void (*CmdPushStorageBuffers)(Shader* shader, Handle<Buffer> uniform_buffer, const Handle<Buffer>* storage_buffers, u32 count);
+
+    // Compute
+    void (*BeginComputePass)();
+    void (*EndComputePass)();
+    void (*Dispatch)(u32 group_count_x, u32 group_count_y, u32 group_count_z);
+    void (*DispatchIndirect)(Handle<Buffer> buffer, u64 offset);
+
+    // Barriers take PipelineAccessFlags
+    void (*PipelineBarrier)(u32 src_access, u32 dst_access);
+    void (*TextureBarrier)(Handle<Texture> texture, u32 src_access, u32 dst_access);
 
     DeviceInfoT DeviceInfo;
 };
@@ -190,6 +328,15 @@ struct Vertex3D
     Vec4f Tangent; // xyz = tangent direction, w = bitangent sign
 };
 
+// Compact alternative to Vertex3D that meshes can opt into at import, 20 bytes instead of 48
+struct Vertex3DPacked
+{
+    i16 Position[4]; // xyz = snorm16 relative to the mesh bounds (see GeometryDrawData::PositionDequantization), w = bitangent sign
+    i16 Normal[2];   // Octahedral encoded, snorm16
+    i16 Tangent[2];  // Octahedral encoded, snorm16
+    u16 UV[2];       // Half precision floats
+};
+
 struct ShaderDataType
 {
     enum Enum : u8
@@ -211,6 +358,7 @@ struct ShaderDataType
         UInt2,
         UInt4,
         TextureID,
+        Half2,
         Count
     } UnderlyingType;
 
@@ -218,7 +366,7 @@ struct ShaderDataType
     static const char* String(Enum Value)
     {
         static const char* Strings[] = { "Float",  "Float2",  "Float3", "Float4",  "Mat4", "Byte",  "Byte4N", "UByte",     "UByte4N",
-                                         "Short2", "Short2N", "Short4", "Short4N", "UInt", "UInt2", "UInt4",  "TextureID", "Count" };
+                                         "Short2", "Short2N", "Short4", "Short4N", "UInt", "UInt2", "UInt4",  "TextureID", "Half2", "Count" };
         return (Value < Enum::Count ? Strings[(int)Value] : "Unsupported");
     }
 
@@ -243,6 +391,7 @@ struct ShaderDataType
             case UInt2:     return 2 * sizeof(u32) * Value.ArraySize;
             case UInt4:     return 4 * sizeof(u32) * Value.ArraySize;
             case TextureID: return sizeof(u32);
+            case Half2:     return 2 * sizeof(u16) * Value.ArraySize;
             case Count:     return 0;
         }
 
@@ -270,6 +419,7 @@ struct ShaderDataType
             case UInt2:     return 8;
             case UInt4:     return 16;
             case TextureID: return 4;
+            case Half2:     return 4;
             case Count:     return 1;
         }
 
@@ -326,10 +476,11 @@ enum Enum
     UniformBuffer,
     StorageBuffer,
     ConstantBuffer,
+    StorageImage,
     Count
 };
 
-static const char* Strings[] = { "Sampler", "UniformBuffer", "StorageBuffer", "ConstantBuffer", "Count" };
+static const char* Strings[] = { "Sampler", "UniformBuffer", "StorageBuffer", "ConstantBuffer", "StorageImage", "Count" };
 
 static const char* String(Enum Value)
 {
@@ -666,6 +817,22 @@ enum ShaderStageFlags : int
     SHADER_STAGE_FLAGS_COMPUTE = 1 << 3,
 };
 
+// How a resource is used on either side of a barrier. Compute reads and writes cover storage buffers and images, while
+// vertex and fragment reads of a texture are sampled reads.
+enum PipelineAccessFlags
+{
+    PIPELINE_ACCESS_FLAGS_NONE = 0,
+    PIPELINE_ACCESS_FLAGS_COMPUTE_READ = 1 << 0,
+    PIPELINE_ACCESS_FLAGS_COMPUTE_WRITE = 1 << 1,
+    PIPELINE_ACCESS_FLAGS_VERTEX_READ = 1 << 2,
+    PIPELINE_ACCESS_FLAGS_FRAGMENT_READ = 1 << 3,
+    PIPELINE_ACCESS_FLAGS_INDIRECT_READ = 1 << 4, // Draw and dispatch arguments
+    PIPELINE_ACCESS_FLAGS_INDEX_READ = 1 << 5,
+    PIPELINE_ACCESS_FLAGS_TRANSFER_READ = 1 << 6,
+    PIPELINE_ACCESS_FLAGS_TRANSFER_WRITE = 1 << 7,
+    PIPELINE_ACCESS_FLAGS_HOST_READ = 1 << 8,
+};
+
 namespace LoadOp {
 enum Enum
 {
@@ -899,6 +1066,9 @@ struct GPUDevice
     u64  min_uniform_buffer_alignment;
     u64  min_storage_buffer_alignment;
     bool supports_device_local_host_visible;
+    bool supports_multi_draw_indirect;
+    u32  max_draw_indirect_count;
+    bool supports_parallel_recording;
 };
 
 struct RenderSurface
@@ -911,12 +1081,16 @@ struct RenderSurface
     Handle<RenderPass>    RenderPass;
     Handle<Texture>       ColorPassTexture;
     Handle<Texture>       DepthPassTexture;
+    bool                  DepthSampled; // The depth attachment can be read by shaders once the surface has ended
     // Sampler to use for sampling color and depth textures
     Handle<TextureSampler> TextureSampler;
     Handle<Buffer>         GlobalUBO;
     World*                 World;
     GlobalShaderData       global_shader_data;
 
+    // Set when the surface's instanced draws are culled on the GPU, see RendererOptions::GPUCulling
+    GPUCullingSurface* Culling;
+
     // Mouse position relative to the surface
     // Used in global data
     kraft::Vec2f RelativeMousePosition;
@@ -55,8 +55,14 @@ struct ResourceManager {
 
     // Uploads data from the the `Buffer` to the `Texture`
     bool (*UploadTexture)(Handle<Texture> Texture, Handle<Buffer> Buffer, u64 BufferOffset) = 0;
+    // Uploads data from the `Buffer` to a region of a texture that UploadTexture already filled, the rest of the texture
+    // keeps its contents. The rows of the region are tightly packed in the buffer.
+    bool (*UploadTextureRegion)(Handle<Texture> Texture, Handle<Buffer> Buffer, u64 BufferOffset, u32 X, u32 Y, u32 Width, u32 Height) = 0;
     // Uploads raw buffer data to the GPU
     bool (*UploadBuffer)(const UploadBufferDescription& Description) = 0;
+    // Uploads are batched and executed right before the frame's rendering work.
+    // This submits everything recorded so far and waits for it to finish.
+    void (*FlushUploads)() = 0;
     bool (*ReadTextureData)(const ReadTextureDataDescription& Description) = 0;
 
     Texture* (*GetTextureMetadata)(Handle<Texture> Resource) = 0;
@@ -7,6 +7,13 @@
 namespace kraft {
 namespace r {
 
+struct TextLayoutCache
+{
+    FlatHashMap<u64, TextLayout> layouts;
+    u64                          use_clock;
+    u32                          font_count; // Atlases and fonts share their ids
+} text_layout_cache;
+
 FontAtlas LoadFontAtlas(ArenaAllocator* arena, u8* font_data, u64 font_data_size, f32 font_size)
 {
     TempArena      scratch = ScratchBegin(&arena, 1);
@@ -21,6 +28,8 @@ FontAtlas LoadFontAtlas(ArenaAllocator* arena, u8* font_data, u64 font_data_size
         .height = 2048,
         .start_character = start_character,
         .num_chars = num_chars,
+        .id = ++text_layout_cache.font_count,
+        .stb_font_info = font,
     };
 
     KASSERT(num_chars < KRAFT_MAX_GLYPHS_IN_ATLAS);
@@ -66,6 +75,16 @@ FontAtlas LoadFontAtlas(ArenaAllocator* arena, u8* font_data, u64 font_data_size
     atlas.font_scale = stbtt_ScaleForPixelHeight(&font, font_size);
     atlas.ascent = (f32)ascent;
     atlas.descent = (f32)descent;
+
+    // Looking the kerning up in the font is slow, so it's done once for every pair here instead of on every layout
+    atlas.kerning = ArenaPushArray(arena, f32, num_chars * num_chars);
+    for (u32 a = 0; a < num_chars; a++)
+    {
+        for (u32 b = 0; b < num_chars; b++)
+        {
+            atlas.kerning[a * num_chars + b] = atlas.font_scale * stbtt_GetCodepointKernAdvance(&font, start_character + a, start_character + b);
+        }
+    }
     atlas.bitmap =
         TextureSystem::AcquireTextureWithData(String8Raw("bitmap"), packed_bitmap, atlas.width, atlas.height, 1);
 
@@ -73,6 +92,457 @@ FontAtlas LoadFontAtlas(ArenaAllocator* arena, u8* font_data, u64 font_data_size
     return atlas;
 }
 
+Font LoadFont(GlyphCache* cache, u8* font_data, u64 font_data_size)
+{
+    Font font = {
+        .cache = cache,
+        .id = ++text_layout_cache.font_count,
+    };
+
+    stbtt_InitFont(&font.stb_font_info, font_data, stbtt_GetFontOffsetForIndex(font_data, 0));
+
+    int ascent;
+    int descent;
+    int line_gap;
+    stbtt_GetFontVMetrics(&font.stb_font_info, &ascent, &descent, &line_gap);
+
+    font.pixel_height_scale = stbtt_ScaleForPixelHeight(&font.stb_font_info, 1.0f);
+    font.ascent = (f32)ascent;
+    font.descent = (f32)descent;
+    font.line_gap = (f32)line_gap;
+
+    return font;
+}
+
+static KRAFT_INLINE f32 GetKernAdvance(const FontAtlas* atlas, u32 char_index, char next_character)
+{
+    u32 next_index = (u32)(u8)next_character - atlas->start_character;
+    if (char_index >= atlas->num_chars || next_index >= atlas->num_chars)
+        return 0.0f;
+
+    return atlas->kerning[char_index * atlas->num_chars + next_index];
+}
+
+static void BuildTextLayout(TextLayout* layout, const FontAtlas* atlas, String8 text)
+{
+    layout->capacity = math::Max(text.count, (u64)1);
+    layout->glyphs = (SpriteInstance*)Malloc(sizeof(SpriteInstance) * layout->capacity, MEMORY_TAG_RENDERER);
+    layout->glyph_count = 0;
+    layout->bounds_min = { 0.0f, 0.0f };
+    layout->bounds_max = { 0.0f, 0.0f };
+
+    f32 cursor_x = 0.0f;
+    f32 cursor_y = 0.0f;
+    f32 space_advance = atlas->glyphs[' ' - atlas->start_character].x_advance;
+    for (u64 i = 0; i < text.count; i++)
+    {
+        char character = text.ptr[i];
+        if (character == '\n')
+        {
+            cursor_y -= atlas->ascent * atlas->font_scale;
+            cursor_x = 0.f;
+            continue;
+        }
+
+        if (character == '\t')
+        {
+            cursor_x += 4.0f * space_advance;
+            continue;
+        }
+
+        // Characters the atlas doesn't have take up no space
+        u32 char_index = (u32)(u8)character - atlas->start_character;
+        if (char_index >= atlas->num_chars)
+            continue;
+
+        const FontGlyph& glyph = atlas->glyphs[char_index];
+        f32              kern_advance = (i + 1) < text.count ? GetKernAdvance(atlas, char_index, text.ptr[i + 1]) : 0.0f;
+
+        // Same quad RenderText builds; the bottom-left corner samples (u0, v1) and the top-right one (u1, v0)
+        Vec2f position = { cursor_x + glyph.baseline_xoff_0, cursor_y - glyph.baseline_yoff_1 };
+        Vec2f size = { glyph.baseline_xoff_1 - glyph.baseline_xoff_0, glyph.baseline_yoff_1 - glyph.baseline_yoff_0 };
+        cursor_x += kern_advance + glyph.x_advance;
+
+        // Whitespace has no quad
+        if (size.x <= 0.0f || size.y <= 0.0f)
+            continue;
+
+        layout->glyphs[layout->glyph_count++] = SpriteInstance{
+            .Position = position,
+            .Size = size,
+            .UVMin = PackUnorm16x2({ glyph.u0, glyph.v1 }),
+            .UVMax = PackUnorm16x2({ glyph.u1, glyph.v0 }),
+        };
+
+        if (layout->glyph_count == 1)
+        {
+            layout->bounds_min = position;
+            layout->bounds_max = position + size;
+        }
+        else
+        {
+            layout->bounds_min = { math::Min(layout->bounds_min.x, position.x), math::Min(layout->bounds_min.y, position.y) };
+            layout->bounds_max = { math::Max(layout->bounds_max.x, position.x + size.x), math::Max(layout->bounds_max.y, position.y + size.y) };
+        }
+    }
+}
+
+// Decodes the codepoint at `*offset` and moves past it; malformed sequences decode to U+FFFD one byte at a time
+static u32 DecodeUTF8(String8 text, u64* offset)
+{
+    const u32 replacement_character = 0xFFFD;
+
+    u8  lead = text.ptr[*offset];
+    u32 length;
+    u32 codepoint;
+    if (lead < 0x80)
+    {
+        *offset += 1;
+        return lead;
+    }
+    else if ((lead & 0xE0) == 0xC0)
+    {
+        length = 2;
+        codepoint = lead & 0x1F;
+    }
+    else if ((lead & 0xF0) == 0xE0)
+    {
+        length = 3;
+        codepoint = lead & 0x0F;
+    }
+    else if ((lead & 0xF8) == 0xF0)
+    {
+        length = 4;
+        codepoint = lead & 0x07;
+    }
+    else
+    {
+        *offset += 1;
+        return replacement_character;
+    }
+
+    if (*offset + length > text.count)
+    {
+        *offset += 1;
+        return replacement_character;
+    }
+
+    for (u32 i = 1; i < length; i++)
+    {
+        u8 continuation = text.ptr[*offset + i];
+        if ((continuation & 0xC0) != 0x80)
+        {
+            *offset += 1;
+            return replacement_character;
+        }
+
+        codepoint = (codepoint << 6) | (continuation & 0x3F);
+    }
+
+    // Overlong encodings, surrogates and anything past the last plane
+    const u32 min_codepoint[] = { 0, 0, 0x80, 0x800, 0x10000 };
+    if (codepoint < min_codepoint[length] || (codepoint >= 0xD800 && codepoint <= 0xDFFF) || codepoint > 0x10FFFF)
+    {
+        *offset += 1;
+        return replacement_character;
+    }
+
+    *offset += length;
+    return codepoint;
+}
+
+static void BuildTextLayout(TextLayout* layout, const Font* font, String8 text)
+{
+    layout->capacity = math::Max(text.count, (u64)1);
+    layout->placements = (GlyphPlacement*)Malloc(sizeof(GlyphPlacement) * layout->capacity, MEMORY_TAG_RENDERER);
+    layout->glyph_count = 0;
+    layout->bounds_min = { 0.0f, 0.0f };
+    layout->bounds_max = { 0.0f, 0.0f };
+
+    const stbtt_fontinfo* info = &font->stb_font_info;
+    int                   space_advance;
+    stbtt_GetCodepointHMetrics(info, ' ', &space_advance, nullptr);
+
+    Vec2f pen = { 0.0f, 0.0f };
+    int   previous_glyph = 0;
+    u64   offset = 0;
+    while (offset < text.count)
+    {
+        u32 codepoint = DecodeUTF8(text, &offset);
+        if (codepoint == '\n')
+        {
+            pen.x = 0.0f;
+            pen.y -= font->ascent - font->descent + font->line_gap;
+            previous_glyph = 0;
+            continue;
+        }
+
+        if (codepoint == '\t')
+        {
+            pen.x += 4.0f * space_advance;
+            previous_glyph = 0;
+            continue;
+        }
+
+        // Codepoints the font doesn't have are drawn with its missing glyph, glyph 0
+        int glyph_index = stbtt_FindGlyphIndex(info, (int)codepoint);
+        if (previous_glyph)
+        {
+            pen.x += stbtt_GetGlyphKernAdvance(info, previous_glyph, glyph_index);
+        }
+
+        int advance;
+        stbtt_GetGlyphHMetrics(info, glyph_index, &advance, nullptr);
+        previous_glyph = glyph_index;
+
+        int x0, y0, x1, y1;
+        if (stbtt_IsGlyphEmpty(info, glyph_index) || !stbtt_GetGlyphBox(info, glyph_index, &x0, &y0, &x1, &y1))
+        {
+            pen.x += advance;
+            continue;
+        }
+
+        layout->placements[layout->glyph_count++] = GlyphPlacement{
+            .pen = pen,
+            .glyph_index = (u32)glyph_index,
+        };
+
+        Vec2f box_min = { pen.x + x0, pen.y + y0 };
+        Vec2f box_max = { pen.x + x1, pen.y + y1 };
+        if (layout->glyph_count == 1)
+        {
+            layout->bounds_min = box_min;
+            layout->bounds_max = box_max;
+        }
+        else
+        {
+            layout->bounds_min = { math::Min(layout->bounds_min.x, box_min.x), math::Min(layout->bounds_min.y, box_min.y) };
+            layout->bounds_max = { math::Max(layout->bounds_max.x, box_max.x), math::Max(layout->bounds_max.y, box_max.y) };
+        }
+
+        pen.x += advance;
+    }
+}
+
+static void FreeTextLayout(TextLayout* layout)
+{
+    if (layout->glyphs)
+    {
+        Free(layout->glyphs, sizeof(SpriteInstance) * layout->capacity, MEMORY_TAG_RENDERER);
+    }
+
+    if (layout->placements)
+    {
+        Free(layout->placements, sizeof(GlyphPlacement) * layout->capacity, MEMORY_TAG_RENDERER);
+    }
+
+    if (layout->text.ptr)
+    {
+        Free(layout->text.ptr, layout->text.count, MEMORY_TAG_RENDERER);
+    }
+
+    layout->glyphs = nullptr;
+    layout->placements = nullptr;
+    layout->capacity = 0;
+    layout->text = {};
+}
+
+static void EvictTextLayouts()
+{
+    TempArena scratch = ScratchBegin(0, 0);
+    u64*      evicted = ArenaPushArrayNoZero(scratch.arena, u64, text_layout_cache.layouts.size());
+    u64       evicted_count = 0;
+    u64       oldest_kept = text_layout_cache.use_clock - KRAFT_TEXT_LAYOUT_CACHE_SIZE / 2;
+    for (auto& it : text_layout_cache.layouts)
+    {
+        if (it.second.last_used < oldest_kept)
+        {
+            FreeTextLayout(&it.second);
+            evicted[evicted_count++] = it.first;
+        }
+    }
+
+    for (u64 i = 0; i < evicted_count; i++)
+    {
+        text_layout_cache.layouts.erase(evicted[i]);
+    }
+
+    ScratchEnd(scratch);
+}
+
+// Returns the layout cached for the text of the atlas or font with the id `font_id`, or an empty one to fill in
+static TextLayout* FindTextLayout(u32 font_id, String8 text, bool* cached)
+{
+    u64 key = MurmurHash64(text.ptr, (int)text.count, font_id);
+    u64 use = ++text_layout_cache.use_clock;
+
+    TextLayout* layout = nullptr;
+    auto        it = text_layout_cache.layouts.find(key);
+    if (it != text_layout_cache.layouts.end())
+    {
+        layout = &it->second;
+        if (layout->font_id == font_id && StringEqual(layout->text, text))
+        {
+            layout->last_used = use;
+            *cached = true;
+            return layout;
+        }
+
+        // A different string with the same hash, its layout is replaced
+        FreeTextLayout(layout);
+    }
+    else
+    {
+        if (text_layout_cache.layouts.size() >= KRAFT_TEXT_LAYOUT_CACHE_SIZE)
+        {
+            EvictTextLayouts();
+        }
+
+        layout = &text_layout_cache.layouts[key];
+    }
+
+    *layout = {};
+    layout->last_used = use;
+    layout->font_id = font_id;
+    if (text.count > 0)
+    {
+        layout->text = String8FromPtrAndLength((u8*)Malloc(text.count, MEMORY_TAG_RENDERER), text.count);
+        MemCpy(layout->text.ptr, text.ptr, text.count);
+    }
+
+    *cached = false;
+    return layout;
+}
+
+const TextLayout* GetTextLayout(FontAtlas* atlas, String8 text)
+{
+    bool        cached;
+    TextLayout* layout = FindTextLayout(atlas->id, text, &cached);
+    if (!cached)
+    {
+        BuildTextLayout(layout, atlas, text);
+    }
+
+    return layout;
+}
+
+const TextLayout* GetTextLayout(Font* font, String8 text)
+{
+    bool        cached;
+    TextLayout* layout = FindTextLayout(font->id, text, &cached);
+    if (!cached)
+    {
+        BuildTextLayout(layout, font, text);
+    }
+
+    return layout;
+}
+
+void ClearTextLayoutCache()
+{
+    for (auto& it : text_layout_cache.layouts)
+    {
+        FreeTextLayout(&it.second);
+    }
+
+    text_layout_cache.layouts.clear();
+}
+
+// The 2D part of a text transform that sprites can carry
+struct TextTransform
+{
+    const Mat4f& matrix;
+    f32          scale_x;
+    f32          scale_y;
+    f32          rotation;
+    u32          color;
+};
+
+static TextTransform GetTextTransform(const Mat4f& transform, Vec4f color)
+{
+    // Row-major, so the first two rows are where the x and y axes end up. A mirrored transform flips the glyphs'
+    // height, which the vertex shader handles like any other size.
+    f32 scale_x = Sqrt(transform[0][0] * transform[0][0] + transform[0][1] * transform[0][1]);
+    f32 scale_y = Sqrt(transform[1][0] * transform[1][0] + transform[1][1] * transform[1][1]);
+    if (transform[0][0] * transform[1][1] - transform[0][1] * transform[1][0] < 0.0f)
+    {
+        scale_y = -scale_y;
+    }
+
+    return {
+        .matrix = transform,
+        .scale_x = scale_x,
+        .scale_y = scale_y,
+        .rotation = atan2f(transform[0][1], transform[0][0]),
+        .color = PackUnorm8x4(color),
+    };
+}
+
+static bool DrawGlyph(SpriteBatch* batch, SpriteInstance sprite, const TextTransform& transform)
+{
+    const Mat4f& matrix = transform.matrix;
+    Vec2f        center = sprite.Position + sprite.Size * 0.5f;
+    Vec2f        world_center = {
+        center.x * matrix[0][0] + center.y * matrix[1][0] + matrix[3][0],
+        center.x * matrix[0][1] + center.y * matrix[1][1] + matrix[3][1],
+    };
+
+    sprite.Size = { sprite.Size.x * transform.scale_x, sprite.Size.y * transform.scale_y };
+    sprite.Position = world_center - sprite.Size * 0.5f;
+    sprite.Color = transform.color;
+    sprite.Rotation = transform.rotation;
+
+    return DrawSprite(batch, sprite);
+}
+
+bool DrawText(SpriteBatch* batch, FontAtlas* atlas, String8 text, const Mat4f& transform, Vec4f color)
+{
+    const TextLayout* layout = GetTextLayout(atlas, text);
+    TextTransform     text_transform = GetTextTransform(transform, color);
+    for (u32 i = 0; i < layout->glyph_count; i++)
+    {
+        if (!DrawGlyph(batch, layout->glyphs[i], text_transform))
+            return false;
+    }
+
+    return true;
+}
+
+bool DrawText(SpriteBatch* batch, Font* font, String8 text, f32 size, const Mat4f& transform, Vec4f color)
+{
+    const TextLayout* layout = GetTextLayout(font, text);
+    TextTransform     text_transform = GetTextTransform(transform, color);
+    GlyphCache*       cache = font->cache;
+    f32               scale = size * font->pixel_height_scale;
+    Vec2f             texel_size = { 1.0f / cache->width, 1.0f / cache->height };
+    bool              drawn = true;
+    for (u32 i = 0; i < layout->glyph_count; i++)
+    {
+        const GlyphPlacement&  placement = layout->placements[i];
+        const GlyphCacheEntry* entry = GetCachedGlyph(cache, font, placement.glyph_index);
+        if (!entry)
+            continue;
+
+        // Same orientation as the atlas quads; the bottom-left corner samples the last row of the glyph
+        SpriteInstance sprite = {
+            .Position = { (placement.pen.x + entry->x0) * scale, (placement.pen.y + entry->y0) * scale },
+            .Size = { (entry->x1 - entry->x0) * scale, (entry->y1 - entry->y0) * scale },
+            .UVMin = PackUnorm16x2({ entry->x * texel_size.x, (entry->y + entry->height) * texel_size.y }),
+            .UVMax = PackUnorm16x2({ (entry->x + entry->width) * texel_size.x, entry->y * texel_size.y }),
+        };
+
+        if (!DrawGlyph(batch, sprite, text_transform))
+        {
+            drawn = false;
+            break;
+        }
+    }
+
+    UploadGlyphCache(cache);
+
+    return drawn;
+}
+
 r::Renderable RenderText(Material* material, FontAtlas* atlas, String8 text, Mat4f transform, Vec4f color)
 {
     TempArena    scratch = ScratchBegin(0, 0);
@@ -104,8 +574,7 @@ r::Renderable RenderText(Material* material, FontAtlas* atlas, String8 text, Mat
         f32 kern_advance = 0.f;
         if ((i + 1) < text.count)
         {
-            kern_advance =
-                atlas->font_scale * stbtt_GetCodepointKernAdvance(&atlas->stb_font_info, text.ptr[i], text.ptr[i + 1]);
+            kern_advance = GetKernAdvance(atlas, char_index, text.ptr[i + 1]);
         }
 
         // top-right
@@ -4,9 +4,15 @@
 
 #define KRAFT_MAX_GLYPHS_IN_ATLAS 512
 
+// Layouts kept around by GetTextLayout; once full, the ones that weren't used in the last half of that many lookups go
+#define KRAFT_TEXT_LAYOUT_CACHE_SIZE 1024
+
 namespace kraft {
 namespace r {
 
+struct SpriteBatch;
+struct SpriteInstance;
+
 struct FontGlyph
 {
     f32 baseline_xoff_0;
@@ -38,11 +44,61 @@ struct FontAtlas
     f32 ascent;
     f32 descent;
 
+    // Kerning in pixels of every pair of characters in the atlas; the pair (a, b) is at a * num_chars + b
+    f32* kerning;
+
+    // Identifies the atlas in the text layout cache
+    u32 id;
+
     // Internal-use
     stbtt_fontinfo stb_font_info;
 };
 
-FontAtlas     LoadFontAtlas(ArenaAllocator* arena, u8* font_data, u64 font_data_size, f32 font_size);
+// Glyph of a string laid out with a Font, where `pen` is the pen position in font units. Which part of the glyph
+// cache it is drawn from is only known once the text is drawn.
+struct GlyphPlacement
+{
+    Vec2f pen;
+    u32   glyph_index;
+};
+
+// Glyph quads of a string, relative to the start of its first baseline. Color and rotation are filled in when the
+// text is drawn. Layouts of a Font have `placements` instead of `glyphs`, and their bounds are in font units.
+struct TextLayout
+{
+    SpriteInstance* glyphs;
+    GlyphPlacement* placements;
+    u64             capacity; // Entries allocated for glyphs or placements
+    u32             glyph_count;
+    u32             font_id;
+    String8         text; // Copy of the text the layout was built from, compared on every cache hit
+    Vec2f           bounds_min;
+    Vec2f           bounds_max;
+    u64             last_used;
+};
+
+// The font data has to outlive the atlas. Only covers ASCII at a single size; use a Font for everything else.
+FontAtlas LoadFontAtlas(ArenaAllocator* arena, u8* font_data, u64 font_data_size, f32 font_size);
+
+// Glyphs are rasterized into `cache` as they are drawn. The font data has to outlive the font.
+Font LoadFont(GlyphCache* cache, u8* font_data, u64 font_data_size);
+
+// Lays out `text` or returns the cached layout from an earlier call with the same atlas and text. The layout stays valid
+// until the next call.
+const TextLayout* GetTextLayout(FontAtlas* atlas, String8 text);
+const TextLayout* GetTextLayout(Font* font, String8 text);
+void              ClearTextLayoutCache();
+
+// Writes the glyphs of `text` into the batch, whose material must sample the atlas with a text shader such as
+// res/shaders/text.kfx. All the strings drawn into a batch are merged into a single draw. Only the 2D part of the
+// transform carries over to the glyphs: translation, rotation around z and scale in the xy plane.
+bool DrawText(SpriteBatch* batch, FontAtlas* atlas, String8 text, const Mat4f& transform, Vec4f color);
+
+// Same as above for UTF-8 text in a Font, `size` pixels high. The batch's material must sample the font's glyph cache
+// with res/shaders/text_sdf.kfx. Glyphs that aren't cached yet are rasterized and uploaded before this returns.
+bool DrawText(SpriteBatch* batch, Font* font, String8 text, f32 size, const Mat4f& transform, Vec4f color);
+
+// Creates a new geometry on every call, use DrawText for text that changes or is drawn every frame
 r::Renderable RenderText(Material* material, FontAtlas* atlas, String8 text, Mat4f transform, Vec4f color);
 
 } // namespace r
@@ -23,6 +23,19 @@ static void SetObjectName(u64 object, VkObjectType type, const char* name);
 static struct ResourceManager* s_ResourceManager = nullptr;
 static VulkanContext s_Context = {};
 
+// Each job thread binds pipelines and index buffers into its own command buffers
+static kraft_thread_internal VulkanRecordingState s_Recording = {};
+static kraft_thread_internal VulkanRecordingState s_SavedRecording = {};
+
+// Command buffer the calling thread records into
+static VulkanCommandBuffer* activeCommandBuffer() {
+    if (s_Recording.Secondary) {
+        return s_Recording.Secondary;
+    }
+
+    return VulkanResourceManagerApi::GetCommandBuffer(s_Context.ActiveCommandBuffer);
+}
+
 VulkanContext* VulkanRendererBackend::Context() {
     return &s_Context;
 }
@@ -32,11 +45,21 @@ void VulkanRendererBackend::SetDeviceData(GPUDevice* device) {
     device->min_storage_buffer_alignment = device_properties->limits.minStorageBufferOffsetAlignment;
     device->min_uniform_buffer_alignment = device_properties->limits.minUniformBufferOffsetAlignment;
     device->supports_device_local_host_visible = s_Context.PhysicalDevice.SupportsDeviceLocalHostVisible;
+
+    // Indirect draws point at their instances with firstInstance, so both features are needed
+    const VkPhysicalDeviceFeatures& features = s_Context.PhysicalDevice.Features;
+    device->supports_multi_draw_indirect = features.multiDrawIndirect && features.drawIndirectFirstInstance;
+    device->max_draw_indirect_count = device->supports_multi_draw_indirect ? device_properties->limits.maxDrawIndirectCount : 1;
+
+    // Secondary command buffers inherit the surface's attachments through dynamic rendering only
+    device->supports_parallel_recording = KRAFT_ENABLE_VK_DYNAMIC_RENDERING && s_Context.SecondaryThreadCount > 1;
 }
 
 static bool createBuffers();
 static void createCommandBuffers();
 static void destroyCommandBuffers();
+static void createSecondaryCommandPools(ArenaAllocator* arena);
+static void destroySecondaryCommandPools();
 static void imageBarrier(VkImage image, VkDependencyFlags dependency_flags, VulkanImageBarrierDescription description);
 
 #if !KRAFT_ENABLE_VK_DYNAMIC_RENDERING
@@ -51,9 +74,8 @@ struct VulkanRendererBackendStateT {
 
 bool VulkanRendererBackend::Init(ArenaAllocator* arena, RendererOptions* renderer_options) {
     KRAFT_VK_CHECK(volkInitialize());
-    s_Context = VulkanContext{
-        .Options = renderer_options,
-    };
+    // The context holds atomics and can't be assigned as a whole; it starts out zeroed as a static
+    s_Context.Options = renderer_options;
 
     s_ResourceManager = ResourceManager;
 
@@ -189,6 +211,8 @@ bool VulkanRendererBackend::Init(ArenaAllocator* arena, RendererOptions* rendere
     KDEBUG("[VulkanRendererBackend::Init]: Graphics command pool created");
     ArenaPop(arena, sizeof(const char*) * max_device_extensions_count);
 
+    VulkanCreatePipelineCache(&s_Context, renderer_options->PipelineCachePath);
+
     PhysicalDeviceFormatSpecs format_specs;
     {
         switch (s_Context.PhysicalDevice.DepthBufferFormat) {
@@ -226,6 +250,7 @@ bool VulkanRendererBackend::Init(ArenaAllocator* arena, RendererOptions* rendere
     createFramebuffers(&s_Context.Swapchain, &s_Context.MainRenderPass);
 #endif
     createCommandBuffers();
+    createSecondaryCommandPools(arena);
 
     CreateArray(s_Context.ImageAvailableSemaphores, s_Context.Swapchain.ImageCount);
     CreateArray(s_Context.RenderCompleteSemaphores, s_Context.Swapchain.ImageCount);
@@ -271,7 +296,7 @@ bool VulkanRendererBackend::Init(ArenaAllocator* arena, RendererOptions* rendere
         vkCreateDescriptorPool(s_Context.LogicalDevice.Handle, &descriptor_pool_create_info, s_Context.AllocationCallbacks, &s_Context.GlobalDescriptorPool);
 
         // Descriptor sets
-        VkDescriptorSetLayoutBinding global_data_layout_bindings[4] = {};
+        VkDescriptorSetLayoutBinding global_data_layout_bindings[2 + KRAFT_RENDERER_MAX_PUSHED_STORAGE_BUFFERS] = {};
 
         // Binding #0: Global Shader Data - Projection, View, Camera, etc
         global_data_layout_bindings[0].binding = 0;
@@ -311,6 +336,22 @@ bool VulkanRendererBackend::Init(ArenaAllocator* arena, RendererOptions* rendere
         global_data_layout_bindings[3].pImmutableSamplers = 0;
         global_data_layout_bindings[3].stageFlags = VK_SHADER_STAGE_ALL;
 
+        // Binding #4: Per-instance data of instanced draws
+        global_data_layout_bindings[4].binding = 4;
+        global_data_layout_bindings[4].descriptorCount = 1;
+        global_data_layout_bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        global_data_layout_bindings[4].pImmutableSamplers = 0;
+        global_data_layout_bindings[4].stageFlags = VK_SHADER_STAGE_ALL;
+
+        // Binding #5 onwards: Storage buffers of compute passes, see CmdPushStorageBuffers
+        for (u32 i = 5; i < KRAFT_C_ARRAY_SIZE(global_data_layout_bindings); i++) {
+            global_data_layout_bindings[i].binding = i;
+            global_data_layout_bindings[i].descriptorCount = 1;
+            global_data_layout_bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            global_data_layout_bindings[i].pImmutableSamplers = 0;
+            global_data_layout_bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+
         VkDescriptorSetLayoutCreateInfo global_data_layout_create_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
         global_data_layout_create_info.bindingCount = KRAFT_C_ARRAY_SIZE(global_data_layout_bindings);
         global_data_layout_create_info.pBindings = &global_data_layout_bindings[0];
@@ -342,7 +383,7 @@ bool VulkanRendererBackend::Init(ArenaAllocator* arena, RendererOptions* rendere
         texture_data_layout_binding.binding = 0;
         texture_data_layout_binding.descriptorCount = KRAFT_RENDERER__MAX_GLOBAL_TEXTURES; // Number of global textures
         texture_data_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-        texture_data_layout_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        texture_data_layout_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
         texture_data_layout_binding.pImmutableSamplers = 0;
 
         VkDescriptorBindingFlags binding_flags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
@@ -409,6 +450,12 @@ bool VulkanRendererBackend::Shutdown() {
     DestroyArray(s_Context.RenderCompleteSemaphores);
     DestroyArray(s_Context.WaitFences);
 
+    destroySecondaryCommandPools();
+
+    VulkanSavePipelineCache(&s_Context);
+    VulkanLogPipelineCacheStats(&s_Context, "Session");
+    VulkanDestroyPipelineCache(&s_Context);
+
     // Destroy command buffers
     // Destroyed when the resource manager is destroyed
     // destroyCommandBuffers();
@@ -447,6 +494,16 @@ i32 VulkanRendererBackend::PrepareFrame() {
         return -1;
     }
 
+    // The fence covers the last submission of this frame slot, so its secondary command buffers are done executing
+    s_Context.SecondaryFrameIndex = s_Context.Swapchain.CurrentFrame;
+    for (u32 i = 0; i < s_Context.SecondaryThreadCount; i++) {
+        VulkanSecondaryCommandPool* pool = &s_Context.SecondaryCommandPools[s_Context.SecondaryFrameIndex * s_Context.SecondaryThreadCount + i];
+        if (pool->UsedCount > 0) {
+            KRAFT_VK_CHECK(vkResetCommandPool(s_Context.LogicalDevice.Handle, pool->Resource, 0));
+            pool->UsedCount = 0;
+        }
+    }
+
     // Record commands
     // s_Context.ActiveCommandBuffer = s_Context.GraphicsCommandBuffers[s_Context.CurrentSwapchainImageIndex];
 
@@ -616,15 +673,19 @@ bool VulkanRendererBackend::EndFrame() {
 
     VulkanEndCommandBuffer(gpu_cmd_buffer);
 
-    VkPipelineStageFlags wait_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    // All the uploads issued this frame go out in one submission that the rendering work waits on
+    VkSemaphore upload_semaphore = VulkanResourceManagerApi::SubmitUploads();
+
+    VkSemaphore wait_semaphores[2] = {s_Context.ImageAvailableSemaphores[s_Context.Swapchain.CurrentFrame], upload_semaphore};
+    VkPipelineStageFlags wait_stage_masks[2] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT};
     VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
     submit_info.commandBufferCount = VulkanRendererBackendState.BuffersToSubmitNum;
     submit_info.pCommandBuffers = &VulkanRendererBackendState.BuffersToSubmit[0];
-    submit_info.waitSemaphoreCount = 1;
-    submit_info.pWaitSemaphores = &s_Context.ImageAvailableSemaphores[s_Context.Swapchain.CurrentFrame];
+    submit_info.waitSemaphoreCount = upload_semaphore ? 2 : 1;
+    submit_info.pWaitSemaphores = wait_semaphores;
     submit_info.signalSemaphoreCount = 1;
     submit_info.pSignalSemaphores = &s_Context.RenderCompleteSemaphores[s_Context.CurrentSwapchainImageIndex];
-    submit_info.pWaitDstStageMask = &wait_stage_mask;
+    submit_info.pWaitDstStageMask = wait_stage_masks;
 
     KRAFT_VK_CHECK(vkQueueSubmit(s_Context.LogicalDevice.GraphicsQueue, 1, &submit_info, s_Context.InFlightImageToFenceMap[s_Context.Swapchain.CurrentFrame]->Handle));
 
@@ -650,6 +711,7 @@ bool VulkanRendererBackend::EndFrame() {
     }
 
     VulkanRendererBackendState.BuffersToSubmitNum = 0;
+    VulkanUpdatePipelineCache(&s_Context);
 
     return true;
 }
@@ -678,7 +740,258 @@ void VulkanRendererBackend::OnResize(int width, int height) {
 #endif
 }
 
-void VulkanRendererBackend::CreateRenderPipeline(Shader* shader) {
+static VkPipeline createComputePipeline(ArenaAllocator* arena, const shaderfx::ShaderEffect& effect, const shaderfx::VariantDefinition& variant, VkPipelineLayout pipeline_layout) {
+    const shaderfx::VariantDefinition::ShaderDefinition& shader_def = variant.shader_stages[0];
+
+    VkShaderModuleCreateInfo module_info = {VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+    module_info.codeSize = shader_def.code_fragment.code.count;
+    module_info.pCode = (u32*)shader_def.code_fragment.code.ptr;
+
+    VkShaderModule shader_module;
+    KRAFT_VK_CHECK(vkCreateShaderModule(s_Context.LogicalDevice.Handle, &module_info, s_Context.AllocationCallbacks, &shader_module));
+    KASSERT(shader_module);
+
+    VkComputePipelineCreateInfo pipeline_create_info = {VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+    pipeline_create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_create_info.stage.module = shader_module;
+    pipeline_create_info.stage.pName = "main";
+    pipeline_create_info.layout = pipeline_layout;
+    pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
+    pipeline_create_info.basePipelineIndex = -1;
+
+    VkPipelineCreationFeedback creation_feedback = {};
+    VkPipelineCreationFeedbackCreateInfo creation_feedback_info = {VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO};
+    creation_feedback_info.pPipelineCreationFeedback = &creation_feedback;
+    pipeline_create_info.pNext = &creation_feedback_info;
+
+    VkPipeline pipeline;
+    f64 creation_start = Platform::GetAbsoluteTime();
+    KRAFT_VK_CHECK(vkCreateComputePipelines(s_Context.LogicalDevice.Handle, s_Context.PipelineCache.Handle, 1, &pipeline_create_info, s_Context.AllocationCallbacks, &pipeline));
+    KASSERT(pipeline);
+    VulkanRecordPipelineCreation(&s_Context, &creation_feedback, Platform::GetAbsoluteTime() - creation_start);
+
+    String8 debug_pipeline_name = StringCat(arena, effect.name, String8Raw("_"));
+    debug_pipeline_name = StringCat(arena, debug_pipeline_name, variant.name);
+    debug_pipeline_name = StringCat(arena, debug_pipeline_name, String8Raw("ComputePipeline"));
+    KRAFT_RENDERER_SET_OBJECT_NAME(pipeline, VK_OBJECT_TYPE_PIPELINE, debug_pipeline_name.str);
+
+    vkDestroyShaderModule(s_Context.LogicalDevice.Handle, shader_module, s_Context.AllocationCallbacks);
+
+    return pipeline;
+}
+
+static VkPipeline createGraphicsPipeline(ArenaAllocator* arena, const shaderfx::ShaderEffect& effect, const shaderfx::VariantDefinition& variant, VkPipelineLayout pipeline_layout) {
+    VkGraphicsPipelineCreateInfo pipeline_create_info = {VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
+
+    // Shader stages
+    u32 shader_stage_count = variant.shader_stage_count;
+    VkPipelineShaderStageCreateInfo* pipeline_shader_stage_create_infos = ArenaPushArray(arena, VkPipelineShaderStageCreateInfo, shader_stage_count);
+    VkShaderModule* shader_modules = ArenaPushArray(arena, VkShaderModule, shader_stage_count);
+
+    for (int j = 0; j < shader_stage_count; j++) {
+        const shaderfx::VariantDefinition::ShaderDefinition& shader_def = variant.shader_stages[j];
+
+        VkShaderModuleCreateInfo info = {VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+        info.codeSize = shader_def.code_fragment.code.count;
+        info.pCode = (u32*)shader_def.code_fragment.code.ptr;
+
+        VkShaderModule shader_module;
+        KRAFT_VK_CHECK(vkCreateShaderModule(s_Context.LogicalDevice.Handle, &info, s_Context.AllocationCallbacks, &shader_module));
+        KASSERT(shader_module);
+
+        VkPipelineShaderStageCreateInfo shader_stage_info = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO};
+        shader_stage_info.module = shader_module;
+        shader_stage_info.pName = "main";
+        shader_stage_info.stage = ToVulkanShaderStageFlagBits(shader_def.stage);
+
+        pipeline_shader_stage_create_infos[j] = shader_stage_info;
+        shader_modules[j] = shader_module;
+    }
+
+    // Input bindings and attributes
+    // u64                              input_binding_count = variant.vertex_layout->input_binding_count;
+    // VkVertexInputBindingDescription* input_binding_descs = ArenaPushArray(arena, VkVertexInputBindingDescription, input_binding_count);
+    // for (int j = 0; j < input_binding_count; j++)
+    // {
+    //     const shaderfx::VertexInputBinding& input_binding_def = variant.vertex_layout->input_bindings[j];
+    //     input_binding_descs[j].binding = input_binding_def.binding;
+    //     input_binding_descs[j].inputRate = input_binding_def.input_rate == VertexInputRate::PerVertex ? VK_VERTEX_INPUT_RATE_VERTEX : VK_VERTEX_INPUT_RATE_INSTANCE;
+    //     input_binding_descs[j].stride = input_binding_def.stride;
+    // }
+
+    // u64                                attribute_count = variant.vertex_layout->attribute_count;
+    // VkVertexInputAttributeDescription* attribute_descs = ArenaPushArray(arena, VkVertexInputAttributeDescription, attribute_count);
+    // for (int j = 0; j < attribute_count; j++)
+    // {
+    //     const shaderfx::VertexAttribute& vertex_attribute_def = variant.vertex_layout->attributes[j];
+    //     attribute_descs[j].location = vertex_attribute_def.location;
+    //     attribute_descs[j].format = ToVulkanFormat(vertex_attribute_def.format);
+    //     attribute_descs[j].binding = vertex_attribute_def.binding;
+    //     attribute_descs[j].offset = vertex_attribute_def.offset;
+    // }
+
+    VkPipelineViewportStateCreateInfo viewport_state_create_info = {};
+    viewport_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewport_state_create_info.viewportCount = 1;
+    viewport_state_create_info.scissorCount = 1;
+    pipeline_create_info.pViewportState = &viewport_state_create_info;
+
+    VkPipelineRasterizationStateCreateInfo raster_state_create_info = {};
+    raster_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    raster_state_create_info.depthClampEnable = VK_FALSE;
+    raster_state_create_info.rasterizerDiscardEnable = VK_FALSE;
+    raster_state_create_info.polygonMode = ToVulkanPolygonMode(variant.render_state->polygon_mode);
+    raster_state_create_info.lineWidth = s_Context.PhysicalDevice.Features.wideLines ? variant.render_state->line_width : 1.0f;
+    raster_state_create_info.cullMode = ToVulkanCullModeFlagBits(variant.render_state->cull_mode);
+    raster_state_create_info.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    raster_state_create_info.depthBiasEnable = VK_FALSE;
+    raster_state_create_info.depthBiasConstantFactor = 0.0f;
+    raster_state_create_info.depthBiasClamp = 0.0f;
+    raster_state_create_info.depthBiasSlopeFactor = 0.0f;
+    pipeline_create_info.pRasterizationState = &raster_state_create_info;
+
+    VkPipelineMultisampleStateCreateInfo multisample_state_create_info = {};
+    multisample_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisample_state_create_info.sampleShadingEnable = VK_FALSE;
+    multisample_state_create_info.rasterizationSamples = s_Context.Swapchain.MSAASampleCount;
+    multisample_state_create_info.minSampleShading = 1.0f;
+    multisample_state_create_info.pSampleMask = 0;
+    multisample_state_create_info.alphaToCoverageEnable = VK_FALSE;
+    multisample_state_create_info.alphaToOneEnable = VK_FALSE;
+    pipeline_create_info.pMultisampleState = &multisample_state_create_info;
+
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_state_create_info = {};
+    depth_stencil_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depth_stencil_state_create_info.depthTestEnable = variant.render_state->z_test_op > CompareOp::Never ? VK_TRUE : VK_FALSE;
+    depth_stencil_state_create_info.depthWriteEnable = variant.render_state->z_write_enable;
+    depth_stencil_state_create_info.depthCompareOp = ToVulkanCompareOp(variant.render_state->z_test_op);
+    depth_stencil_state_create_info.depthBoundsTestEnable = VK_FALSE;
+    depth_stencil_state_create_info.stencilTestEnable = VK_FALSE;
+    pipeline_create_info.pDepthStencilState = &depth_stencil_state_create_info;
+
+    VkPipelineColorBlendAttachmentState color_blend_attachment_state = {};
+    VkPipelineColorBlendStateCreateInfo color_blend_state_create_info = {};
+    color_blend_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    color_blend_state_create_info.logicOpEnable = VK_FALSE;
+    color_blend_state_create_info.logicOp = VK_LOGIC_OP_COPY;
+
+    if (variant.has_color_output) {
+        color_blend_attachment_state.blendEnable = variant.render_state->blend_enable;
+        if (variant.render_state->blend_enable) {
+            color_blend_attachment_state.srcColorBlendFactor = ToVulkanBlendFactor(variant.render_state->blend_mode.src_color_blend_factor);
+            color_blend_attachment_state.dstColorBlendFactor = ToVulkanBlendFactor(variant.render_state->blend_mode.dst_color_blend_factor);
+            color_blend_attachment_state.colorBlendOp = ToVulkanBlendOp(variant.render_state->blend_mode.color_blend_op);
+            color_blend_attachment_state.srcAlphaBlendFactor = ToVulkanBlendFactor(variant.render_state->blend_mode.src_alpha_blend_factor);
+            color_blend_attachment_state.dstAlphaBlendFactor = ToVulkanBlendFactor(variant.render_state->blend_mode.dst_alpha_blend_factor);
+            color_blend_attachment_state.alphaBlendOp = ToVulkanBlendOp(variant.render_state->blend_mode.alpha_blend_op);
+        }
+        color_blend_attachment_state.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        color_blend_state_create_info.attachmentCount = 1;
+        color_blend_state_create_info.pAttachments = &color_blend_attachment_state;
+    } else {
+        color_blend_state_create_info.attachmentCount = 0;
+        color_blend_state_create_info.pAttachments = nullptr;
+    }
+
+    pipeline_create_info.pColorBlendState = &color_blend_state_create_info;
+
+    VkDynamicState dynamic_states[] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
+        VK_DYNAMIC_STATE_LINE_WIDTH,
+    };
+
+    VkPipelineDynamicStateCreateInfo dynamic_state_create_info = {};
+    dynamic_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamic_state_create_info.pDynamicStates = dynamic_states;
+    dynamic_state_create_info.dynamicStateCount = sizeof(dynamic_states) / sizeof(dynamic_states[0]);
+    pipeline_create_info.pDynamicState = &dynamic_state_create_info;
+
+    // Vertices are now fetched from a storage buffer
+    VkPipelineVertexInputStateCreateInfo vertex_input_state_create_info = {VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+    pipeline_create_info.pVertexInputState = &vertex_input_state_create_info;
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly_state_create_info = {VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
+    input_assembly_state_create_info.primitiveRestartEnable = VK_FALSE;
+    input_assembly_state_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    pipeline_create_info.pInputAssemblyState = &input_assembly_state_create_info;
+
+    pipeline_create_info.layout = pipeline_layout;
+    pipeline_create_info.stageCount = (u32)shader_stage_count;
+    pipeline_create_info.pStages = &pipeline_shader_stage_create_infos[0];
+    pipeline_create_info.pTessellationState = 0;
+
+#if KRAFT_ENABLE_VK_DYNAMIC_RENDERING
+    const VkFormat color_format = VK_FORMAT_R8G8B8A8_UNORM;
+
+    VkPipelineRenderingCreateInfo rendering_create_info = {VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO};
+    rendering_create_info.colorAttachmentCount = variant.has_color_output ? 1 : 0;
+    rendering_create_info.pColorAttachmentFormats = variant.has_color_output ? &color_format : nullptr;
+    rendering_create_info.depthAttachmentFormat = variant.has_depth_output ? VK_FORMAT_D32_SFLOAT : VK_FORMAT_UNDEFINED;
+    pipeline_create_info.pNext = &rendering_create_info;
+    pipeline_create_info.renderPass = NULL;
+#else
+    pipeline_create_info.renderPass = s_Context.MainRenderPass.Handle;
+#endif
+
+    pipeline_create_info.subpass = 0;
+    pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
+    pipeline_create_info.basePipelineIndex = -1;
+
+    // Tells us whether the driver found the pipeline in the pipeline cache
+    VkPipelineCreationFeedback creation_feedback = {};
+    VkPipelineCreationFeedbackCreateInfo creation_feedback_info = {VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO};
+    creation_feedback_info.pNext = pipeline_create_info.pNext;
+    creation_feedback_info.pPipelineCreationFeedback = &creation_feedback;
+    pipeline_create_info.pNext = &creation_feedback_info;
+
+    VkPipeline pipeline;
+    f64 creation_start = Platform::GetAbsoluteTime();
+    KRAFT_VK_CHECK(vkCreateGraphicsPipelines(s_Context.LogicalDevice.Handle, s_Context.PipelineCache.Handle, 1, &pipeline_create_info, s_Context.AllocationCallbacks, &pipeline));
+    KASSERT(pipeline);
+    VulkanRecordPipelineCreation(&s_Context, &creation_feedback, Platform::GetAbsoluteTime() - creation_start);
+
+    String8 debug_pipeline_name = StringCat(arena, effect.name, String8Raw("_"));
+    debug_pipeline_name = StringCat(arena, debug_pipeline_name, variant.name);
+    debug_pipeline_name = StringCat(arena, debug_pipeline_name, String8Raw("Pipeline"));
+    KRAFT_RENDERER_SET_OBJECT_NAME(pipeline, VK_OBJECT_TYPE_PIPELINE, debug_pipeline_name.str);
+
+    // Release shader modules for this variant
+    for (int j = 0; j < shader_stage_count; j++) {
+        vkDestroyShaderModule(s_Context.LogicalDevice.Handle, shader_modules[j], s_Context.AllocationCallbacks);
+    }
+
+    return pipeline;
+}
+
+// Creates the pipelines of the variants in [start, end), on any thread
+static void createPipelinesJob(void* user_data, u32 start, u32 end) {
+    Shader* shader = (Shader*)user_data;
+    const shaderfx::ShaderEffect& effect = shader->ShaderEffect;
+    VulkanShader* shader_data = (VulkanShader*)shader->RendererData;
+
+    TempArena scratch = ScratchBegin(0, 0);
+    for (u32 v = start; v < end; v++) {
+        const shaderfx::VariantDefinition& variant = effect.variants[v];
+        if (shaderfx::IsComputeVariant(variant)) {
+            shader_data->Pipelines[v] = createComputePipeline(scratch.arena, effect, variant, shader_data->PipelineLayout);
+        } else {
+            shader_data->Pipelines[v] = createGraphicsPipeline(scratch.arena, effect, variant, shader_data->PipelineLayout);
+        }
+    }
+
+    s_Context.PipelineCache.PendingCount.fetch_sub(end - start, std::memory_order_relaxed);
+    ScratchEnd(scratch);
+}
+
+// Spreads the variants of a shader across the job threads
+static void createShaderPipelinesJob(void* user_data) {
+    Shader* shader = (Shader*)user_data;
+    JobSystem::ParallelFor(shader->ShaderEffect.variant_count, 1, createPipelinesJob, shader);
+}
+
+void VulkanRendererBackend::CreateRenderPipeline(Shader* shader, JobCounter* counter) {
     TempArena scratch = ScratchBegin(0, 0);
     const shaderfx::ShaderEffect& effect = shader->ShaderEffect;
 
@@ -777,184 +1090,19 @@ void VulkanRendererBackend::CreateRenderPipeline(Shader* shader) {
     internal_shader_data->PipelineCount = effect.variant_count;
     internal_shader_data->Pipelines = (VkPipeline*)Malloc(sizeof(VkPipeline) * effect.variant_count, MEMORY_TAG_RENDERER, true);
 
-    // Create a pipeline for every shader variant specified
-    for (u32 v = 0; v < effect.variant_count; v++) {
-        const shaderfx::VariantDefinition& variant = effect.variants[v];
-        VkGraphicsPipelineCreateInfo pipeline_create_info = {VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
-
-        // Shader stages
-        u32 shader_stage_count = variant.shader_stage_count;
-        VkPipelineShaderStageCreateInfo* pipeline_shader_stage_create_infos = ArenaPushArray(scratch.arena, VkPipelineShaderStageCreateInfo, shader_stage_count);
-        VkShaderModule* shader_modules = ArenaPushArray(scratch.arena, VkShaderModule, shader_stage_count);
-
-        for (int j = 0; j < shader_stage_count; j++) {
-            const shaderfx::VariantDefinition::ShaderDefinition& shader_def = variant.shader_stages[j];
-
-            VkShaderModuleCreateInfo info = {VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
-            info.codeSize = shader_def.code_fragment.code.count;
-            info.pCode = (u32*)shader_def.code_fragment.code.ptr;
-
-            VkShaderModule shader_module;
-            KRAFT_VK_CHECK(vkCreateShaderModule(s_Context.LogicalDevice.Handle, &info, s_Context.AllocationCallbacks, &shader_module));
-            KASSERT(shader_module);
-
-            VkPipelineShaderStageCreateInfo shader_stage_info = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO};
-            shader_stage_info.module = shader_module;
-            shader_stage_info.pName = "main";
-            shader_stage_info.stage = ToVulkanShaderStageFlagBits(shader_def.stage);
-
-            pipeline_shader_stage_create_infos[j] = shader_stage_info;
-            shader_modules[j] = shader_module;
-        }
-
-        // Input bindings and attributes
-        // u64                              input_binding_count = variant.vertex_layout->input_binding_count;
-        // VkVertexInputBindingDescription* input_binding_descs = ArenaPushArray(scratch.arena, VkVertexInputBindingDescription, input_binding_count);
-        // for (int j = 0; j < input_binding_count; j++)
-        // {
-        //     const shaderfx::VertexInputBinding& input_binding_def = variant.vertex_layout->input_bindings[j];
-        //     input_binding_descs[j].binding = input_binding_def.binding;
-        //     input_binding_descs[j].inputRate = input_binding_def.input_rate == VertexInputRate::PerVertex ? VK_VERTEX_INPUT_RATE_VERTEX : VK_VERTEX_INPUT_RATE_INSTANCE;
-        //     input_binding_descs[j].stride = input_binding_def.stride;
-        // }
-
-        // u64                                attribute_count = variant.vertex_layout->attribute_count;
-        // VkVertexInputAttributeDescription* attribute_descs = ArenaPushArray(scratch.arena, VkVertexInputAttributeDescription, attribute_count);
-        // for (int j = 0; j < attribute_count; j++)
-        // {
-        //     const shaderfx::VertexAttribute& vertex_attribute_def = variant.vertex_layout->attributes[j];
-        //     attribute_descs[j].location = vertex_attribute_def.location;
-        //     attribute_descs[j].format = ToVulkanFormat(vertex_attribute_def.format);
-        //     attribute_descs[j].binding = vertex_attribute_def.binding;
-        //     attribute_descs[j].offset = vertex_attribute_def.offset;
-        // }
-
-        VkPipelineViewportStateCreateInfo viewport_state_create_info = {};
-        viewport_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-        viewport_state_create_info.viewportCount = 1;
-        viewport_state_create_info.scissorCount = 1;
-        pipeline_create_info.pViewportState = &viewport_state_create_info;
-
-        VkPipelineRasterizationStateCreateInfo raster_state_create_info = {};
-        raster_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-        raster_state_create_info.depthClampEnable = VK_FALSE;
-        raster_state_create_info.rasterizerDiscardEnable = VK_FALSE;
-        raster_state_create_info.polygonMode = ToVulkanPolygonMode(variant.render_state->polygon_mode);
-        raster_state_create_info.lineWidth = s_Context.PhysicalDevice.Features.wideLines ? variant.render_state->line_width : 1.0f;
-        raster_state_create_info.cullMode = ToVulkanCullModeFlagBits(variant.render_state->cull_mode);
-        raster_state_create_info.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-        raster_state_create_info.depthBiasEnable = VK_FALSE;
-        raster_state_create_info.depthBiasConstantFactor = 0.0f;
-        raster_state_create_info.depthBiasClamp = 0.0f;
-        raster_state_create_info.depthBiasSlopeFactor = 0.0f;
-        pipeline_create_info.pRasterizationState = &raster_state_create_info;
-
-        VkPipelineMultisampleStateCreateInfo multisample_state_create_info = {};
-        multisample_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        multisample_state_create_info.sampleShadingEnable = VK_FALSE;
-        multisample_state_create_info.rasterizationSamples = s_Context.Swapchain.MSAASampleCount;
-        multisample_state_create_info.minSampleShading = 1.0f;
-        multisample_state_create_info.pSampleMask = 0;
-        multisample_state_create_info.alphaToCoverageEnable = VK_FALSE;
-        multisample_state_create_info.alphaToOneEnable = VK_FALSE;
-        pipeline_create_info.pMultisampleState = &multisample_state_create_info;
-
-        VkPipelineDepthStencilStateCreateInfo depth_stencil_state_create_info = {};
-        depth_stencil_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-        depth_stencil_state_create_info.depthTestEnable = variant.render_state->z_test_op > CompareOp::Never ? VK_TRUE : VK_FALSE;
-        depth_stencil_state_create_info.depthWriteEnable = variant.render_state->z_write_enable;
-        depth_stencil_state_create_info.depthCompareOp = ToVulkanCompareOp(variant.render_state->z_test_op);
-        depth_stencil_state_create_info.depthBoundsTestEnable = VK_FALSE;
-        depth_stencil_state_create_info.stencilTestEnable = VK_FALSE;
-        pipeline_create_info.pDepthStencilState = &depth_stencil_state_create_info;
-
-        VkPipelineColorBlendAttachmentState color_blend_attachment_state = {};
-        VkPipelineColorBlendStateCreateInfo color_blend_state_create_info = {};
-        color_blend_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-        color_blend_state_create_info.logicOpEnable = VK_FALSE;
-        color_blend_state_create_info.logicOp = VK_LOGIC_OP_COPY;
-
-        if (variant.has_color_output) {
-            color_blend_attachment_state.blendEnable = variant.render_state->blend_enable;
-            if (variant.render_state->blend_enable) {
-                color_blend_attachment_state.srcColorBlendFactor = ToVulkanBlendFactor(variant.render_state->blend_mode.src_color_blend_factor);
-                color_blend_attachment_state.dstColorBlendFactor = ToVulkanBlendFactor(variant.render_state->blend_mode.dst_color_blend_factor);
-                color_blend_attachment_state.colorBlendOp = ToVulkanBlendOp(variant.render_state->blend_mode.color_blend_op);
-                color_blend_attachment_state.srcAlphaBlendFactor = ToVulkanBlendFactor(variant.render_state->blend_mode.src_alpha_blend_factor);
-                color_blend_attachment_state.dstAlphaBlendFactor = ToVulkanBlendFactor(variant.render_state->blend_mode.dst_alpha_blend_factor);
-                color_blend_attachment_state.alphaBlendOp = ToVulkanBlendOp(variant.render_state->blend_mode.alpha_blend_op);
-            }
-            color_blend_attachment_state.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-            color_blend_state_create_info.attachmentCount = 1;
-            color_blend_state_create_info.pAttachments = &color_blend_attachment_state;
-        } else {
-            color_blend_state_create_info.attachmentCount = 0;
-            color_blend_state_create_info.pAttachments = nullptr;
-        }
-
-        pipeline_create_info.pColorBlendState = &color_blend_state_create_info;
-
-        VkDynamicState dynamic_states[] = {
-            VK_DYNAMIC_STATE_VIEWPORT,
-            VK_DYNAMIC_STATE_SCISSOR,
-            VK_DYNAMIC_STATE_LINE_WIDTH,
-        };
-
-        VkPipelineDynamicStateCreateInfo dynamic_state_create_info = {};
-        dynamic_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-        dynamic_state_create_info.pDynamicStates = dynamic_states;
-        dynamic_state_create_info.dynamicStateCount = sizeof(dynamic_states) / sizeof(dynamic_states[0]);
-        pipeline_create_info.pDynamicState = &dynamic_state_create_info;
-
-        // Vertices are now fetched from a storage buffer
-        VkPipelineVertexInputStateCreateInfo vertex_input_state_create_info = {VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
-        pipeline_create_info.pVertexInputState = &vertex_input_state_create_info;
-
-        VkPipelineInputAssemblyStateCreateInfo input_assembly_state_create_info = {VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
-        input_assembly_state_create_info.primitiveRestartEnable = VK_FALSE;
-        input_assembly_state_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-        pipeline_create_info.pInputAssemblyState = &input_assembly_state_create_info;
-
-        pipeline_create_info.layout = pipeline_layout;
-        pipeline_create_info.stageCount = (u32)shader_stage_count;
-        pipeline_create_info.pStages = &pipeline_shader_stage_create_infos[0];
-        pipeline_create_info.pTessellationState = 0;
-
-#if KRAFT_ENABLE_VK_DYNAMIC_RENDERING
-        const VkFormat color_format = VK_FORMAT_R8G8B8A8_UNORM;
-
-        VkPipelineRenderingCreateInfo rendering_create_info = {VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO};
-        rendering_create_info.colorAttachmentCount = variant.has_color_output ? 1 : 0;
-        rendering_create_info.pColorAttachmentFormats = variant.has_color_output ? &color_format : nullptr;
-        rendering_create_info.depthAttachmentFormat = variant.has_depth_output ? VK_FORMAT_D32_SFLOAT : VK_FORMAT_UNDEFINED;
-        pipeline_create_info.pNext = &rendering_create_info;
-        pipeline_create_info.renderPass = NULL;
-#else
-        pipeline_create_info.renderPass = s_Context.MainRenderPass.Handle;
-#endif
-
-        pipeline_create_info.subpass = 0;
-        pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
-        pipeline_create_info.basePipelineIndex = -1;
-
-        VkPipeline pipeline;
-        KRAFT_VK_CHECK(vkCreateGraphicsPipelines(s_Context.LogicalDevice.Handle, VK_NULL_HANDLE, 1, &pipeline_create_info, s_Context.AllocationCallbacks, &pipeline));
-        KASSERT(pipeline);
-
-        String8 debug_pipeline_name = StringCat(scratch.arena, shader_effect_name, String8Raw("_"));
-        debug_pipeline_name = StringCat(scratch.arena, debug_pipeline_name, variant.name);
-        debug_pipeline_name = StringCat(scratch.arena, debug_pipeline_name, String8Raw("Pipeline"));
-        KRAFT_RENDERER_SET_OBJECT_NAME(pipeline, VK_OBJECT_TYPE_PIPELINE, debug_pipeline_name.str);
-
-        internal_shader_data->Pipelines[v] = pipeline;
-
-        // Release shader modules for this variant
-        for (int j = 0; j < shader_stage_count; j++) {
-            vkDestroyShaderModule(s_Context.LogicalDevice.Handle, shader_modules[j], s_Context.AllocationCallbacks);
-        }
-    }
-
+    // Create a pipeline for every shader variant specified. Only the pipelines are created on the job threads, the
+    // descriptor pool and the layouts above aren't safe to touch from more than one thread.
     shader->RendererData = internal_shader_data;
+    s_Context.PipelineCache.PendingCount.fetch_add(effect.variant_count, std::memory_order_relaxed);
+    if (counter) {
+        JobSystem::Submit({
+            .Function = createShaderPipelinesJob,
+            .UserData = shader,
+            .Counter = counter,
+        });
+    } else {
+        JobSystem::ParallelFor(effect.variant_count, 1, createPipelinesJob, shader);
+    }
 
     ScratchEnd(scratch);
 }
@@ -977,17 +1125,37 @@ void VulkanRendererBackend::DestroyRenderPipeline(Shader* Shader) {
 }
 
 void VulkanRendererBackend::UseShader(const Shader* Shader, u32 variant_index) {
+    KASSERTM(Shader->Ready, "UseShader called before the shader's pipelines were created");
     VulkanShader* VulkanShaderData = (VulkanShader*)Shader->RendererData;
     KASSERT(variant_index < VulkanShaderData->PipelineCount);
     VkPipeline Pipeline = VulkanShaderData->Pipelines[variant_index];
-    VulkanCommandBuffer* GPUCmdBuffer = VulkanResourceManagerApi::GetCommandBuffer(s_Context.ActiveCommandBuffer);
+    VulkanCommandBuffer* GPUCmdBuffer = activeCommandBuffer();
+
+    bool compute = shaderfx::IsComputeVariant(Shader->ShaderEffect.variants[variant_index]);
+    s_Recording.ActiveBindPoint = compute ? VK_PIPELINE_BIND_POINT_COMPUTE : VK_PIPELINE_BIND_POINT_GRAPHICS;
+    vkCmdBindPipeline(GPUCmdBuffer->Resource, s_Recording.ActiveBindPoint, Pipeline);
+
+    // Command buffers are reused across frames, so the cached index buffer binding can't outlive a pipeline bind
+    s_Recording.BoundIndexCommandBuffer = VK_NULL_HANDLE;
+}
+
+// Collects all active samplers into an array for binding
+static u32 getSamplerImageInfos(VkDescriptorImageInfo* out_infos) {
+    VkSampler active_samplers[KRAFT_VULKAN_MAX_SAMPLERS_ALLOWED];
+    u32 sampler_count = VulkanResourceManagerApi::GetActiveSamplers(active_samplers, KRAFT_VULKAN_MAX_SAMPLERS_ALLOWED);
+
+    for (u32 i = 0; i < sampler_count; i++) {
+        out_infos[i].sampler = active_samplers[i];
+        out_infos[i].imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        out_infos[i].imageView = VK_NULL_HANDLE;
+    }
 
-    vkCmdBindPipeline(GPUCmdBuffer->Resource, VK_PIPELINE_BIND_POINT_GRAPHICS, Pipeline);
+    return sampler_count;
 }
 
-void VulkanRendererBackend::ApplyGlobalShaderProperties(Shader* shader, Handle<Buffer> ubo_buffer, Handle<Buffer> materials_buffer, Handle<Buffer> vertex_buffer, Handle<Buffer> index_buffer) {
-    s_Context.IndexBuffer = index_buffer;
-    VulkanCommandBuffer* cmd_buffer = VulkanResourceManagerApi::GetCommandBuffer(s_Context.ActiveCommandBuffer);
+void VulkanRendererBackend::ApplyGlobalShaderProperties(Shader* shader, Handle<Buffer> ubo_buffer, Handle<Buffer> materials_buffer, Handle<Buffer> vertex_buffer, Handle<Buffer> index_buffer, Handle<Buffer> instance_buffer) {
+    s_Recording.IndexBuffer = index_buffer ? VulkanResourceManagerApi::GetBuffer(index_buffer)->Handle : VK_NULL_HANDLE;
+    VulkanCommandBuffer* cmd_buffer = activeCommandBuffer();
     VulkanShader* shader_data = (VulkanShader*)shader->RendererData;
 
     VkBuffer gpu_buffer = VulkanResourceManagerApi::GetBuffer(ubo_buffer)->Handle;
@@ -997,33 +1165,27 @@ void VulkanRendererBackend::ApplyGlobalShaderProperties(Shader* shader, Handle<B
     global_data_buffer_info.range = VK_WHOLE_SIZE;
 
     u32 count = 0;
-    VkWriteDescriptorSet descriptor_write_info[4] = {};
-    descriptor_write_info[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptor_write_info[0].descriptorCount = 1;
-    descriptor_write_info[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    descriptor_write_info[0].dstBinding = 0;
-    descriptor_write_info[0].dstArrayElement = 0;
-    descriptor_write_info[0].pBufferInfo = &global_data_buffer_info;
-    count++;
-
-    // Collect all active samplers into an array for binding
-    VkSampler active_samplers[KRAFT_VULKAN_MAX_SAMPLERS_ALLOWED];
-    u32 sampler_count = VulkanResourceManagerApi::GetActiveSamplers(active_samplers, KRAFT_VULKAN_MAX_SAMPLERS_ALLOWED);
+    VkWriteDescriptorSet descriptor_write_info[5] = {};
+    descriptor_write_info[count++] = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstBinding = 0,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        .pBufferInfo = &global_data_buffer_info,
+    };
 
     VkDescriptorImageInfo sampler_image_infos[KRAFT_VULKAN_MAX_SAMPLERS_ALLOWED];
-    for (u32 i = 0; i < sampler_count; i++) {
-        sampler_image_infos[i].sampler = active_samplers[i];
-        sampler_image_infos[i].imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        sampler_image_infos[i].imageView = VK_NULL_HANDLE;
-    }
-
-    descriptor_write_info[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptor_write_info[1].descriptorCount = sampler_count;
-    descriptor_write_info[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
-    descriptor_write_info[1].dstBinding = 1;
-    descriptor_write_info[1].dstArrayElement = 0;
-    descriptor_write_info[1].pImageInfo = sampler_image_infos;
-    count++;
+    u32 sampler_count = getSamplerImageInfos(sampler_image_infos);
+
+    descriptor_write_info[count++] = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstBinding = 1,
+        .dstArrayElement = 0,
+        .descriptorCount = sampler_count,
+        .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER,
+        .pImageInfo = sampler_image_infos,
+    };
 
     VulkanBuffer* materials_gpu_buffer = VulkanResourceManagerApi::GetBuffer(materials_buffer);
     VkDescriptorBufferInfo materials_buffer_info = {};
@@ -1031,13 +1193,14 @@ void VulkanRendererBackend::ApplyGlobalShaderProperties(Shader* shader, Handle<B
         materials_buffer_info.buffer = materials_gpu_buffer->Handle;
         materials_buffer_info.range = VK_WHOLE_SIZE;
 
-        descriptor_write_info[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptor_write_info[2].descriptorCount = 1;
-        descriptor_write_info[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        descriptor_write_info[2].dstBinding = 2;
-        descriptor_write_info[2].dstArrayElement = 0;
-        descriptor_write_info[2].pBufferInfo = &materials_buffer_info;
-        count++;
+        descriptor_write_info[count++] = {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstBinding = 2,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .pBufferInfo = &materials_buffer_info,
+        };
     }
 
     VulkanBuffer* vertex_gpu_buffer = VulkanResourceManagerApi::GetBuffer(vertex_buffer);
@@ -1046,21 +1209,38 @@ void VulkanRendererBackend::ApplyGlobalShaderProperties(Shader* shader, Handle<B
         vertex_buffer_info.buffer = vertex_gpu_buffer->Handle;
         vertex_buffer_info.range = VK_WHOLE_SIZE;
 
-        descriptor_write_info[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptor_write_info[3].descriptorCount = 1;
-        descriptor_write_info[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        descriptor_write_info[3].dstBinding = 3;
-        descriptor_write_info[3].dstArrayElement = 0;
-        descriptor_write_info[3].pBufferInfo = &vertex_buffer_info;
-        count++;
+        descriptor_write_info[count++] = {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstBinding = 3,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .pBufferInfo = &vertex_buffer_info,
+        };
     }
 
-    vkCmdPushDescriptorSetKHR(cmd_buffer->Resource, VK_PIPELINE_BIND_POINT_GRAPHICS, shader_data->PipelineLayout, 0, count, &descriptor_write_info[0]);
-    vkCmdBindDescriptorSets(cmd_buffer->Resource, VK_PIPELINE_BIND_POINT_GRAPHICS, shader_data->PipelineLayout, 2, 1, &s_Context.GlobalTexturesDescriptorSet, 0, nullptr);
+    VulkanBuffer* instance_gpu_buffer = VulkanResourceManagerApi::GetBuffer(instance_buffer);
+    VkDescriptorBufferInfo instance_buffer_info = {};
+    if (instance_gpu_buffer) {
+        instance_buffer_info.buffer = instance_gpu_buffer->Handle;
+        instance_buffer_info.range = VK_WHOLE_SIZE;
+
+        descriptor_write_info[count++] = {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstBinding = 4,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .pBufferInfo = &instance_buffer_info,
+        };
+    }
+
+    vkCmdPushDescriptorSetKHR(cmd_buffer->Resource, s_Recording.ActiveBindPoint, shader_data->PipelineLayout, 0, count, &descriptor_write_info[0]);
+    vkCmdBindDescriptorSets(cmd_buffer->Resource, s_Recording.ActiveBindPoint, shader_data->PipelineLayout, 2, 1, &s_Context.GlobalTexturesDescriptorSet, 0, nullptr);
 }
 
 void VulkanRendererBackend::ApplyLocalShaderProperties(Shader* shader, void* data) {
-    VulkanCommandBuffer* cmd_buffer = VulkanResourceManagerApi::GetCommandBuffer(s_Context.ActiveCommandBuffer);
+    VulkanCommandBuffer* cmd_buffer = activeCommandBuffer();
     VulkanShader* shader_data = (VulkanShader*)shader->RendererData;
 
     vkCmdPushConstants(cmd_buffer->Resource, shader_data->PipelineLayout, VK_SHADER_STAGE_ALL, 0, 128, data);
@@ -1085,12 +1265,57 @@ void VulkanRendererBackend::UpdateTextures(Handle<Texture>* textures, u64 textur
     }
 }
 
+void VulkanRendererBackend::BindPlaceholderTextures(Handle<Texture>* textures, u64 texture_count, Handle<Texture> placeholder) {
+    VulkanTexture* placeholder_texture = VulkanResourceManagerApi::GetTexture(placeholder);
+    VkDescriptorImageInfo image_info = {};
+    image_info.imageView = placeholder_texture->View;
+    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    for (u32 i = 0; i < texture_count; i++) {
+        VkWriteDescriptorSet write_descriptor_set = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+        write_descriptor_set.dstSet = s_Context.GlobalTexturesDescriptorSet;
+        write_descriptor_set.dstBinding = 0;
+        write_descriptor_set.dstArrayElement = textures[i].GetIndex();
+        write_descriptor_set.descriptorCount = 1;
+        write_descriptor_set.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        write_descriptor_set.pImageInfo = &image_info;
+
+        vkUpdateDescriptorSets(s_Context.LogicalDevice.Handle, 1, &write_descriptor_set, 0, nullptr);
+    }
+}
+
 void VulkanRendererBackend::DrawGeometryData(GeometryDrawData draw_data) {
-    VulkanCommandBuffer* cmd_buffer = VulkanResourceManagerApi::GetCommandBuffer(s_Context.ActiveCommandBuffer);
-    VulkanBuffer* index_buffer = VulkanResourceManagerApi::GetBuffer(s_Context.IndexBuffer);
+    DrawGeometryDataInstanced(draw_data, 1, 0);
+}
+
+static void bindIndexBuffer(VulkanCommandBuffer* cmd_buffer, VkIndexType index_type) {
+    VkBuffer index_buffer = s_Recording.IndexBuffer;
+    if (s_Recording.BoundIndexCommandBuffer != cmd_buffer->Resource || s_Recording.BoundIndexBuffer != index_buffer || s_Recording.BoundIndexType != index_type) {
+        vkCmdBindIndexBuffer(cmd_buffer->Resource, index_buffer, 0, index_type);
+        s_Recording.BoundIndexCommandBuffer = cmd_buffer->Resource;
+        s_Recording.BoundIndexBuffer = index_buffer;
+        s_Recording.BoundIndexType = index_type;
+    }
+}
+
+void VulkanRendererBackend::DrawGeometryDataInstanced(GeometryDrawData draw_data, u32 instance_count, u32 first_instance) {
+    VulkanCommandBuffer* cmd_buffer = activeCommandBuffer();
+
+    VkIndexType index_type = draw_data.IndexType == IndexType::UInt16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    u32 index_size = index_type == VK_INDEX_TYPE_UINT16 ? sizeof(u16) : sizeof(u32);
+    bindIndexBuffer(cmd_buffer, index_type);
 
-    vkCmdBindIndexBuffer(cmd_buffer->Resource, index_buffer->Handle, draw_data.IndexBufferOffset, VK_INDEX_TYPE_UINT32);
-    vkCmdDrawIndexed(cmd_buffer->Resource, draw_data.IndexCount, 1, 0, draw_data.VertexOffset, 0);
+    // Index ranges are aligned to the index size, so the byte offset always maps to a whole first index
+    u32 first_index = draw_data.IndexBufferOffset / index_size;
+    vkCmdDrawIndexed(cmd_buffer->Resource, draw_data.IndexCount, instance_count, first_index, draw_data.VertexOffset, first_instance);
+}
+
+void VulkanRendererBackend::DrawGeometryIndirect(Handle<Buffer> indirect_buffer, u64 offset, u32 draw_count, IndexType::Enum index_type) {
+    VulkanCommandBuffer* cmd_buffer = activeCommandBuffer();
+    VulkanBuffer* gpu_buffer = VulkanResourceManagerApi::GetBuffer(indirect_buffer);
+
+    bindIndexBuffer(cmd_buffer, index_type == IndexType::UInt16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+    vkCmdDrawIndexedIndirect(cmd_buffer->Resource, gpu_buffer->Handle, offset, draw_count, sizeof(VkDrawIndexedIndirectCommand));
 }
 
 static bool UploadDataToGPU(VulkanContext* context, Handle<Buffer> dst_buffer, u32 dst_buffer_offset, const void* data, u32 size) {
@@ -1132,64 +1357,35 @@ bool VulkanRendererBackend::UpdateGeometry(const GeometryDescription& descriptio
     return true;
 }
 
-void VulkanRendererBackend::BeginSurface(RenderSurface* surface) {
-    Handle<CommandBuffer> cmd_buffer_handle = surface->CmdBuffers[s_Context.CurrentSwapchainImageIndex];
-    s_Context.ActiveCommandBuffer = cmd_buffer_handle;
-    VulkanCommandBuffer* gpu_cmd_buffer = VulkanResourceManagerApi::GetCommandBuffer(cmd_buffer_handle);
-    VulkanResetCommandBuffer(gpu_cmd_buffer);
-    VulkanBeginCommandBuffer(gpu_cmd_buffer, false, false, false);
+static void setSurfaceViewport(VulkanCommandBuffer* gpu_cmd_buffer, const RenderSurface* surface) {
+    VkViewport viewport = {};
+    viewport.width = (f32)surface->Width;
+    viewport.height = (f32)surface->Height;
+    viewport.maxDepth = 1.0f;
 
-    // Transition the attachments to the right format
-    // Before rendering, they must be in VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL
-    if (surface->DepthPassTexture) {
-        imageBarrier(
-            VulkanResourceManagerApi::GetTexture(surface->DepthPassTexture)->Image,
-            VK_DEPENDENCY_BY_REGION_BIT,
-            {
-                .src_stage_mask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                .dst_stage_mask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-                .src_access_mask = 0,
-                .dst_access_mask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-                .old_layout = VK_IMAGE_LAYOUT_UNDEFINED,
-                .new_layout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
-                .aspect_mask = VK_IMAGE_ASPECT_DEPTH_BIT,
-                .base_mip_level = 0,
-                .level_count = VK_REMAINING_MIP_LEVELS,
-            }
-        );
-    }
+    vkCmdSetViewport(gpu_cmd_buffer->Resource, 0, 1, &viewport);
 
-    // Gbuffer target
-    if (surface->ColorPassTexture) {
-        imageBarrier(
-            VulkanResourceManagerApi::GetTexture(surface->ColorPassTexture)->Image,
-            VK_DEPENDENCY_BY_REGION_BIT,
-            {
-                .src_stage_mask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                .dst_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                .src_access_mask = 0,
-                .dst_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-                .old_layout = VK_IMAGE_LAYOUT_UNDEFINED,
-                .new_layout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
-                .aspect_mask = VK_IMAGE_ASPECT_COLOR_BIT,
-                .base_mip_level = 0,
-                .level_count = VK_REMAINING_MIP_LEVELS,
-            }
-        );
-    }
+    VkRect2D scissor = {};
+    scissor.extent = {surface->Width, surface->Height};
 
+    vkCmdSetScissor(gpu_cmd_buffer->Resource, 0, 1, &scissor);
+}
+
+// With `secondary_contents` every draw comes from secondary command buffers, which set their own viewport and scissor
+static void beginSurfaceRendering(VulkanCommandBuffer* gpu_cmd_buffer, const RenderSurface* surface, VkAttachmentLoadOp load_op, bool secondary_contents = false) {
 #if KRAFT_ENABLE_VK_DYNAMIC_RENDERING
     VkRenderingInfo rendering_info = {VK_STRUCTURE_TYPE_RENDERING_INFO};
     rendering_info.renderArea.extent.width = s_Context.FramebufferWidth;
     rendering_info.renderArea.extent.height = s_Context.FramebufferHeight;
     rendering_info.layerCount = 1;
+    rendering_info.flags = secondary_contents ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0;
 
     VkRenderingAttachmentInfo color_attachment_info = {VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
     if (surface->ColorPassTexture) {
         VkImageView color_pass_view = VulkanResourceManagerApi::GetTexture(surface->ColorPassTexture)->View;
         color_attachment_info.imageView = color_pass_view;
         color_attachment_info.imageLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL;
-        color_attachment_info.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        color_attachment_info.loadOp = load_op;
         color_attachment_info.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         color_attachment_info.clearValue.color = {{0x2c / 255.0f, 0x3e / 255.0f, 0x50 / 255.0f, 1.0f}};
 
@@ -1202,7 +1398,7 @@ void VulkanRendererBackend::BeginSurface(RenderSurface* surface) {
         VkImageView depth_pass_view = VulkanResourceManagerApi::GetTexture(surface->DepthPassTexture)->View;
         depth_attachment_info.imageView = depth_pass_view;
         depth_attachment_info.imageLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL;
-        depth_attachment_info.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depth_attachment_info.loadOp = load_op;
         depth_attachment_info.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         depth_attachment_info.clearValue.depthStencil = {1.f, 0};
         rendering_info.pDepthAttachment = &depth_attachment_info;
@@ -1244,22 +1440,184 @@ void VulkanRendererBackend::BeginSurface(RenderSurface* surface) {
 #endif
     gpu_cmd_buffer->State = VULKAN_COMMAND_BUFFER_STATE_IN_RENDER_PASS;
 
-    VkViewport viewport = {};
-    viewport.width = (f32)surface->Width;
-    viewport.height = (f32)surface->Height;
-    viewport.maxDepth = 1.0f;
-
-    vkCmdSetViewport(gpu_cmd_buffer->Resource, 0, 1, &viewport);
-
-    VkRect2D scissor = {};
-    scissor.extent = {surface->Width, surface->Height};
+    if (!secondary_contents) {
+        setSurfaceViewport(gpu_cmd_buffer, surface);
+    }
+}
 
-    vkCmdSetScissor(gpu_cmd_buffer->Resource, 0, 1, &scissor);
+void VulkanRendererBackend::PrepareSurface(RenderSurface* surface) {
+    Handle<CommandBuffer> cmd_buffer_handle = surface->CmdBuffers[s_Context.CurrentSwapchainImageIndex];
+    s_Context.ActiveCommandBuffer = cmd_buffer_handle;
+    VulkanCommandBuffer* gpu_cmd_buffer = VulkanResourceManagerApi::GetCommandBuffer(cmd_buffer_handle);
+    VulkanResetCommandBuffer(gpu_cmd_buffer);
+    VulkanBeginCommandBuffer(gpu_cmd_buffer, false, false, false);
 
     VulkanRendererBackendState.BuffersToSubmit[VulkanRendererBackendState.BuffersToSubmitNum] = gpu_cmd_buffer->Resource;
     VulkanRendererBackendState.BuffersToSubmitNum++;
 }
 
+static void beginSurface(RenderSurface* surface, bool secondary_contents) {
+    Handle<CommandBuffer> cmd_buffer_handle = surface->CmdBuffers[s_Context.CurrentSwapchainImageIndex];
+    VulkanCommandBuffer* gpu_cmd_buffer = VulkanResourceManagerApi::GetCommandBuffer(cmd_buffer_handle);
+
+    // Surfaces that record compute work ahead of their draws have been started by PrepareSurface already
+    if (gpu_cmd_buffer->State != VULKAN_COMMAND_BUFFER_STATE_RECORDING) {
+        VulkanRendererBackend::PrepareSurface(surface);
+    }
+
+    s_Context.ActiveCommandBuffer = cmd_buffer_handle;
+
+    // Transition the attachments to the right format
+    // Before rendering, they must be in VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL
+    if (surface->DepthPassTexture) {
+        imageBarrier(
+            VulkanResourceManagerApi::GetTexture(surface->DepthPassTexture)->Image,
+            VK_DEPENDENCY_BY_REGION_BIT,
+            {
+                .src_stage_mask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                .dst_stage_mask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+                .src_access_mask = 0,
+                .dst_access_mask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                .old_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .new_layout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
+                .aspect_mask = VK_IMAGE_ASPECT_DEPTH_BIT,
+                .base_mip_level = 0,
+                .level_count = VK_REMAINING_MIP_LEVELS,
+            }
+        );
+    }
+
+    // Gbuffer target
+    if (surface->ColorPassTexture) {
+        imageBarrier(
+            VulkanResourceManagerApi::GetTexture(surface->ColorPassTexture)->Image,
+            VK_DEPENDENCY_BY_REGION_BIT,
+            {
+                .src_stage_mask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                .dst_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .src_access_mask = 0,
+                .dst_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                .old_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .new_layout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
+                .aspect_mask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .base_mip_level = 0,
+                .level_count = VK_REMAINING_MIP_LEVELS,
+            }
+        );
+    }
+
+    beginSurfaceRendering(gpu_cmd_buffer, surface, VK_ATTACHMENT_LOAD_OP_CLEAR, secondary_contents);
+}
+
+void VulkanRendererBackend::BeginSurface(RenderSurface* surface) {
+    beginSurface(surface, false);
+}
+
+void VulkanRendererBackend::BeginParallelSurface(RenderSurface* surface) {
+    beginSurface(surface, true);
+
+    // Secondary command buffers have to declare the attachment formats of the rendering they continue
+    s_Context.ParallelSurfaceColorFormat = VK_FORMAT_UNDEFINED;
+    s_Context.ParallelSurfaceDepthFormat = VK_FORMAT_UNDEFINED;
+    s_Context.ParallelSurfaceSamples = VK_SAMPLE_COUNT_1_BIT;
+    if (surface->DepthPassTexture) {
+        Texture* depth_texture = s_ResourceManager->GetTextureMetadata(surface->DepthPassTexture);
+        s_Context.ParallelSurfaceDepthFormat = ToVulkanFormat(depth_texture->TextureFormat);
+        s_Context.ParallelSurfaceSamples = ToVulkanSampleCountFlagBits(depth_texture->SampleCount);
+    }
+
+    if (surface->ColorPassTexture) {
+        Texture* color_texture = s_ResourceManager->GetTextureMetadata(surface->ColorPassTexture);
+        s_Context.ParallelSurfaceColorFormat = ToVulkanFormat(color_texture->TextureFormat);
+        s_Context.ParallelSurfaceSamples = ToVulkanSampleCountFlagBits(color_texture->SampleCount);
+    }
+
+    MemZero(s_Context.SecondaryCommandBuffers, sizeof(s_Context.SecondaryCommandBuffers));
+}
+
+bool VulkanRendererBackend::BeginSecondaryCommands(const RenderSurface* surface, u32 slot) {
+    KASSERT(slot < KRAFT_RENDERER_MAX_SECONDARY_COMMAND_BUFFERS);
+    KASSERT(s_Recording.Secondary == nullptr);
+
+    u32 thread_index = JobSystem::GetCurrentThreadIndex();
+    KASSERT(thread_index < s_Context.SecondaryThreadCount);
+
+    VulkanSecondaryCommandPool* pool = &s_Context.SecondaryCommandPools[s_Context.SecondaryFrameIndex * s_Context.SecondaryThreadCount + thread_index];
+    if (pool->UsedCount == KRAFT_VULKAN_MAX_SECONDARY_COMMAND_BUFFERS_PER_THREAD) {
+        KERROR("[VulkanRendererBackend::BeginSecondaryCommands]: Thread %d ran out of secondary command buffers", thread_index);
+        return false;
+    }
+
+    VulkanCommandBuffer* cmd_buffer = &pool->Buffers[pool->UsedCount];
+    if (pool->UsedCount == pool->AllocatedCount) {
+        VkCommandBufferAllocateInfo allocate_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocate_info.commandPool = pool->Resource;
+        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocate_info.commandBufferCount = 1;
+
+        KRAFT_VK_CHECK(vkAllocateCommandBuffers(s_Context.LogicalDevice.Handle, &allocate_info, &cmd_buffer->Resource));
+        cmd_buffer->Pool = pool->Resource;
+        pool->AllocatedCount++;
+    }
+
+    pool->UsedCount++;
+
+    VkCommandBufferInheritanceRenderingInfo inheritance_rendering_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO};
+    inheritance_rendering_info.colorAttachmentCount = surface->ColorPassTexture ? 1 : 0;
+    inheritance_rendering_info.pColorAttachmentFormats = &s_Context.ParallelSurfaceColorFormat;
+    inheritance_rendering_info.depthAttachmentFormat = s_Context.ParallelSurfaceDepthFormat;
+    inheritance_rendering_info.rasterizationSamples = s_Context.ParallelSurfaceSamples;
+
+    VkCommandBufferInheritanceInfo inheritance_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+    inheritance_info.pNext = &inheritance_rendering_info;
+
+    VkCommandBufferBeginInfo begin_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    begin_info.pInheritanceInfo = &inheritance_info;
+
+    KRAFT_VK_CHECK(vkBeginCommandBuffer(cmd_buffer->Resource, &begin_info));
+    cmd_buffer->State = VULKAN_COMMAND_BUFFER_STATE_IN_RENDER_PASS;
+
+    // Dynamic state isn't inherited from the primary command buffer
+    setSurfaceViewport(cmd_buffer, surface);
+
+    // The main thread also runs chunks while it waits on them, so its own recording state is put back afterwards
+    s_SavedRecording = s_Recording;
+    s_Recording = {};
+    s_Recording.Secondary = cmd_buffer;
+    s_Recording.SecondarySlot = slot;
+
+    return true;
+}
+
+void VulkanRendererBackend::EndSecondaryCommands() {
+    VulkanCommandBuffer* cmd_buffer = s_Recording.Secondary;
+    KASSERT(cmd_buffer);
+
+    VulkanEndCommandBuffer(cmd_buffer);
+    s_Context.SecondaryCommandBuffers[s_Recording.SecondarySlot] = cmd_buffer->Resource;
+
+    s_Recording = s_SavedRecording;
+}
+
+void VulkanRendererBackend::ExecuteSecondaryCommands(RenderSurface* surface, u32 count) {
+    KASSERT(count <= KRAFT_RENDERER_MAX_SECONDARY_COMMAND_BUFFERS);
+    VulkanCommandBuffer* gpu_cmd_buffer = VulkanResourceManagerApi::GetCommandBuffer(surface->CmdBuffers[s_Context.CurrentSwapchainImageIndex]);
+
+    // Chunks that couldn't get a command buffer leave their slot empty
+    VkCommandBuffer cmd_buffers[KRAFT_RENDERER_MAX_SECONDARY_COMMAND_BUFFERS];
+    u32 cmd_buffer_count = 0;
+    for (u32 i = 0; i < count; i++) {
+        if (s_Context.SecondaryCommandBuffers[i]) {
+            cmd_buffers[cmd_buffer_count++] = s_Context.SecondaryCommandBuffers[i];
+        }
+    }
+
+    if (cmd_buffer_count > 0) {
+        vkCmdExecuteCommands(gpu_cmd_buffer->Resource, cmd_buffer_count, cmd_buffers);
+    }
+}
+
 void VulkanRendererBackend::EndSurface(RenderSurface* surface) {
     Handle<CommandBuffer> cmd_buffer_handle = surface->CmdBuffers[s_Context.CurrentSwapchainImageIndex];
     VulkanCommandBuffer* gpu_cmd_buffer = VulkanResourceManagerApi::GetCommandBuffer(cmd_buffer_handle);
@@ -1324,8 +1682,85 @@ void VulkanRendererBackend::EndSurface(RenderSurface* surface) {
     VulkanSetCommandBufferSubmitted(gpu_cmd_buffer);
 }
 
+void VulkanRendererBackend::SuspendSurface(RenderSurface* surface) {
+    Handle<CommandBuffer> cmd_buffer_handle = surface->CmdBuffers[s_Context.CurrentSwapchainImageIndex];
+    s_Context.ActiveCommandBuffer = cmd_buffer_handle;
+    VulkanCommandBuffer* gpu_cmd_buffer = VulkanResourceManagerApi::GetCommandBuffer(cmd_buffer_handle);
+
+#if KRAFT_ENABLE_VK_DYNAMIC_RENDERING
+    vkCmdEndRendering(gpu_cmd_buffer->Resource);
+#else
+    vkCmdEndRenderPass(gpu_cmd_buffer->Resource);
+#endif
+    gpu_cmd_buffer->State = VULKAN_COMMAND_BUFFER_STATE_RECORDING;
+
+    // Compute work recorded while the surface is suspended can read what has been drawn to the depth attachment so far
+    if (surface->DepthPassTexture) {
+        imageBarrier(
+            VulkanResourceManagerApi::GetTexture(surface->DepthPassTexture)->Image,
+            0,
+            {
+                .src_stage_mask = VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                .dst_stage_mask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                .src_access_mask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                .dst_access_mask = VK_ACCESS_2_SHADER_READ_BIT,
+                .old_layout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
+                .new_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                .aspect_mask = VK_IMAGE_ASPECT_DEPTH_BIT,
+                .base_mip_level = 0,
+                .level_count = VK_REMAINING_MIP_LEVELS,
+            }
+        );
+    }
+}
+
+void VulkanRendererBackend::ResumeSurface(RenderSurface* surface) {
+    Handle<CommandBuffer> cmd_buffer_handle = surface->CmdBuffers[s_Context.CurrentSwapchainImageIndex];
+    s_Context.ActiveCommandBuffer = cmd_buffer_handle;
+    VulkanCommandBuffer* gpu_cmd_buffer = VulkanResourceManagerApi::GetCommandBuffer(cmd_buffer_handle);
+
+    if (surface->DepthPassTexture) {
+        imageBarrier(
+            VulkanResourceManagerApi::GetTexture(surface->DepthPassTexture)->Image,
+            0,
+            {
+                .src_stage_mask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                .dst_stage_mask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                .src_access_mask = 0,
+                .dst_access_mask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                .old_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                .new_layout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
+                .aspect_mask = VK_IMAGE_ASPECT_DEPTH_BIT,
+                .base_mip_level = 0,
+                .level_count = VK_REMAINING_MIP_LEVELS,
+            }
+        );
+    }
+
+    // The color attachment stays in its layout, but the writes made before the suspension have to be visible to the load
+    if (surface->ColorPassTexture) {
+        imageBarrier(
+            VulkanResourceManagerApi::GetTexture(surface->ColorPassTexture)->Image,
+            VK_DEPENDENCY_BY_REGION_BIT,
+            {
+                .src_stage_mask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .dst_stage_mask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .src_access_mask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                .dst_access_mask = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                .old_layout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
+                .new_layout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
+                .aspect_mask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .base_mip_level = 0,
+                .level_count = VK_REMAINING_MIP_LEVELS,
+            }
+        );
+    }
+
+    beginSurfaceRendering(gpu_cmd_buffer, surface, VK_ATTACHMENT_LOAD_OP_LOAD);
+}
+
 void VulkanRendererBackend::CmdSetCustomBuffer(Shader* shader, Handle<Buffer> buffer, u32 set_idx, u32 binding_idx) {
-    VulkanCommandBuffer* cmd_buffer = VulkanResourceManagerApi::GetCommandBuffer(s_Context.ActiveCommandBuffer);
+    VulkanCommandBuffer* cmd_buffer = activeCommandBuffer();
     VulkanShader* shader_data = (VulkanShader*)shader->RendererData;
 
     VkBuffer buffer_handle = VulkanResourceManagerApi::GetBuffer(buffer)->Handle;
@@ -1344,7 +1779,7 @@ void VulkanRendererBackend::CmdSetCustomBuffer(Shader* shader, Handle<Buffer> bu
     vkUpdateDescriptorSets(s_Context.LogicalDevice.Handle, 1, &write_info, 0, 0);
     vkCmdBindDescriptorSets(
         cmd_buffer->Resource,
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        s_Recording.ActiveBindPoint,
         shader_data->PipelineLayout,
         set_idx,
         1,
@@ -1354,8 +1789,149 @@ void VulkanRendererBackend::CmdSetCustomBuffer(Shader* shader, Handle<Buffer> bu
     );
 }
 
+void VulkanRendererBackend::CmdSetCustomStorageImage(Shader* shader, Handle<Texture> texture, u32 set_idx, u32 binding_idx) {
+    VulkanCommandBuffer* cmd_buffer = activeCommandBuffer();
+    VulkanShader* shader_data = (VulkanShader*)shader->RendererData;
+
+    // Storage images are accessed in the general layout, see TextureBarrier
+    VkDescriptorImageInfo info = {};
+    info.imageView = VulkanResourceManagerApi::GetTexture(texture)->View;
+    info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    VkWriteDescriptorSet write_info = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write_info.descriptorCount = 1;
+    write_info.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    write_info.dstBinding = binding_idx;
+    write_info.pImageInfo = &info;
+    write_info.dstSet = shader_data->descriptor_sets[set_idx - (KRAFT_VULKAN_NUM_CUSTOM_DESCRIPTOR_SETS - 1)];
+
+    vkUpdateDescriptorSets(s_Context.LogicalDevice.Handle, 1, &write_info, 0, 0);
+    vkCmdBindDescriptorSets(
+        cmd_buffer->Resource,
+        s_Recording.ActiveBindPoint,
+        shader_data->PipelineLayout,
+        set_idx,
+        1,
+        &shader_data->descriptor_sets[set_idx - (KRAFT_VULKAN_NUM_CUSTOM_DESCRIPTOR_SETS - 1)],
+        0,
+        nullptr
+    );
+}
+
+void VulkanRendererBackend::CmdPushStorageBuffers(Shader* shader, Handle<Buffer> uniform_buffer, const Handle<Buffer>* storage_buffers, u32 count) {
+    KASSERT(count <= KRAFT_RENDERER_MAX_PUSHED_STORAGE_BUFFERS);
+    VulkanCommandBuffer* cmd_buffer = activeCommandBuffer();
+    VulkanShader* shader_data = (VulkanShader*)shader->RendererData;
+
+    VkDescriptorBufferInfo buffer_infos[1 + KRAFT_RENDERER_MAX_PUSHED_STORAGE_BUFFERS] = {};
+    VkWriteDescriptorSet descriptor_write_info[2 + KRAFT_RENDERER_MAX_PUSHED_STORAGE_BUFFERS] = {};
+
+    buffer_infos[0].buffer = VulkanResourceManagerApi::GetBuffer(uniform_buffer)->Handle;
+    buffer_infos[0].range = VK_WHOLE_SIZE;
+
+    descriptor_write_info[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptor_write_info[0].descriptorCount = 1;
+    descriptor_write_info[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptor_write_info[0].dstBinding = 0;
+    descriptor_write_info[0].pBufferInfo = &buffer_infos[0];
+
+    VkDescriptorImageInfo sampler_image_infos[KRAFT_VULKAN_MAX_SAMPLERS_ALLOWED];
+    u32 sampler_count = getSamplerImageInfos(sampler_image_infos);
+
+    descriptor_write_info[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptor_write_info[1].descriptorCount = sampler_count;
+    descriptor_write_info[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+    descriptor_write_info[1].dstBinding = 1;
+    descriptor_write_info[1].pImageInfo = sampler_image_infos;
+
+    for (u32 i = 0; i < count; i++) {
+        buffer_infos[1 + i].buffer = VulkanResourceManagerApi::GetBuffer(storage_buffers[i])->Handle;
+        buffer_infos[1 + i].range = VK_WHOLE_SIZE;
+
+        descriptor_write_info[2 + i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_write_info[2 + i].descriptorCount = 1;
+        descriptor_write_info[2 + i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptor_write_info[2 + i].dstBinding = 2 + i;
+        descriptor_write_info[2 + i].pBufferInfo = &buffer_infos[1 + i];
+    }
+
+    vkCmdPushDescriptorSetKHR(cmd_buffer->Resource, s_Recording.ActiveBindPoint, shader_data->PipelineLayout, 0, 2 + count, &descriptor_write_info[0]);
+    vkCmdBindDescriptorSets(cmd_buffer->Resource, s_Recording.ActiveBindPoint, shader_data->PipelineLayout, 2, 1, &s_Context.GlobalTexturesDescriptorSet, 0, nullptr);
+}
+
+void VulkanRendererBackend::BeginComputePass() {
+    Handle<CommandBuffer> cmd_buffer_handle = s_Context.ComputeCommandBuffers[s_Context.CurrentSwapchainImageIndex];
+    s_Context.ActiveCommandBuffer = cmd_buffer_handle;
+    VulkanCommandBuffer* gpu_cmd_buffer = VulkanResourceManagerApi::GetCommandBuffer(cmd_buffer_handle);
+    VulkanResetCommandBuffer(gpu_cmd_buffer);
+    VulkanBeginCommandBuffer(gpu_cmd_buffer, false, false, false);
+
+    // Submitted in recording order, so the surfaces and the main pass recorded after this see its results
+    // once they are made visible with a barrier
+    VulkanRendererBackendState.BuffersToSubmit[VulkanRendererBackendState.BuffersToSubmitNum] = gpu_cmd_buffer->Resource;
+    VulkanRendererBackendState.BuffersToSubmitNum++;
+}
+
+void VulkanRendererBackend::EndComputePass() {
+    VulkanCommandBuffer* gpu_cmd_buffer = VulkanResourceManagerApi::GetCommandBuffer(s_Context.ComputeCommandBuffers[s_Context.CurrentSwapchainImageIndex]);
+
+    VulkanEndCommandBuffer(gpu_cmd_buffer);
+    VulkanSetCommandBufferSubmitted(gpu_cmd_buffer);
+}
+
+void VulkanRendererBackend::Dispatch(u32 group_count_x, u32 group_count_y, u32 group_count_z) {
+    KASSERT(s_Recording.ActiveBindPoint == VK_PIPELINE_BIND_POINT_COMPUTE);
+    VulkanCommandBuffer* cmd_buffer = activeCommandBuffer();
+
+    vkCmdDispatch(cmd_buffer->Resource, group_count_x, group_count_y, group_count_z);
+}
+
+void VulkanRendererBackend::DispatchIndirect(Handle<Buffer> buffer, u64 offset) {
+    KASSERT(s_Recording.ActiveBindPoint == VK_PIPELINE_BIND_POINT_COMPUTE);
+    VulkanCommandBuffer* cmd_buffer = activeCommandBuffer();
+    VulkanBuffer* gpu_buffer = VulkanResourceManagerApi::GetBuffer(buffer);
+
+    vkCmdDispatchIndirect(cmd_buffer->Resource, gpu_buffer->Handle, offset);
+}
+
+void VulkanRendererBackend::PipelineBarrier(u32 src_access, u32 dst_access) {
+    VulkanCommandBuffer* cmd_buffer = activeCommandBuffer();
+
+    VkMemoryBarrier2 barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    barrier.srcStageMask = ToVulkanPipelineStageFlags2(src_access);
+    barrier.srcAccessMask = ToVulkanAccessFlags2(src_access);
+    barrier.dstStageMask = ToVulkanPipelineStageFlags2(dst_access);
+    barrier.dstAccessMask = ToVulkanAccessFlags2(dst_access);
+
+    VkDependencyInfo dependency_info = {VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dependency_info.memoryBarrierCount = 1;
+    dependency_info.pMemoryBarriers = &barrier;
+
+    vkCmdPipelineBarrier2(cmd_buffer->Resource, &dependency_info);
+}
+
+void VulkanRendererBackend::TextureBarrier(Handle<Texture> texture, u32 src_access, u32 dst_access) {
+    Texture* metadata = ResourceManager->GetTextureMetadata(texture);
+
+    imageBarrier(
+        VulkanResourceManagerApi::GetTexture(texture)->Image,
+        0,
+        {
+            .src_stage_mask = ToVulkanPipelineStageFlags2(src_access),
+            .dst_stage_mask = ToVulkanPipelineStageFlags2(dst_access),
+            .src_access_mask = ToVulkanAccessFlags2(src_access),
+            .dst_access_mask = ToVulkanAccessFlags2(dst_access),
+            .old_layout = ToVulkanImageLayout(src_access),
+            .new_layout = ToVulkanImageLayout(dst_access),
+            .aspect_mask = GetImageAspectMask(metadata->TextureFormat),
+            .base_mip_level = 0,
+            .level_count = VK_REMAINING_MIP_LEVELS,
+        }
+    );
+}
+
 static void imageBarrier(VkImage image, VkDependencyFlags dependency_flags, VulkanImageBarrierDescription description) {
-    VulkanCommandBuffer* cmd_buffer = VulkanResourceManagerApi::GetCommandBuffer(s_Context.ActiveCommandBuffer);
+    VulkanCommandBuffer* cmd_buffer = activeCommandBuffer();
     VkImageMemoryBarrier2 barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
 
     barrier.srcStageMask = description.src_stage_mask;
@@ -1433,6 +2009,13 @@ void createCommandBuffers() {
             .CommandPool = s_Context.GraphicsCommandPool,
             .Primary = true,
         });
+
+        // Compute work goes through the graphics queue, so it is ordered with the rendering without semaphores
+        s_Context.ComputeCommandBuffers[i] = s_ResourceManager->CreateCommandBuffer({
+            .DebugName = "ComputeCmdBuffer",
+            .CommandPool = s_Context.GraphicsCommandPool,
+            .Primary = true,
+        });
     }
 
     KDEBUG("[VulkanRendererBackend::Init]: Graphics command buffers created");
@@ -1443,7 +2026,39 @@ void destroyCommandBuffers() {
         if (s_Context.GraphicsCommandBuffers[i]) {
             s_ResourceManager->DestroyCommandBuffer(s_Context.GraphicsCommandBuffers[i]);
         }
+
+        if (s_Context.ComputeCommandBuffers[i]) {
+            s_ResourceManager->DestroyCommandBuffer(s_Context.ComputeCommandBuffers[i]);
+        }
+    }
+}
+
+void createSecondaryCommandPools(ArenaAllocator* arena) {
+    s_Context.SecondaryThreadCount = JobSystem::GetThreadCount();
+    u32 pool_count = KRAFT_VULKAN_MAX_SWAPCHAIN_IMAGES * s_Context.SecondaryThreadCount;
+    s_Context.SecondaryCommandPools = ArenaPushArray(arena, VulkanSecondaryCommandPool, pool_count);
+
+    // Pools are reset as a whole, so their buffers don't need to be individually resettable
+    for (u32 i = 0; i < pool_count; i++) {
+        VkCommandPoolCreateInfo info = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        info.queueFamilyIndex = (u32)s_Context.PhysicalDevice.QueueFamilyInfo.GraphicsQueueIndex;
+        info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        KRAFT_VK_CHECK(vkCreateCommandPool(s_Context.LogicalDevice.Handle, &info, s_Context.AllocationCallbacks, &s_Context.SecondaryCommandPools[i].Resource));
     }
+
+    KDEBUG("[VulkanRendererBackend::Init]: Secondary command pools created for %d threads", s_Context.SecondaryThreadCount);
+}
+
+void destroySecondaryCommandPools() {
+    u32 pool_count = KRAFT_VULKAN_MAX_SWAPCHAIN_IMAGES * s_Context.SecondaryThreadCount;
+    for (u32 i = 0; i < pool_count; i++) {
+        // Destroying the pool frees its command buffers too
+        vkDestroyCommandPool(s_Context.LogicalDevice.Handle, s_Context.SecondaryCommandPools[i].Resource, s_Context.AllocationCallbacks);
+        s_Context.SecondaryCommandPools[i] = {};
+    }
+
+    s_Context.SecondaryThreadCount = 0;
 }
 
 #if !KRAFT_ENABLE_VK_DYNAMIC_RENDERING
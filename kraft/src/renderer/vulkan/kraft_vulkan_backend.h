@@ -10,6 +10,7 @@ struct ShaderUniform;
 struct RendererOptions;
 struct Geometry;
 struct ArenaAllocator;
+struct JobCounter;
 
 namespace r {
 
@@ -34,25 +35,47 @@ struct VulkanRendererBackend
     static bool EndFrame();
     static void OnResize(i32 width, i32 height);
 
-    static void CreateRenderPipeline(Shader* shader);
+    // Without a counter the pipelines have been created when this returns, otherwise they are created on the job threads
+    // and `counter` hits zero once they are all done
+    static void CreateRenderPipeline(Shader* shader, JobCounter* counter = nullptr);
     static void DestroyRenderPipeline(Shader* shader);
 
     static void UseShader(const Shader* shader, u32 variant_index = 0);
-    static void ApplyGlobalShaderProperties(Shader* shader, Handle<Buffer> ubo_buffer, Handle<Buffer> materials_buffer, Handle<Buffer> vertex_buffer, Handle<Buffer> index_buffer);
+    static void ApplyGlobalShaderProperties(Shader* shader, Handle<Buffer> ubo_buffer, Handle<Buffer> materials_buffer, Handle<Buffer> vertex_buffer, Handle<Buffer> index_buffer, Handle<Buffer> instance_buffer);
     static void ApplyLocalShaderProperties(Shader* shader, void* data);
     static void UpdateTextures(Handle<Texture>* textures, u64 texture_count);
+    static void BindPlaceholderTextures(Handle<Texture>* textures, u64 texture_count, Handle<Texture> placeholder);
 
     // Geometry
     static void DrawGeometryData(GeometryDrawData draw_data);
+    static void DrawGeometryDataInstanced(GeometryDrawData draw_data, u32 instance_count, u32 first_instance);
+    static void DrawGeometryIndirect(Handle<Buffer> indirect_buffer, u64 offset, u32 draw_count, IndexType::Enum index_type);
     static bool CreateGeometry(const GeometryDescription& description);
     static bool UpdateGeometry(const GeometryDescription& description);
 
     // Render Passes
+    static void PrepareSurface(RenderSurface* surface);
     static void BeginSurface(RenderSurface* surface);
     static void EndSurface(RenderSurface* surface);
+    static void SuspendSurface(RenderSurface* surface);
+    static void ResumeSurface(RenderSurface* surface);
+    static void BeginParallelSurface(RenderSurface* surface);
+    static bool BeginSecondaryCommands(const RenderSurface* surface, u32 slot);
+    static void EndSecondaryCommands();
+    static void ExecuteSecondaryCommands(RenderSurface* surface, u32 count);
+
+    // Compute
+    static void BeginComputePass();
+    static void EndComputePass();
+    static void Dispatch(u32 group_count_x, u32 group_count_y, u32 group_count_z);
+    static void DispatchIndirect(Handle<Buffer> buffer, u64 offset);
 
     // Commands
     static void CmdSetCustomBuffer(Shader* shader, Handle<Buffer> buffer, u32 set_idx, u32 binding_idx);
+    static void CmdSetCustomStorageImage(Shader* shader, Handle<Texture> texture, u32 set_idx, u32 binding_idx);
+    static void CmdPushStorageBuffers(Shader* shader, Handle<Buffer> uniform_buffer, const Handle<Buffer>* storage_buffers, u32 count);
+    static void PipelineBarrier(u32 src_access, u32 dst_access);
+    static void TextureBarrier(Handle<Texture> texture, u32 src_access, u32 dst_access);
 
     // Misc
     static VulkanContext* Context();
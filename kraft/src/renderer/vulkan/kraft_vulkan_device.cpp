@@ -482,6 +482,8 @@ void VulkanCreateLogicalDevice(ArenaAllocator* Arena, VulkanContext* Context, Vu
     FeatureRequests2.features.wideLines = Context->PhysicalDevice.Features.wideLines;
     FeatureRequests2.features.fragmentStoresAndAtomics = true;
     FeatureRequests2.features.samplerAnisotropy = true;
+    FeatureRequests2.features.multiDrawIndirect = Context->PhysicalDevice.Features.multiDrawIndirect;
+    FeatureRequests2.features.drawIndirectFirstInstance = Context->PhysicalDevice.Features.drawIndirectFirstInstance;
 
     VkPhysicalDeviceVulkan11Features FeatureRequests11 = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES };
     VkPhysicalDeviceVulkan12Features FeatureRequests12 = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
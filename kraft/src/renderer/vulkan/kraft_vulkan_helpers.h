@@ -13,7 +13,8 @@ static inline VkFormat ToVulkanFormat(ShaderDataType Format)
     static VkFormat Mapping[ShaderDataType::Count] = { VK_FORMAT_R32_SFLOAT,          VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT,
                                                        VK_FORMAT_R32G32B32A32_SFLOAT, VK_FORMAT_R8_SINT,       VK_FORMAT_R8G8B8A8_SNORM,   VK_FORMAT_R8_UINT,
                                                        VK_FORMAT_R8G8B8A8_UINT,       VK_FORMAT_R16G16_SINT,   VK_FORMAT_R16G16_SNORM,     VK_FORMAT_R16G16B16A16_SINT,
-                                                       VK_FORMAT_R16G16B16A16_SNORM,  VK_FORMAT_R32_UINT,      VK_FORMAT_R32G32_UINT,      VK_FORMAT_R32G32B32A32_UINT };
+                                                       VK_FORMAT_R16G16B16A16_SNORM,  VK_FORMAT_R32_UINT,      VK_FORMAT_R32G32_UINT,      VK_FORMAT_R32G32B32A32_UINT,
+                                                       VK_FORMAT_R32_UINT,            VK_FORMAT_R16G16_SFLOAT };
 
     return Mapping[Format.UnderlyingType];
 }
@@ -69,7 +70,10 @@ static inline VkShaderStageFlags ToVulkanShaderStageFlags(u64 Flags)
 
 static inline VkDescriptorType ToVulkanResourceType(ResourceType::Enum Value)
 {
-    static VkDescriptorType Mapping[ResourceType::Count] = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER };
+    // Constant buffers are push constants and never end up in a descriptor set
+    static VkDescriptorType Mapping[ResourceType::Count] = {
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_SAMPLER, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE
+    };
 
     return Mapping[Value];
 }
@@ -387,4 +391,73 @@ static inline VkCommandPoolCreateFlags ToVulkanCommandPoolCreateFlags(i32 Flags)
     return Result;
 }
 
+static inline VkImageAspectFlags GetImageAspectMask(Format::Enum Type)
+{
+    if (Type == Format::RGB8_UNORM || Type == Format::RGBA8_UNORM || Type == Format::BGRA8_UNORM || Type == Format::BGR8_UNORM || Type == Format::R32_SFLOAT)
+    {
+        return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+
+    if (Type == Format::D16_UNORM || Type == Format::D32_SFLOAT)
+    {
+        return VK_IMAGE_ASPECT_DEPTH_BIT;
+    }
+
+    if (Type >= Format::D16_UNORM_S8_UINT)
+    {
+        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+
+    return VK_IMAGE_ASPECT_COLOR_BIT;
+}
+
+static inline VkPipelineStageFlags2 ToVulkanPipelineStageFlags2(u32 Access)
+{
+    VkPipelineStageFlags2 Result = 0;
+
+    Result |= (Access & (PIPELINE_ACCESS_FLAGS_COMPUTE_READ | PIPELINE_ACCESS_FLAGS_COMPUTE_WRITE)) ? VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT : 0;
+    Result |= (Access & PIPELINE_ACCESS_FLAGS_VERTEX_READ) ? VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT : 0;
+    Result |= (Access & PIPELINE_ACCESS_FLAGS_FRAGMENT_READ) ? VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT : 0;
+    Result |= (Access & PIPELINE_ACCESS_FLAGS_INDIRECT_READ) ? VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT : 0;
+    Result |= (Access & PIPELINE_ACCESS_FLAGS_INDEX_READ) ? VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT : 0;
+    Result |= (Access & (PIPELINE_ACCESS_FLAGS_TRANSFER_READ | PIPELINE_ACCESS_FLAGS_TRANSFER_WRITE)) ? VK_PIPELINE_STAGE_2_TRANSFER_BIT : 0;
+    Result |= (Access & PIPELINE_ACCESS_FLAGS_HOST_READ) ? VK_PIPELINE_STAGE_2_HOST_BIT : 0;
+
+    return Result ? Result : VK_PIPELINE_STAGE_2_NONE;
+}
+
+static inline VkAccessFlags2 ToVulkanAccessFlags2(u32 Access)
+{
+    VkAccessFlags2 Result = 0;
+
+    Result |= (Access & (PIPELINE_ACCESS_FLAGS_COMPUTE_READ | PIPELINE_ACCESS_FLAGS_VERTEX_READ | PIPELINE_ACCESS_FLAGS_FRAGMENT_READ)) ? VK_ACCESS_2_SHADER_READ_BIT : 0;
+    Result |= (Access & PIPELINE_ACCESS_FLAGS_COMPUTE_WRITE) ? VK_ACCESS_2_SHADER_WRITE_BIT : 0;
+    Result |= (Access & PIPELINE_ACCESS_FLAGS_INDIRECT_READ) ? VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT : 0;
+    Result |= (Access & PIPELINE_ACCESS_FLAGS_INDEX_READ) ? VK_ACCESS_2_INDEX_READ_BIT : 0;
+    Result |= (Access & PIPELINE_ACCESS_FLAGS_TRANSFER_READ) ? VK_ACCESS_2_TRANSFER_READ_BIT : 0;
+    Result |= (Access & PIPELINE_ACCESS_FLAGS_TRANSFER_WRITE) ? VK_ACCESS_2_TRANSFER_WRITE_BIT : 0;
+    Result |= (Access & PIPELINE_ACCESS_FLAGS_HOST_READ) ? VK_ACCESS_2_HOST_READ_BIT : 0;
+
+    return Result;
+}
+
+// Layout an image has to be in for the given access. Compute access is storage access, which is what
+// CmdSetCustomStorageImage binds, so those images stay in the general layout; sampled reads use the vertex and fragment flags.
+static inline VkImageLayout ToVulkanImageLayout(u32 Access)
+{
+    if (Access == PIPELINE_ACCESS_FLAGS_NONE)
+        return VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (Access & (PIPELINE_ACCESS_FLAGS_COMPUTE_READ | PIPELINE_ACCESS_FLAGS_COMPUTE_WRITE))
+        return VK_IMAGE_LAYOUT_GENERAL;
+
+    if (Access == PIPELINE_ACCESS_FLAGS_TRANSFER_WRITE)
+        return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
+    if (Access == PIPELINE_ACCESS_FLAGS_TRANSFER_READ)
+        return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+}
+
 } // namespace kraft::r
\ No newline at end of file
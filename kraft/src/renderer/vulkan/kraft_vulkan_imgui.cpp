@@ -83,7 +83,7 @@ bool Init()
     init_info.Device = context->LogicalDevice.Handle;
     init_info.QueueFamily = context->PhysicalDevice.QueueFamilyInfo.GraphicsQueueIndex;
     init_info.Queue = context->LogicalDevice.GraphicsQueue;
-    init_info.PipelineCache = 0; // TODO: (amn) Pipeline cache
+    init_info.PipelineCache = context->PipelineCache.Handle;
     init_info.DescriptorPool = ImGuiDescriptorPool;
     init_info.Subpass = 0;
     init_info.MinImageCount = context->Swapchain.ImageCount;
@@ -3,6 +3,8 @@
 #include "kraft_vulkan_swapchain.cpp"
 #include "kraft_vulkan_command_buffer.cpp"
 #include "kraft_vulkan_fence.cpp"
+#include "kraft_vulkan_pipeline_cache.cpp"
+#include "kraft_vulkan_memory.cpp"
 #include "kraft_vulkan_renderpass.cpp"
 #include "kraft_vulkan_framebuffer.cpp"
 #include "kraft_vulkan_resource_manager.cpp"
@@ -6,6 +6,8 @@
 #include "kraft_vulkan_swapchain.h"
 #include "kraft_vulkan_command_buffer.h"
 #include "kraft_vulkan_fence.h"
+#include "kraft_vulkan_pipeline_cache.h"
+#include "kraft_vulkan_memory.h"
 #include "kraft_vulkan_renderpass.h"
 #include "kraft_vulkan_framebuffer.h"
 #include "kraft_vulkan_helpers.h"
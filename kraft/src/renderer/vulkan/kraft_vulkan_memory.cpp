@@ -0,0 +1,635 @@
+#include <volk/volk.h>
+
+#include "kraft_vulkan_memory.h"
+
+#include <core/kraft_allocators.h>
+#include <core/kraft_asserts.h>
+#include <core/kraft_log.h>
+#include <core/kraft_math.h>
+#include <core/kraft_memory.h>
+
+#include <renderer/vulkan/kraft_vulkan_types.h>
+
+#if defined(KRAFT_COMPILER_MSVC)
+#include <intrin.h>
+#endif
+
+// Each pool is a TLSF (two-level segregated fit) allocator. Free regions are binned by the position
+// of their highest set bit (first level) and then linearly into TLSF_SL_COUNT bins inside that power
+// of two (second level). Finding a free region takes two bit scans, splitting and coalescing are O(1).
+#define TLSF_SL_LOG2       4
+#define TLSF_SL_COUNT      (1 << TLSF_SL_LOG2)
+#define TLSF_MIN_SIZE_LOG2 8 // log2(KRAFT_VULKAN_MEMORY_MIN_ALIGNMENT)
+#define TLSF_FL_COUNT      24
+
+namespace kraft::r {
+
+struct VulkanMemoryPool;
+
+struct VulkanMemoryRegion {
+    u64 offset;
+    u64 size;
+    VulkanMemoryBlock* block;
+    VulkanMemoryRegion* prev_physical;
+    VulkanMemoryRegion* next_physical;
+    VulkanMemoryRegion* prev_free;
+    VulkanMemoryRegion* next_free;
+    bool free;
+};
+
+struct VulkanMemoryBlock {
+    VkDeviceMemory memory;
+    u64 size;
+    u8* mapped_ptr;
+    u32 allocation_count;
+    VulkanMemoryPool* pool;
+    VulkanMemoryRegion* first_region;
+    VulkanMemoryBlock* prev;
+    VulkanMemoryBlock* next;
+};
+
+struct VulkanMemoryPool {
+    u32 memory_type_index;
+    u64 block_size;
+    VulkanMemoryBlock* blocks;
+    u32 block_count;
+    u32 allocation_count;
+    u64 used_bytes;
+
+    u32 fl_bitmap;
+    u32 sl_bitmap[TLSF_FL_COUNT];
+    VulkanMemoryRegion* free_lists[TLSF_FL_COUNT][TLSF_SL_COUNT];
+};
+
+struct VulkanMemoryState {
+    ArenaAllocator* arena;
+    VulkanMemoryPool* pools[VK_MAX_MEMORY_TYPES][VULKAN_MEMORY_RESOURCE_KIND_COUNT];
+
+    // Recycled nodes
+    VulkanMemoryRegion* free_regions;
+    VulkanMemoryBlock* free_blocks;
+
+    u64 device_memory_count;
+    u64 dedicated_allocation_count[VK_MAX_MEMORY_HEAPS];
+    u64 dedicated_bytes[VK_MAX_MEMORY_HEAPS];
+};
+
+static VulkanMemoryState* memory_state = nullptr;
+
+static KRAFT_INLINE u32 BitScanForward32(u32 value) {
+    KASSERT(value);
+#if defined(KRAFT_COMPILER_MSVC)
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return (u32)index;
+#else
+    return (u32)__builtin_ctz(value);
+#endif
+}
+
+static KRAFT_INLINE u32 BitScanReverse64(u64 value) {
+    KASSERT(value);
+#if defined(KRAFT_COMPILER_MSVC)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (u32)index;
+#else
+    return 63 - (u32)__builtin_clzll(value);
+#endif
+}
+
+static i32 FindMemoryIndex(VulkanPhysicalDevice device, u32 type_filter, u32 property_flags) {
+    for (u32 i = 0; i < device.MemoryProperties.memoryTypeCount; ++i) {
+        VkMemoryType type = device.MemoryProperties.memoryTypes[i];
+        if (type_filter & (1 << i) && (type.propertyFlags & property_flags) == property_flags) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+//
+// TLSF
+//
+
+static void TLSFMapping(u64 size, u32* fl, u32* sl) {
+    if (size < (1ull << TLSF_MIN_SIZE_LOG2)) {
+        *fl = 0;
+        *sl = (u32)(size >> (TLSF_MIN_SIZE_LOG2 - TLSF_SL_LOG2));
+    } else {
+        u32 log2 = BitScanReverse64(size);
+        *fl = log2 - TLSF_MIN_SIZE_LOG2 + 1;
+        *sl = (u32)(size >> (log2 - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT;
+    }
+}
+
+static void TLSFInsertFree(VulkanMemoryPool* pool, VulkanMemoryRegion* region) {
+    u32 fl, sl;
+    TLSFMapping(region->size, &fl, &sl);
+    KASSERT(fl < TLSF_FL_COUNT);
+
+    VulkanMemoryRegion* head = pool->free_lists[fl][sl];
+    region->free = true;
+    region->prev_free = nullptr;
+    region->next_free = head;
+    if (head) {
+        head->prev_free = region;
+    }
+
+    pool->free_lists[fl][sl] = region;
+    pool->sl_bitmap[fl] |= 1u << sl;
+    pool->fl_bitmap |= 1u << fl;
+}
+
+static void TLSFRemoveFree(VulkanMemoryPool* pool, VulkanMemoryRegion* region) {
+    KASSERT(region->free);
+
+    u32 fl, sl;
+    TLSFMapping(region->size, &fl, &sl);
+
+    if (region->prev_free) {
+        region->prev_free->next_free = region->next_free;
+    } else {
+        pool->free_lists[fl][sl] = region->next_free;
+    }
+
+    if (region->next_free) {
+        region->next_free->prev_free = region->prev_free;
+    }
+
+    if (!pool->free_lists[fl][sl]) {
+        pool->sl_bitmap[fl] &= ~(1u << sl);
+        if (!pool->sl_bitmap[fl]) {
+            pool->fl_bitmap &= ~(1u << fl);
+        }
+    }
+
+    region->free = false;
+    region->prev_free = nullptr;
+    region->next_free = nullptr;
+}
+
+// Returns a free region that is at least `size` bytes large, or nullptr
+static VulkanMemoryRegion* TLSFFindFree(VulkanMemoryPool* pool, u64 size) {
+    // Round the size up to the next bin so that every region in the bin we land on is large enough
+    if (size >= (1ull << TLSF_MIN_SIZE_LOG2)) {
+        size += (1ull << (BitScanReverse64(size) - TLSF_SL_LOG2)) - 1;
+    }
+
+    u32 fl, sl;
+    TLSFMapping(size, &fl, &sl);
+    if (fl >= TLSF_FL_COUNT) {
+        return nullptr;
+    }
+
+    u32 sl_map = pool->sl_bitmap[fl] & (~0u << sl);
+    if (!sl_map) {
+        u32 fl_map = fl + 1 < TLSF_FL_COUNT ? pool->fl_bitmap & (~0u << (fl + 1)) : 0;
+        if (!fl_map) {
+            return nullptr;
+        }
+
+        fl = BitScanForward32(fl_map);
+        sl_map = pool->sl_bitmap[fl];
+    }
+
+    sl = BitScanForward32(sl_map);
+    return pool->free_lists[fl][sl];
+}
+
+//
+// Pools & blocks
+//
+
+static VulkanMemoryRegion* AcquireRegion() {
+    VulkanMemoryRegion* region = memory_state->free_regions;
+    if (region) {
+        memory_state->free_regions = region->next_free;
+    } else {
+        region = ArenaPush(memory_state->arena, VulkanMemoryRegion);
+    }
+
+    *region = {};
+    return region;
+}
+
+static void ReleaseRegion(VulkanMemoryRegion* region) {
+    region->next_free = memory_state->free_regions;
+    memory_state->free_regions = region;
+}
+
+static VulkanMemoryPool* GetPool(VulkanContext* context, u32 memory_type_index, VulkanMemoryResourceKind kind) {
+    VulkanMemoryPool* pool = memory_state->pools[memory_type_index][kind];
+    if (pool) {
+        return pool;
+    }
+
+    const VkPhysicalDeviceMemoryProperties& properties = context->PhysicalDevice.MemoryProperties;
+    u64 heap_size = properties.memoryHeaps[properties.memoryTypes[memory_type_index].heapIndex].size;
+
+    pool = ArenaPush(memory_state->arena, VulkanMemoryPool);
+    pool->memory_type_index = memory_type_index;
+    pool->block_size = KRAFT_VULKAN_MEMORY_BLOCK_SIZE;
+
+    // Small heaps (like the host visible part of VRAM) would be used up by a couple of blocks
+    if (heap_size < KRAFT_SIZE_GB(1)) {
+        pool->block_size = (heap_size / 8) & ~(u64)(KRAFT_VULKAN_MEMORY_MIN_ALIGNMENT - 1);
+    }
+
+    memory_state->pools[memory_type_index][kind] = pool;
+    return pool;
+}
+
+static VulkanMemoryBlock* CreateBlock(VulkanContext* context, VulkanMemoryPool* pool) {
+    VkMemoryAllocateInfo info = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+    info.allocationSize = pool->block_size;
+    info.memoryTypeIndex = pool->memory_type_index;
+
+    VkDeviceMemory memory = 0;
+    VkResult result = vkAllocateMemory(context->LogicalDevice.Handle, &info, context->AllocationCallbacks, &memory);
+    if (result != VK_SUCCESS) {
+        KERROR("[CreateBlock]: Failed to allocate a %llu byte block for memory type %d", pool->block_size, pool->memory_type_index);
+        return nullptr;
+    }
+
+    KRAFT_RENDERER_SET_OBJECT_NAME(memory, VK_OBJECT_TYPE_DEVICE_MEMORY, "VulkanMemoryBlock");
+
+    VulkanMemoryBlock* block = memory_state->free_blocks;
+    if (block) {
+        memory_state->free_blocks = block->next;
+    } else {
+        block = ArenaPush(memory_state->arena, VulkanMemoryBlock);
+    }
+
+    *block = {};
+    block->memory = memory;
+    block->size = pool->block_size;
+    block->pool = pool;
+    block->next = pool->blocks;
+    if (pool->blocks) {
+        pool->blocks->prev = block;
+    }
+
+    pool->blocks = block;
+    pool->block_count++;
+    memory_state->device_memory_count++;
+
+    VulkanMemoryRegion* region = AcquireRegion();
+    region->offset = 0;
+    region->size = block->size;
+    region->block = block;
+    block->first_region = region;
+
+    TLSFInsertFree(pool, region);
+
+    return block;
+}
+
+static void DestroyBlock(VulkanContext* context, VulkanMemoryPool* pool, VulkanMemoryBlock* block) {
+    // Unmapping is implicit
+    vkFreeMemory(context->LogicalDevice.Handle, block->memory, context->AllocationCallbacks);
+
+    if (block->prev) {
+        block->prev->next = block->next;
+    } else {
+        pool->blocks = block->next;
+    }
+
+    if (block->next) {
+        block->next->prev = block->prev;
+    }
+
+    pool->block_count--;
+    memory_state->device_memory_count--;
+
+    ReleaseRegion(block->first_region);
+    block->next = memory_state->free_blocks;
+    memory_state->free_blocks = block;
+}
+
+static VulkanMemoryRegion* PoolAllocate(VulkanContext* context, VulkanMemoryPool* pool, u64 size, u64 alignment) {
+    size = math::AlignUp(size, KRAFT_VULKAN_MEMORY_MIN_ALIGNMENT);
+    alignment = math::Max(alignment, (u64)KRAFT_VULKAN_MEMORY_MIN_ALIGNMENT);
+
+    // Every region starts at a multiple of the minimum alignment, so that's the most padding we could need
+    u64 search_size = size + alignment - KRAFT_VULKAN_MEMORY_MIN_ALIGNMENT;
+    if (search_size > pool->block_size) {
+        return nullptr;
+    }
+
+    VulkanMemoryRegion* region = TLSFFindFree(pool, search_size);
+    if (!region) {
+        if (!CreateBlock(context, pool)) {
+            return nullptr;
+        }
+
+        region = TLSFFindFree(pool, search_size);
+        KASSERT(region);
+    }
+
+    TLSFRemoveFree(pool, region);
+
+    // Leading padding turns into a free region of its own
+    u64 aligned_offset = math::AlignUp(region->offset, alignment);
+    if (aligned_offset > region->offset) {
+        VulkanMemoryRegion* padding = AcquireRegion();
+        padding->offset = region->offset;
+        padding->size = aligned_offset - region->offset;
+        padding->block = region->block;
+        padding->prev_physical = region->prev_physical;
+        padding->next_physical = region;
+        if (region->prev_physical) {
+            region->prev_physical->next_physical = padding;
+        } else {
+            region->block->first_region = padding;
+        }
+
+        region->prev_physical = padding;
+        region->offset = aligned_offset;
+        region->size -= padding->size;
+
+        TLSFInsertFree(pool, padding);
+    }
+
+    // And so does whatever is left at the end
+    if (region->size > size) {
+        VulkanMemoryRegion* remainder = AcquireRegion();
+        remainder->offset = region->offset + size;
+        remainder->size = region->size - size;
+        remainder->block = region->block;
+        remainder->prev_physical = region;
+        remainder->next_physical = region->next_physical;
+        if (region->next_physical) {
+            region->next_physical->prev_physical = remainder;
+        }
+
+        region->next_physical = remainder;
+        region->size = size;
+
+        TLSFInsertFree(pool, remainder);
+    }
+
+    region->block->allocation_count++;
+    pool->allocation_count++;
+    pool->used_bytes += region->size;
+
+    return region;
+}
+
+static void PoolFree(VulkanContext* context, VulkanMemoryPool* pool, VulkanMemoryRegion* region) {
+    VulkanMemoryBlock* block = region->block;
+    block->allocation_count--;
+    pool->allocation_count--;
+    pool->used_bytes -= region->size;
+
+    // Coalesce with the neighbours
+    VulkanMemoryRegion* prev = region->prev_physical;
+    if (prev && prev->free) {
+        TLSFRemoveFree(pool, prev);
+        prev->size += region->size;
+        prev->next_physical = region->next_physical;
+        if (region->next_physical) {
+            region->next_physical->prev_physical = prev;
+        }
+
+        ReleaseRegion(region);
+        region = prev;
+    }
+
+    VulkanMemoryRegion* next = region->next_physical;
+    if (next && next->free) {
+        TLSFRemoveFree(pool, next);
+        region->size += next->size;
+        region->next_physical = next->next_physical;
+        if (next->next_physical) {
+            next->next_physical->prev_physical = region;
+        }
+
+        ReleaseRegion(next);
+    }
+
+    // Empty blocks go back to the driver, except for the last one so that creating and destroying
+    // a single resource over and over doesn't end up calling vkAllocateMemory every time
+    if (block->allocation_count == 0 && pool->block_count > 1) {
+        KASSERT(region == block->first_region && region->size == block->size);
+        DestroyBlock(context, pool, block);
+        return;
+    }
+
+    TLSFInsertFree(pool, region);
+}
+
+static bool AllocateDedicated(VulkanContext* context, const VulkanAllocationDescription& description, u32 memory_type_index, VulkanAllocation* out) {
+    VkMemoryAllocateInfo info = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+    info.allocationSize = description.Requirements.size;
+    info.memoryTypeIndex = memory_type_index;
+
+    VkMemoryDedicatedAllocateInfo dedicated_info = {VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO};
+    if (description.DedicatedImage || description.DedicatedBuffer) {
+        dedicated_info.image = description.DedicatedImage;
+        dedicated_info.buffer = description.DedicatedBuffer;
+        dedicated_info.pNext = info.pNext;
+        info.pNext = &dedicated_info;
+    }
+
+    VkMemoryAllocateFlagsInfo flags_info = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO};
+    if (description.AllocateFlags) {
+        flags_info.flags = description.AllocateFlags;
+        flags_info.pNext = info.pNext;
+        info.pNext = &flags_info;
+    }
+
+    VkResult result = vkAllocateMemory(context->LogicalDevice.Handle, &info, context->AllocationCallbacks, &out->Memory);
+    if (result != VK_SUCCESS) {
+        KERROR("[AllocateDedicated]: vkAllocateMemory failed for '%s' (%llu bytes)", description.DebugName, description.Requirements.size);
+        return false;
+    }
+
+    KRAFT_RENDERER_SET_OBJECT_NAME(out->Memory, VK_OBJECT_TYPE_DEVICE_MEMORY, description.DebugName);
+
+    u32 heap_index = context->PhysicalDevice.MemoryProperties.memoryTypes[memory_type_index].heapIndex;
+    memory_state->dedicated_allocation_count[heap_index]++;
+    memory_state->dedicated_bytes[heap_index] += description.Requirements.size;
+    memory_state->device_memory_count++;
+
+    out->Offset = 0;
+    out->Size = description.Requirements.size;
+
+    return true;
+}
+
+//
+// API
+//
+
+void VulkanMemoryInit(ArenaAllocator* arena) {
+    memory_state = ArenaPush(arena, VulkanMemoryState);
+    memory_state->arena = arena;
+}
+
+void VulkanMemoryShutdown(VulkanContext* context) {
+    for (u32 i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+        for (u32 kind = 0; kind < VULKAN_MEMORY_RESOURCE_KIND_COUNT; kind++) {
+            VulkanMemoryPool* pool = memory_state->pools[i][kind];
+            if (!pool) {
+                continue;
+            }
+
+            if (pool->allocation_count > 0) {
+                KWARN("[VulkanMemoryShutdown]: %u allocations leaked from memory type %u", pool->allocation_count, i);
+            }
+
+            while (pool->blocks) {
+                DestroyBlock(context, pool, pool->blocks);
+            }
+
+            MemZero(pool->free_lists, sizeof(pool->free_lists));
+            MemZero(pool->sl_bitmap, sizeof(pool->sl_bitmap));
+            pool->fl_bitmap = 0;
+            pool->allocation_count = 0;
+            pool->used_bytes = 0;
+        }
+    }
+}
+
+bool VulkanMemoryAllocate(VulkanContext* context, const VulkanAllocationDescription& description, VulkanAllocation* out) {
+    *out = {};
+
+    i32 memory_type_index = FindMemoryIndex(context->PhysicalDevice, description.Requirements.memoryTypeBits, description.PropertyFlags);
+    if (memory_type_index == -1) {
+        KERROR("[VulkanMemoryAllocate]: Failed to find suitable memoryType for '%s'", description.DebugName);
+        return false;
+    }
+
+    out->MemoryTypeIndex = memory_type_index;
+
+    // Blocks are allocated without any allocate flags, so anything that needs them gets its own memory
+    VulkanMemoryPool* pool = GetPool(context, memory_type_index, description.Kind);
+    bool dedicated = description.Dedicated || description.AllocateFlags || description.Requirements.size > pool->block_size / 2;
+    if (!dedicated) {
+        VulkanMemoryRegion* region = PoolAllocate(context, pool, description.Requirements.size, description.Requirements.alignment);
+        if (region) {
+            out->Memory = region->block->memory;
+            out->Offset = region->offset;
+            out->Size = region->size;
+            out->Block = region->block;
+            out->Region = region;
+
+            return true;
+        }
+
+        KWARN("[VulkanMemoryAllocate]: Sub-allocation failed for '%s', falling back to a dedicated allocation", description.DebugName);
+    }
+
+    return AllocateDedicated(context, description, memory_type_index, out);
+}
+
+void VulkanMemoryFree(VulkanContext* context, VulkanAllocation* allocation) {
+    if (allocation->Region) {
+        PoolFree(context, allocation->Block->pool, allocation->Region);
+    } else if (allocation->Memory) {
+        vkFreeMemory(context->LogicalDevice.Handle, allocation->Memory, context->AllocationCallbacks);
+
+        u32 heap_index = context->PhysicalDevice.MemoryProperties.memoryTypes[allocation->MemoryTypeIndex].heapIndex;
+        memory_state->dedicated_allocation_count[heap_index]--;
+        memory_state->dedicated_bytes[heap_index] -= allocation->Size;
+        memory_state->device_memory_count--;
+    }
+
+    *allocation = {};
+}
+
+u8* VulkanMemoryMap(VulkanContext* context, VulkanAllocation* allocation) {
+    VkDevice device = context->LogicalDevice.Handle;
+    if (allocation->Block) {
+        // A VkDeviceMemory can only be mapped once, so the whole block gets mapped the first time any of its allocations is
+        VulkanMemoryBlock* block = allocation->Block;
+        if (!block->mapped_ptr) {
+            KRAFT_VK_CHECK(vkMapMemory(device, block->memory, 0, VK_WHOLE_SIZE, 0, (void**)&block->mapped_ptr));
+        }
+
+        return block->mapped_ptr + allocation->Offset;
+    }
+
+    if (!allocation->MappedPtr) {
+        KRAFT_VK_CHECK(vkMapMemory(device, allocation->Memory, 0, VK_WHOLE_SIZE, 0, &allocation->MappedPtr));
+    }
+
+    return (u8*)allocation->MappedPtr;
+}
+
+void VulkanMemoryGetStats(VulkanContext* context, VulkanMemoryStats* out) {
+    const VkPhysicalDeviceMemoryProperties& properties = context->PhysicalDevice.MemoryProperties;
+
+    *out = {};
+    out->HeapCount = properties.memoryHeapCount;
+    out->DeviceMemoryCount = memory_state->device_memory_count;
+
+    u64 free_bytes[VK_MAX_MEMORY_HEAPS] = {};
+    for (u32 i = 0; i < properties.memoryHeapCount; i++) {
+        VulkanMemoryHeapStats* heap = &out->Heaps[i];
+        heap->HeapSize = properties.memoryHeaps[i].size;
+        heap->AllocationCount = memory_state->dedicated_allocation_count[i];
+        heap->DedicatedAllocationCount = memory_state->dedicated_allocation_count[i];
+        heap->ReservedBytes = memory_state->dedicated_bytes[i];
+        heap->UsedBytes = memory_state->dedicated_bytes[i];
+    }
+
+    for (u32 i = 0; i < properties.memoryTypeCount; i++) {
+        VulkanMemoryHeapStats* heap = &out->Heaps[properties.memoryTypes[i].heapIndex];
+        for (u32 kind = 0; kind < VULKAN_MEMORY_RESOURCE_KIND_COUNT; kind++) {
+            VulkanMemoryPool* pool = memory_state->pools[i][kind];
+            if (!pool) {
+                continue;
+            }
+
+            heap->BlockCount += pool->block_count;
+            heap->AllocationCount += pool->allocation_count;
+            heap->UsedBytes += pool->used_bytes;
+
+            for (VulkanMemoryBlock* block = pool->blocks; block; block = block->next) {
+                heap->ReservedBytes += block->size;
+                for (VulkanMemoryRegion* region = block->first_region; region; region = region->next_physical) {
+                    if (region->free) {
+                        free_bytes[properties.memoryTypes[i].heapIndex] += region->size;
+                        heap->LargestFreeRegion = math::Max(heap->LargestFreeRegion, region->size);
+                    }
+                }
+            }
+        }
+    }
+
+    for (u32 i = 0; i < properties.memoryHeapCount; i++) {
+        VulkanMemoryHeapStats* heap = &out->Heaps[i];
+        heap->Fragmentation = free_bytes[i] ? 1.0f - (f32)((f64)heap->LargestFreeRegion / (f64)free_bytes[i]) : 0.0f;
+    }
+}
+
+void VulkanMemoryPrintStats(VulkanContext* context) {
+    VulkanMemoryStats stats;
+    VulkanMemoryGetStats(context, &stats);
+
+    KINFO("[VulkanMemoryPrintStats]: %llu live device memory allocations", stats.DeviceMemoryCount);
+    for (u32 i = 0; i < stats.HeapCount; i++) {
+        const VulkanMemoryHeapStats& heap = stats.Heaps[i];
+        if (heap.ReservedBytes == 0) {
+            continue;
+        }
+
+        KINFO(
+            "[VulkanMemoryPrintStats]: Heap %u: %.2f/%.2f MiB used (heap size %.2f MiB), %llu blocks, %llu allocations (%llu dedicated), largest free region %.2f MiB, fragmentation %.2f",
+            i,
+            (f64)heap.UsedBytes / (1024.0 * 1024.0),
+            (f64)heap.ReservedBytes / (1024.0 * 1024.0),
+            (f64)heap.HeapSize / (1024.0 * 1024.0),
+            heap.BlockCount,
+            heap.AllocationCount,
+            heap.DedicatedAllocationCount,
+            (f64)heap.LargestFreeRegion / (1024.0 * 1024.0),
+            heap.Fragmentation
+        );
+    }
+}
+
+} // namespace kraft::r
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <core/kraft_core.h>
+
+namespace kraft {
+struct ArenaAllocator;
+} // namespace kraft
+
+namespace kraft::r {
+
+struct VulkanContext;
+struct VulkanAllocation;
+
+// Size of the VkDeviceMemory blocks that resources get sub-allocated from.
+// Heaps smaller than 1GB use an eighth of the heap instead.
+#define KRAFT_VULKAN_MEMORY_BLOCK_SIZE KRAFT_SIZE_MB(64)
+
+// Every sub-allocation starts at a multiple of this
+#define KRAFT_VULKAN_MEMORY_MIN_ALIGNMENT 256
+
+// Buffers and linearly tiled images never share a block with optimally tiled images,
+// so we never have to pad allocations to bufferImageGranularity
+enum VulkanMemoryResourceKind {
+    VULKAN_MEMORY_RESOURCE_KIND_LINEAR,
+    VULKAN_MEMORY_RESOURCE_KIND_OPTIMAL,
+
+    VULKAN_MEMORY_RESOURCE_KIND_COUNT
+};
+
+struct VulkanAllocationDescription {
+    VkMemoryRequirements Requirements;
+    VkMemoryPropertyFlags PropertyFlags;
+    VkMemoryAllocateFlags AllocateFlags;
+    VulkanMemoryResourceKind Kind;
+
+    // Forces a VkDeviceMemory of its own. The allocator also falls back to a dedicated allocation
+    // for anything larger than half a block or when `AllocateFlags` is set.
+    bool Dedicated = false;
+
+    // Optional, passed along through VkMemoryDedicatedAllocateInfo for dedicated allocations
+    VkImage DedicatedImage = 0;
+    VkBuffer DedicatedBuffer = 0;
+
+    const char* DebugName = "";
+};
+
+struct VulkanMemoryHeapStats {
+    u64 HeapSize;
+    u64 BlockCount;
+    u64 AllocationCount;
+    u64 DedicatedAllocationCount;
+    u64 ReservedBytes;     // Total size of every VkDeviceMemory allocated from this heap
+    u64 UsedBytes;         // Bytes handed out to resources
+    u64 LargestFreeRegion; // Largest allocation that fits in the existing blocks
+
+    // 0 when all the free space in the blocks is in one piece, approaching 1 as it gets split up
+    f32 Fragmentation;
+};
+
+struct VulkanMemoryStats {
+    u32 HeapCount;
+    u64 DeviceMemoryCount; // Number of live vkAllocateMemory allocations
+    VulkanMemoryHeapStats Heaps[VK_MAX_MEMORY_HEAPS];
+};
+
+// The allocator is not thread-safe, like the rest of the resource manager it is only used from the main thread
+void VulkanMemoryInit(ArenaAllocator* arena);
+void VulkanMemoryShutdown(VulkanContext* context);
+
+bool VulkanMemoryAllocate(VulkanContext* context, const VulkanAllocationDescription& description, VulkanAllocation* out);
+void VulkanMemoryFree(VulkanContext* context, VulkanAllocation* allocation);
+
+// Returns a pointer to the start of the allocation; host visible blocks stay mapped until they are released
+u8* VulkanMemoryMap(VulkanContext* context, VulkanAllocation* allocation);
+
+void VulkanMemoryGetStats(VulkanContext* context, VulkanMemoryStats* out);
+void VulkanMemoryPrintStats(VulkanContext* context);
+
+} // namespace kraft::r
@@ -0,0 +1,271 @@
+#include <volk/volk.h>
+#include <vulkan/vk_enum_string_helper.h>
+
+#include "kraft_vulkan_pipeline_cache.h"
+
+#include <containers/kraft_array.h>
+#include <core/kraft_allocators.h>
+#include <core/kraft_asserts.h>
+#include <core/kraft_hash.h>
+#include <core/kraft_log.h>
+#include <core/kraft_memory.h>
+#include <core/kraft_strings.h>
+#include <platform/kraft_filesystem.h>
+#include <platform/kraft_platform.h>
+
+#include <renderer/vulkan/kraft_vulkan_types.h>
+
+namespace kraft::r {
+
+#define KRAFT_VULKAN_PIPELINE_CACHE_MAGIC   0x43505346 // "FSPC"
+#define KRAFT_VULKAN_PIPELINE_CACHE_VERSION 1
+
+// Written in front of the data returned by vkGetPipelineCacheData. Drivers validate their own header too, but some only
+// check it loosely and a cache from another driver version or a truncated file can crash them, so the file carries
+// enough to reject it before it ever reaches the driver.
+struct VulkanPipelineCacheFileHeader
+{
+    u32 Magic;
+    u32 Version;
+    u32 VendorID;
+    u32 DeviceID;
+    u32 DriverVersion;
+    u8  PipelineCacheUUID[VK_UUID_SIZE];
+    u64 DataSize;
+    u64 DataHash;
+};
+
+static u64 HashPipelineCacheData(const u8* data, u64 size)
+{
+    return MurmurHash64(data, (int)size, KRAFT_VULKAN_PIPELINE_CACHE_MAGIC);
+}
+
+// Returns the cache data stored in `file`, or an empty buffer if the file can't be used on this device
+static buffer GetPipelineCacheData(VulkanContext* context, buffer file)
+{
+    const VkPhysicalDeviceProperties& properties = context->PhysicalDevice.Properties;
+    const char*                       path = context->PipelineCache.Path;
+
+    VulkanPipelineCacheFileHeader header;
+    if (file.count < sizeof(header))
+    {
+        KWARN("[VulkanCreatePipelineCache]: '%s' is truncated", path);
+        return {};
+    }
+
+    MemCpy(&header, file.ptr, sizeof(header));
+    if (header.Magic != KRAFT_VULKAN_PIPELINE_CACHE_MAGIC || header.Version != KRAFT_VULKAN_PIPELINE_CACHE_VERSION)
+    {
+        KWARN("[VulkanCreatePipelineCache]: '%s' is not a pipeline cache or was written by an older version", path);
+        return {};
+    }
+
+    if (header.VendorID != properties.vendorID || header.DeviceID != properties.deviceID || header.DriverVersion != properties.driverVersion ||
+        MemCmp(header.PipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        KINFO("[VulkanCreatePipelineCache]: '%s' was written by a different device or driver", path);
+        return {};
+    }
+
+    const u8* data = file.ptr + sizeof(header);
+    if (header.DataSize != file.count - sizeof(header) || HashPipelineCacheData(data, header.DataSize) != header.DataHash)
+    {
+        KWARN("[VulkanCreatePipelineCache]: '%s' is corrupted", path);
+        return {};
+    }
+
+    // The driver's header should agree with ours, unless the file was tampered with
+    VkPipelineCacheHeaderVersionOne driver_header;
+    if (header.DataSize < sizeof(driver_header))
+    {
+        KWARN("[VulkanCreatePipelineCache]: '%s' is truncated", path);
+        return {};
+    }
+
+    MemCpy(&driver_header, data, sizeof(driver_header));
+    if (driver_header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || driver_header.vendorID != properties.vendorID ||
+        driver_header.deviceID != properties.deviceID || MemCmp(driver_header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        KWARN("[VulkanCreatePipelineCache]: '%s' has a mismatching driver header", path);
+        return {};
+    }
+
+    return { (u8*)data, header.DataSize };
+}
+
+void VulkanCreatePipelineCache(VulkanContext* context, const char* path)
+{
+    VulkanPipelineCache* cache = &context->PipelineCache;
+    cache->Path = path;
+    cache->LastSaveTime = Platform::GetAbsoluteTime();
+
+    TempArena scratch = ScratchBegin(0, 0);
+    buffer    data = {};
+    if (path)
+    {
+        buffer file = fs::ReadAllBytes(scratch.arena, String8FromCString(path));
+        if (file.count > 0)
+        {
+            data = GetPipelineCacheData(context, file);
+        }
+    }
+
+    VkPipelineCacheCreateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    info.initialDataSize = data.count;
+    info.pInitialData = data.ptr;
+
+    VkResult result = vkCreatePipelineCache(context->LogicalDevice.Handle, &info, context->AllocationCallbacks, &cache->Handle);
+    if (result != VK_SUCCESS && info.initialDataSize > 0)
+    {
+        KWARN("[VulkanCreatePipelineCache]: The driver rejected '%s' (%s), starting with an empty cache", path, string_VkResult(result));
+
+        info.initialDataSize = 0;
+        info.pInitialData = nullptr;
+        result = vkCreatePipelineCache(context->LogicalDevice.Handle, &info, context->AllocationCallbacks, &cache->Handle);
+    }
+
+    KRAFT_VK_CHECK(result);
+    cache->LoadedSize = info.initialDataSize;
+    if (cache->LoadedSize > 0)
+    {
+        KDEBUG("[VulkanCreatePipelineCache]: Loaded %llu bytes from '%s'", cache->LoadedSize, path);
+    }
+
+    ScratchEnd(scratch);
+}
+
+bool VulkanSavePipelineCache(VulkanContext* context, bool force)
+{
+    VulkanPipelineCache* cache = &context->PipelineCache;
+    if (!cache->Handle || !cache->Path)
+        return false;
+
+    // Pipelines created on the job threads while saving are left for the next save
+    u32 created = cache->CreatedSinceSave.load(std::memory_order_relaxed);
+    if (!force && created == 0)
+        return true;
+
+    const VkPhysicalDeviceProperties& properties = context->PhysicalDevice.Properties;
+
+    size_t size = 0;
+    KRAFT_VK_CHECK(vkGetPipelineCacheData(context->LogicalDevice.Handle, cache->Handle, &size, nullptr));
+
+    TempArena scratch = ScratchBegin(0, 0);
+    u8*       file_data = ArenaPushArrayNoZero(scratch.arena, u8, sizeof(VulkanPipelineCacheFileHeader) + size);
+    u8*       data = file_data + sizeof(VulkanPipelineCacheFileHeader);
+
+    // VK_INCOMPLETE only means pipelines were added in between the two calls, what we got is still a valid cache
+    VkResult result = vkGetPipelineCacheData(context->LogicalDevice.Handle, cache->Handle, &size, data);
+    if (result != VK_SUCCESS && result != VK_INCOMPLETE)
+    {
+        KERROR("[VulkanSavePipelineCache]: vkGetPipelineCacheData failed with %s", string_VkResult(result));
+        ScratchEnd(scratch);
+        return false;
+    }
+
+    VulkanPipelineCacheFileHeader header = {};
+    header.Magic = KRAFT_VULKAN_PIPELINE_CACHE_MAGIC;
+    header.Version = KRAFT_VULKAN_PIPELINE_CACHE_VERSION;
+    header.VendorID = properties.vendorID;
+    header.DeviceID = properties.deviceID;
+    header.DriverVersion = properties.driverVersion;
+    MemCpy(header.PipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.DataSize = size;
+    header.DataHash = HashPipelineCacheData(data, size);
+    MemCpy(file_data, &header, sizeof(header));
+
+    fs::FileHandle file = {};
+    bool           written = false;
+    if (fs::OpenFile(String8FromCString(cache->Path), fs::FILE_OPEN_MODE_WRITE, true, &file))
+    {
+        written = fs::WriteFile(&file, file_data, sizeof(header) + size);
+        fs::CloseFile(&file);
+    }
+
+    ScratchEnd(scratch);
+
+    // Don't retry every frame if the file can't be written, the next attempt happens after the save interval
+    cache->LastSaveTime = Platform::GetAbsoluteTime();
+    if (!written)
+    {
+        KWARN("[VulkanSavePipelineCache]: Failed to write '%s'", cache->Path);
+        return false;
+    }
+
+    cache->CreatedSinceSave.fetch_sub(created, std::memory_order_relaxed);
+    KDEBUG("[VulkanSavePipelineCache]: Saved %llu bytes to '%s'", (u64)size, cache->Path);
+
+    return true;
+}
+
+void VulkanDestroyPipelineCache(VulkanContext* context)
+{
+    VulkanPipelineCache* cache = &context->PipelineCache;
+    if (cache->Handle)
+    {
+        vkDestroyPipelineCache(context->LogicalDevice.Handle, cache->Handle, context->AllocationCallbacks);
+        cache->Handle = VK_NULL_HANDLE;
+    }
+}
+
+void VulkanRecordPipelineCreation(VulkanContext* context, const VkPipelineCreationFeedback* feedback, f64 duration)
+{
+    VulkanPipelineCache* cache = &context->PipelineCache;
+    u64                  duration_ns = (u64)(duration * 1000000000.0);
+
+    // Without valid feedback there is no telling, assume the pipeline was compiled
+    const VkPipelineCreationFeedbackFlags hit_flags = VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT | VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT;
+    if (feedback && (feedback->flags & hit_flags) == hit_flags)
+    {
+        cache->Stats.HitCount.fetch_add(1, std::memory_order_relaxed);
+        cache->Stats.HitTimeNS.fetch_add(duration_ns, std::memory_order_relaxed);
+    }
+    else
+    {
+        cache->Stats.MissCount.fetch_add(1, std::memory_order_relaxed);
+        cache->Stats.MissTimeNS.fetch_add(duration_ns, std::memory_order_relaxed);
+        cache->CreatedSinceSave.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void VulkanUpdatePipelineCache(VulkanContext* context)
+{
+    // Startup ends with the first frame that has no pipelines left to create
+    VulkanPipelineCache* cache = &context->PipelineCache;
+    if (!cache->StartupReported && cache->PendingCount.load(std::memory_order_relaxed) == 0)
+    {
+        VulkanLogPipelineCacheStats(context, "Startup");
+        cache->StartupReported = true;
+    }
+
+    if (cache->CreatedSinceSave > 0 && Platform::GetAbsoluteTime() - cache->LastSaveTime >= KRAFT_VULKAN_PIPELINE_CACHE_SAVE_INTERVAL)
+    {
+        VulkanSavePipelineCache(context);
+    }
+}
+
+void VulkanLogPipelineCacheStats(VulkanContext* context, const char* label)
+{
+    const VulkanPipelineCacheStats& stats = context->PipelineCache.Stats;
+    u32                             hit_count = stats.HitCount.load(std::memory_order_relaxed);
+    u32                             miss_count = stats.MissCount.load(std::memory_order_relaxed);
+    f64                             hit_time = stats.HitTimeNS.load(std::memory_order_relaxed) / 1000000000.0;
+    f64                             miss_time = stats.MissTimeNS.load(std::memory_order_relaxed) / 1000000000.0;
+    f64                             hit_average = hit_count ? hit_time / hit_count : 0.0;
+    f64                             miss_average = miss_count ? miss_time / miss_count : 0.0;
+
+    KINFO(
+        "[VulkanPipelineCache]: %s: %d pipelines from the cache in %.2f ms (%.3f ms each), %d compiled in %.2f ms (%.3f ms each), %llu bytes loaded from disk",
+        label,
+        hit_count,
+        hit_time * 1000.0,
+        hit_average * 1000.0,
+        miss_count,
+        miss_time * 1000.0,
+        miss_average * 1000.0,
+        context->PipelineCache.LoadedSize
+    );
+}
+
+} // namespace kraft::r
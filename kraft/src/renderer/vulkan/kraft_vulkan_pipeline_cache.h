@@ -0,0 +1,28 @@
+#pragma once
+
+#include <core/kraft_core.h>
+
+namespace kraft::r {
+
+struct VulkanContext;
+
+// Creates the pipeline cache every pipeline is created against, seeded with the cache saved at `path` by a previous run.
+// The saved cache is only used if it was written by the same device and driver and isn't corrupted, otherwise the cache
+// starts out empty. Pass nullptr as the `path` to keep the cache in memory only.
+void VulkanCreatePipelineCache(VulkanContext* context, const char* path);
+
+// Writes the cache back to disk, unless no pipeline had to be compiled since it was last loaded or saved and `force`
+// isn't set. Returns false if the cache couldn't be written.
+bool VulkanSavePipelineCache(VulkanContext* context, bool force = false);
+void VulkanDestroyPipelineCache(VulkanContext* context);
+
+// Accounts a pipeline created against the cache. `feedback` is the creation feedback the driver filled in, `duration` the
+// time in seconds the create call took.
+void VulkanRecordPipelineCreation(VulkanContext* context, const VkPipelineCreationFeedback* feedback, f64 duration);
+
+// Called once per frame; reports the pipelines created during startup once none are left pending and saves new pipelines
+// every KRAFT_VULKAN_PIPELINE_CACHE_SAVE_INTERVAL seconds
+void VulkanUpdatePipelineCache(VulkanContext* context);
+void VulkanLogPipelineCacheStats(VulkanContext* context, const char* label);
+
+} // namespace kraft::r
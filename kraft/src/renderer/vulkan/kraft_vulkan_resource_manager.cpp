@@ -4,40 +4,6 @@
 
 namespace kraft::r {
 
-static i32 FindMemoryIndex(VulkanPhysicalDevice device, u32 type_filter, u32 property_flags) {
-    for (u32 i = 0; i < device.MemoryProperties.memoryTypeCount; ++i) {
-        VkMemoryType type = device.MemoryProperties.memoryTypes[i];
-        if (type_filter & (1 << i) && (type.propertyFlags & property_flags) == property_flags) {
-            return i;
-        }
-    }
-
-    return -1;
-}
-
-static bool VulkanAllocateMemory(VulkanContext* context, VkDeviceSize size, i32 type_filter, VkMemoryPropertyFlags property_flags, VkMemoryAllocateFlags allocate_flags, VkDeviceMemory* out) {
-    i32 memory_type_index = FindMemoryIndex(context->PhysicalDevice, type_filter, property_flags);
-    if (memory_type_index == -1) {
-        KERROR("[VulkanAllocateMemory]: Failed to find suitable memoryType");
-        return false;
-    }
-
-    VkMemoryAllocateInfo info = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
-    info.allocationSize = size;
-    info.memoryTypeIndex = memory_type_index;
-
-    if (allocate_flags) {
-        VkMemoryAllocateFlagsInfo flags_info = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO};
-        flags_info.flags = allocate_flags;
-        info.pNext = &flags_info;
-    }
-
-    VkResult result = vkAllocateMemory(context->LogicalDevice.Handle, &info, context->AllocationCallbacks, out);
-    KRAFT_VK_CHECK(result);
-
-    return true;
-}
-
 void VulkanTempMemoryBlockAllocator::Initialize(ArenaAllocator* arena, u64 block_size) {
     this->block_size = block_size;
 }
@@ -105,28 +71,14 @@ BufferView VulkanTempMemoryBlockAllocator::AllocateGPUMemory(ArenaAllocator* are
     };
 }
 
-static VkImageAspectFlags GetImageAspectMask(Format::Enum type) {
-    if (type == Format::RGB8_UNORM || type == Format::RGBA8_UNORM || type == Format::BGRA8_UNORM || type == Format::BGR8_UNORM || type == Format::R32_SFLOAT) {
-        return VK_IMAGE_ASPECT_COLOR_BIT;
-    }
-
-    if (type == Format::D16_UNORM || type == Format::D32_SFLOAT) {
-        return VK_IMAGE_ASPECT_DEPTH_BIT;
-    }
-
-    if (type >= Format::D16_UNORM_S8_UINT) {
-        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
-    }
-
-    return VK_IMAGE_ASPECT_COLOR_BIT;
-}
-
 static VulkanResourceManagerState* state = nullptr;
 
 static void Clear() {
     VulkanContext* context = VulkanRendererBackend::Context();
     VkDevice device = context->LogicalDevice.Handle;
 
+    VulkanMemoryPrintStats(context);
+
     // We don't have to check if the handle to any resource is invalid here in any of the cleanup code
     // because vk___ functions don't do anything if the passed handle is "NULL"
 
@@ -148,10 +100,7 @@ static void Clear() {
             texture.View = 0;
         }
 
-        if (texture.Memory) {
-            vkFreeMemory(device, texture.Memory, context->AllocationCallbacks);
-            texture.Memory = 0;
-        }
+        VulkanMemoryFree(context, &texture.Allocation);
 
         if (texture.Image) {
             vkDestroyImage(device, texture.Image, context->AllocationCallbacks);
@@ -168,10 +117,9 @@ static void Clear() {
 
     for (int i = 0; i < state->buffer_pool.GetCapacity(); i++) {
         VulkanBuffer& buffer = state->buffer_pool.data[i];
-        vkFreeMemory(device, buffer.Memory, context->AllocationCallbacks);
         vkDestroyBuffer(device, buffer.Handle, context->AllocationCallbacks);
+        VulkanMemoryFree(context, &buffer.Allocation);
 
-        buffer.Memory = 0;
         buffer.Handle = 0;
     }
 
@@ -192,6 +140,21 @@ static void Clear() {
         vkDestroyCommandPool(device, cmd_pool.Resource, context->AllocationCallbacks);
         cmd_pool.Resource = 0;
     }
+
+    // Every resource has been released by now, whatever is left are the empty blocks
+    VulkanMemoryShutdown(context);
+
+    // The staging buffers and the command buffers were released along with the pools above
+    if (state->upload_frames_initialized) {
+        for (int i = 0; i < KRAFT_VULKAN_UPLOAD_FRAME_COUNT; i++) {
+            VulkanUploadFrame* frame = &state->upload_frames[i];
+            VulkanDestroyFence(context, &frame->fence);
+            vkDestroySemaphore(device, frame->semaphore, context->AllocationCallbacks);
+            *frame = {};
+        }
+
+        state->upload_frames_initialized = false;
+    }
 }
 
 static Handle<Texture> CreateTexture(const TextureDescription& description) {
@@ -246,15 +209,32 @@ static Handle<Texture> CreateTexture(const TextureDescription& description) {
 
     KRAFT_RENDERER_SET_OBJECT_NAME(output.Image, VK_OBJECT_TYPE_IMAGE, description.DebugName);
 
-    VkMemoryRequirements memory_requirements = {};
-    vkGetImageMemoryRequirements(device, output.Image, &memory_requirements);
-    if (!VulkanAllocateMemory(context, memory_requirements.size, memory_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, &output.Memory)) {
+    VkImageMemoryRequirementsInfo2 requirements_info = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2};
+    requirements_info.image = output.Image;
+
+    VkMemoryDedicatedRequirements dedicated_requirements = {VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS};
+    VkMemoryRequirements2 memory_requirements = {VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2};
+    memory_requirements.pNext = &dedicated_requirements;
+    vkGetImageMemoryRequirements2(device, &requirements_info, &memory_requirements);
+
+    // Render targets get resized and recreated as a whole, so they get their own memory instead of punching holes in the blocks
+    bool is_render_target = description.Usage & (TEXTURE_USAGE_FLAGS_COLOR_ATTACHMENT | TEXTURE_USAGE_FLAGS_DEPTH_STENCIL_ATTACHMENT);
+    VulkanAllocationDescription allocation_description = {
+        .Requirements = memory_requirements.memoryRequirements,
+        .PropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        .AllocateFlags = 0,
+        .Kind = description.Tiling == TextureTiling::Optimal ? VULKAN_MEMORY_RESOURCE_KIND_OPTIMAL : VULKAN_MEMORY_RESOURCE_KIND_LINEAR,
+        .Dedicated = is_render_target || dedicated_requirements.prefersDedicatedAllocation || dedicated_requirements.requiresDedicatedAllocation,
+        .DedicatedImage = output.Image,
+        .DebugName = description.DebugName,
+    };
+
+    if (!VulkanMemoryAllocate(context, allocation_description, &output.Allocation)) {
+        vkDestroyImage(device, output.Image, context->AllocationCallbacks);
         return Handle<Texture>::Invalid();
     }
 
-    KRAFT_RENDERER_SET_OBJECT_NAME(output.Memory, VK_OBJECT_TYPE_DEVICE_MEMORY, description.DebugName);
-
-    KRAFT_VK_CHECK(vkBindImageMemory(device, output.Image, output.Memory, 0));
+    KRAFT_VK_CHECK(vkBindImageMemory(device, output.Image, output.Allocation.Memory, output.Allocation.Offset));
 
     // Now create the image view
     VkImageViewCreateInfo view_create_info = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
@@ -349,15 +329,31 @@ static Handle<Buffer> CreateBuffer(const BufferDescription& description) {
     KRAFT_VK_CHECK(vkCreateBuffer(device, &create_info, context->AllocationCallbacks, &output.Handle));
     KRAFT_RENDERER_SET_OBJECT_NAME(output.Handle, VK_OBJECT_TYPE_BUFFER, description.DebugName);
 
-    VkMemoryRequirements memory_requirements;
-    vkGetBufferMemoryRequirements(device, output.Handle, &memory_requirements);
+    VkBufferMemoryRequirementsInfo2 requirements_info = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2};
+    requirements_info.buffer = output.Handle;
+
+    VkMemoryDedicatedRequirements dedicated_requirements = {VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS};
+    VkMemoryRequirements2 memory_requirements = {VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2};
+    memory_requirements.pNext = &dedicated_requirements;
+    vkGetBufferMemoryRequirements2(device, &requirements_info, &memory_requirements);
+
+    VulkanAllocationDescription allocation_description = {
+        .Requirements = memory_requirements.memoryRequirements,
+        .PropertyFlags = memory_properties,
+        .AllocateFlags = allocate_flags,
+        .Kind = VULKAN_MEMORY_RESOURCE_KIND_LINEAR,
+        .Dedicated = dedicated_requirements.prefersDedicatedAllocation || dedicated_requirements.requiresDedicatedAllocation,
+        .DedicatedBuffer = output.Handle,
+        .DebugName = description.DebugName,
+    };
 
-    if (!VulkanAllocateMemory(context, memory_requirements.size, memory_requirements.memoryTypeBits, memory_properties, allocate_flags, &output.Memory)) {
+    if (!VulkanMemoryAllocate(context, allocation_description, &output.Allocation)) {
+        vkDestroyBuffer(device, output.Handle, context->AllocationCallbacks);
         return Handle<Buffer>::Invalid();
     }
 
     if (description.BindMemory) {
-        KRAFT_VK_CHECK(vkBindBufferMemory(device, output.Handle, output.Memory, 0));
+        KRAFT_VK_CHECK(vkBindBufferMemory(device, output.Handle, output.Allocation.Memory, output.Allocation.Offset));
     }
 
     // Get the device address if this buffer is to be used as a raw pointer in shaders
@@ -369,7 +365,7 @@ static Handle<Buffer> CreateBuffer(const BufferDescription& description) {
 
     void* ptr = nullptr;
     if (description.MapMemory) {
-        vkMapMemory(device, output.Memory, 0, VK_WHOLE_SIZE, 0, &ptr);
+        ptr = VulkanMemoryMap(context, &output.Allocation);
     }
 
     return state->buffer_pool.Insert({.Size = actual_size, .Ptr = ptr}, output);
@@ -596,14 +592,100 @@ static u8* GetBufferData(Handle<Buffer> handle) {
 
     // Map the buffer first if it not mapped yet
     if (!buffer->Ptr) {
-        KRAFT_VK_CHECK(vkMapMemory(device, gpu_buffer->Memory, 0, VK_WHOLE_SIZE, 0, &buffer->Ptr));
+        buffer->Ptr = VulkanMemoryMap(context, &gpu_buffer->Allocation);
     }
 
     return (u8*)buffer->Ptr;
 }
 
+static void InitializeUploadFrames() {
+    VulkanContext* context = VulkanRendererBackend::Context();
+    VkDevice device = context->LogicalDevice.Handle;
+
+    for (int i = 0; i < KRAFT_VULKAN_UPLOAD_FRAME_COUNT; i++) {
+        VulkanUploadFrame* frame = &state->upload_frames[i];
+        frame->cmd_buffer = CreateCommandBuffer({
+            .DebugName = "UploadCmdBuffer",
+            .CommandPool = context->GraphicsCommandPool,
+            .Primary = true,
+        });
+
+        VulkanCreateFence(context, true, &frame->fence);
+
+        VkSemaphoreCreateInfo create_info = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        KRAFT_VK_CHECK(vkCreateSemaphore(device, &create_info, context->AllocationCallbacks, &frame->semaphore));
+
+        frame->temp_allocator.Initialize(state->arena, KRAFT_SIZE_MB(128));
+    }
+
+    state->upload_frame_index = 0;
+    state->upload_frames_initialized = true;
+}
+
+// Returns the current upload frame, waiting for the GPU to finish with its previous submission
+// the first time it is touched so the staging memory can be reused
+static VulkanUploadFrame* GetUploadFrame() {
+    if (!state->upload_frames_initialized) {
+        InitializeUploadFrames();
+    }
+
+    VulkanUploadFrame* frame = &state->upload_frames[state->upload_frame_index];
+    if (!frame->open) {
+        VulkanContext* context = VulkanRendererBackend::Context();
+        if (!VulkanWaitForFence(context, &frame->fence, UINT64_MAX)) {
+            KERROR("[GetUploadFrame]: VulkanWaitForFence failed");
+        }
+
+        frame->temp_allocator.Clear();
+        frame->open = true;
+    }
+
+    return frame;
+}
+
+static VulkanCommandBuffer* GetUploadCommandBuffer() {
+    VulkanUploadFrame* frame = GetUploadFrame();
+    VulkanCommandBuffer* gpu_cmd_buffer = state->cmd_buffer_pool.Get(frame->cmd_buffer);
+
+    if (!frame->recording) {
+        VulkanResetCommandBuffer(gpu_cmd_buffer);
+        VulkanBeginCommandBuffer(gpu_cmd_buffer, true, false, false);
+
+        // The previous frame may still be reading from the resources we are about to write to,
+        // so the copies must not start before everything submitted earlier has finished
+        vkCmdPipelineBarrier(gpu_cmd_buffer->Resource, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+        frame->recording = true;
+    }
+
+    return gpu_cmd_buffer;
+}
+
+static void SubmitUploadFrame(VulkanUploadFrame* frame, VkSemaphore signal_semaphore) {
+    VulkanContext* context = VulkanRendererBackend::Context();
+    VulkanCommandBuffer* gpu_cmd_buffer = state->cmd_buffer_pool.Get(frame->cmd_buffer);
+    VulkanEndCommandBuffer(gpu_cmd_buffer);
+
+    VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &gpu_cmd_buffer->Resource;
+    submit_info.signalSemaphoreCount = signal_semaphore ? 1 : 0;
+    submit_info.pSignalSemaphores = &signal_semaphore;
+
+    VulkanResetFence(context, &frame->fence);
+    KRAFT_VK_CHECK(vkQueueSubmit(context->LogicalDevice.GraphicsQueue, 1, &submit_info, frame->fence.Handle));
+
+    VulkanSetCommandBufferSubmitted(gpu_cmd_buffer);
+    frame->recording = false;
+}
+
 static BufferView CreateTempBuffer(u64 size) {
-    return state->temp_gpu_allocator->Allocate(state->arena, size, 128);
+    VulkanUploadFrame* frame = GetUploadFrame();
+    return frame->temp_allocator.Allocate(state->arena, size, 128);
+}
+
+static void FlushUploads() {
+    VulkanResourceManagerApi::FlushUploads();
 }
 
 static bool UploadTexture(Handle<Texture> texture, Handle<Buffer> buffer, u64 buffer_offset) {
@@ -617,21 +699,14 @@ static bool UploadTexture(Handle<Texture> texture, Handle<Buffer> buffer, u64 bu
     VulkanBuffer* gpu_buffer = state->buffer_pool.Get(buffer);
     KASSERT(gpu_buffer);
 
-    // Allocate a single use command buffer
-    Handle<CommandBuffer> temp_cmd_buffer = CreateCommandBuffer({
-        .CommandPool = context->GraphicsCommandPool,
-        .Primary = true,
-        .Begin = true,
-        .SingleUse = true,
-    });
-
-    VulkanCommandBuffer* gpu_temp_cmd_buffer = state->cmd_buffer_pool.Get(temp_cmd_buffer);
+    // The copy is batched with the rest of this frame's uploads
+    VulkanCommandBuffer* gpu_cmd_buffer = GetUploadCommandBuffer();
 
     // Default image layout is undefined, so make it transfer dst optimal
     // This will change the image layout to VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-    VulkanTransitionImageLayout(context, gpu_temp_cmd_buffer, gpu_texture->Image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    VulkanTransitionImageLayout(context, gpu_cmd_buffer, gpu_texture->Image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
-    // Copy the image pixels from the staging buffer to the image using the temp command buffer
+    // Copy the image pixels from the staging buffer to the image using the upload command buffer
     VkBufferImageCopy region = {};
     region.bufferOffset = buffer_offset;
     region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -643,15 +718,51 @@ static bool UploadTexture(Handle<Texture> texture, Handle<Buffer> buffer, u64 bu
     region.imageExtent.height = (u32)metadata->Height;
     region.imageExtent.depth = 1;
 
-    vkCmdCopyBufferToImage(gpu_temp_cmd_buffer->Resource, gpu_buffer->Handle, gpu_texture->Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    vkCmdCopyBufferToImage(gpu_cmd_buffer->Resource, gpu_buffer->Handle, gpu_texture->Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 
     // Transition the layout from VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL -> VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
     // so the image turns into a suitable format for the shader to read
-    VulkanTransitionImageLayout(context, gpu_temp_cmd_buffer, gpu_texture->Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    VulkanTransitionImageLayout(context, gpu_cmd_buffer, gpu_texture->Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    return true;
+}
+
+static bool UploadTextureRegion(Handle<Texture> texture, Handle<Buffer> buffer, u64 buffer_offset, u32 x, u32 y, u32 width, u32 height) {
+    VulkanContext* context = VulkanRendererBackend::Context();
+    Texture* metadata = state->texture_pool.GetAuxiliaryData(texture);
+    KASSERT(metadata);
+
+    if (x + width > (u32)metadata->Width || y + height > (u32)metadata->Height) {
+        KERROR("[UploadTextureRegion]: Region (%d, %d, %d, %d) is out of bounds", x, y, width, height);
+        return false;
+    }
+
+    VulkanTexture* gpu_texture = state->texture_pool.Get(texture);
+    KASSERT(gpu_texture);
+
+    VulkanBuffer* gpu_buffer = state->buffer_pool.Get(buffer);
+    KASSERT(gpu_buffer);
+
+    VulkanCommandBuffer* gpu_cmd_buffer = GetUploadCommandBuffer();
+
+    // Unlike UploadTexture, the texture is already in use so its contents have to survive the transition
+    VulkanTransitionImageLayout(context, gpu_cmd_buffer, gpu_texture->Image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+    VkBufferImageCopy region = {};
+    region.bufferOffset = buffer_offset;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageSubresource.mipLevel = 0;
+
+    region.imageOffset.x = (i32)x;
+    region.imageOffset.y = (i32)y;
+    region.imageExtent.width = width;
+    region.imageExtent.height = height;
+    region.imageExtent.depth = 1;
 
-    // End our temp command buffer
-    VulkanEndAndSubmitSingleUseCommandBuffer(context, gpu_temp_cmd_buffer->Pool, gpu_temp_cmd_buffer, context->LogicalDevice.GraphicsQueue);
-    DestroyCommandBuffer(temp_cmd_buffer);
+    vkCmdCopyBufferToImage(gpu_cmd_buffer->Resource, gpu_buffer->Handle, gpu_texture->Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    VulkanTransitionImageLayout(context, gpu_cmd_buffer, gpu_texture->Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
     return true;
 }
@@ -667,26 +778,15 @@ static bool UploadBuffer(const UploadBufferDescription& description) {
         return false;
     }
 
-    VulkanContext* context = VulkanRendererBackend::Context();
-
-    // Allocate a single use command buffer
-    Handle<CommandBuffer> temp_cmd_buf = CreateCommandBuffer({
-        .CommandPool = context->GraphicsCommandPool,
-        .Primary = true,
-        .Begin = true,
-        .SingleUse = true,
-    });
-
-    VulkanCommandBuffer* gpu_temp_cmd_buf = state->cmd_buffer_pool.Get(temp_cmd_buf);
+    // The copy is batched with the rest of this frame's uploads
+    VulkanCommandBuffer* gpu_cmd_buffer = GetUploadCommandBuffer();
 
     VkBufferCopy buffer_copy_info = {};
     buffer_copy_info.size = description.SrcSize;
     buffer_copy_info.srcOffset = description.SrcOffset;
     buffer_copy_info.dstOffset = description.DstOffset;
 
-    vkCmdCopyBuffer(gpu_temp_cmd_buf->Resource, src->Handle, dst->Handle, 1, &buffer_copy_info);
-    VulkanEndAndSubmitSingleUseCommandBuffer(context, gpu_temp_cmd_buf->Pool, gpu_temp_cmd_buf, context->LogicalDevice.GraphicsQueue);
-    DestroyCommandBuffer(temp_cmd_buf);
+    vkCmdCopyBuffer(gpu_cmd_buffer->Resource, src->Handle, dst->Handle, 1, &buffer_copy_info);
 
     return true;
 }
@@ -695,6 +795,9 @@ static bool ReadTextureData(const ReadTextureDataDescription& description) {
     KASSERT(description.SrcTexture.IsInvalid() == false);
     KASSERT(description.OutBuffer);
 
+    // The texture may have uploads that haven't been submitted yet
+    FlushUploads();
+
     Texture* metadata = state->texture_pool.GetAuxiliaryData(description.SrcTexture);
     u32 width_to_read = description.Width == 0 ? (u32)metadata->Width : (u32)description.Width;
     u32 height_to_read = description.Height == 0 ? (u32)metadata->Height : (u32)description.Height;
@@ -799,10 +902,7 @@ static void EndFrame(u64 frame_number) {
             resource->View = 0;
         }
 
-        if (resource->Memory) {
-            vkFreeMemory(device, resource->Memory, context->AllocationCallbacks);
-            resource->Memory = 0;
-        }
+        VulkanMemoryFree(context, &resource->Allocation);
 
         if (resource->Image) {
             vkDestroyImage(device, resource->Image, context->AllocationCallbacks);
@@ -821,10 +921,9 @@ static void EndFrame(u64 frame_number) {
         VulkanContext* context = VulkanRendererBackend::Context();
         VkDevice device = context->LogicalDevice.Handle;
 
-        vkFreeMemory(device, resource->Memory, context->AllocationCallbacks);
         vkDestroyBuffer(device, resource->Handle, context->AllocationCallbacks);
+        VulkanMemoryFree(context, &resource->Allocation);
 
-        resource->Memory = 0;
         resource->Handle = 0;
     });
 
@@ -845,8 +944,6 @@ static void EndFrame(u64 frame_number) {
         vkDestroyCommandPool(device, resource->Resource, context->AllocationCallbacks);
         resource->Resource = 0;
     });
-
-    state->temp_gpu_allocator->Clear();
 }
 
 VulkanTexture* VulkanResourceManagerApi::GetTexture(Handle<Texture> handle) {
@@ -886,17 +983,54 @@ u32 VulkanResourceManagerApi::GetActiveSamplers(VkSampler* out_samplers, u32 max
     return count;
 }
 
+VkSemaphore VulkanResourceManagerApi::SubmitUploads() {
+    if (!state->upload_frames_initialized) {
+        return VK_NULL_HANDLE;
+    }
+
+    VulkanUploadFrame* frame = &state->upload_frames[state->upload_frame_index];
+    VkSemaphore signal_semaphore = VK_NULL_HANDLE;
+    if (frame->recording) {
+        signal_semaphore = frame->semaphore;
+        SubmitUploadFrame(frame, signal_semaphore);
+    }
+
+    // Staging memory from this frame may still be in use, so the next frame gets its own
+    if (frame->open) {
+        frame->open = false;
+        state->upload_frame_index = (state->upload_frame_index + 1) % KRAFT_VULKAN_UPLOAD_FRAME_COUNT;
+    }
+
+    return signal_semaphore;
+}
+
+void VulkanResourceManagerApi::FlushUploads() {
+    if (!state->upload_frames_initialized) {
+        return;
+    }
+
+    VulkanUploadFrame* frame = &state->upload_frames[state->upload_frame_index];
+    if (!frame->recording) {
+        return;
+    }
+
+    // The frame stays open, callers may still be holding on to staging memory they haven't uploaded yet
+    SubmitUploadFrame(frame, VK_NULL_HANDLE);
+    if (!VulkanWaitForFence(VulkanRendererBackend::Context(), &frame->fence, UINT64_MAX)) {
+        KERROR("[VulkanResourceManagerApi::FlushUploads]: VulkanWaitForFence failed");
+    }
+}
+
 struct ResourceManager* CreateVulkanResourceManager(ArenaAllocator* arena) {
     state = ArenaPush(arena, VulkanResourceManagerState);
     state->arena = arena;
+    VulkanMemoryInit(arena);
     state->texture_pool.Grow(KRAFT_RENDERER__MAX_GLOBAL_TEXTURES);
     state->texture_sampler_pool.Grow(4);
     state->buffer_pool.Grow(1024);
     state->render_pass_pool.Grow(16);
     state->cmd_buffer_pool.Grow(16);
     state->cmd_pool_pool.Grow(1);
-    state->temp_gpu_allocator = ArenaPush(arena, VulkanTempMemoryBlockAllocator);
-    state->temp_gpu_allocator->Initialize(arena, KRAFT_SIZE_MB(128));
 
     struct ResourceManager* api = ArenaPush(arena, struct ResourceManager);
     api->Clear = Clear;
@@ -915,7 +1049,9 @@ struct ResourceManager* CreateVulkanResourceManager(ArenaAllocator* arena) {
     api->GetBufferData = GetBufferData;
     api->CreateTempBuffer = CreateTempBuffer;
     api->UploadTexture = UploadTexture;
+    api->UploadTextureRegion = UploadTextureRegion;
     api->UploadBuffer = UploadBuffer;
+    api->FlushUploads = FlushUploads;
     api->ReadTextureData = ReadTextureData;
     api->GetTextureMetadata = GetTextureMetadata;
     api->GetRenderPassMetadata = GetRenderPassMetadata;
@@ -43,6 +43,22 @@ struct VulkanTempMemoryBlockAllocator
     BufferView AllocateGPUMemory(ArenaAllocator* arena);
 };
 
+// Number of upload batches that can be in flight on the GPU at the same time
+#define KRAFT_VULKAN_UPLOAD_FRAME_COUNT 3
+
+// All the uploads issued during a frame are recorded into a single command buffer that gets
+// submitted once, right before the frame's graphics work. The staging memory handed out during
+// the frame is only reclaimed once the fence for that submission has signalled.
+struct VulkanUploadFrame
+{
+    Handle<CommandBuffer>          cmd_buffer;
+    VulkanFence                    fence;
+    VkSemaphore                    semaphore;      // Signalled when the uploads are done, the graphics submission waits on it
+    VulkanTempMemoryBlockAllocator temp_allocator; // Staging memory for this frame
+    bool                           open = false;      // The GPU is done with this frame's previous submission
+    bool                           recording = false; // There are commands that haven't been submitted yet
+};
+
 struct VulkanResourceManagerState
 {
     ArenaAllocator*                            arena;
@@ -52,7 +68,9 @@ struct VulkanResourceManagerState
     Pool<VulkanRenderPass, RenderPass>         render_pass_pool;
     Pool<VulkanCommandBuffer, CommandBuffer>   cmd_buffer_pool;
     Pool<VulkanCommandPool, CommandPool>       cmd_pool_pool;
-    VulkanTempMemoryBlockAllocator*            temp_gpu_allocator = nullptr;
+    VulkanUploadFrame                          upload_frames[KRAFT_VULKAN_UPLOAD_FRAME_COUNT];
+    u32                                        upload_frame_index = 0;
+    bool                                       upload_frames_initialized = false;
 };
 
 struct VulkanResourceManagerApi
@@ -66,6 +84,14 @@ struct VulkanResourceManagerApi
 
     // Returns the number of active samplers and fills out_samplers with their VkSampler handles
     static u32 GetActiveSamplers(VkSampler* out_samplers, u32 max_count);
+
+    // Submits the uploads recorded during this frame and moves on to the next upload frame.
+    // Returns the semaphore that the frame's graphics submission must wait on, or VK_NULL_HANDLE
+    // if nothing was recorded.
+    static VkSemaphore SubmitUploads();
+
+    // Submits the uploads recorded so far and blocks until the GPU is done with them
+    static void FlushUploads();
 };
 
 struct ResourceManager* CreateVulkanResourceManager(ArenaAllocator* arena);
@@ -2,6 +2,8 @@
 
 #include <volk/volk.h>
 
+#include <atomic>
+
 #ifndef KRAFT_ENABLE_VK_DYNAMIC_RENDERING
 #define KRAFT_ENABLE_VK_DYNAMIC_RENDERING 1
 #endif
@@ -22,6 +24,12 @@
 // So the max samplers allowed are 2^4
 #define KRAFT_VULKAN_MAX_SAMPLERS_ALLOWED 16
 
+// Secondary command buffers a single thread can record in one frame, across all the surfaces recorded in parallel
+#define KRAFT_VULKAN_MAX_SECONDARY_COMMAND_BUFFERS_PER_THREAD 256
+
+// New pipelines are written back to the on-disk pipeline cache at most this often, in seconds
+#define KRAFT_VULKAN_PIPELINE_CACHE_SAVE_INTERVAL 30.0
+
 #ifdef KRAFT_RENDERER_DEBUG
 #define KRAFT_RENDERER_SET_OBJECT_NAME(object, type, name) kraft::r::VulkanRendererBackend::Context()->SetObjectName((u64)object, type, name)
 #else
@@ -50,14 +58,30 @@ struct VulkanMaterialData {
 // Resources
 //
 
+struct VulkanMemoryBlock;
+struct VulkanMemoryRegion;
+
+// A range of device memory handed out by the memory allocator (see kraft_vulkan_memory.h).
+// Most resources live inside a larger VkDeviceMemory block at `Offset`; dedicated allocations
+// own the whole VkDeviceMemory and have no block.
+struct VulkanAllocation {
+    VkDeviceMemory Memory = 0;
+    u64 Offset = 0;
+    u64 Size = 0;
+    i32 MemoryTypeIndex = -1;
+    VulkanMemoryBlock* Block = nullptr;
+    VulkanMemoryRegion* Region = nullptr;
+    void* MappedPtr = nullptr; // Only used by dedicated allocations, blocks are mapped as a whole
+};
+
 struct VulkanTexture {
     u32 Width;
     u32 Height;
     VkImage Image;
     VkImageView View;
-    VkDeviceMemory Memory;
+    VulkanAllocation Allocation;
 
-    VulkanTexture() : Width(0), Height(0), Image(0), View(0), Memory(0) {}
+    VulkanTexture() : Width(0), Height(0), Image(0), View(0), Allocation() {}
 };
 
 struct VulkanTextureSampler {
@@ -67,7 +91,7 @@ struct VulkanTextureSampler {
 struct VulkanBuffer {
     VkBuffer Handle;
     u64 Size;
-    VkDeviceMemory Memory;
+    VulkanAllocation Allocation;
     VkBufferUsageFlags UsageFlags;
     bool IsLocked;
     i32 MemoryIndex;
@@ -120,6 +144,32 @@ struct VulkanCommandPool {
     VkCommandPool Resource;
 };
 
+// Command pool owned by one recording thread for one frame in flight. Its buffers are allocated on first use and the
+// whole pool is reset once the frame's fence has signaled, so no other thread ever touches it.
+struct VulkanSecondaryCommandPool {
+    VkCommandPool Resource;
+    u32 AllocatedCount;
+    u32 UsedCount;
+    VulkanCommandBuffer Buffers[KRAFT_VULKAN_MAX_SECONDARY_COMMAND_BUFFERS_PER_THREAD];
+};
+
+// Per thread recording state. Commands go to the context's ActiveCommandBuffer unless the thread is recording a
+// secondary command buffer.
+struct VulkanRecordingState {
+    VulkanCommandBuffer* Secondary;
+    u32 SecondarySlot;
+
+    // Bind point of the last pipeline bound with UseShader; descriptors are bound to the same one
+    VkPipelineBindPoint ActiveBindPoint;
+    VkBuffer IndexBuffer;
+
+    // Last index buffer bound with vkCmdBindIndexBuffer; every geometry lives in the same index buffer,
+    // so draws only have to rebind it when the index type changes. Reset whenever a pipeline is bound.
+    VkCommandBuffer BoundIndexCommandBuffer;
+    VkBuffer BoundIndexBuffer;
+    VkIndexType BoundIndexType;
+};
+
 enum VulkanRenderPassState {
     VULKAN_RENDER_PASS_STATE_NOT_ALLOCATED,
     VULKAN_RENDER_PASS_STATE_READY,
@@ -200,6 +250,26 @@ struct VulkanSwapchain {
     VkSampleCountFlagBits MSAASampleCount = VK_SAMPLE_COUNT_1_BIT;
 };
 
+// Pipelines created since the backend started, split by whether the driver found them in the pipeline cache. Pipelines
+// are created on the job threads, hence the atomics.
+struct VulkanPipelineCacheStats {
+    std::atomic<u32> HitCount;
+    std::atomic<u32> MissCount;
+    std::atomic<u64> HitTimeNS; // Time spent creating the pipelines found in the cache
+    std::atomic<u64> MissTimeNS; // Time spent compiling the rest
+};
+
+struct VulkanPipelineCache {
+    VkPipelineCache Handle;
+    const char* Path; // nullptr when the cache only lives for this run
+    u64 LoadedSize;   // Bytes of cache data loaded from disk, 0 when the cache started out empty
+    std::atomic<u32> CreatedSinceSave;
+    std::atomic<u32> PendingCount; // Pipelines still being created on the job threads
+    f64 LastSaveTime;
+    bool StartupReported;
+    VulkanPipelineCacheStats Stats;
+};
+
 struct VulkanContext {
     RendererOptions* Options;
     VkInstance Instance;
@@ -216,7 +286,23 @@ struct VulkanContext {
 #endif
     Handle<CommandPool> GraphicsCommandPool;
     Handle<CommandBuffer> GraphicsCommandBuffers[3];
+    Handle<CommandBuffer> ComputeCommandBuffers[3]; // Compute passes recorded before the frame's render passes
     Handle<CommandBuffer> ActiveCommandBuffer;
+
+    // Secondary command pools, one per recording thread for every frame in flight
+    VulkanSecondaryCommandPool* SecondaryCommandPools;
+    u32 SecondaryThreadCount;
+    u32 SecondaryFrameIndex;
+
+    // Secondary command buffers of the surface being recorded in parallel, executed in slot order
+    VkCommandBuffer SecondaryCommandBuffers[KRAFT_RENDERER_MAX_SECONDARY_COMMAND_BUFFERS];
+    VkFormat ParallelSurfaceColorFormat;
+    VkFormat ParallelSurfaceDepthFormat;
+    VkSampleCountFlagBits ParallelSurfaceSamples;
+
+    // Shared by every pipeline the backend creates, persisted to RendererOptions::PipelineCachePath
+    VulkanPipelineCache PipelineCache;
+
     VulkanFence* WaitFences;
     // VkCommandPool          GraphicsCommandPool;
     // If everything was perfect, this mapping below would not be needed
@@ -238,8 +324,6 @@ struct VulkanContext {
 
     ArenaAllocator* Arena;
 
-    Handle<Buffer> IndexBuffer;
-
     // Global Data
     VkDescriptorPool GlobalDescriptorPool;
     VkDescriptorSetLayout DescriptorSetLayouts[16];
@@ -265,7 +349,7 @@ struct VulkanShader {
     VkDescriptorSet descriptor_sets[KRAFT_VULKAN_NUM_CUSTOM_DESCRIPTOR_SETS];
 
     u32 PipelineCount;
-    VkPipeline* Pipelines; // One per variant
+    VkPipeline* Pipelines; // One per variant, filled in on the job threads when created asynchronously
 };
 
 struct VulkanImageBarrierDescription {
@@ -28,6 +28,9 @@ struct Shader {
     Array<ShaderUniform> UniformCache;
     FlatHashMap<u64, u32> UniformCacheMapping;
 
+    // False while the pipelines are being created on the job threads; draws with the shader are skipped until then
+    bool Ready;
+
     void* RendererData;
 };
 
@@ -134,6 +137,7 @@ struct Material {
 struct Geometry {
     ResourceID ID;
     r::GeometryDrawData DrawData;
+    r::GeometryBounds Bounds;
 };
 
 } // namespace kraft
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include <core/kraft_allocators.h>
 #include <core/kraft_asserts.h>
+#include <core/kraft_hash.h>
 #include <core/kraft_lexer.h>
 #include <core/kraft_log.h>
 #include <core/kraft_memory.h>
@@ -12,6 +13,7 @@
 
 #include <renderer/kraft_renderer_types.h>
 #include <shaderfx/kraft_shaderfx_types.h>
+#include <shaderfx/kraft_shaderfx_binary.h>
 
 #define PARSER_ERROR_NEXT_TOKEN_READ_FAILED "Error while reading the next token %d"
 #define PARSER_ERROR_TOKEN_MISMATCH         "Token mismatch\nExpected '%S' got '%S'"
@@ -80,6 +82,9 @@ bool ShaderFXParser::GenerateAST(ArenaAllocator* arena, ShaderEffect* effect)
     effect->variant_count = 0;
     effect->variants = ArenaPushArray(arena, VariantDefinition, 16);
 
+    effect->instance_buffer_count = 0;
+    effect->instance_buffers = nullptr;
+
     while (true)
     {
         LexerToken token;
@@ -202,6 +207,9 @@ bool ShaderFXParser::ParseLayoutBlock(ArenaAllocator* arena, ShaderEffect* effec
     u32                      storage_buffer_count = 0;
     UniformBufferDefinition* storage_buffers = ArenaPushArray(scratch.arena, UniformBufferDefinition, 16);
 
+    u32                      instance_buffer_count = 0;
+    UniformBufferDefinition* instance_buffers = ArenaPushArray(scratch.arena, UniformBufferDefinition, 16);
+
     while (!this->Lexer->EqualsToken(&token, TokenType::TOKEN_TYPE_CLOSE_BRACE))
     {
         if (token.type != TokenType::TOKEN_TYPE_IDENTIFIER)
@@ -325,6 +333,25 @@ bool ShaderFXParser::ParseLayoutBlock(ArenaAllocator* arena, ShaderEffect* effec
 
             storage_buffer_count++;
         }
+        else if (token.MatchesKeyword(String8Raw("InstanceBuffer")))
+        {
+            // Consume "InstanceBuffer"
+            if (LexerError ErrorCode = this->Lexer->NextToken(&token))
+            {
+                this->SetError(arena, PARSER_ERROR_NEXT_TOKEN_READ_FAILED, ErrorCode);
+                return false;
+            }
+
+            UniformBufferDefinition* buffer_def = &instance_buffers[instance_buffer_count];
+            buffer_def->name = ArenaPushString8Copy(arena, token.text);
+
+            if (!this->ParseUniformBuffer(arena, buffer_def))
+            {
+                return false;
+            }
+
+            instance_buffer_count++;
+        }
     }
 
     effect->vertex_layout_count = vertex_layout_count;
@@ -351,6 +378,10 @@ bool ShaderFXParser::ParseLayoutBlock(ArenaAllocator* arena, ShaderEffect* effec
     effect->storage_buffers = ArenaPushArray(arena, UniformBufferDefinition, storage_buffer_count);
     MemCpy(effect->storage_buffers, storage_buffers, sizeof(UniformBufferDefinition) * storage_buffer_count);
 
+    effect->instance_buffer_count = instance_buffer_count;
+    effect->instance_buffers = ArenaPushArray(arena, UniformBufferDefinition, instance_buffer_count);
+    MemCpy(effect->instance_buffers, instance_buffers, sizeof(UniformBufferDefinition) * instance_buffer_count);
+
     ScratchEnd(scratch);
 
     return true;
@@ -390,6 +421,10 @@ bool ShaderFXParser::ParseResourceBindings(ArenaAllocator* arena, ResourceBindin
         {
             binding->type = r::ResourceType::Sampler;
         }
+        else if (token.MatchesKeyword(String8Raw("StorageImage")))
+        {
+            binding->type = r::ResourceType::StorageImage;
+        }
         else
         {
             this->SetError(arena, "Invalid binding type '%S'", token.text);
@@ -657,6 +692,13 @@ bool ShaderFXParser::ParseDataType(ArenaAllocator* arena, const LexerToken* curr
             MATCH_FORMAT("texID", r::ShaderDataType::TextureID);
         }
         break;
+        case 'h': // "Half2"
+        case 'H': // "Half2"
+        {
+            MATCH_FORMAT("half2", r::ShaderDataType::Half2);
+            MATCH_FORMAT("Half2", r::ShaderDataType::Half2);
+        }
+        break;
         default: return false;
     }
 
@@ -1314,6 +1356,7 @@ bool ShaderFXParser::ParseVariantBlock(ArenaAllocator* arena, ShaderEffect* effe
     variant->name = ArenaPushString8Copy(arena, token.text);
     variant->has_color_output = true;
     variant->has_depth_output = true;
+    variant->instance_buffer = nullptr;
 
     // Consume the opening brace
     if (!this->Lexer->ExpectToken(&token, TokenType::TOKEN_TYPE_OPEN_BRACE))
@@ -1448,6 +1491,33 @@ bool ShaderFXParser::ParseVariantBlock(ArenaAllocator* arena, ShaderEffect* effe
                 return false;
             }
         }
+        else if (token.MatchesKeyword(String8Raw("InstanceBuffer")))
+        {
+            if (!this->Lexer->ExpectToken(&token, TokenType::TOKEN_TYPE_IDENTIFIER))
+            {
+                this->SetError(arena, PARSER_ERROR_TOKEN_MISMATCH, TokenType::String(TokenType::TOKEN_TYPE_IDENTIFIER), TokenType::String(token.type));
+                ScratchEnd(scratch);
+                return false;
+            }
+
+            bool valid = false;
+            for (u32 i = 0; i < effect->instance_buffer_count; i++)
+            {
+                if (StringEqual(effect->instance_buffers[i].name, token.text))
+                {
+                    variant->instance_buffer = &effect->instance_buffers[i];
+                    valid = true;
+                    break;
+                }
+            }
+
+            if (!valid)
+            {
+                this->SetError(arena, "Unknown InstanceBuffer: '%S'", token.text);
+                ScratchEnd(scratch);
+                return false;
+            }
+        }
         else if (token.MatchesKeyword(String8Raw("VertexShader")))
         {
             if (!this->Lexer->ExpectToken(&token, TokenType::TOKEN_TYPE_IDENTIFIER))
@@ -1508,6 +1578,36 @@ bool ShaderFXParser::ParseVariantBlock(ArenaAllocator* arena, ShaderEffect* effe
                 return false;
             }
         }
+        else if (token.MatchesKeyword(String8Raw("ComputeShader")))
+        {
+            if (!this->Lexer->ExpectToken(&token, TokenType::TOKEN_TYPE_IDENTIFIER))
+            {
+                this->SetError(arena, PARSER_ERROR_TOKEN_MISMATCH, TokenType::String(TokenType::TOKEN_TYPE_IDENTIFIER), TokenType::String(token.type));
+                ScratchEnd(scratch);
+                return false;
+            }
+
+            // Look up the GLSL code fragment by name
+            bool valid = false;
+            for (u32 i = 0; i < effect->code_fragment_count; i++)
+            {
+                if (StringEqual(effect->code_fragments[i].name, token.text))
+                {
+                    shader_defs[shader_def_count].stage = r::ShaderStageFlags::SHADER_STAGE_FLAGS_COMPUTE;
+                    shader_defs[shader_def_count].code_fragment = effect->code_fragments[i];
+                    shader_def_count++;
+                    valid = true;
+                    break;
+                }
+            }
+
+            if (!valid)
+            {
+                this->SetError(arena, "Unknown GLSL code fragment: '%S'", token.text);
+                ScratchEnd(scratch);
+                return false;
+            }
+        }
         else if (token.MatchesKeyword(String8Raw("ColorOutput")))
         {
             if (!this->Lexer->ExpectToken(&token, TokenType::TOKEN_TYPE_IDENTIFIER))
@@ -1532,6 +1632,17 @@ bool ShaderFXParser::ParseVariantBlock(ArenaAllocator* arena, ShaderEffect* effe
         }
     }
 
+    // A compute pipeline is made of exactly one stage
+    for (u32 i = 0; i < shader_def_count; i++)
+    {
+        if (shader_defs[i].stage == r::ShaderStageFlags::SHADER_STAGE_FLAGS_COMPUTE && shader_def_count > 1)
+        {
+            this->SetError(arena, "Variant '%S' mixes a ComputeShader with other shader stages", variant->name);
+            ScratchEnd(scratch);
+            return false;
+        }
+    }
+
     variant->shader_stage_count = shader_def_count;
     variant->shader_stages = ArenaPushArray(arena, VariantDefinition::ShaderDefinition, shader_def_count);
     MemCpy(variant->shader_stages, shader_defs, sizeof(VariantDefinition::ShaderDefinition) * shader_def_count);
@@ -1543,190 +1654,337 @@ bool ShaderFXParser::ParseVariantBlock(ArenaAllocator* arena, ShaderEffect* effe
     return true;
 }
 
-bool LoadShaderFX(ArenaAllocator* arena, String8 path, ShaderEffect* effect)
+static_assert(sizeof(ShaderFXBinaryHeader) % KRAFT_SHADERFX_BINARY_ALIGNMENT == 0, "The image has to start aligned");
+
+u64 GetShaderFXBinaryLayoutHash()
 {
-    KASSERT(arena);
-    fs::FileHandle file;
+    const u64 sizes[] = {
+        sizeof(void*),
+        sizeof(String8),
+        sizeof(ShaderEffect),
+        sizeof(VertexLayoutDefinition),
+        sizeof(VertexAttribute),
+        sizeof(VertexInputBinding),
+        sizeof(ResourceBindingsDefinition),
+        sizeof(ResourceBinding),
+        sizeof(ConstantBufferDefinition),
+        sizeof(ConstantBufferEntry),
+        sizeof(UniformBufferDefinition),
+        sizeof(UniformBufferEntry),
+        sizeof(RenderStateDefinition),
+        sizeof(ShaderCodeFragment),
+        sizeof(VariantDefinition),
+        sizeof(VariantDefinition::ShaderDefinition),
+        sizeof(r::ShaderDataType),
+        sizeof(r::BlendState),
+    };
+
+    return MurmurHash64(sizes, sizeof(sizes), KRAFT_SHADERFX_BINARY_VERSION);
+}
+
+// Adds up the space the effect takes in the image
+struct ShaderFXImageMeasure
+{
+    u64 size = 0;
+    u32 array_count = 0;
+    u32 pointer_count = 0;
 
-    // Read test
-    if (!fs::OpenFile(path, fs::FILE_OPEN_MODE_READ, true, &file))
+    template<typename T>
+    void Array(T** field, u32* count)
     {
-        KERROR("Failed to read file %S", path);
-        return false;
+        if (*count == 0)
+            return;
+
+        size += AlignPow2(sizeof(T) * *count, (u64)KRAFT_SHADERFX_BINARY_ALIGNMENT);
+        array_count++;
+        pointer_count++;
     }
 
-    TempArena scratch = ScratchBegin(&arena, 1);
+    // Strings are null terminated in the image
+    void String(String8* str)
+    {
+        if (str->count == 0)
+            return;
+
+        size += AlignPow2(str->count + 1, (u64)KRAFT_SHADERFX_BINARY_ALIGNMENT);
+        pointer_count++;
+    }
+
+    template<typename T>
+    void Reference(const T** field)
+    {
+        pointer_count++;
+    }
+};
+
+// Copies everything the effect points to into the image and points the fields of the copies at the copies
+struct ShaderFXImageWriter
+{
+    struct Relocation
+    {
+        const u8* source;
+        u64       size;
+        u8*       copy;
+    };
+
+    u8*         image;
+    u64         size;
+    Relocation* relocations;
+    u32         relocation_count;
 
-    u64 binary_buffer_size = fs::GetFileSize(&file) + 1;
-    u8* file_buf = ArenaPushArray(scratch.arena, u8, true);
-    fs::ReadAllBytes(&file, &file_buf);
-    fs::CloseFile(&file);
+    // Where in the image each pointer was written, they are turned into offsets once everything is copied
+    u64* pointers;
+    u32  pointer_count;
 
-    Buffer Reader((char*)file_buf, binary_buffer_size);
-    effect->name = Reader.ReadString(arena);
-    effect->resource_path = Reader.ReadString(arena);
+    void AddPointer(void* field)
+    {
+        pointers[pointer_count++] = (u64)((u8*)field - image);
+    }
 
-    effect->vertex_layout_count = Reader.Readu32();
-    effect->vertex_layouts = ArenaPushArray(arena, VertexLayoutDefinition, effect->vertex_layout_count);
-    for (u32 i = 0; i < effect->vertex_layout_count; i++)
+    u8* Copy(const void* data, u64 data_size, u64 reserved_size)
     {
-        effect->vertex_layouts[i].name = Reader.ReadString(arena);
+        u8* copy = image + size;
+        MemCpy(copy, data, data_size);
+        size += AlignPow2(reserved_size, (u64)KRAFT_SHADERFX_BINARY_ALIGNMENT);
+
+        return copy;
+    }
 
-        effect->vertex_layouts[i].attribute_count = Reader.Readu32();
-        effect->vertex_layouts[i].attributes = ArenaPushArray(arena, VertexAttribute, effect->vertex_layouts[i].attribute_count);
-        for (u32 j = 0; j < effect->vertex_layouts[i].attribute_count; j++)
+    template<typename T>
+    void Array(T** field, u32* count)
+    {
+        if (*count == 0)
         {
-            effect->vertex_layouts[i].attributes[j].location = Reader.Readu16();
-            effect->vertex_layouts[i].attributes[j].binding = Reader.Readu16();
-            effect->vertex_layouts[i].attributes[j].offset = Reader.Readu16();
-            // Reader.ReadRaw(&effect->vertex_layouts[i].attributes[j].format, sizeof(r::ShaderDataType));
-            effect->vertex_layouts[i].attributes[j].format.UnderlyingType = (r::ShaderDataType::Enum)Reader.Readu8();
-            effect->vertex_layouts[i].attributes[j].format.ArraySize = Reader.Readu16();
+            *field = nullptr;
+            return;
         }
 
-        effect->vertex_layouts[i].input_binding_count = Reader.Readu32();
-        effect->vertex_layouts[i].input_bindings = ArenaPushArray(arena, VertexInputBinding, effect->vertex_layouts[i].input_binding_count);
-        for (u32 j = 0; j < effect->vertex_layouts[i].input_binding_count; j++)
+        u64 array_size = sizeof(T) * *count;
+        u8* copy = Copy(*field, array_size, array_size);
+        relocations[relocation_count++] = { (const u8*)*field, array_size, copy };
+        *field = (T*)copy;
+        AddPointer(field);
+    }
+
+    void String(String8* str)
+    {
+        if (str->count == 0)
         {
-            effect->vertex_layouts[i].input_bindings[j].binding = Reader.Readu16();
-            effect->vertex_layouts[i].input_bindings[j].stride = Reader.Readu16();
-            effect->vertex_layouts[i].input_bindings[j].input_rate = (r::VertexInputRate::Enum)Reader.Readi32();
+            str->ptr = nullptr;
+            return;
         }
+
+        // The image starts out zeroed, which leaves the terminator in place
+        str->ptr = Copy(str->ptr, str->count, str->count + 1);
+        AddPointer(&str->ptr);
     }
 
-    effect->local_resource_count = Reader.Readu32();
-    effect->local_resources = ArenaPushArray(arena, ResourceBindingsDefinition, effect->local_resource_count);
-    for (u32 i = 0; i < effect->local_resource_count; i++)
+    template<typename T>
+    void Reference(const T** field)
     {
-        effect->local_resources[i].name = Reader.ReadString(arena);
-        effect->local_resources[i].binding_count = Reader.Readu32();
-        effect->local_resources[i].bindings = ArenaPushArray(arena, ResourceBinding, effect->local_resources[i].binding_count);
-        for (u32 j = 0; j < effect->local_resources[i].binding_count; j++)
+        const u8* target = (const u8*)*field;
+        if (!target)
+            return;
+
+        for (u32 i = 0; i < relocation_count; i++)
         {
-            effect->local_resources[i].bindings[j].name = Reader.ReadString(arena);
-            effect->local_resources[i].bindings[j].set = Reader.Readu16();
-            effect->local_resources[i].bindings[j].binding = Reader.Readu16();
-            effect->local_resources[i].bindings[j].size = Reader.Readu16();
-            effect->local_resources[i].bindings[j].parent_index = Reader.Readi16();
-            effect->local_resources[i].bindings[j].type = (r::ResourceType::Enum)Reader.Readi32();
-            effect->local_resources[i].bindings[j].stage = (r::ShaderStageFlags)Reader.Readi32();
+            const Relocation& relocation = relocations[i];
+            if (target >= relocation.source && target < relocation.source + relocation.size)
+            {
+                *field = (const T*)(relocation.copy + (target - relocation.source));
+                AddPointer(field);
+                return;
+            }
         }
+
+        // Only happens for the resources of variants in effects without local resources, the old format dropped those too
+        *field = nullptr;
     }
+};
+
+// Turns the offsets in the image back into pointers, making sure each of them stays inside the image
+struct ShaderFXImageFixup
+{
+    u8*  image;
+    u64  size;
+    bool valid = true;
 
-    effect->global_resource_count = Reader.Readu32();
-    effect->global_resources = ArenaPushArray(arena, ResourceBindingsDefinition, effect->global_resource_count);
-    for (u32 i = 0; i < effect->global_resource_count; i++)
+    bool Resolve(void** field, u64 resolved_size, u64 alignment)
     {
-        effect->global_resources[i].name = Reader.ReadString(arena);
-        effect->global_resources[i].binding_count = Reader.Readu32();
-        effect->global_resources[i].bindings = ArenaPushArray(arena, ResourceBinding, effect->global_resources[i].binding_count);
-        for (u32 j = 0; j < effect->global_resources[i].binding_count; j++)
+        u64 offset = (u64)*field;
+        if (offset == 0 && resolved_size == 0)
         {
-            effect->global_resources[i].bindings[j].name = Reader.ReadString(arena);
-            effect->global_resources[i].bindings[j].set = Reader.Readu16();
-            effect->global_resources[i].bindings[j].binding = Reader.Readu16();
-            effect->global_resources[i].bindings[j].size = Reader.Readu16();
-            effect->global_resources[i].bindings[j].parent_index = Reader.Readi16();
-            effect->global_resources[i].bindings[j].type = (r::ResourceType::Enum)Reader.Readi32();
-            effect->global_resources[i].bindings[j].stage = (r::ShaderStageFlags)Reader.Readi32();
+            *field = nullptr;
+            return true;
         }
+
+        if (offset == 0 || offset % alignment != 0 || offset >= size || resolved_size > size - offset)
+        {
+            *field = nullptr;
+            valid = false;
+            return false;
+        }
+
+        *field = image + offset;
+        return true;
     }
 
-    effect->constant_buffer_count = Reader.Readu32();
-    effect->constant_buffers = ArenaPushArray(arena, ConstantBufferDefinition, effect->constant_buffer_count);
-    for (u32 i = 0; i < effect->constant_buffer_count; i++)
+    template<typename T>
+    void Array(T** field, u32* count)
     {
-        effect->constant_buffers[i].name = Reader.ReadString(arena);
-        effect->constant_buffers[i].field_count = Reader.Readu32();
-        effect->constant_buffers[i].fields = ArenaPushArray(arena, ConstantBufferEntry, effect->constant_buffers[i].field_count);
-        for (u32 j = 0; j < effect->constant_buffers[i].field_count; j++)
+        if (!Resolve((void**)field, sizeof(T) * (u64)*count, AlignOf(T)))
         {
-            effect->constant_buffers[i].fields[j].name = Reader.ReadString(arena);
-            effect->constant_buffers[i].fields[j].stage = (r::ShaderStageFlags)Reader.Readi32();
-            Reader.ReadRaw(&effect->constant_buffers[i].fields[j].type, sizeof(r::ShaderDataType));
+            *count = 0;
         }
     }
 
-    effect->uniform_buffer_count = Reader.Readu32();
-    effect->uniform_buffers = ArenaPushArray(arena, UniformBufferDefinition, effect->uniform_buffer_count);
-    for (u32 i = 0; i < effect->uniform_buffer_count; i++)
+    void String(String8* str)
     {
-        effect->uniform_buffers[i].name = Reader.ReadString(arena);
-        effect->uniform_buffers[i].field_count = Reader.Readu32();
-        effect->uniform_buffers[i].fields = ArenaPushArray(arena, UniformBufferEntry, effect->uniform_buffers[i].field_count);
-        for (u32 j = 0; j < effect->uniform_buffers[i].field_count; j++)
+        if (!Resolve((void**)&str->ptr, str->count, 1))
         {
-            effect->uniform_buffers[i].fields[j].name = Reader.ReadString(arena);
-            Reader.ReadRaw(&effect->uniform_buffers[i].fields[j].type, sizeof(r::ShaderDataType));
+            str->count = 0;
         }
     }
 
-    effect->storage_buffer_count = Reader.Readu32();
-    effect->storage_buffers = ArenaPushArray(arena, UniformBufferDefinition, effect->storage_buffer_count);
-    for (u32 i = 0; i < effect->storage_buffer_count; i++)
+    template<typename T>
+    void Reference(const T** field)
     {
-        effect->storage_buffers[i].name = Reader.ReadString(arena);
-        effect->storage_buffers[i].field_count = Reader.Readu32();
-        effect->storage_buffers[i].fields = ArenaPushArray(arena, UniformBufferEntry, effect->storage_buffers[i].field_count);
-        for (u32 j = 0; j < effect->storage_buffers[i].field_count; j++)
+        if (*field)
         {
-            effect->storage_buffers[i].fields[j].name = Reader.ReadString(arena);
-            Reader.ReadRaw(&effect->storage_buffers[i].fields[j].type, sizeof(r::ShaderDataType));
+            Resolve((void**)field, sizeof(T), AlignOf(T));
         }
     }
+};
 
-    // RenderStates
-    effect->render_state_count = Reader.Readu32();
-    effect->render_states = ArenaPushArray(arena, RenderStateDefinition, effect->render_state_count);
-    for (u32 i = 0; i < effect->render_state_count; i++)
+bool WriteShaderFXBinary(const ShaderEffect* effect, String8 path)
+{
+    // The sources were compiled into the variants, nothing reads them at runtime
+    ShaderEffect source = *effect;
+    source.code_fragments = nullptr;
+    source.code_fragment_count = 0;
+
+    ShaderFXImageMeasure measure = {};
+    measure.size = AlignPow2(sizeof(ShaderEffect), (u64)KRAFT_SHADERFX_BINARY_ALIGNMENT);
+    VisitShaderEffect(&measure, &source);
+
+    TempArena scratch = ScratchBegin(0, 0);
+    u64       file_size = sizeof(ShaderFXBinaryHeader) + measure.size;
+    u8*       file_data = (u8*)scratch.arena->Push(file_size, KRAFT_SHADERFX_BINARY_ALIGNMENT, true);
+
+    ShaderFXImageWriter writer = {
+        .image = file_data + sizeof(ShaderFXBinaryHeader),
+        .relocations = ArenaPushArray(scratch.arena, ShaderFXImageWriter::Relocation, measure.array_count),
+        .pointers = ArenaPushArray(scratch.arena, u64, measure.pointer_count),
+    };
+
+    // The effect itself is the first thing in the image
+    ShaderEffect* root = (ShaderEffect*)writer.Copy(&source, sizeof(ShaderEffect), sizeof(ShaderEffect));
+    VisitShaderEffect(&writer, root);
+    KASSERT(writer.size == measure.size);
+
+    for (u32 i = 0; i < writer.pointer_count; i++)
     {
-        effect->render_states[i].name = Reader.ReadString(arena);
-        effect->render_states[i].cull_mode = (r::CullModeFlags::Enum)Reader.Readi32();
-        effect->render_states[i].z_test_op = (r::CompareOp::Enum)Reader.Readi32();
-        effect->render_states[i].z_write_enable = Reader.Readbool();
-        effect->render_states[i].blend_enable = Reader.Readbool();
-        Reader.ReadRaw(&effect->render_states[i].blend_mode, sizeof(r::BlendState));
-        effect->render_states[i].polygon_mode = (r::PolygonMode::Enum)Reader.Readi32();
-        effect->render_states[i].line_width = Reader.Readf32();
+        u8** field = (u8**)(writer.image + writer.pointers[i]);
+        *field = (u8*)(*field - writer.image);
     }
 
-    // Variants
-    effect->variant_count = Reader.Readu32();
-    effect->variants = ArenaPushArray(arena, VariantDefinition, effect->variant_count);
-    for (u32 v = 0; v < effect->variant_count; v++)
+    ShaderFXBinaryHeader header = {
+        .magic = KRAFT_SHADERFX_BINARY_MAGIC,
+        .version = KRAFT_SHADERFX_BINARY_VERSION,
+        .layout_hash = GetShaderFXBinaryLayoutHash(),
+        .content_hash = MurmurHash64(writer.image, (int)writer.size, KRAFT_SHADERFX_BINARY_MAGIC),
+        .image_size = writer.size,
+    };
+
+    MemCpy(file_data, &header, sizeof(header));
+
+    fs::FileHandle file = {};
+    bool           written = false;
+    if (fs::OpenFile(path, fs::FILE_OPEN_MODE_WRITE, true, &file))
     {
-        effect->variants[v].name = Reader.ReadString(arena);
+        written = fs::WriteFile(&file, file_data, file_size);
+        fs::CloseFile(&file);
+    }
 
-        i64 vertex_layout_offset = Reader.Readi64();
-        effect->variants[v].vertex_layout = &effect->vertex_layouts[vertex_layout_offset];
+    ScratchEnd(scratch);
 
-        i64 resources_offset = Reader.Readi64();
-        effect->variants[v].resources = resources_offset > -1 ? &effect->local_resources[resources_offset] : 0;
+    if (!written)
+    {
+        KERROR("[WriteShaderFXBinary]: Failed to write '%S'", path);
+    }
 
-        i64 constant_buffers_offset = Reader.Readi64();
-        effect->variants[v].contant_buffers = &effect->constant_buffers[constant_buffers_offset];
+    return written;
+}
 
-        i64 render_state_offset = Reader.Readi64();
-        effect->variants[v].render_state = &effect->render_states[render_state_offset];
+bool LoadShaderFX(ArenaAllocator* arena, String8 path, ShaderEffect* effect)
+{
+    KASSERT(arena);
 
-        effect->variants[v].has_color_output = Reader.Readbool();
-        effect->variants[v].has_depth_output = Reader.Readbool();
+    // The offsets are fixed up in place, so the image lives in the arena along with the rest of the effect
+    buffer file = fs::ReadAllBytes(arena, path, KRAFT_SHADERFX_BINARY_ALIGNMENT);
+    if (!file.ptr || file.count == 0)
+    {
+        KERROR("[LoadShaderFX]: Failed to read file %S", path);
+        return false;
+    }
 
-        effect->variants[v].shader_stage_count = Reader.Readu32();
-        effect->variants[v].shader_stages = ArenaPushArray(arena, VariantDefinition::ShaderDefinition, effect->variants[v].shader_stage_count);
-        for (u32 j = 0; j < effect->variants[v].shader_stage_count; j++)
-        {
-            effect->variants[v].shader_stages[j].stage = (r::ShaderStageFlags)Reader.Readi32();
-            effect->variants[v].shader_stages[j].code_fragment.name = Reader.ReadString(arena);
-            effect->variants[v].shader_stages[j].code_fragment.code = Reader.ReadString(arena);
-        }
+    ShaderFXBinaryHeader header = {};
+    if (file.count >= sizeof(header.magic))
+    {
+        MemCpy(&header.magic, file.ptr, sizeof(header.magic));
     }
 
-    ScratchEnd(scratch);
+    // Files from before the header were serialized field by field in a format that changed without being versioned,
+    // so there's no telling which fields one holds
+    if (header.magic != KRAFT_SHADERFX_BINARY_MAGIC)
+    {
+        KERROR("[LoadShaderFX]: '%S' was compiled by an old version of the shader compiler, it has to be recompiled", path);
+        return false;
+    }
+
+    if (file.count < sizeof(header) + sizeof(ShaderEffect))
+    {
+        KERROR("[LoadShaderFX]: '%S' is truncated", path);
+        return false;
+    }
+
+    MemCpy(&header, file.ptr, sizeof(header));
+    if (header.version != KRAFT_SHADERFX_BINARY_VERSION || header.layout_hash != GetShaderFXBinaryLayoutHash())
+    {
+        KERROR("[LoadShaderFX]: '%S' was compiled by a different version of the shader compiler, it has to be recompiled", path);
+        return false;
+    }
+
+    u8* image = file.ptr + sizeof(header);
+    if (header.image_size != file.count - sizeof(header) || MurmurHash64(image, (int)header.image_size, KRAFT_SHADERFX_BINARY_MAGIC) != header.content_hash)
+    {
+        KERROR("[LoadShaderFX]: '%S' is corrupted", path);
+        return false;
+    }
+
+    ShaderEffect*      root = (ShaderEffect*)image;
+    ShaderFXImageFixup fixup = {
+        .image = image,
+        .size = header.image_size,
+    };
+
+    VisitShaderEffect(&fixup, root);
+    if (!fixup.valid)
+    {
+        KERROR("[LoadShaderFX]: '%S' points outside of itself", path);
+        return false;
+    }
+
+    *effect = *root;
 
     return true;
 }
 
+bool IsComputeVariant(const VariantDefinition& variant)
+{
+    return variant.shader_stage_count == 1 && variant.shader_stages[0].stage == r::ShaderStageFlags::SHADER_STAGE_FLAGS_COMPUTE;
+}
+
 bool ValidateShaderFX(const ShaderEffect* shader1, const ShaderEffect* shader2)
 {
     KASSERT(StringEqual(shader1->name, shader2->name));
@@ -1757,6 +2015,18 @@ bool ValidateShaderFX(const ShaderEffect* shader1, const ShaderEffect* shader2)
         }
     }
 
+    KASSERT(shader1->instance_buffer_count == shader2->instance_buffer_count);
+    for (int i = 0; i < shader1->instance_buffer_count; i++)
+    {
+        KASSERT(StringEqual(shader1->instance_buffers[i].name, shader2->instance_buffers[i].name));
+        KASSERT(shader1->instance_buffers[i].field_count == shader2->instance_buffers[i].field_count);
+        for (int j = 0; j < shader1->instance_buffers[i].field_count; j++)
+        {
+            KASSERT(StringEqual(shader1->instance_buffers[i].fields[j].name, shader2->instance_buffers[i].fields[j].name));
+            KASSERT(shader1->instance_buffers[i].fields[j].type == shader2->instance_buffers[i].fields[j].type);
+        }
+    }
+
     KASSERT(shader1->vertex_layout_count == shader2->vertex_layout_count);
     for (int i = 0; i < shader1->vertex_layout_count; i++)
     {
@@ -1796,6 +2066,7 @@ bool ValidateShaderFX(const ShaderEffect* shader1, const ShaderEffect* shader2)
         KASSERT(StringEqual(shader1->variants[v].name, shader2->variants[v].name));
         KASSERT(shader1->variants[v].has_color_output == shader2->variants[v].has_color_output);
         KASSERT(shader1->variants[v].has_depth_output == shader2->variants[v].has_depth_output);
+        KASSERT((shader1->variants[v].instance_buffer == nullptr) == (shader2->variants[v].instance_buffer == nullptr));
         KASSERT(shader1->variants[v].shader_stage_count == shader2->variants[v].shader_stage_count);
         for (int j = 0; j < shader1->variants[v].shader_stage_count; j++)
         {
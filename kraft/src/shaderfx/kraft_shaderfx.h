@@ -77,4 +77,7 @@ struct ShaderFXParser
 bool LoadShaderFX(ArenaAllocator* arena, String8 path, ShaderEffect* shader);
 bool ValidateShaderFX(const ShaderEffect* shader1, const ShaderEffect* shader2);
 
+// Compute variants have a single compute stage and are created as compute pipelines
+bool IsComputeVariant(const VariantDefinition& variant);
+
 } // namespace kraft::shaderfx
\ No newline at end of file
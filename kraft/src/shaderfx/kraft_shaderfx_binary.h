@@ -0,0 +1,140 @@
+#pragma once
+
+// Compiled effects (.bkfx) are an image of the ShaderEffect and everything it points to, with the pointers stored as
+// offsets from the start of the image. Loading one is a single read followed by turning the offsets back into pointers;
+// nothing is deserialized or copied field by field.
+//
+// The image holds the structs as the compiler laid them out, so it's only valid for builds with the same struct layout.
+// The header records a hash of the layout, bump KRAFT_SHADERFX_BINARY_VERSION when changing a struct in a way that
+// keeps its size.
+
+#define KRAFT_SHADERFX_BINARY_MAGIC   0x5846424B // "KBFX"
+#define KRAFT_SHADERFX_BINARY_VERSION 2
+
+// Every array and string in the image starts at a multiple of this, which also keeps SPIR-V word aligned
+#define KRAFT_SHADERFX_BINARY_ALIGNMENT 8
+
+namespace kraft::shaderfx {
+
+struct ShaderFXBinaryHeader
+{
+    u32 magic;
+    u32 version;
+    u64 layout_hash;
+    u64 content_hash; // Hash of the image
+    u64 image_size;   // The image follows the header
+};
+
+// Sections of VisitShaderEffect shared by several kinds of buffers
+template<typename Visitor>
+void VisitUniformBuffers(Visitor* visitor, UniformBufferDefinition** buffers, u32* count)
+{
+    visitor->Array(buffers, count);
+    for (u32 i = 0; i < *count; i++)
+    {
+        UniformBufferDefinition* buffer = &(*buffers)[i];
+        visitor->String(&buffer->name);
+        visitor->Array(&buffer->fields, &buffer->field_count);
+        for (u32 j = 0; j < buffer->field_count; j++)
+        {
+            visitor->String(&buffer->fields[j].name);
+        }
+    }
+}
+
+template<typename Visitor>
+void VisitResourceBindings(Visitor* visitor, ResourceBindingsDefinition** resources, u32* count)
+{
+    visitor->Array(resources, count);
+    for (u32 i = 0; i < *count; i++)
+    {
+        ResourceBindingsDefinition* resource = &(*resources)[i];
+        visitor->String(&resource->name);
+        visitor->Array(&resource->bindings, &resource->binding_count);
+        for (u32 j = 0; j < resource->binding_count; j++)
+        {
+            visitor->String(&resource->bindings[j].name);
+        }
+    }
+}
+
+// The schema of the image, shared by the compiler and the loader. Visits every pointer in the effect: arrays along with
+// their element count, strings, and references to an element of one of the effect's arrays. An array is visited before
+// its elements, so a visitor that moves the array can point the field at the new location and the walk follows it there.
+// Visitors may set a count to zero to skip the elements of an array they can't resolve.
+template<typename Visitor>
+void VisitShaderEffect(Visitor* visitor, ShaderEffect* effect)
+{
+    visitor->String(&effect->name);
+    visitor->String(&effect->resource_path);
+
+    visitor->Array(&effect->vertex_layouts, &effect->vertex_layout_count);
+    for (u32 i = 0; i < effect->vertex_layout_count; i++)
+    {
+        VertexLayoutDefinition* layout = &effect->vertex_layouts[i];
+        visitor->String(&layout->name);
+        visitor->Array(&layout->attributes, &layout->attribute_count);
+        visitor->Array(&layout->input_bindings, &layout->input_binding_count);
+    }
+
+    VisitResourceBindings(visitor, &effect->local_resources, &effect->local_resource_count);
+    VisitResourceBindings(visitor, &effect->global_resources, &effect->global_resource_count);
+
+    visitor->Array(&effect->constant_buffers, &effect->constant_buffer_count);
+    for (u32 i = 0; i < effect->constant_buffer_count; i++)
+    {
+        ConstantBufferDefinition* buffer = &effect->constant_buffers[i];
+        visitor->String(&buffer->name);
+        visitor->Array(&buffer->fields, &buffer->field_count);
+        for (u32 j = 0; j < buffer->field_count; j++)
+        {
+            visitor->String(&buffer->fields[j].name);
+        }
+    }
+
+    VisitUniformBuffers(visitor, &effect->uniform_buffers, &effect->uniform_buffer_count);
+    VisitUniformBuffers(visitor, &effect->storage_buffers, &effect->storage_buffer_count);
+    VisitUniformBuffers(visitor, &effect->instance_buffers, &effect->instance_buffer_count);
+
+    visitor->Array(&effect->render_states, &effect->render_state_count);
+    for (u32 i = 0; i < effect->render_state_count; i++)
+    {
+        visitor->String(&effect->render_states[i].name);
+    }
+
+    visitor->Array(&effect->code_fragments, &effect->code_fragment_count);
+    for (u32 i = 0; i < effect->code_fragment_count; i++)
+    {
+        visitor->String(&effect->code_fragments[i].name);
+        visitor->String(&effect->code_fragments[i].code);
+    }
+
+    // Variants point into the arrays above
+    visitor->Array(&effect->variants, &effect->variant_count);
+    for (u32 v = 0; v < effect->variant_count; v++)
+    {
+        VariantDefinition* variant = &effect->variants[v];
+        visitor->String(&variant->name);
+        visitor->Reference(&variant->render_state);
+        visitor->Reference(&variant->vertex_layout);
+        visitor->Reference(&variant->resources);
+        visitor->Reference(&variant->contant_buffers);
+        visitor->Reference(&variant->instance_buffer);
+
+        visitor->Array(&variant->shader_stages, &variant->shader_stage_count);
+        for (u32 j = 0; j < variant->shader_stage_count; j++)
+        {
+            visitor->String(&variant->shader_stages[j].code_fragment.name);
+            visitor->String(&variant->shader_stages[j].code_fragment.code);
+        }
+    }
+}
+
+// Hash of the size of every struct in the image
+u64 GetShaderFXBinaryLayoutHash();
+
+// Writes the compiled effect to `path`. The variants' code fragments must hold the compiled code, the effect's own
+// code fragments (the sources) are left out.
+bool WriteShaderFXBinary(const ShaderEffect* effect, String8 path);
+
+} // namespace kraft::shaderfx
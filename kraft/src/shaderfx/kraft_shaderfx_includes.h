@@ -1,4 +1,5 @@
 #pragma once
 
 #include "kraft_shaderfx_types.h"
+#include "kraft_shaderfx_binary.h"
 #include "kraft_shaderfx.h"
\ No newline at end of file
@@ -110,6 +110,10 @@ struct VariantDefinition
     const VertexLayoutDefinition*     vertex_layout;
     const ResourceBindingsDefinition* resources;
     const ConstantBufferDefinition*   contant_buffers;
+
+    // Set when the variant reads its per-instance data (model matrix, entity id, material index) from the
+    // instance buffer with gl_InstanceIndex, which lets the renderer batch identical draws into one instanced draw
+    const UniformBufferDefinition*    instance_buffer = nullptr;
     u32                               shader_stage_count;
     ShaderDefinition*                 shader_stages;
     bool                              has_color_output = true;
@@ -139,6 +143,9 @@ struct ShaderEffect
     u32                      storage_buffer_count;
     UniformBufferDefinition* storage_buffers;
 
+    u32                      instance_buffer_count;
+    UniformBufferDefinition* instance_buffers;
+
     u32                      render_state_count;
     RenderStateDefinition*   render_states;
 
@@ -189,8 +189,151 @@ void AssetDatabase::ProcessAINode(MeshAsset& BaseMesh, aiNode* Node, const aiSce
 
 #endif
 
-static MeshAsset* LoadGLTFMesh(ArenaAllocator* arena, String8 path, MeshAsset* out_mesh);
-MeshAsset* AssetDatabase::LoadMesh(ArenaAllocator* arena, String8 path) {
+static i16 QuantizeSnorm16(f32 value) {
+    value = math::Clamp(value, -1.0f, 1.0f);
+    return (i16)(value * 32767.0f + (value >= 0.0f ? 0.5f : -0.5f));
+}
+
+// Round-to-nearest float to IEEE half conversion; out of range values become infinity
+static u16 FloatToHalf(f32 value) {
+    u32 bits;
+    MemCpy(&bits, &value, sizeof(bits));
+
+    u32 sign = (bits >> 16) & 0x8000;
+    u32 float_exponent = (bits >> 23) & 0xFF;
+    u32 mantissa = bits & 0x7FFFFF;
+
+    // Infinity and NaN
+    if (float_exponent == 0xFF) {
+        return (u16)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    }
+
+    i32 exponent = (i32)float_exponent - 127 + 15;
+    if (exponent >= 31) {
+        return (u16)(sign | 0x7C00);
+    }
+
+    // Denormals
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return (u16)sign;
+        }
+
+        mantissa |= 0x800000;
+        u32 shift = (u32)(14 - exponent);
+        u32 half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1) {
+            half++;
+        }
+
+        return (u16)(sign | half);
+    }
+
+    // A carry out of the mantissa correctly bumps the exponent
+    u32 half = sign | ((u32)exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000) {
+        half++;
+    }
+
+    return (u16)half;
+}
+
+// Maps a direction onto the [-1, 1] square by projecting it onto an octahedron and folding the lower half over
+static void OctahedralEncode(Vec3f direction, i16 out[2]) {
+    f32 l1_norm = Abs(direction.x) + Abs(direction.y) + Abs(direction.z);
+    if (l1_norm == 0.0f) {
+        out[0] = 0;
+        out[1] = 0;
+        return;
+    }
+
+    f32 x = direction.x / l1_norm;
+    f32 y = direction.y / l1_norm;
+    if (direction.z < 0.0f) {
+        f32 folded_x = (1.0f - Abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        f32 folded_y = (1.0f - Abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = folded_x;
+        y = folded_y;
+    }
+
+    out[0] = QuantizeSnorm16(x);
+    out[1] = QuantizeSnorm16(y);
+}
+
+// Converts a submesh into the layout the import options ask for. Anything that gets converted is
+// pushed onto `arena` and has to stay alive until the geometry has been acquired.
+static GeometryData BuildMeshGeometry(ArenaAllocator* arena, const MeshImportOptions& options, r::Vertex3D* vertices, u32 vertex_count, u32* indices, u32 index_count) {
+    GeometryData geometry = {
+        .VertexCount = vertex_count,
+        .IndexCount = index_count,
+        .VertexSize = sizeof(r::Vertex3D),
+        .IndexSize = sizeof(u32),
+        .Vertices = vertices,
+        .Indices = indices,
+    };
+
+    // 16-bit indices whenever they can address every vertex
+    if (index_count > 0 && vertex_count < 65536) {
+        u16* short_indices = ArenaPushArray(arena, u16, index_count);
+        for (u32 i = 0; i < index_count; i++) {
+            short_indices[i] = (u16)indices[i];
+        }
+
+        geometry.Indices = short_indices;
+        geometry.IndexSize = sizeof(u16);
+    }
+
+    if (!options.CompressVertices || vertex_count == 0) {
+        return geometry;
+    }
+
+    Vec3f min = vertices[0].Position;
+    Vec3f max = vertices[0].Position;
+    for (u32 i = 1; i < vertex_count; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            min[axis] = math::Min(min[axis], vertices[i].Position[axis]);
+            max[axis] = math::Max(max[axis], vertices[i].Position[axis]);
+        }
+    }
+
+    // Positions share one scale across all axes so the dequantization stays a uniform scale,
+    // which keeps the normal matrix of the dequantized model matrix valid
+    Vec3f center;
+    f32 scale = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        center[axis] = (min[axis] + max[axis]) * 0.5f;
+        scale = math::Max(scale, (max[axis] - min[axis]) * 0.5f);
+    }
+
+    if (scale == 0.0f) {
+        scale = 1.0f;
+    }
+
+    f32 inv_scale = 1.0f / scale;
+    r::Vertex3DPacked* packed_vertices = ArenaPushArray(arena, r::Vertex3DPacked, vertex_count);
+    for (u32 i = 0; i < vertex_count; i++) {
+        const r::Vertex3D& vertex = vertices[i];
+        r::Vertex3DPacked& packed = packed_vertices[i];
+        for (int axis = 0; axis < 3; axis++) {
+            packed.Position[axis] = QuantizeSnorm16((vertex.Position[axis] - center[axis]) * inv_scale);
+        }
+
+        packed.Position[3] = vertex.Tangent.w < 0.0f ? -32767 : 32767;
+        OctahedralEncode(vertex.Normal, packed.Normal);
+        OctahedralEncode(Vec3f{vertex.Tangent.x, vertex.Tangent.y, vertex.Tangent.z}, packed.Tangent);
+        packed.UV[0] = FloatToHalf(vertex.UV.x);
+        packed.UV[1] = FloatToHalf(vertex.UV.y);
+    }
+
+    geometry.Vertices = packed_vertices;
+    geometry.VertexSize = sizeof(r::Vertex3DPacked);
+    geometry.PositionDequantization = Vec4f{center.x, center.y, center.z, scale};
+
+    return geometry;
+}
+
+static MeshAsset* LoadGLTFMesh(ArenaAllocator* arena, String8 path, const MeshImportOptions& options, MeshAsset* out_mesh);
+MeshAsset* AssetDatabase::LoadMesh(ArenaAllocator* arena, String8 path, MeshImportOptions options) {
     // auto It = AssetDatabaseStatePtr->AssetsIndexMap.find(path);
     // if (It != AssetDatabaseStatePtr->AssetsIndexMap.end())
     // {
@@ -208,7 +351,7 @@ MeshAsset* AssetDatabase::LoadMesh(ArenaAllocator* arena, String8 path) {
 
     // GLTF
     if (StringEndsWith(path, S(".gltf")) || StringEndsWith(path, S(".glb"))) {
-        KASSERT(LoadGLTFMesh(arena, path, mesh));
+        KASSERT(LoadGLTFMesh(arena, path, options, mesh));
         return &AssetDatabaseStatePtr->Meshes[AssetDatabaseStatePtr->MeshCount++];
     }
 
@@ -342,13 +485,8 @@ MeshAsset* AssetDatabase::LoadMesh(ArenaAllocator* arena, String8 path) {
                 return nullptr;
             }
 
-            GeometryData geometry = {};
-            geometry.IndexCount = num_indices;
-            geometry.IndexSize = sizeof(u32);
-            geometry.Indices = indices.Data();
-            geometry.VertexCount = num_vertices;
-            geometry.VertexSize = sizeof(r::Vertex3D);
-            geometry.Vertices = vertices.Data();
+            u64 arena_pos = ArenaPosition(arena);
+            GeometryData geometry = BuildMeshGeometry(arena, options, vertices.Data(), num_vertices, indices.Data(), num_indices);
 
             for (int j = 0; j < ufbx_mesh->instances.count; j++) {
                 ufbx_node* ufbx_node = ufbx_mesh->instances[j];
@@ -372,6 +510,8 @@ MeshAsset* AssetDatabase::LoadMesh(ArenaAllocator* arena, String8 path) {
                     }
                 }
             }
+
+            ArenaPopToPosition(arena, arena_pos);
         }
     }
 
@@ -430,15 +570,15 @@ MeshAsset* AssetDatabase::LoadMesh(ArenaAllocator* arena, String8 path) {
     return &AssetDatabaseStatePtr->Meshes[AssetDatabaseStatePtr->MeshCount++];
 }
 
-static MeshAsset* LoadGLTFMesh(ArenaAllocator* arena, String8 path, MeshAsset* out_mesh) {
-    cgltf_options options = {};
+static MeshAsset* LoadGLTFMesh(ArenaAllocator* arena, String8 path, const MeshImportOptions& options, MeshAsset* out_mesh) {
+    cgltf_options parse_options = {};
     cgltf_data* data = nullptr;
 
     TempArena scratch = ScratchBegin(&arena, 1);
     buffer file_buf = fs::ReadAllBytes(scratch.arena, path);
 
-    cgltf_result result = cgltf_parse(&options, file_buf.ptr, file_buf.count, &data);
-    // cgltf_result result = cgltf_parse_file(&options, path.str, &data);
+    cgltf_result result = cgltf_parse(&parse_options, file_buf.ptr, file_buf.count, &data);
+    // cgltf_result result = cgltf_parse_file(&parse_options, path.str, &data);
 
     if (result != cgltf_result_success) {
         ScratchEnd(scratch);
@@ -449,7 +589,7 @@ static MeshAsset* LoadGLTFMesh(ArenaAllocator* arena, String8 path, MeshAsset* o
     MemCpy(path_cstr, path.ptr, path.count);
     path_cstr[path.count] = '\0';
 
-    result = cgltf_load_buffers(&options, data, path_cstr);
+    result = cgltf_load_buffers(&parse_options, data, path_cstr);
     if (result != cgltf_result_success) {
         cgltf_free(data);
         ScratchEnd(scratch);
@@ -514,14 +654,7 @@ static MeshAsset* LoadGLTFMesh(ArenaAllocator* arena, String8 path, MeshAsset* o
                 }
             }
 
-            GeometryData geometry{
-                .VertexCount = vertex_count,
-                .IndexCount = index_count,
-                .VertexSize = sizeof(r::Vertex3D),
-                .IndexSize = sizeof(u32),
-                .Vertices = vertices,
-                .Indices = (void*)indices,
-            };
+            GeometryData geometry = BuildMeshGeometry(arena, options, vertices, vertex_count, indices, index_count);
 
             MeshT submesh = {};
             submesh.Geometry = GeometrySystem::AcquireGeometryWithData(geometry);
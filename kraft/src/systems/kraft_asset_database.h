@@ -30,10 +30,16 @@ namespace r {
 template <typename T> struct Handle;
 }
 
+struct MeshImportOptions {
+    // Store the vertices as r::Vertex3DPacked instead of r::Vertex3D. The mesh has to be drawn
+    // with shaders that use the packed vertex layout.
+    bool CompressVertices = false;
+};
+
 KRAFT_API struct AssetDatabase {
     static void Init();
     static void Shutdown();
-    static MeshAsset* LoadMesh(ArenaAllocator* arena, String8 path);
+    static MeshAsset* LoadMesh(ArenaAllocator* arena, String8 path, MeshImportOptions options = {});
     static TextureAsset* LoadTexture(ArenaAllocator* arena, String8 path);
     static SpriteAtlasAsset* LoadSpriteAtlas(ArenaAllocator* arena, String8 path);
     static SpriteAtlasAsset** GetLoadedSpriteAtlases(u32* out_count);
@@ -14,6 +14,69 @@ static GeometrySystemState* geometry_system_state = nullptr;
 
 static void _createDefaultGeometries();
 
+// Object space box and sphere around the vertex positions. Vertex formats without a known position layout get
+// invalid bounds, which the culling code treats as always visible.
+static r::GeometryBounds ComputeGeometryBounds(const GeometryData& data)
+{
+    r::GeometryBounds bounds = {};
+    if (data.VertexCount == 0 || data.Vertices == nullptr)
+    {
+        return bounds;
+    }
+
+    const u8* vertices = (const u8*)data.Vertices;
+    bool      quantized = data.PositionDequantization.w != 0.0f;
+    if (!quantized && data.VertexSize != sizeof(r::Vertex3D) && data.VertexSize != sizeof(r::Vertex2D))
+    {
+        return bounds;
+    }
+
+    auto position_at = [&](u32 i) -> Vec3f {
+        const u8* vertex = vertices + (u64)i * data.VertexSize;
+        if (quantized)
+        {
+            const r::Vertex3DPacked* packed = (const r::Vertex3DPacked*)vertex;
+            f32                      scale = data.PositionDequantization.w / 32767.0f;
+            return Vec3f{
+                packed->Position[0] * scale + data.PositionDequantization.x,
+                packed->Position[1] * scale + data.PositionDequantization.y,
+                packed->Position[2] * scale + data.PositionDequantization.z,
+            };
+        }
+
+        if (data.VertexSize == sizeof(r::Vertex3D))
+        {
+            return ((const r::Vertex3D*)vertex)->Position;
+        }
+
+        const Vec2f& position = ((const r::Vertex2D*)vertex)->Position;
+        return Vec3f{ position.x, position.y, 0.0f };
+    };
+
+    Vec3f min = position_at(0);
+    Vec3f max = min;
+    for (u32 i = 1; i < data.VertexCount; i++)
+    {
+        Vec3f position = position_at(i);
+        min = Vec3f{ math::Min(min.x, position.x), math::Min(min.y, position.y), math::Min(min.z, position.z) };
+        max = Vec3f{ math::Max(max.x, position.x), math::Max(max.y, position.y), math::Max(max.z, position.z) };
+    }
+
+    bounds.Center = (min + max) * 0.5f;
+    bounds.Extents = (max - min) * 0.5f;
+
+    // Sharing the box center keeps the culling test simple; the sphere is still tight for most meshes
+    f32 radius_squared = 0.0f;
+    for (u32 i = 0; i < data.VertexCount; i++)
+    {
+        radius_squared = math::Max(radius_squared, LengthSquared(position_at(i) - bounds.Center));
+    }
+
+    bounds.Radius = Sqrt(radius_squared);
+
+    return bounds;
+}
+
 void GeometrySystem::Init(GeometrySystemConfig Config)
 {
     u32 total_size = sizeof(GeometrySystemState) + sizeof(GeometryReference) * Config.MaxGeometriesCount;
@@ -90,6 +153,8 @@ Geometry* GeometrySystem::AcquireGeometryWithData(GeometryData data, bool auto_r
     reference->ref_count = 1;
     reference->auto_release = auto_release;
     reference->geometry.ID = index;
+    reference->geometry.DrawData.PositionDequantization = data.PositionDequantization;
+    reference->geometry.Bounds = ComputeGeometryBounds(data);
 
 #ifdef KRAFT_GUI_APP
     if (!g_Renderer->CreateGeometry(&reference->geometry, data.VertexCount, data.Vertices, data.VertexSize, data.IndexCount, data.Indices, data.IndexSize))
@@ -107,6 +172,9 @@ Geometry* GeometrySystem::AcquireGeometryWithData(GeometryData data, bool auto_r
 
 bool GeometrySystem::UpdateGeometry(Geometry* geometry, GeometryData data)
 {
+    geometry->DrawData.PositionDequantization = data.PositionDequantization;
+    geometry->Bounds = ComputeGeometryBounds(data);
+
 #ifdef KRAFT_GUI_APP
     if (!g_Renderer->UpdateGeometry(geometry, data.VertexCount, data.Vertices, data.VertexSize, data.IndexCount, data.Indices, data.IndexSize))
     {
@@ -123,6 +191,8 @@ bool GeometrySystem::UpdateGeometry(u32 id, GeometryData data)
     if (id < geometry_system_state->max_geometries_count)
     {
         GeometryReference* reference = &geometry_system_state->geometries[id];
+        reference->geometry.DrawData.PositionDequantization = data.PositionDequantization;
+        reference->geometry.Bounds = ComputeGeometryBounds(data);
         if (!g_Renderer->UpdateGeometry(&reference->geometry, data.VertexCount, data.Vertices, data.VertexSize, data.IndexCount, data.Indices, data.IndexSize))
         {
             return false;
@@ -165,8 +235,13 @@ void GeometrySystem::ReleaseGeometry(u32 id)
 
 void GeometrySystem::DestroyGeometry(Geometry* geometry)
 {
+#ifdef KRAFT_GUI_APP
+    g_Renderer->DestroyGeometry(geometry);
+#endif
+
     geometry->ID = geometry_system_state->max_geometries_count;
     geometry->DrawData = {};
+    geometry->Bounds = {};
 }
 
 void _createDefaultGeometries()
@@ -17,6 +17,9 @@ struct GeometryData
     u32   IndexSize;  // Size of a single index
     void* Vertices;
     void* Indices;
+
+    // Only set for r::Vertex3DPacked vertices, see r::GeometryDrawData::PositionDequantization
+    Vec4f PositionDequantization = { 0.0f, 0.0f, 0.0f, 0.0f };
 };
 
 struct GeometryReference
@@ -13,6 +13,7 @@ namespace kraft {
 static MaterialSystemState* material_system_state = 0;
 
 static void ReleaseMaterialInternal(u32 Index);
+static void MarkMaterialDirty(u32 index);
 // static void CreateDefaultMaterialsInternal();
 static bool LoadMaterialFromFileInternal(ArenaAllocator* arena, String8 file_path, MaterialDataIntermediateFormat* data);
 
@@ -25,6 +26,7 @@ void MaterialSystem::Init(const RendererOptions& options) {
     material_system_state->max_materials_count = options.MaxMaterials;
     material_system_state->materials_buffer = ArenaPushArray(arena, u8, material_system_state->material_buffer_size * material_system_state->max_materials_count);
     material_system_state->material_references = ArenaPushArray(arena, MaterialReference, material_system_state->max_materials_count);
+    material_system_state->dirty_materials = ArenaPushArray(arena, u64, (material_system_state->max_materials_count + 63) / 64);
 }
 
 void MaterialSystem::Shutdown() {
@@ -158,6 +160,8 @@ Material* MaterialSystem::CreateMaterialWithData(const MaterialDataIntermediateF
         }
     }
 
+    MarkMaterialDirty(free_index);
+
     instance->Properties = data.properties;
     return instance;
 }
@@ -226,6 +230,7 @@ bool MaterialSystem::SetTexture(Material* instance, String8 key, r::Handle<Textu
     u32 Index = texture.GetIndex();
     MemCpy(material_buf + uniform.Offset, &Index, uniform.Stride);
     instance->Properties[key_hash].TextureValue = texture;
+    MarkMaterialDirty(instance->ID);
 
     return true;
 }
@@ -234,10 +239,59 @@ u8* MaterialSystem::GetMaterialsBuffer() {
     return material_system_state->materials_buffer;
 }
 
+u32 MaterialSystem::GetDirtyRanges(ArenaAllocator* arena, MaterialBufferRange** out_ranges) {
+    *out_ranges = nullptr;
+    if (!material_system_state->has_dirty_materials) {
+        return 0;
+    }
+
+    u32 material_size = material_system_state->material_buffer_size;
+    u32 word_count = (material_system_state->max_materials_count + 63) / 64;
+    MaterialBufferRange* ranges = ArenaPushArrayNoZero(arena, MaterialBufferRange, material_system_state->max_materials_count);
+    u32 range_count = 0;
+    u32 last_material = 0;
+    for (u32 word_index = 0; word_index < word_count; word_index++) {
+        u64 word = material_system_state->dirty_materials[word_index];
+        for (u32 bit = 0; word != 0; bit++, word >>= 1) {
+            if ((word & 1) == 0) {
+                continue;
+            }
+
+            // Copying a few clean materials along with the dirty ones is cheaper than another copy command
+            u32 material = word_index * 64 + bit;
+            if (range_count > 0 && material - last_material <= KRAFT_MATERIAL_UPLOAD_MAX_GAP + 1) {
+                MaterialBufferRange* range = &ranges[range_count - 1];
+                range->Size = (material + 1) * material_size - range->Offset;
+            } else {
+                ranges[range_count++] = {
+                    .Offset = material * material_size,
+                    .Size = material_size,
+                };
+            }
+
+            last_material = material;
+        }
+    }
+
+    *out_ranges = ranges;
+    return range_count;
+}
+
+void MaterialSystem::ClearDirtyMaterials() {
+    MemZero(material_system_state->dirty_materials, sizeof(u64) * ((material_system_state->max_materials_count + 63) / 64));
+    material_system_state->has_dirty_materials = false;
+}
+
 //
 // Internal private methods
 //
 
+static void MarkMaterialDirty(u32 index) {
+    KASSERT(index < material_system_state->max_materials_count);
+    material_system_state->dirty_materials[index / 64] |= 1ull << (index % 64);
+    material_system_state->has_dirty_materials = true;
+}
+
 static void ReleaseMaterialInternal(u32 index) {
     MaterialReference ref = material_system_state->material_references[index];
     if (ref.ref_count == 0) {
@@ -575,6 +629,7 @@ static bool LoadMaterialFromFileInternal(ArenaAllocator* arena, String8 file_pat
         }                                                                                                                                                                                              \
                                                                                                                                                                                                        \
         MemCpy(material_buffer + uniform.Offset, &value, uniform.Stride);                                                                                                                              \
+        MarkMaterialDirty(instance->ID);                                                                                                                                                               \
         return true;                                                                                                                                                                                   \
     }
 
@@ -7,6 +7,9 @@ template<typename>
 struct Handle;
 } // namespace kraft::r
 
+// Dirty materials at most this many clean materials apart are uploaded with a single copy
+#define KRAFT_MATERIAL_UPLOAD_MAX_GAP 4
+
 namespace kraft {
 
 struct MaterialDataIntermediateFormat;
@@ -20,6 +23,13 @@ struct MaterialReference
     u32      ref_count;
 };
 
+// Bytes of the materials buffer that have to be uploaded
+struct MaterialBufferRange
+{
+    u32 Offset;
+    u32 Size;
+};
+
 struct MaterialSystemState
 {
     ArenaAllocator* arena;
@@ -29,6 +39,10 @@ struct MaterialSystemState
 
     MaterialReference* material_references;
     CArray(u8) materials_buffer;
+
+    // One bit per material whose data changed since the renderer last uploaded it
+    CArray(u64) dirty_materials;
+    bool has_dirty_materials;
 };
 
 struct MaterialSystem
@@ -49,6 +63,11 @@ struct MaterialSystem
     static bool SetProperty(Material* instance, String8 name, T value);
 
     static u8* GetMaterialsBuffer();
+
+    // Coalesces the dirty materials into ranges of the materials buffer, allocated from `arena`. Returns the number of
+    // ranges, 0 when no material changed.
+    static u32  GetDirtyRanges(ArenaAllocator* arena, MaterialBufferRange** out_ranges);
+    static void ClearDirtyMaterials();
 };
 
 } // namespace kraft
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <containers/kraft_hashmap.h>
 #include <core/kraft_asserts.h>
 #include <core/kraft_log.h>
+#include <platform/kraft_filesystem.h>
 #include <renderer/kraft_renderer_frontend.h>
 
 // TODO: REMOVE
@@ -15,9 +16,11 @@
 
 namespace kraft {
 
-static void ReleaseShaderInternal(u32 Index);
-static u32  AddUniform(Shader* shader, String8 name, u32 location, u32 offset, u32 size, r::ShaderDataType data_type, r::ShaderUniformScope::Enum scope);
-static void BuildUniformCache(Shader* shader);
+static void    ReleaseShaderInternal(u32 Index);
+static void    WaitForPipelines(ShaderReference* reference);
+static u32     AddUniform(Shader* shader, String8 name, u32 location, u32 offset, u32 size, r::ShaderDataType data_type, r::ShaderUniformScope::Enum scope);
+static void    BuildUniformCache(Shader* shader);
+static String8 GetShaderSourcePath(ArenaAllocator* arena, String8 shader_path);
 
 static ShaderSystemState* shader_system_state = nullptr;
 
@@ -46,6 +49,9 @@ void ShaderSystem::Init(u32 max_shader_count)
 
 void ShaderSystem::Shutdown()
 {
+    // The pipeline jobs read the shader effects out of our arena
+    WaitForPendingShaders();
+
     // Free the default shader
     ReleaseShaderInternal(0);
 
@@ -81,6 +87,25 @@ Shader* ShaderSystem::AcquireShader(String8 shader_path, bool auto_release)
         return nullptr;
     }
 
+    // A missing binary next to its source means res/shaders was never compiled, which LoadShaderFX can't tell apart
+    // from a wrong path. Only the .kfx itself is compared for staleness, not the files it includes.
+    TempArena scratch = ScratchBegin(0, 0);
+    String8   source_path = GetShaderSourcePath(scratch.arena, shader_path);
+    u64       source_time = source_path.count > 0 ? fs::GetFileModifiedTime(source_path) : 0;
+    u64       binary_time = fs::GetFileModifiedTime(shader_path);
+    ScratchEnd(scratch);
+
+    if (source_time > 0 && binary_time == 0)
+    {
+        KERROR("[ShaderSystem::AcquireShader]: %S hasn't been compiled, build the KraftShaders target to compile res/shaders", shader_path);
+        return nullptr;
+    }
+
+    if (binary_time > 0 && source_time > binary_time)
+    {
+        KWARN("[ShaderSystem::AcquireShader]: %S is older than its source, build the KraftShaders target to recompile it", shader_path);
+    }
+
     ShaderReference* reference = &shader_system_state->shaders[free_index];
     if (!shaderfx::LoadShaderFX(shader_system_state->arena, shader_path, &reference->shader.ShaderEffect))
     {
@@ -95,11 +120,92 @@ Shader* ShaderSystem::AcquireShader(String8 shader_path, bool auto_release)
     reference->auto_release = auto_release;
 
     BuildUniformCache(&reference->shader);
-    g_Renderer->CreateRenderPipeline(&reference->shader);
+
+    reference->shader.Ready = false;
+    g_Renderer->CreateRenderPipeline(&reference->shader, &reference->pending_pipelines);
+    shader_system_state->pending_shader_count++;
 
     return &shader_system_state->shaders[free_index].shader;
 }
 
+u32 ShaderSystem::PrewarmShaders(const String8* shader_paths, u32 count)
+{
+    u32 acquired = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+        if (AcquireShader(shader_paths[i], false))
+        {
+            acquired++;
+        }
+    }
+
+    KDEBUG("[ShaderSystem::PrewarmShaders]: Creating pipelines for %d shaders", acquired);
+    return acquired;
+}
+
+static bool IsShaderPending(ShaderReference* reference)
+{
+    return reference->shader.RendererData && !reference->shader.Ready;
+}
+
+static void WaitForPipelines(ShaderReference* reference)
+{
+    KASSERT(JobSystem::IsMainThread());
+
+    // The main thread helps out with the pipeline jobs while it waits
+    JobSystem::WaitForCounter(&reference->pending_pipelines);
+    if (IsShaderPending(reference))
+    {
+        reference->shader.Ready = true;
+        shader_system_state->pending_shader_count--;
+    }
+}
+
+void ShaderSystem::WaitForShader(Shader* shader)
+{
+    WaitForPipelines(&shader_system_state->shaders[shader->ID]);
+}
+
+void ShaderSystem::WaitForPendingShaders()
+{
+    for (u32 i = 0; i < shader_system_state->max_shader_count && shader_system_state->pending_shader_count > 0; i++)
+    {
+        WaitForPipelines(&shader_system_state->shaders[i]);
+    }
+}
+
+bool ShaderSystem::HasPendingShaders()
+{
+    ProcessPendingShaders();
+    return shader_system_state->pending_shader_count > 0;
+}
+
+void ShaderSystem::ProcessPendingShaders()
+{
+    for (u32 i = 0; i < shader_system_state->max_shader_count && shader_system_state->pending_shader_count > 0; i++)
+    {
+        ShaderReference* reference = &shader_system_state->shaders[i];
+        if (IsShaderPending(reference) && JobSystem::IsDone(&reference->pending_pipelines))
+        {
+            reference->shader.Ready = true;
+            shader_system_state->pending_shader_count--;
+        }
+    }
+}
+
+// The shader compiler writes "effect.kfx.bkfx" next to "effect.kfx". Returns the source of a compiled effect, or an empty
+// string if the path doesn't look like one. The result is null-terminated.
+static String8 GetShaderSourcePath(ArenaAllocator* arena, String8 shader_path)
+{
+    String8 binary_extension = String8Raw(".bkfx");
+    if (!StringEndsWith(shader_path, binary_extension))
+    {
+        return {};
+    }
+
+    return StringCopy(arena, String8FromPtrAndLength(shader_path.ptr, shader_path.count - binary_extension.count));
+}
+
 static u32 AddUniform(Shader* shader, String8 name, u32 location, u32 offset, u32 size, r::ShaderDataType data_type, r::ShaderUniformScope::Enum scope)
 {
     ShaderUniform uniform = {};
@@ -124,7 +230,10 @@ static void BuildUniformCache(Shader* shader)
 
     const shaderfx::ShaderEffect&      Effect = shader->ShaderEffect;
     const shaderfx::VariantDefinition& variant0 = Effect.variants[0];
-    shader->UniformCache.Reserve(global_resource_bindings_count + (variant0.resources != nullptr ? variant0.resources->binding_count : 0) + variant0.contant_buffers->field_count);
+    shader->UniformCache.Reserve(
+        global_resource_bindings_count + (variant0.resources != nullptr ? variant0.resources->binding_count : 0) +
+        (variant0.contant_buffers != nullptr ? variant0.contant_buffers->field_count : 0)
+    );
 
     // Collect global resources
     for (int i = 0; i < Effect.global_resource_count; i++)
@@ -194,7 +303,10 @@ static void BuildUniformCache(Shader* shader)
         }
     }
 
-    // Cache constant buffers as local uniforms
+    // Cache constant buffers as local uniforms; compute variants don't need one
+    if (!variant0.contant_buffers)
+        return;
+
     u32 offset = 0;
     for (u64 i = 0; i < variant0.contant_buffers->field_count; i++)
     {
@@ -212,7 +324,11 @@ bool ShaderSystem::ReloadShader(Shader* shader)
 
     KINFO("[ShaderSystem::ReloadShader]: Reloading shader '%S'", shader->Path);
 
+    ShaderReference* reference = &shader_system_state->shaders[shader->ID];
+    WaitForPipelines(reference);
     g_Renderer->DestroyRenderPipeline(shader);
+    shader->Ready = false;
+
     if (!shaderfx::LoadShaderFX(shader_system_state->arena, shader->Path, &shader->ShaderEffect))
     {
         KERROR("[ShaderSystem::ReloadShader]: Failed to reload %S", shader->Path);
@@ -222,7 +338,9 @@ bool ShaderSystem::ReloadShader(Shader* shader)
     // Rebuild the uniform cache
     BuildUniformCache(shader);
 
-    g_Renderer->CreateRenderPipeline(shader);
+    shader->Ready = false;
+    g_Renderer->CreateRenderPipeline(shader, &reference->pending_pipelines);
+    shader_system_state->pending_shader_count++;
 
     KSUCCESS("[ShaderSystem::ReloadShader]: Successfully reloaded '%S'", shader->Path);
     return true;
@@ -333,6 +451,7 @@ static void ReleaseShaderInternal(u32 index)
 
     if (reference->auto_release && reference->ref_count == 0)
     {
+        WaitForPipelines(reference);
         g_Renderer->DestroyRenderPipeline(&reference->shader);
 
         reference->auto_release = false;
@@ -370,6 +489,11 @@ Shader* ShaderSystem::GetActiveShader()
     return shader_system_state->current_shader;
 }
 
+i32 ShaderSystem::GetActiveVariantIndex()
+{
+    return shader_system_state->active_variant_index;
+}
+
 void ShaderSystem::SetActiveVariant(String8 variant_name)
 {
     shader_system_state->active_variant_name = variant_name;
@@ -392,6 +516,12 @@ i32 ShaderSystem::FindVariantIndex(const Shader* shader, String8 variant_name)
 
 Shader* ShaderSystem::Bind(Shader* Shader)
 {
+    // The pipelines are still being created - skip
+    if (!Shader->Ready)
+    {
+        return nullptr;
+    }
+
     // Resolve variant index
     u32 variant_index = 0;
     if (shader_system_state->active_variant_name.count > 0)
@@ -410,6 +540,7 @@ Shader* ShaderSystem::Bind(Shader* Shader)
 
     shader_system_state->current_shader_id = Shader->ID;
     shader_system_state->current_shader = Shader;
+    shader_system_state->active_variant_index = (i32)variant_index;
 
     return Shader;
 }
@@ -428,6 +559,7 @@ void ShaderSystem::Unbind()
     {
         shader_system_state->current_shader_id = KRAFT_INVALID_ID;
         shader_system_state->current_shader = nullptr;
+        shader_system_state->active_variant_index = -1;
     }
 }
 
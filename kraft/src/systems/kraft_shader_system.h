@@ -1,6 +1,7 @@
 #pragma once
 
 #include "core/kraft_core.h"
+#include "core/kraft_jobs.h"
 
 namespace kraft {
 
@@ -18,10 +19,11 @@ struct ShaderUniform;
 
 struct ShaderReference
 {
-    u32    ref_count;
-    bool   auto_release;
-    u64    source_last_modified_time;
-    Shader shader;
+    u32        ref_count;
+    bool       auto_release;
+    u64        source_last_modified_time;
+    JobCounter pending_pipelines; // Pipeline creation running on the job threads
+    Shader     shader;
 };
 
 struct ShaderSystemState
@@ -34,6 +36,9 @@ struct ShaderSystemState
     u32     current_shader_id;
     Shader* current_shader;
 
+    // Shaders whose pipelines are still being created
+    u32 pending_shader_count;
+
     // Active variant for surface-driven variant selection
     String8 active_variant_name;
     i32     active_variant_index; // Cached index for the current shader, -1 if not resolved
@@ -48,8 +53,23 @@ struct ShaderSystem
     static void Init(u32 max_shader_count);
     static void Shutdown();
 
+    // The pipelines of the shader are created on the job threads, the shader is returned right away and becomes Ready
+    // at the start of the first frame after they are done. Until then draws with it are skipped.
     static Shader* AcquireShader(String8 shader_path, bool auto_release = true);
     static bool    ReleaseShader(Shader* shader);
+
+    // Acquires the shaders and keeps them loaded, so their pipelines get created while a loading screen is up. Returns
+    // the number of shaders that were found.
+    static u32  PrewarmShaders(const String8* shader_paths, u32 count);
+    static bool HasPendingShaders();
+
+    // Blocks until the pipelines have been created; for shaders that are bound right after being acquired
+    static void WaitForShader(Shader* shader);
+    static void WaitForPendingShaders();
+
+    // Marks the shaders whose pipelines are done as ready, called by the renderer at the start of every frame
+    static void ProcessPendingShaders();
+
     static bool    ReloadShader(Shader* shader);
     static void    ReloadAllShaders();
     static Shader* GetDefaultShader();
@@ -66,6 +86,9 @@ struct ShaderSystem
     // If a shader doesn't have the variant, Bind returns nullptr (caller should skip draw).
     static void SetActiveVariant(String8 variant_name);
 
+    // Variant of the bound shader that draws use. Returns -1 if no shader is bound.
+    static i32 GetActiveVariantIndex();
+
     // Find a variant index by name in the given shader. Returns -1 if not found.
     static i32 FindVariantIndex(const Shader* shader, String8 variant_name);
 
@@ -32,15 +32,43 @@ struct TextureReference {
     TextureReference(r::Handle<Texture> handle, bool auto_release = true) : ref_count(0), auto_release(auto_release), handle(handle) {}
 };
 
+struct TextureLoadRequest {
+    r::Handle<Texture> handle;
+    String8 path;
+    i32 desired_channels;
+
+    // Filled in by the worker
+    u8* pixels;
+    i32 width;
+    i32 height;
+};
+
 // Private state
 struct TextureSystemState {
     u32 max_texture_count;
     FlatHashMap<String8, TextureReference> cache;
     Array<r::Handle<Texture>> dirty_textures;
+
+    // Async loading
+    Array<r::Handle<Texture>> placeholder_textures;
+    Array<r::Handle<Texture>> pending_textures;
+    JobCounter pending_loads;
 };
 
 static TextureSystemState* texture_system_state = 0;
 static void _createDefaultTextures();
+static void UploadTextureJob(void* user_data);
+
+static bool RemoveTextureFromList(Array<r::Handle<Texture>>& list, r::Handle<Texture> handle) {
+    for (u32 i = 0; i < list.Length; i++) {
+        if (list[i] == handle) {
+            list.Pop(i);
+            return true;
+        }
+    }
+
+    return false;
+}
 
 static r::Format::Enum FormatFromChannels(u8 channels) {
     if (channels == 1) {
@@ -68,6 +96,8 @@ void TextureSystem::Init(u32 max_texture_count) {
 }
 
 void TextureSystem::Shutdown() {
+    WaitForPendingTextures();
+
     u32 total_size = sizeof(TextureSystemState);
     kraft::Free(texture_system_state, total_size, MEMORY_TAG_TEXTURE_SYSTEM);
 
@@ -136,6 +166,131 @@ r::Handle<Texture> TextureSystem::AcquireTexture(String8 name, bool auto_release
     return handle;
 }
 
+// Runs on a worker thread
+static void DecodeTextureJob(void* user_data) {
+    TextureLoadRequest* request = (TextureLoadRequest*)user_data;
+
+    stbi_set_flip_vertically_on_load_thread(1);
+    request->pixels = stbi_load(request->path.str, &request->width, &request->height, 0, request->desired_channels);
+    if (!request->pixels) {
+        KERROR("[TextureSystem::DecodeTextureJob]: Failed to load image '%S'", request->path);
+        if (const char* reason = stbi_failure_reason()) {
+            KERROR("[TextureSystem::DecodeTextureJob]: Error %s", reason);
+        }
+    }
+
+    // Hand the pixels back to the main thread for the upload
+    JobSystem::Submit({
+        .Function = UploadTextureJob,
+        .UserData = request,
+        .Counter = &texture_system_state->pending_loads,
+        .MainThreadOnly = true,
+    });
+}
+
+// Runs on the main thread
+static void UploadTextureJob(void* user_data) {
+    TextureLoadRequest* request = (TextureLoadRequest*)user_data;
+
+    // The texture may have been released while we were decoding it
+    bool still_wanted = RemoveTextureFromList(texture_system_state->pending_textures, request->handle);
+    if (still_wanted && request->pixels) {
+        u64 size = (u64)request->width * request->height * request->desired_channels;
+        r::BufferView staging_buf = r::ResourceManager->CreateTempBuffer(size);
+        MemCpy(staging_buf.Ptr, request->pixels, size);
+
+        if (!r::ResourceManager->UploadTexture(request->handle, staging_buf.GPUBuffer, staging_buf.Offset)) {
+            KERROR("[TextureSystem::UploadTextureJob]: Texture upload failed for '%S'", request->path);
+        } else {
+            // Swaps the placeholder out for the real image
+            texture_system_state->dirty_textures.Push(request->handle);
+            KDEBUG("[TextureSystem::UploadTextureJob]: Loaded texture %S", request->path);
+        }
+    }
+
+    if (request->pixels) {
+        stbi_image_free(request->pixels);
+    }
+
+    kraft::Free(request->path.ptr, request->path.count + 1, MEMORY_TAG_TEXTURE_SYSTEM);
+    kraft::Free(request, sizeof(TextureLoadRequest), MEMORY_TAG_TEXTURE_SYSTEM);
+}
+
+r::Handle<Texture> TextureSystem::AcquireTextureAsync(String8 name, bool auto_release) {
+    auto existing_texture = texture_system_state->cache.find(name);
+    if (existing_texture != texture_system_state->cache.end()) {
+        existing_texture->second.ref_count++;
+        return existing_texture->second.handle;
+    }
+
+    if (texture_system_state->cache.size() == texture_system_state->max_texture_count) {
+        KERROR("[TextureSystem::AcquireTextureAsync]: Failed to acquire texture; Out-of-memory!");
+        return r::Handle<Texture>::Invalid();
+    }
+
+    TextureLoadRequest* request = (TextureLoadRequest*)Malloc(sizeof(TextureLoadRequest), MEMORY_TAG_TEXTURE_SYSTEM, true);
+    request->path.ptr = (u8*)Malloc(name.count + 1, MEMORY_TAG_TEXTURE_SYSTEM);
+    request->path.count = name.count;
+    MemCpy(request->path.ptr, name.ptr, name.count);
+    request->path.ptr[name.count] = 0;
+
+    // Only the header is read here; we need the dimensions to create the texture up front
+    i32 width, height, channels;
+    if (!stbi_info(request->path.str, &width, &height, &channels)) {
+        KERROR("[TextureSystem::AcquireTextureAsync]: Failed to load metadata for image '%S' with error '%s'", name, stbi_failure_reason());
+
+        kraft::Free(request->path.ptr, request->path.count + 1, MEMORY_TAG_TEXTURE_SYSTEM);
+        kraft::Free(request, sizeof(TextureLoadRequest), MEMORY_TAG_TEXTURE_SYSTEM);
+        return r::Handle<Texture>::Invalid();
+    }
+
+    // GPUs dont usually support 3 channel images, so we load with 4
+    request->desired_channels = (channels == 3) ? 4 : channels;
+
+    r::Handle<Texture> handle = r::ResourceManager->CreateTexture({
+        .DebugName = request->path.str,
+        .Dimensions = {(f32)width, (f32)height, 1, (f32)request->desired_channels},
+        .Format = FormatFromChannels(request->desired_channels),
+        .Usage = r::TextureUsageFlags::TEXTURE_USAGE_FLAGS_TRANSFER_SRC | r::TextureUsageFlags::TEXTURE_USAGE_FLAGS_TRANSFER_DST | r::TextureUsageFlags::TEXTURE_USAGE_FLAGS_SAMPLED,
+    });
+
+    KASSERT(!handle.IsInvalid());
+    request->handle = handle;
+
+    texture_system_state->cache[name] = TextureReference(handle, auto_release);
+    texture_system_state->placeholder_textures.Push(handle);
+    texture_system_state->pending_textures.Push(handle);
+
+    JobSystem::Submit({
+        .Function = DecodeTextureJob,
+        .UserData = request,
+        .Counter = &texture_system_state->pending_loads,
+    });
+
+    return handle;
+}
+
+bool TextureSystem::IsTextureReady(r::Handle<Texture> handle) {
+    for (u32 i = 0; i < texture_system_state->pending_textures.Length; i++) {
+        if (texture_system_state->pending_textures[i] == handle) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool TextureSystem::HasPendingTextures() {
+    return !JobSystem::IsDone(&texture_system_state->pending_loads);
+}
+
+void TextureSystem::WaitForPendingTextures() {
+    KASSERT(JobSystem::IsMainThread());
+
+    // The main thread runs the upload jobs while it waits
+    JobSystem::WaitForCounter(&texture_system_state->pending_loads);
+}
+
 r::Handle<Texture> TextureSystem::AcquireTextureWithData(String8 name, u8* data, u32 width, u32 height, u32 channels) {
     char debug_name[512] = {0};
     MemCpy(debug_name, name.ptr, name.count);
@@ -177,6 +332,10 @@ void TextureSystem::ReleaseTexture(String8 texture_name) {
 
     ref.ref_count--;
     if (ref.ref_count == 0 && ref.auto_release) {
+        // If the texture is still loading, the upload job will see that it is gone and drop the pixels
+        RemoveTextureFromList(texture_system_state->pending_textures, ref.handle);
+        RemoveTextureFromList(texture_system_state->placeholder_textures, ref.handle);
+
         r::ResourceManager->DestroyTexture(ref.handle);
         texture_system_state->cache.erase(it);
     }
@@ -294,6 +453,14 @@ void TextureSystem::ClearDirtyTextures() {
     texture_system_state->dirty_textures.Clear();
 }
 
+Array<r::Handle<Texture>> TextureSystem::GetPlaceholderTextures() {
+    return texture_system_state->placeholder_textures;
+}
+
+void TextureSystem::ClearPlaceholderTextures() {
+    texture_system_state->placeholder_textures.Clear();
+}
+
 //
 // Internal methods
 //
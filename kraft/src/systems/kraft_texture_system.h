@@ -18,6 +18,14 @@ void Init(u32 max_texture_count);
 void Shutdown();
 
 r::Handle<Texture> AcquireTexture(String8 name, bool auto_release = true);
+
+// Returns a handle right away that samples the default diffuse texture until the image
+// has been decoded on a worker thread and uploaded on the main thread
+r::Handle<Texture> AcquireTextureAsync(String8 name, bool auto_release = true);
+bool IsTextureReady(r::Handle<Texture> handle);
+bool HasPendingTextures();
+void WaitForPendingTextures();
+
 r::Handle<Texture> AcquireTextureWithData(String8 name, u8* data, u32 width, u32 height, u32 channels);
 void ReleaseTexture(String8 name);
 void ReleaseTexture(r::Handle<Texture> handle);
@@ -26,6 +34,10 @@ kraft::BufferView CreateEmptyTexture(u32 width, u32 height, u8 channels);
 r::Handle<Texture> GetDefaultDiffuseTexture();
 Array<r::Handle<Texture>> GetDirtyTextures();
 void ClearDirtyTextures();
+
+// Textures that are still loading and need to be bound to the default diffuse texture
+Array<r::Handle<Texture>> GetPlaceholderTextures();
+void ClearPlaceholderTextures();
 }; // namespace TextureSystem
 
 } // namespace kraft
\ No newline at end of file
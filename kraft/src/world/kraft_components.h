@@ -16,6 +16,9 @@ struct TransformComponent
     Vec3f Scale = kraft::Vec3fOne;
     Mat4f ModelMatrix = kraft::ScaleMatrix(Scale) * kraft::RotationMatrixFromEulerAngles(Rotation) * kraft::TranslationMatrix(Position);
 
+    // Set whenever the local transform changes, cleared by World::UpdateTransforms() once the world transform is up to date
+    bool Dirty = true;
+
     TransformComponent() = default;
     TransformComponent(Vec3f Position, Vec3f Rotation, Vec3f Scale) : Position(Position), Rotation(Rotation), Scale(Scale)
     {
@@ -27,6 +30,7 @@ struct TransformComponent
         // Since we have row-major matrices, the correct order of multiplication is SRT
         ModelMatrix = kraft::ScaleMatrix(Scale) * kraft::RotationMatrixFromEulerAngles(Rotation) * kraft::TranslationMatrix(Position);
         // ModelMatrix = kraft::TranslationMatrix(Position) * kraft::RotationMatrixFromEulerAngles(Rotation) * kraft::ScaleMatrix(Scale);
+        Dirty = true;
     }
 
     void SetTransform(Vec3f Position, Vec3f Rotation, Vec3f Scale)
@@ -66,9 +70,16 @@ struct TransformComponent
     {
         this->ModelMatrix = matrix;
         this->ModelMatrix.Decompose(this->Position, this->Rotation, this->Scale);
+        this->Dirty = true;
     }
 };
 
+// Local transform concatenated with the transforms of all the parents
+struct WorldTransformComponent
+{
+    Mat4f WorldMatrix = Mat4f(Identity);
+};
+
 struct RelationshipComponent
 {
     EntityHandleT        Parent = EntityHandleT(-1);
@@ -89,11 +100,47 @@ struct MetadataComponent
 
 struct MeshComponent
 {
-    Material*           MaterialInstance = nullptr;
-    r::GeometryDrawData DrawData = {};
+    Material* MaterialInstance = nullptr;
+
+    // Draw data and bounds are read through the geometry, so ranges moved by the renderer (compaction, growing
+    // updates) are picked up without touching every component
+    const Geometry* GeometryInstance = nullptr;
 
     MeshComponent() = default;
-    MeshComponent(Material* MaterialInstance, r::GeometryDrawData DrawData) : MaterialInstance(MaterialInstance), DrawData(DrawData) {};
+    MeshComponent(Material* MaterialInstance, const Geometry* Source) : MaterialInstance(MaterialInstance), GeometryInstance(Source) {};
+
+    void SetGeometry(const Geometry* Source)
+    {
+        this->GeometryInstance = Source;
+    }
+
+    const r::GeometryDrawData& GetDrawData() const
+    {
+        return GeometryInstance->DrawData;
+    }
+
+    // Object space bounds used for culling; meshes without bounds are always drawn
+    const r::GeometryBounds& GetBounds() const
+    {
+        return GeometryInstance->Bounds;
+    }
+};
+
+// Low poly stand-in of a mesh that hides whatever is behind it when World::OcclusionCulling is enabled. The triangles
+// are in object space and must fit inside the mesh, otherwise objects that peek around it get culled.
+struct OccluderComponent
+{
+    Array<Vec3f> Vertices;
+    Array<u32>   Indices;
+
+    OccluderComponent() = default;
+
+    // Box occluder, generated from the mesh bounds shrunk by `Scale`. Only correct for solid, box-like meshes such as
+    // buildings or walls, where the shrunk box stays inside the geometry.
+    OccluderComponent(const r::GeometryBounds& Bounds, f32 Scale = 0.9f) : Vertices(8), Indices(36)
+    {
+        r::BuildBoxOccluder(Bounds.Center, Bounds.Extents * Scale, Vertices.Data(), Indices.Data());
+    }
 };
 
 struct LightComponent
@@ -4,6 +4,8 @@
 #include <core/kraft_base_includes.h>
 
 #include <containers/kraft_array.h>
+#include <renderer/kraft_culling.h>
+#include <renderer/kraft_occlusion_culling.h>
 #include <renderer/kraft_renderer_frontend.h>
 #include <renderer/kraft_renderer_types.h>
 #include <world/kraft_components.h>
@@ -52,6 +54,9 @@ Entity World::CreateEntity(String8 name, EntityHandleT Parent, Vec3f Position, V
     Registry.emplace<MetadataComponent>(EntityHandle, name);
     Registry.emplace<RelationshipComponent>(EntityHandle, Parent);
     Registry.emplace<TransformComponent>(EntityHandle, Position, Rotation, Scale);
+    Registry.emplace<WorldTransformComponent>(EntityHandle);
+    this->HierarchyDirty = true;
+
     if (Parent != EntityHandleInvalid)
     {
         RelationshipComponent& Relationship = Registry.get<RelationshipComponent>(Parent);
@@ -81,6 +86,7 @@ void World::DestroyEntity(Entity Entity)
     }
 
     Registry.destroy(Entity.EntityHandle);
+    this->HierarchyDirty = true;
 }
 
 Entity World::GetEntity(EntityHandleT Handle) const
@@ -94,26 +100,345 @@ bool World::IsValidEntity(EntityHandleT Handle) const
     return Entities.contains(Handle);
 }
 
+#define KRAFT_WORLD_CULLING_BATCH_SIZE 256
+
+struct WorldCullingJobData
+{
+    const r::Frustum*     Frustum;
+    const MeshComponent** Meshes;
+    const Mat4f**         ModelMatrices;
+    r::CullingBounds      Bounds;
+    u8*                   Visible;
+    std::atomic<u32>      VisibleCount;
+};
+
+static void WorldCullingJob(void* user_data, u32 start, u32 end)
+{
+    WorldCullingJobData* data = (WorldCullingJobData*)user_data;
+    for (u32 i = start; i < end; i++)
+    {
+        r::WriteWorldBounds(data->Meshes[i]->GetBounds(), *data->ModelMatrices[i], &data->Bounds, i);
+    }
+
+    // Only the bounds are needed when occlusion culling runs without frustum culling
+    u32 visible_count = end - start;
+    if (data->Frustum)
+    {
+        visible_count = r::CullBounds(*data->Frustum, data->Bounds, start, end, data->Visible);
+    }
+    else
+    {
+        MemSet(data->Visible + start, 1, end - start);
+    }
+
+    data->VisibleCount.fetch_add(visible_count, std::memory_order_relaxed);
+}
+
+struct WorldOcclusionJobData
+{
+    const r::OcclusionBuffer* Buffer;
+    const Mat4f*              ViewProjection;
+    r::CullingBounds          Bounds;
+    u8*                       Visible;
+    std::atomic<u32>          OccludedCount;
+};
+
+static void WorldOcclusionJob(void* user_data, u32 start, u32 end)
+{
+    WorldOcclusionJobData* data = (WorldOcclusionJobData*)user_data;
+    u32                    occluded_count = r::CullOccludedBounds(*data->Buffer, *data->ViewProjection, data->Bounds, start, end, data->Visible);
+    data->OccludedCount.fetch_add(occluded_count, std::memory_order_relaxed);
+}
+
 void World::Render()
 {
     g_Renderer->Camera = &this->Camera;
     // kraft::r::Renderer->CurrentWorld = this;
 
+    this->UpdateTransforms();
+
     auto Group = Registry.group<MeshComponent, TransformComponent>();
+    u32  Count = (u32)Group.size();
+    if (Count == 0)
+    {
+        this->RenderStats = {};
+        return;
+    }
+
+    TempArena             Scratch = ScratchBegin(0, 0);
+    EntityHandleT*        Handles = ArenaPushArrayNoZero(Scratch.arena, EntityHandleT, Count);
+    const MeshComponent** Meshes = ArenaPushArrayNoZero(Scratch.arena, const MeshComponent*, Count);
+    const Mat4f**         ModelMatrices = ArenaPushArrayNoZero(Scratch.arena, const Mat4f*, Count);
+    u8*                   Visible = ArenaPushArrayNoZero(Scratch.arena, u8, Count);
+
+    u32 Index = 0;
     for (auto EntityHandle : Group)
     {
         auto [Transform, Mesh] = Group.get<TransformComponent, MeshComponent>(EntityHandle);
+        Handles[Index] = EntityHandle;
+        Meshes[Index] = &Mesh;
+
+        // Entities that aren't part of the hierarchy only have their local transform
+        const WorldTransformComponent* WorldTransform = Registry.try_get<WorldTransformComponent>(EntityHandle);
+        ModelMatrices[Index] = WorldTransform ? &WorldTransform->WorldMatrix : &Transform.ModelMatrix;
+        Index++;
+    }
+
+    u32 VisibleCount = Count;
+    u32 OccludedCount = 0;
+    if (this->FrustumCulling || this->OcclusionCulling)
+    {
+        Mat4f               ViewProjection = this->Camera.GetViewMatrix() * this->Camera.ProjectionMatrix;
+        r::Frustum          Frustum = r::FrustumFromViewProjection(ViewProjection);
+        WorldCullingJobData JobData;
+        JobData.Frustum = this->FrustumCulling ? &Frustum : nullptr;
+        JobData.Meshes = Meshes;
+        JobData.ModelMatrices = ModelMatrices;
+        JobData.Bounds = {
+            .CenterX = ArenaPushArrayNoZero(Scratch.arena, f32, Count),
+            .CenterY = ArenaPushArrayNoZero(Scratch.arena, f32, Count),
+            .CenterZ = ArenaPushArrayNoZero(Scratch.arena, f32, Count),
+            .ExtentX = ArenaPushArrayNoZero(Scratch.arena, f32, Count),
+            .ExtentY = ArenaPushArrayNoZero(Scratch.arena, f32, Count),
+            .ExtentZ = ArenaPushArrayNoZero(Scratch.arena, f32, Count),
+            .Radius = ArenaPushArrayNoZero(Scratch.arena, f32, Count),
+        };
+        JobData.Visible = Visible;
+        JobData.VisibleCount = 0;
+
+        JobSystem::ParallelFor(Count, KRAFT_WORLD_CULLING_BATCH_SIZE, WorldCullingJob, &JobData);
+        VisibleCount = JobData.VisibleCount.load(std::memory_order_relaxed);
+
+        if (this->OcclusionCulling)
+        {
+            OccludedCount = this->CullOccluded(Scratch.arena, ViewProjection, JobData.Bounds, Count, Visible);
+            VisibleCount -= OccludedCount;
+        }
+    }
+    else
+    {
+        MemSet(Visible, 1, Count);
+    }
+
+    // Renderables are added from the main thread, in group order, so the output doesn't depend on how the work was split
+    for (u32 i = 0; i < Count; i++)
+    {
+        if (!Visible[i])
+            continue;
+
         g_Renderer->AddRenderable(kraft::r::Renderable{
-            .ModelMatrix = Transform.ModelMatrix, // GetWorldSpaceTransformMatrix(Entity(EntityHandle, this)),
-            .MaterialInstance = Mesh.MaterialInstance,
-            .DrawData = Mesh.DrawData,
-            .EntityId = (u32)EntityHandle,
+            .ModelMatrix = *ModelMatrices[i],
+            .MaterialInstance = Meshes[i]->MaterialInstance,
+            .DrawData = Meshes[i]->GetDrawData(),
+            .EntityId = (u32)Handles[i],
+            .Bounds = Meshes[i]->GetBounds(),
         });
     }
+
+    this->RenderStats.VisibleCount = VisibleCount;
+    this->RenderStats.CulledCount = Count - VisibleCount;
+    this->RenderStats.OccludedCount = OccludedCount;
+
+    ScratchEnd(Scratch);
+}
+
+u32 World::CullOccluded(ArenaAllocator* Arena, const Mat4f& ViewProjection, const r::CullingBounds& Bounds, u32 Count, u8* Visible)
+{
+    auto Occluders = Registry.view<OccluderComponent, TransformComponent>();
+
+    r::OccluderMesh* Meshes = ArenaPushArrayNoZero(Arena, r::OccluderMesh, Occluders.size_hint());
+    u32              OccluderCount = 0;
+    for (auto EntityHandle : Occluders)
+    {
+        auto [Occluder, Transform] = Occluders.get<OccluderComponent, TransformComponent>(EntityHandle);
+        if (Occluder.Indices.Length == 0)
+            continue;
+
+        const WorldTransformComponent* WorldTransform = Registry.try_get<WorldTransformComponent>(EntityHandle);
+        Meshes[OccluderCount++] = {
+            .Vertices = Occluder.Vertices.Data(),
+            .Indices = Occluder.Indices.Data(),
+            .VertexCount = (u32)Occluder.Vertices.Length,
+            .IndexCount = (u32)Occluder.Indices.Length,
+            .ModelMatrix = WorldTransform ? &WorldTransform->WorldMatrix : &Transform.ModelMatrix,
+        };
+    }
+
+    if (OccluderCount == 0)
+        return 0;
+
+    r::OcclusionBuffer Buffer = r::CreateOcclusionBuffer(Arena, KRAFT_OCCLUSION_BUFFER_WIDTH, KRAFT_OCCLUSION_BUFFER_HEIGHT);
+    r::RasterizeOccluders(&Buffer, ViewProjection, Meshes, OccluderCount);
+
+    WorldOcclusionJobData JobData;
+    JobData.Buffer = &Buffer;
+    JobData.ViewProjection = &ViewProjection;
+    JobData.Bounds = Bounds;
+    JobData.Visible = Visible;
+    JobData.OccludedCount = 0;
+    JobSystem::ParallelFor(Count, KRAFT_WORLD_CULLING_BATCH_SIZE, WorldOcclusionJob, &JobData);
+
+    return JobData.OccludedCount.load(std::memory_order_relaxed);
+}
+
+void World::RebuildHierarchy()
+{
+    this->Hierarchy.Clear();
+    this->HierarchySubtrees.Clear();
+
+    auto Relationships = Registry.view<RelationshipComponent, TransformComponent, WorldTransformComponent>();
+    for (auto EntityHandle : Relationships)
+    {
+        if (Relationships.get<RelationshipComponent>(EntityHandle).Parent == EntityHandleInvalid)
+        {
+            this->Hierarchy.Push({ .Handle = EntityHandle, .ParentIndex = -1 });
+        }
+    }
+
+    this->HierarchyRootCount = (u32)this->Hierarchy.Length;
+
+    // Depth first, pre-order walk of every child of the roots, so each subtree ends up in one contiguous range
+    TempArena           Scratch = ScratchBegin(0, 0);
+    u32                 StackCapacity = (u32)Registry.storage<RelationshipComponent>().size();
+    WorldHierarchyNode* Stack = ArenaPushArrayNoZero(Scratch.arena, WorldHierarchyNode, StackCapacity);
+    for (u32 RootIndex = 0; RootIndex < this->HierarchyRootCount; RootIndex++)
+    {
+        const RelationshipComponent& Root = Registry.get<RelationshipComponent>(this->Hierarchy[RootIndex].Handle);
+        for (u32 ChildIndex = 0; ChildIndex < Root.Children.Length; ChildIndex++)
+        {
+            this->HierarchySubtrees.Push((u32)this->Hierarchy.Length);
+
+            u32 StackSize = 0;
+            Stack[StackSize++] = { .Handle = Root.Children[ChildIndex], .ParentIndex = (i32)RootIndex };
+            while (StackSize > 0)
+            {
+                WorldHierarchyNode Node = Stack[--StackSize];
+                if (!Registry.all_of<TransformComponent, WorldTransformComponent>(Node.Handle))
+                    continue;
+
+                i32 NodeIndex = (i32)this->Hierarchy.Length;
+                this->Hierarchy.Push(Node);
+
+                // Pushed in reverse so children keep their order in the flattened array
+                const RelationshipComponent& Relationship = Registry.get<RelationshipComponent>(Node.Handle);
+                for (u32 i = (u32)Relationship.Children.Length; i > 0; i--)
+                {
+                    KASSERT(StackSize < StackCapacity);
+                    Stack[StackSize++] = { .Handle = Relationship.Children[i - 1], .ParentIndex = NodeIndex };
+                }
+            }
+        }
+    }
+
+    ScratchEnd(Scratch);
+    this->HierarchyDirty = false;
+}
+
+// The jobs only touch the component storages directly, lookups through the registry aren't safe to do from several threads
+struct WorldTransformJobData
+{
+    World::RegistryType::storage_for_type<TransformComponent>*      Transforms;
+    World::RegistryType::storage_for_type<WorldTransformComponent>* WorldTransforms;
+    const WorldHierarchyNode*                                       Hierarchy;
+    const u32*                                                      Subtrees;
+    u32                                                             SubtreeCount;
+    u32                                                             HierarchyLength;
+    u8*                                                             Changed;
+    bool                                                            ForceUpdate;
+};
+
+// Nodes are visited in order, so the parent's world transform is always final by the time a child reads it
+static void UpdateWorldTransforms(WorldTransformJobData* Data, u32 Start, u32 End)
+{
+    for (u32 i = Start; i < End; i++)
+    {
+        const WorldHierarchyNode& Node = Data->Hierarchy[i];
+        TransformComponent&       Transform = Data->Transforms->get(Node.Handle);
+        bool                      ParentChanged = Node.ParentIndex >= 0 && Data->Changed[Node.ParentIndex];
+        if (!Transform.Dirty && !ParentChanged && !Data->ForceUpdate)
+            continue;
+
+        WorldTransformComponent& WorldTransform = Data->WorldTransforms->get(Node.Handle);
+        if (Node.ParentIndex >= 0)
+        {
+            const WorldTransformComponent& Parent = Data->WorldTransforms->get(Data->Hierarchy[Node.ParentIndex].Handle);
+            WorldTransform.WorldMatrix = Transform.ModelMatrix * Parent.WorldMatrix;
+        }
+        else
+        {
+            WorldTransform.WorldMatrix = Transform.ModelMatrix;
+        }
+
+        Transform.Dirty = false;
+        Data->Changed[i] = 1;
+    }
+}
+
+static void WorldTransformJob(void* user_data, u32 start, u32 end)
+{
+    WorldTransformJobData* Data = (WorldTransformJobData*)user_data;
+    for (u32 Subtree = start; Subtree < end; Subtree++)
+    {
+        u32 SubtreeEnd = Subtree + 1 < Data->SubtreeCount ? Data->Subtrees[Subtree + 1] : Data->HierarchyLength;
+        UpdateWorldTransforms(Data, Data->Subtrees[Subtree], SubtreeEnd);
+    }
+}
+
+void World::UpdateTransforms()
+{
+    // Reparenting can change the world transform of an entity whose local transform didn't change, so everything is
+    // recomputed after the hierarchy changes
+    bool ForceUpdate = this->HierarchyDirty;
+    if (this->HierarchyDirty)
+    {
+        this->RebuildHierarchy();
+    }
+
+    if (this->Hierarchy.Length == 0)
+        return;
+
+    TempArena             Scratch = ScratchBegin(0, 0);
+    WorldTransformJobData Data = {
+        .Transforms = &this->Registry.storage<TransformComponent>(),
+        .WorldTransforms = &this->Registry.storage<WorldTransformComponent>(),
+        .Hierarchy = this->Hierarchy.Data(),
+        .Subtrees = this->HierarchySubtrees.Data(),
+        .SubtreeCount = (u32)this->HierarchySubtrees.Length,
+        .HierarchyLength = (u32)this->Hierarchy.Length,
+        .Changed = ArenaPushArray(Scratch.arena, u8, this->Hierarchy.Length),
+        .ForceUpdate = ForceUpdate,
+    };
+
+    UpdateWorldTransforms(&Data, 0, this->HierarchyRootCount);
+
+    // A few subtrees per batch, so worlds with lots of tiny subtrees don't turn into lots of tiny jobs
+    u32 BatchSize = math::Max(1u, Data.SubtreeCount / (JobSystem::GetThreadCount() * 4));
+    JobSystem::ParallelFor(Data.SubtreeCount, BatchSize, WorldTransformJob, &Data);
+
+    ScratchEnd(Scratch);
+}
+
+bool World::IsTransformDirty(EntityHandleT Handle)
+{
+    while (Handle != EntityHandleInvalid)
+    {
+        if (Registry.get<TransformComponent>(Handle).Dirty)
+            return true;
+
+        Handle = Registry.get<RelationshipComponent>(Handle).Parent;
+    }
+
+    return false;
 }
 
 Mat4f World::GetWorldSpaceTransformMatrix(Entity E)
 {
+    // The cached transform is only stale if the entity or one of its parents changed since the last update
+    if (!this->HierarchyDirty && E.HasComponent<WorldTransformComponent>() && !IsTransformDirty(E.EntityHandle))
+    {
+        return E.GetComponent<WorldTransformComponent>().WorldMatrix;
+    }
+
     TransformComponent Transform = E.GetComponent<TransformComponent>();
     EntityHandleT      ParentEntityHandle = E.GetParent();
     if (ParentEntityHandle == EntityHandleInvalid)
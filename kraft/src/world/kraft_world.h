@@ -11,6 +11,26 @@ namespace kraft {
 
 struct Entity;
 struct Material;
+struct ArenaAllocator;
+
+namespace r {
+struct CullingBounds;
+}
+
+// Filled in by World::Render, describes the last rendered frame
+struct WorldRenderStats
+{
+    u32 VisibleCount = 0;
+    u32 CulledCount = 0;
+    u32 OccludedCount = 0; // Part of CulledCount, objects hidden behind occluders
+};
+
+// Entry of the flattened hierarchy, see World::UpdateTransforms()
+struct WorldHierarchyNode
+{
+    EntityHandleT Handle;
+    i32           ParentIndex; // Index of the parent in the flattened hierarchy, -1 for entities without a parent
+};
 
 struct World
 {
@@ -21,6 +41,15 @@ struct World
     EntityHandleT GlobalLight = EntityHandleInvalid;
     Camera        Camera;
 
+    // Skip meshes whose bounds are completely outside the camera frustum
+    bool FrustumCulling = true;
+
+    // Skip meshes hidden behind the OccluderComponents of the world. The occluders are drawn into a low resolution
+    // depth buffer on the CPU every frame and the bounds of the meshes are tested against it.
+    bool OcclusionCulling = false;
+
+    WorldRenderStats RenderStats = {};
+
     World();
     ~World();
 
@@ -33,7 +62,12 @@ struct World
     Entity CreateEntity(String8 name, const Entity& Parent, Vec3f Position = Vec3fZero, Vec3f Rotation = Vec3fZero, Vec3f Scale = Vec3fOne);
     void   DestroyEntity(Entity Entity);
 
-    void                       Render();
+    void Render();
+
+    // Recomputes the world transforms of every entity whose transform, or one of its parents' transforms, changed
+    // since the last update. Called by Render(), call it manually if world transforms are needed before that.
+    void UpdateTransforms();
+
     Mat4f                      GetWorldSpaceTransformMatrix(Entity E);
     KRAFT_INLINE RegistryType& GetRegistry()
     {
@@ -44,6 +78,18 @@ private:
     RegistryType Registry;
 
     FlatHashMap<EntityHandleT, Entity> Entities;
+
+    // Every entity reachable from a parentless entity, parents always before their children. The entities without a
+    // parent come first, followed by the subtree of each of their children. Those subtrees don't depend on each other,
+    // `HierarchySubtrees` holds the index each one starts at.
+    Array<WorldHierarchyNode> Hierarchy;
+    Array<u32>                HierarchySubtrees;
+    u32                       HierarchyRootCount = 0;
+    bool                      HierarchyDirty = true;
+
+    void RebuildHierarchy();
+    u32  CullOccluded(ArenaAllocator* Arena, const Mat4f& ViewProjection, const r::CullingBounds& Bounds, u32 Count, u8* Visible);
+    bool IsTransformDirty(EntityHandleT Handle);
 };
 
 } // namespace kraft
\ No newline at end of file
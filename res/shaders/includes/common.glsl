@@ -21,6 +21,43 @@ layout (set = 0, binding = 0) uniform GlobalUniformBuffer
     uint  Pad2;
 } globalState;
 
+#if defined KRAFT_INSTANCED
+
+// Defined for variants that declare an InstanceBuffer. Identical draws are batched into one instanced draw whose
+// firstInstance is the offset of its first instance, so gl_InstanceIndex indexes Instances[] directly.
+// Matches r::InstanceData.
+struct InstanceData
+{
+    mat4 Model;
+    uint EntityId;
+    uint MaterialIdx;
+    uint Pad0;
+    uint Pad1;
+};
+
+layout (set = 0, binding = 4) readonly buffer GlobalInstanceData
+{
+    InstanceData Instances[];
+};
+
+#endif
+
+// Normals and tangents of r::Vertex3DPacked are octahedral encoded. With vertex input attributes the packed layout is
+//     Binding     0 20 vertex
+//     Attribute   short4n Position 0 0 0      (xyz = position, w = bitangent sign)
+//     Attribute   short2n Normal 0 1 8
+//     Attribute   short2n Tangent 0 2 12
+//     Attribute   half2 UV 0 3 16
+// The position stays in [-1, 1]; the renderer folds the dequantization into variableState.Model.
+vec3 OctahedralDecode(vec2 encoded)
+{
+    vec3  direction = vec3(encoded.xy, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-direction.z, 0.0);
+    direction.x += direction.x >= 0.0 ? -fold : fold;
+    direction.y += direction.y >= 0.0 ? -fold : fold;
+    return normalize(direction);
+}
+
 #if defined FRAGMENT
 
 layout(set = 0, binding = 1) uniform sampler TextureSamplers[];
@@ -23,6 +23,22 @@ layout (set = 0, binding = 0) uniform GlobalUniformBuffer
     uint  Pad2;
 } globalState;
 
+// Normals and tangents of r::Vertex3DPacked are octahedral encoded. With vertex input attributes the packed layout is
+//     Binding     0 20 vertex
+//     Attribute   short4n Position 0 0 0      (xyz = position, w = bitangent sign)
+//     Attribute   short2n Normal 0 1 8
+//     Attribute   short2n Tangent 0 2 12
+//     Attribute   half2 UV 0 3 16
+// The position stays in [-1, 1]; the renderer folds the dequantization into variableState.Model.
+vec3 OctahedralDecode(vec2 encoded)
+{
+    vec3  direction = vec3(encoded.xy, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-direction.z, 0.0);
+    direction.x += direction.x >= 0.0 ? -fold : fold;
+    direction.y += direction.y >= 0.0 ? -fold : fold;
+    return normalize(direction);
+}
+
 struct Vertex3D
 {
     vec3 position;
@@ -31,11 +47,50 @@ struct Vertex3D
     vec4 tangent;
 };
 
+#if defined KRAFT_VERTEX3D_PACKED
+
+// r::Vertex3DPacked, shaders drawing compressed meshes define KRAFT_VERTEX3D_PACKED before including this file
+struct Vertex3DPacked
+{
+    uint position_xy;
+    uint position_zw;
+    uint normal;
+    uint tangent;
+    uint uv;
+};
+
+layout(scalar, set = 0, binding = 3) readonly buffer VertexData
+{
+    Vertex3DPacked vertices[];
+};
+
+Vertex3D LoadVertex3D(uint index)
+{
+    Vertex3DPacked packed = vertices[index];
+    vec2           position_zw = unpackSnorm2x16(packed.position_zw);
+
+    Vertex3D vertex;
+    vertex.position = vec3(unpackSnorm2x16(packed.position_xy), position_zw.x);
+    vertex.uv = unpackHalf2x16(packed.uv);
+    vertex.normal = OctahedralDecode(unpackSnorm2x16(packed.normal));
+    vertex.tangent = vec4(OctahedralDecode(unpackSnorm2x16(packed.tangent)), position_zw.y);
+    return vertex;
+}
+
+#else
+
 layout(scalar, set = 0, binding = 3) readonly buffer VertexData
 {
     Vertex3D vertices[];
 };
 
+Vertex3D LoadVertex3D(uint index)
+{
+    return vertices[index];
+}
+
+#endif
+
 #if defined FRAGMENT
 
 layout(set = 0, binding = 1) uniform sampler TextureSamplers[];
@@ -0,0 +1,538 @@
+#include "kraft_benchmarks.h"
+
+// The console build of Kraft leaves out the renderer along with volk, so the suite loads Vulkan itself. It runs on
+// whatever device the loader finds, a software implementation like lavapipe or SwiftShader is enough.
+#define VOLK_IMPLEMENTATION
+#include <volk/volk.h>
+
+using namespace kraft;
+
+#define KRAFT_BENCH_COMPUTE_GROUP_SIZE  64 // Has to match local_size_x in the shader
+#define KRAFT_BENCH_COMPUTE_GROUP_COUNT 1024
+#define KRAFT_BENCH_COMPUTE_ITERATIONS  100
+
+// SPIR-V 1.0 for
+//
+//     #version 450
+//     layout (local_size_x = 64) in;
+//     layout (set = 0, binding = 0) buffer Values { uint values[]; };
+//     void main() { uint i = gl_GlobalInvocationID.x; values[i] = i * 3 + 1; }
+//
+// The benchmarks don't link shaderc, so the shader is stored already assembled
+static const u32 FillComputeShaderSPIRV[] = {
+    // Header: magic, version 1.0, generator, id bound, schema
+    0x07230203, 0x00010000, 0x00000000, 25, 0,
+    // OpCapability Shader
+    0x00020011, 1,
+    // OpMemoryModel Logical GLSL450
+    0x0003000E, 0, 1,
+    // OpEntryPoint GLCompute %1 "main" %2
+    0x0006000F, 5, 1, 0x6E69616D, 0x00000000, 2,
+    // OpExecutionMode %1 LocalSize 64 1 1
+    0x00060010, 1, 17, KRAFT_BENCH_COMPUTE_GROUP_SIZE, 1, 1,
+    // OpDecorate %2 BuiltIn GlobalInvocationId
+    0x00040047, 2, 11, 28,
+    // OpDecorate %3 ArrayStride 4
+    0x00040047, 3, 6, 4,
+    // OpMemberDecorate %4 0 Offset 0
+    0x00050048, 4, 0, 35, 0,
+    // OpDecorate %4 BufferBlock
+    0x00030047, 4, 3,
+    // OpDecorate %5 DescriptorSet 0
+    0x00040047, 5, 34, 0,
+    // OpDecorate %5 Binding 0
+    0x00040047, 5, 33, 0,
+    // %6 = OpTypeVoid
+    0x00020013, 6,
+    // %7 = OpTypeFunction %6
+    0x00030021, 7, 6,
+    // %8 = OpTypeInt 32 0
+    0x00040015, 8, 32, 0,
+    // %9 = OpTypeVector %8 3
+    0x00040017, 9, 8, 3,
+    // %10 = OpTypePointer Input %9
+    0x00040020, 10, 1, 9,
+    // %2 = OpVariable %10 Input
+    0x0004003B, 10, 2, 1,
+    // %11 = OpTypePointer Input %8
+    0x00040020, 11, 1, 8,
+    // %3 = OpTypeRuntimeArray %8
+    0x0003001D, 3, 8,
+    // %4 = OpTypeStruct %3
+    0x0003001E, 4, 3,
+    // %12 = OpTypePointer Uniform %4
+    0x00040020, 12, 2, 4,
+    // %5 = OpVariable %12 Uniform
+    0x0004003B, 12, 5, 2,
+    // %13 = OpTypeInt 32 1
+    0x00040015, 13, 32, 1,
+    // %14 = OpConstant %13 0
+    0x0004002B, 13, 14, 0,
+    // %15 = OpConstant %8 0
+    0x0004002B, 8, 15, 0,
+    // %16 = OpConstant %8 3
+    0x0004002B, 8, 16, 3,
+    // %17 = OpConstant %8 1
+    0x0004002B, 8, 17, 1,
+    // %18 = OpTypePointer Uniform %8
+    0x00040020, 18, 2, 8,
+    // %1 = OpFunction %6 None %7
+    0x00050036, 6, 1, 0, 7,
+    // %19 = OpLabel
+    0x000200F8, 19,
+    // %20 = OpAccessChain %11 %2 %15
+    0x00050041, 11, 20, 2, 15,
+    // %21 = OpLoad %8 %20
+    0x0004003D, 8, 21, 20,
+    // %22 = OpIMul %8 %21 %16
+    0x00050084, 8, 22, 21, 16,
+    // %23 = OpIAdd %8 %22 %17
+    0x00050080, 8, 23, 22, 17,
+    // %24 = OpAccessChain %18 %5 %14 %21
+    0x00060041, 18, 24, 5, 14, 21,
+    // OpStore %24 %23
+    0x0003003E, 24, 23,
+    // OpReturn
+    0x000100FD,
+    // OpFunctionEnd
+    0x00010038,
+};
+
+struct ComputeContext
+{
+    VkInstance       instance;
+    VkPhysicalDevice physical_device;
+    VkDevice         device;
+    VkQueue          queue;
+    u32              queue_family;
+
+    VkBuffer       buffer;
+    VkDeviceMemory memory;
+    u32*           values;
+    u32            value_count;
+
+    VkDescriptorSetLayout set_layout;
+    VkPipelineLayout      pipeline_layout;
+    VkDescriptorPool      descriptor_pool;
+    VkDescriptorSet       descriptor_set;
+    VkShaderModule        shader_module;
+    VkPipeline            pipeline;
+
+    VkCommandPool   command_pool;
+    VkCommandBuffer command_buffer;
+    VkFence         fence;
+};
+
+static bool VulkanSucceeded(VkResult result, const char* call)
+{
+    if (result == VK_SUCCESS)
+        return true;
+
+    KERROR("[compute]: %s failed with %d", call, result);
+    return false;
+}
+
+//
+// Setup
+//
+
+// Returns false when there is no Vulkan loader or no device with a compute queue, the suite is skipped then
+static bool CreateComputeDevice(ComputeContext* context)
+{
+    if (volkInitialize() != VK_SUCCESS)
+    {
+        KWARN("[compute]: No Vulkan loader found, skipping");
+        return false;
+    }
+
+    VkApplicationInfo application_info = {
+        .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+        .pApplicationName = "KraftBenchmarks",
+        .pEngineName = "Kraft",
+        .apiVersion = VK_API_VERSION_1_0,
+    };
+
+    VkInstanceCreateInfo instance_create_info = {
+        .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+        .pApplicationInfo = &application_info,
+    };
+
+    if (vkCreateInstance(&instance_create_info, nullptr, &context->instance) != VK_SUCCESS)
+    {
+        KWARN("[compute]: Failed to create a Vulkan instance, skipping");
+        return false;
+    }
+
+    volkLoadInstance(context->instance);
+
+    u32 physical_device_count = 0;
+    vkEnumeratePhysicalDevices(context->instance, &physical_device_count, nullptr);
+
+    TempArena         scratch = ScratchBegin(0, 0);
+    VkPhysicalDevice* physical_devices = ArenaPushArray(scratch.arena, VkPhysicalDevice, physical_device_count);
+    vkEnumeratePhysicalDevices(context->instance, &physical_device_count, physical_devices);
+
+    // The first device with a compute queue
+    for (u32 i = 0; i < physical_device_count && !context->physical_device; i++)
+    {
+        u32 queue_family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physical_devices[i], &queue_family_count, nullptr);
+
+        VkQueueFamilyProperties* queue_families = ArenaPushArray(scratch.arena, VkQueueFamilyProperties, queue_family_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(physical_devices[i], &queue_family_count, queue_families);
+        for (u32 j = 0; j < queue_family_count; j++)
+        {
+            if (queue_families[j].queueFlags & VK_QUEUE_COMPUTE_BIT)
+            {
+                context->physical_device = physical_devices[i];
+                context->queue_family = j;
+                break;
+            }
+        }
+    }
+
+    ScratchEnd(scratch);
+
+    if (!context->physical_device)
+    {
+        KWARN("[compute]: No Vulkan device with a compute queue, skipping");
+        return false;
+    }
+
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(context->physical_device, &properties);
+    KINFO("[compute]: Running on '%s'", properties.deviceName);
+
+    f32                     queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_create_info = {
+        .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+        .queueFamilyIndex = context->queue_family,
+        .queueCount = 1,
+        .pQueuePriorities = &queue_priority,
+    };
+
+    VkDeviceCreateInfo device_create_info = {
+        .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .queueCreateInfoCount = 1,
+        .pQueueCreateInfos = &queue_create_info,
+    };
+
+    if (vkCreateDevice(context->physical_device, &device_create_info, nullptr, &context->device) != VK_SUCCESS)
+    {
+        KWARN("[compute]: Failed to create a Vulkan device on '%s', skipping", properties.deviceName);
+        return false;
+    }
+
+    volkLoadDevice(context->device);
+    vkGetDeviceQueue(context->device, context->queue_family, 0, &context->queue);
+
+    return true;
+}
+
+static bool CreateComputeBuffer(ComputeContext* context)
+{
+    VkBufferCreateInfo buffer_create_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = sizeof(u32) * context->value_count,
+        .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+
+    if (!VulkanSucceeded(vkCreateBuffer(context->device, &buffer_create_info, nullptr, &context->buffer), "vkCreateBuffer"))
+        return false;
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(context->device, context->buffer, &requirements);
+
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    vkGetPhysicalDeviceMemoryProperties(context->physical_device, &memory_properties);
+
+    // Host visible, so the results can be read back without a copy
+    const VkMemoryPropertyFlags required_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    u32                         memory_type = (u32)-1;
+    for (u32 i = 0; i < memory_properties.memoryTypeCount; i++)
+    {
+        if ((requirements.memoryTypeBits & (1u << i)) && (memory_properties.memoryTypes[i].propertyFlags & required_flags) == required_flags)
+        {
+            memory_type = i;
+            break;
+        }
+    }
+
+    if (memory_type == (u32)-1)
+    {
+        KERROR("[compute]: No host visible memory for the storage buffer");
+        return false;
+    }
+
+    VkMemoryAllocateInfo allocate_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = requirements.size,
+        .memoryTypeIndex = memory_type,
+    };
+
+    if (!VulkanSucceeded(vkAllocateMemory(context->device, &allocate_info, nullptr, &context->memory), "vkAllocateMemory"))
+        return false;
+
+    if (!VulkanSucceeded(vkBindBufferMemory(context->device, context->buffer, context->memory, 0), "vkBindBufferMemory"))
+        return false;
+
+    return VulkanSucceeded(vkMapMemory(context->device, context->memory, 0, VK_WHOLE_SIZE, 0, (void**)&context->values), "vkMapMemory");
+}
+
+static bool CreateComputePipeline(ComputeContext* context)
+{
+    VkDescriptorSetLayoutBinding binding = {
+        .binding = 0,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = 1,
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+    };
+
+    VkDescriptorSetLayoutCreateInfo set_layout_create_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = 1,
+        .pBindings = &binding,
+    };
+
+    if (!VulkanSucceeded(vkCreateDescriptorSetLayout(context->device, &set_layout_create_info, nullptr, &context->set_layout), "vkCreateDescriptorSetLayout"))
+        return false;
+
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &context->set_layout,
+    };
+
+    if (!VulkanSucceeded(vkCreatePipelineLayout(context->device, &pipeline_layout_create_info, nullptr, &context->pipeline_layout), "vkCreatePipelineLayout"))
+        return false;
+
+    VkDescriptorPoolSize       pool_size = { .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1 };
+    VkDescriptorPoolCreateInfo pool_create_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = 1,
+        .poolSizeCount = 1,
+        .pPoolSizes = &pool_size,
+    };
+
+    if (!VulkanSucceeded(vkCreateDescriptorPool(context->device, &pool_create_info, nullptr, &context->descriptor_pool), "vkCreateDescriptorPool"))
+        return false;
+
+    VkDescriptorSetAllocateInfo set_allocate_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = context->descriptor_pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &context->set_layout,
+    };
+
+    if (!VulkanSucceeded(vkAllocateDescriptorSets(context->device, &set_allocate_info, &context->descriptor_set), "vkAllocateDescriptorSets"))
+        return false;
+
+    VkDescriptorBufferInfo buffer_info = { .buffer = context->buffer, .offset = 0, .range = VK_WHOLE_SIZE };
+    VkWriteDescriptorSet   write = {
+          .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+          .dstSet = context->descriptor_set,
+          .dstBinding = 0,
+          .descriptorCount = 1,
+          .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+          .pBufferInfo = &buffer_info,
+    };
+
+    vkUpdateDescriptorSets(context->device, 1, &write, 0, nullptr);
+
+    VkShaderModuleCreateInfo shader_module_create_info = {
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = sizeof(FillComputeShaderSPIRV),
+        .pCode = FillComputeShaderSPIRV,
+    };
+
+    if (!VulkanSucceeded(vkCreateShaderModule(context->device, &shader_module_create_info, nullptr, &context->shader_module), "vkCreateShaderModule"))
+        return false;
+
+    VkComputePipelineCreateInfo pipeline_create_info = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = context->shader_module,
+            .pName = "main",
+        },
+        .layout = context->pipeline_layout,
+    };
+
+    return VulkanSucceeded(vkCreateComputePipelines(context->device, VK_NULL_HANDLE, 1, &pipeline_create_info, nullptr, &context->pipeline), "vkCreateComputePipelines");
+}
+
+// Records the dispatch once, it's submitted again for every timed iteration
+static bool RecordComputeDispatch(ComputeContext* context)
+{
+    VkCommandPoolCreateInfo command_pool_create_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .queueFamilyIndex = context->queue_family,
+    };
+
+    if (!VulkanSucceeded(vkCreateCommandPool(context->device, &command_pool_create_info, nullptr, &context->command_pool), "vkCreateCommandPool"))
+        return false;
+
+    VkCommandBufferAllocateInfo command_buffer_allocate_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = context->command_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+
+    if (!VulkanSucceeded(vkAllocateCommandBuffers(context->device, &command_buffer_allocate_info, &context->command_buffer), "vkAllocateCommandBuffers"))
+        return false;
+
+    VkFenceCreateInfo fence_create_info = { .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+    if (!VulkanSucceeded(vkCreateFence(context->device, &fence_create_info, nullptr, &context->fence), "vkCreateFence"))
+        return false;
+
+    VkCommandBufferBeginInfo begin_info = { .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+    if (!VulkanSucceeded(vkBeginCommandBuffer(context->command_buffer, &begin_info), "vkBeginCommandBuffer"))
+        return false;
+
+    vkCmdBindPipeline(context->command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, context->pipeline);
+    vkCmdBindDescriptorSets(context->command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, context->pipeline_layout, 0, 1, &context->descriptor_set, 0, nullptr);
+    vkCmdDispatch(context->command_buffer, context->value_count / KRAFT_BENCH_COMPUTE_GROUP_SIZE, 1, 1);
+
+    // Makes the shader writes visible to the mapped pointer
+    VkMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+    };
+
+    vkCmdPipelineBarrier(context->command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    return VulkanSucceeded(vkEndCommandBuffer(context->command_buffer), "vkEndCommandBuffer");
+}
+
+static bool SubmitComputeDispatch(ComputeContext* context)
+{
+    VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &context->command_buffer,
+    };
+
+    if (!VulkanSucceeded(vkQueueSubmit(context->queue, 1, &submit_info, context->fence), "vkQueueSubmit"))
+        return false;
+
+    if (!VulkanSucceeded(vkWaitForFences(context->device, 1, &context->fence, true, (u64)-1), "vkWaitForFences"))
+        return false;
+
+    return VulkanSucceeded(vkResetFences(context->device, 1, &context->fence), "vkResetFences");
+}
+
+static void DestroyComputeContext(ComputeContext* context)
+{
+    if (context->device)
+    {
+        vkDeviceWaitIdle(context->device);
+
+        if (context->fence)
+            vkDestroyFence(context->device, context->fence, nullptr);
+        if (context->command_pool)
+            vkDestroyCommandPool(context->device, context->command_pool, nullptr);
+        if (context->pipeline)
+            vkDestroyPipeline(context->device, context->pipeline, nullptr);
+        if (context->shader_module)
+            vkDestroyShaderModule(context->device, context->shader_module, nullptr);
+        if (context->descriptor_pool)
+            vkDestroyDescriptorPool(context->device, context->descriptor_pool, nullptr);
+        if (context->pipeline_layout)
+            vkDestroyPipelineLayout(context->device, context->pipeline_layout, nullptr);
+        if (context->set_layout)
+            vkDestroyDescriptorSetLayout(context->device, context->set_layout, nullptr);
+        if (context->values)
+            vkUnmapMemory(context->device, context->memory);
+        if (context->memory)
+            vkFreeMemory(context->device, context->memory, nullptr);
+        if (context->buffer)
+            vkDestroyBuffer(context->device, context->buffer, nullptr);
+
+        vkDestroyDevice(context->device, nullptr);
+    }
+
+    if (context->instance)
+    {
+        vkDestroyInstance(context->instance, nullptr);
+    }
+}
+
+//
+// Checks
+//
+
+// Every invocation writes its own slot, so a slot that still holds the fill value was never dispatched
+static int CheckComputeResults(ComputeContext* context)
+{
+    MemSet(context->values, 0xFF, sizeof(u32) * context->value_count);
+    if (!SubmitComputeDispatch(context))
+        return 1;
+
+    for (u32 i = 0; i < context->value_count; i++)
+    {
+        if (context->values[i] != i * 3 + 1)
+        {
+            KERROR("[compute]: values[%d] is %u instead of %u", i, context->values[i], i * 3 + 1);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+//
+// Timings
+//
+
+static void TimeComputeDispatch(ComputeContext* context)
+{
+    f64 start_time = Platform::GetAbsoluteTime();
+    for (u32 i = 0; i < KRAFT_BENCH_COMPUTE_ITERATIONS; i++)
+    {
+        if (!SubmitComputeDispatch(context))
+            return;
+    }
+
+    f64 elapsed_time = Platform::GetAbsoluteTime() - start_time;
+    KINFO(
+        "[compute]: %d dispatches of %d invocations, %8.3f ms (%6.3f ms per submit and wait)",
+        KRAFT_BENCH_COMPUTE_ITERATIONS,
+        context->value_count,
+        elapsed_time * 1000.0,
+        elapsed_time * 1000.0 / KRAFT_BENCH_COMPUTE_ITERATIONS
+    );
+}
+
+int RunComputeBenchmarks(BenchmarkOpts opts)
+{
+    ComputeContext context = {};
+    context.value_count = KRAFT_BENCH_COMPUTE_GROUP_SIZE * KRAFT_BENCH_COMPUTE_GROUP_COUNT;
+
+    // No device isn't a failure, machines without a GPU or a software driver just skip the suite
+    if (!CreateComputeDevice(&context))
+    {
+        DestroyComputeContext(&context);
+        return 0;
+    }
+
+    int failed_checks = 0;
+    if (!CreateComputeBuffer(&context) || !CreateComputePipeline(&context) || !RecordComputeDispatch(&context))
+    {
+        failed_checks = 1;
+    }
+    else
+    {
+        failed_checks = CheckComputeResults(&context);
+        if (failed_checks == 0 && !opts.check_only)
+        {
+            TimeComputeDispatch(&context);
+        }
+    }
+
+    DestroyComputeContext(&context);
+    return failed_checks;
+}
@@ -0,0 +1,370 @@
+#include "kraft_benchmarks.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace kraft;
+
+#define KRAFT_BENCH_JOB_ROUND_SIZE   2048
+#define KRAFT_BENCH_JOB_ROUNDS       500
+#define KRAFT_BENCH_JOB_NESTED_COUNT 8
+#define KRAFT_BENCH_MUTEX_QUEUE_SIZE (KRAFT_BENCH_JOB_ROUND_SIZE * 2)
+
+// What the job system is measured against: a fixed set of workers pulling jobs out of a single queue behind a mutex,
+// with the submitting thread sleeping until the queue drains
+struct MutexJobPool
+{
+    struct QueuedJob
+    {
+        JobFunction function;
+        void*       user_data;
+    };
+
+    std::mutex              mutex;
+    std::condition_variable wake_condition;
+    std::condition_variable done_condition;
+    QueuedJob               jobs[KRAFT_BENCH_MUTEX_QUEUE_SIZE];
+    u64                     read;
+    u64                     write;
+    u32                     pending_count;
+    bool                    running;
+
+    std::thread* threads;
+    u32          thread_count;
+};
+
+static void MutexJobPoolWorker(MutexJobPool* pool)
+{
+    while (true)
+    {
+        MutexJobPool::QueuedJob job;
+        {
+            std::unique_lock<std::mutex> lock(pool->mutex);
+            pool->wake_condition.wait(lock, [pool] { return !pool->running || pool->read != pool->write; });
+            if (!pool->running)
+                return;
+
+            job = pool->jobs[pool->read % KRAFT_BENCH_MUTEX_QUEUE_SIZE];
+            pool->read++;
+        }
+
+        job.function(job.user_data);
+
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->pending_count--;
+        if (pool->pending_count == 0)
+        {
+            pool->done_condition.notify_all();
+        }
+    }
+}
+
+static MutexJobPool* CreateMutexJobPool(ArenaAllocator* arena, u32 thread_count)
+{
+    MutexJobPool* pool = new (ArenaPush(arena, MutexJobPool)) MutexJobPool();
+    pool->running = true;
+    pool->thread_count = thread_count;
+    pool->threads = ArenaPushArray(arena, std::thread, thread_count);
+    for (u32 i = 0; i < thread_count; i++)
+    {
+        new (&pool->threads[i]) std::thread(MutexJobPoolWorker, pool);
+    }
+
+    return pool;
+}
+
+static void DestroyMutexJobPool(MutexJobPool* pool)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->running = false;
+    }
+
+    pool->wake_condition.notify_all();
+    for (u32 i = 0; i < pool->thread_count; i++)
+    {
+        pool->threads[i].join();
+        pool->threads[i].~thread();
+    }
+
+    pool->~MutexJobPool();
+}
+
+static void SubmitToMutexJobPool(MutexJobPool* pool, JobFunction function, void** user_data, u32 count)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        KASSERT(pool->write - pool->read + count <= KRAFT_BENCH_MUTEX_QUEUE_SIZE);
+        for (u32 i = 0; i < count; i++)
+        {
+            pool->jobs[pool->write % KRAFT_BENCH_MUTEX_QUEUE_SIZE] = { function, user_data[i] };
+            pool->write++;
+        }
+
+        pool->pending_count += count;
+    }
+
+    pool->wake_condition.notify_all();
+}
+
+static void WaitForMutexJobPool(MutexJobPool* pool)
+{
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    pool->done_condition.wait(lock, [pool] { return pool->pending_count == 0; });
+}
+
+//
+// Workloads
+//
+
+static void EmptyJob(void* user_data)
+{
+    u32* value = (u32*)user_data;
+    *value += 1;
+}
+
+// About a microsecond of work
+static void SmallJob(void* user_data)
+{
+    u32* value = (u32*)user_data;
+    u32  state = *value + 1;
+    for (u32 i = 0; i < 256; i++)
+    {
+        state = state * 1664525u + 1013904223u;
+    }
+
+    *value = state | 1;
+}
+
+struct NestedJobData
+{
+    u32 children[KRAFT_BENCH_JOB_NESTED_COUNT];
+};
+
+// Submits its children from inside a job and waits on them, which interleaves pops with new submissions on the
+// worker's own deque
+static void NestedJob(void* user_data)
+{
+    NestedJobData* data = (NestedJobData*)user_data;
+    JobCounter     counter;
+    JobDescription jobs[KRAFT_BENCH_JOB_NESTED_COUNT];
+    for (u32 i = 0; i < KRAFT_BENCH_JOB_NESTED_COUNT; i++)
+    {
+        jobs[i] = {
+            .Function = EmptyJob,
+            .UserData = &data->children[i],
+            .Counter = &counter,
+        };
+    }
+
+    JobSystem::Submit(jobs, KRAFT_BENCH_JOB_NESTED_COUNT);
+    JobSystem::WaitForCounter(&counter);
+}
+
+static void ParallelForCountJob(void* user_data, u32 start, u32 end)
+{
+    u32* values = (u32*)user_data;
+    for (u32 i = start; i < end; i++)
+    {
+        values[i] += 1;
+    }
+}
+
+static void RunRoundOnJobSystem(JobDescription* jobs, JobFunction function, u32* values)
+{
+    JobCounter counter;
+    for (u32 i = 0; i < KRAFT_BENCH_JOB_ROUND_SIZE; i++)
+    {
+        jobs[i] = {
+            .Function = function,
+            .UserData = &values[i],
+            .Counter = &counter,
+        };
+    }
+
+    JobSystem::Submit(jobs, KRAFT_BENCH_JOB_ROUND_SIZE);
+    JobSystem::WaitForCounter(&counter);
+}
+
+static void RunRoundOnMutexJobPool(MutexJobPool* pool, void** user_data, JobFunction function, u32* values)
+{
+    for (u32 i = 0; i < KRAFT_BENCH_JOB_ROUND_SIZE; i++)
+    {
+        user_data[i] = &values[i];
+    }
+
+    SubmitToMutexJobPool(pool, function, user_data, KRAFT_BENCH_JOB_ROUND_SIZE);
+    WaitForMutexJobPool(pool);
+}
+
+//
+// Checks
+//
+
+static int CheckJobsRanOnce(const char* name, const u32* values, u32 count, u32 expected)
+{
+    for (u32 i = 0; i < count; i++)
+    {
+        if (values[i] != expected)
+        {
+            KERROR("[jobs]: %s: job %d ran %d times instead of %d", name, i, values[i], expected);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int RunJobChecks(ArenaAllocator* arena)
+{
+    int             failed_checks = 0;
+    u32*            values = ArenaPushArray(arena, u32, KRAFT_BENCH_JOB_ROUND_SIZE);
+    JobDescription* jobs = ArenaPushArray(arena, JobDescription, KRAFT_BENCH_JOB_ROUND_SIZE);
+
+    for (u32 round = 0; round < 16; round++)
+    {
+        RunRoundOnJobSystem(jobs, EmptyJob, values);
+    }
+
+    failed_checks += CheckJobsRanOnce("Submit", values, KRAFT_BENCH_JOB_ROUND_SIZE, 16);
+
+    MemSet(values, 0, sizeof(u32) * KRAFT_BENCH_JOB_ROUND_SIZE);
+    JobSystem::ParallelFor(KRAFT_BENCH_JOB_ROUND_SIZE, 7, ParallelForCountJob, values);
+    failed_checks += CheckJobsRanOnce("ParallelFor", values, KRAFT_BENCH_JOB_ROUND_SIZE, 1);
+
+    // Enough nested jobs to fill the deques, so the slots of popped jobs get reused while others are still queued
+    u32            nested_count = KRAFT_BENCH_JOB_ROUND_SIZE;
+    NestedJobData* nested = ArenaPushArray(arena, NestedJobData, nested_count);
+    JobCounter     counter;
+    for (u32 i = 0; i < nested_count; i++)
+    {
+        jobs[i] = {
+            .Function = NestedJob,
+            .UserData = &nested[i],
+            .Counter = &counter,
+        };
+    }
+
+    JobSystem::Submit(jobs, nested_count);
+    JobSystem::WaitForCounter(&counter);
+    failed_checks += CheckJobsRanOnce("Nested", (u32*)nested, nested_count * KRAFT_BENCH_JOB_NESTED_COUNT, 1);
+
+    return failed_checks;
+}
+
+//
+// Timings
+//
+
+static void ReportJobTiming(const char* name, f64 job_system_time, f64 mutex_pool_time, u32 job_count)
+{
+    KINFO(
+        "[jobs]: %-12s job system %8.3f ms (%6.1f ns/job), mutex pool %8.3f ms (%6.1f ns/job), %.2fx",
+        name,
+        job_system_time * 1000.0,
+        job_system_time * 1e9 / job_count,
+        mutex_pool_time * 1000.0,
+        mutex_pool_time * 1e9 / job_count,
+        mutex_pool_time / job_system_time
+    );
+}
+
+static void TimeRounds(const char* name, JobFunction function, MutexJobPool* pool, ArenaAllocator* arena)
+{
+    u32*            values = ArenaPushArray(arena, u32, KRAFT_BENCH_JOB_ROUND_SIZE);
+    JobDescription* jobs = ArenaPushArray(arena, JobDescription, KRAFT_BENCH_JOB_ROUND_SIZE);
+    void**          user_data = ArenaPushArray(arena, void*, KRAFT_BENCH_JOB_ROUND_SIZE);
+
+    f64 start_time = Platform::GetAbsoluteTime();
+    for (u32 round = 0; round < KRAFT_BENCH_JOB_ROUNDS; round++)
+    {
+        RunRoundOnJobSystem(jobs, function, values);
+    }
+
+    f64 job_system_time = Platform::GetAbsoluteTime() - start_time;
+
+    start_time = Platform::GetAbsoluteTime();
+    for (u32 round = 0; round < KRAFT_BENCH_JOB_ROUNDS; round++)
+    {
+        RunRoundOnMutexJobPool(pool, user_data, function, values);
+    }
+
+    f64 mutex_pool_time = Platform::GetAbsoluteTime() - start_time;
+
+    ReportJobTiming(name, job_system_time, mutex_pool_time, KRAFT_BENCH_JOB_ROUND_SIZE * KRAFT_BENCH_JOB_ROUNDS);
+}
+
+// ParallelFor against the same batches pushed through the mutex pool one job per batch
+static void TimeParallelFor(MutexJobPool* pool, ArenaAllocator* arena)
+{
+    const u32 count = 1 << 20;
+    const u32 batch_size = 256;
+    const u32 batch_count = count / batch_size;
+    const u32 iterations = 100;
+    KASSERT(batch_count <= KRAFT_BENCH_MUTEX_QUEUE_SIZE);
+
+    u32* values = ArenaPushArray(arena, u32, count);
+
+    f64 start_time = Platform::GetAbsoluteTime();
+    for (u32 i = 0; i < iterations; i++)
+    {
+        JobSystem::ParallelFor(count, batch_size, ParallelForCountJob, values);
+    }
+
+    f64 job_system_time = Platform::GetAbsoluteTime() - start_time;
+
+    struct Batch
+    {
+        u32* values;
+        u32  start;
+        u32  end;
+    };
+
+    Batch* batches = ArenaPushArray(arena, Batch, batch_count);
+    void** user_data = ArenaPushArray(arena, void*, batch_count);
+    for (u32 i = 0; i < batch_count; i++)
+    {
+        batches[i] = { values, i * batch_size, (i + 1) * batch_size };
+        user_data[i] = &batches[i];
+    }
+
+    auto batch_job = [](void* user_data) {
+        Batch* batch = (Batch*)user_data;
+        ParallelForCountJob(batch->values, batch->start, batch->end);
+    };
+
+    start_time = Platform::GetAbsoluteTime();
+    for (u32 i = 0; i < iterations; i++)
+    {
+        SubmitToMutexJobPool(pool, batch_job, user_data, batch_count);
+        WaitForMutexJobPool(pool);
+    }
+
+    f64 mutex_pool_time = Platform::GetAbsoluteTime() - start_time;
+
+    ReportJobTiming("ParallelFor", job_system_time, mutex_pool_time, batch_count * iterations);
+}
+
+int RunJobBenchmarks(BenchmarkOpts opts)
+{
+    ArenaAllocator* arena = CreateArena({ .ChunkSize = KRAFT_SIZE_MB(64), .Alignment = 64 });
+
+    int failed_checks = RunJobChecks(arena);
+    if (failed_checks == 0 && !opts.check_only)
+    {
+        // The mutex pool gets as many workers as the job system, which also runs jobs on the main thread
+        u32           worker_count = JobSystem::GetThreadCount() - 1;
+        MutexJobPool* pool = CreateMutexJobPool(arena, math::Max(worker_count, 1u));
+
+        KINFO("[jobs]: %d rounds of %d jobs, %d job system threads", KRAFT_BENCH_JOB_ROUNDS, KRAFT_BENCH_JOB_ROUND_SIZE, JobSystem::GetThreadCount());
+        TimeRounds("Empty", EmptyJob, pool, arena);
+        TimeRounds("Small", SmallJob, pool, arena);
+        TimeParallelFor(pool, arena);
+
+        DestroyMutexJobPool(pool);
+    }
+
+    DestroyArena(arena);
+    return failed_checks;
+}
@@ -0,0 +1,227 @@
+#include "kraft_benchmarks.h"
+
+using namespace kraft;
+
+#define KRAFT_BENCH_MATH_MATRIX_COUNT 4096
+#define KRAFT_BENCH_MATH_ITERATIONS   500
+
+#if defined(KRAFT_SIMD_AVX)
+#define KRAFT_BENCH_MATH_SIMD_NAME "AVX"
+#elif defined(KRAFT_SIMD_SSE)
+#define KRAFT_BENCH_MATH_SIMD_NAME "SSE"
+#elif defined(KRAFT_SIMD_NEON)
+#define KRAFT_BENCH_MATH_SIMD_NAME "NEON"
+#else
+#define KRAFT_BENCH_MATH_SIMD_NAME "scalar"
+#endif
+
+//
+// Inputs
+//
+
+// Fixed seed, every run checks and times the same matrices
+static u32 RandomU32(u32* state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state;
+}
+
+static f32 RandomF32(u32* state, f32 min, f32 max)
+{
+    return min + (max - min) * ((RandomU32(state) >> 8) * (1.0f / 16777216.0f));
+}
+
+static Vec3f RandomVec3f(u32* state, f32 min, f32 max)
+{
+    return Vec3f{ RandomF32(state, min, max), RandomF32(state, min, max), RandomF32(state, min, max) };
+}
+
+// Scale, rotation and translation, the matrices AffineInverse is meant for
+static Mat4f RandomAffineMatrix(u32* state)
+{
+    Mat4f Rotation = RotationMatrixFromEulerAngles(RandomVec3f(state, -KRAFT_PI, KRAFT_PI));
+    return ScaleMatrix(RandomVec3f(state, 0.5f, 2.0f)) * Rotation * TranslationMatrix(RandomVec3f(state, -100.0f, 100.0f));
+}
+
+// Dense, with a dominant diagonal so it stays well conditioned
+static Mat4f RandomMatrix(u32* state)
+{
+    Mat4f Out;
+    for (int i = 0; i < 16; i++)
+    {
+        Out._data[i] = RandomF32(state, -1.0f, 1.0f);
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        Out[i][i] += 4.0f;
+    }
+
+    return Out;
+}
+
+//
+// Checks
+//
+
+static bool NearlyEqual(f32 a, f32 b, f32 tolerance)
+{
+    return Abs(a - b) <= tolerance * math::Max(1.0f, Abs(b));
+}
+
+static int CheckMatrix(const char* name, u32 index, const Mat4f& simd, const Mat4f& scalar, f32 tolerance)
+{
+    for (int i = 0; i < 16; i++)
+    {
+        if (!NearlyEqual(simd._data[i], scalar._data[i], tolerance))
+        {
+            KERROR("[math]: %s: matrix %d differs at [%d][%d], %f instead of %f", name, index, i / 4, i % 4, simd._data[i], scalar._data[i]);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int CheckVector(const char* name, u32 index, Vec3f simd, Vec3f scalar, f32 tolerance)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        if (!NearlyEqual(simd[i], scalar[i], tolerance))
+        {
+            KERROR("[math]: %s: vector %d differs at [%d], %f instead of %f", name, index, i, simd[i], scalar[i]);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// The SIMD overloads against the scalar templates they replace, on the same inputs
+static int RunMathChecks(const Mat4f* dense, const Mat4f* affine, const Vec3f* points, u32 count)
+{
+    int failed_checks = 0;
+    for (u32 i = 0; i < count && failed_checks == 0; i++)
+    {
+        const Mat4f& a = dense[i];
+        const Mat4f& b = dense[(i + 1) % count];
+
+        failed_checks += CheckMatrix("Multiply", i, a * b, operator*<f32>(a, b), 1e-5f);
+        failed_checks += CheckMatrix("Inverse", i, Inverse(a), Inverse<f32>(a), 1e-4f);
+        failed_checks += CheckMatrix("AffineInverse", i, AffineInverse(affine[i]), AffineInverse<f32>(affine[i]), 1e-4f);
+        failed_checks += CheckMatrix("AffineInverse round trip", i, affine[i] * AffineInverse(affine[i]), Mat4f(Identity), 1e-4f);
+        failed_checks += CheckVector("TransformPoint", i, TransformPoint(affine[i], points[i]), TransformPoint<f32>(affine[i], points[i]), 1e-5f);
+        failed_checks += CheckVector("TransformVector", i, TransformVector(affine[i], points[i]), TransformVector<f32>(affine[i], points[i]), 1e-5f);
+
+        Vec3f translation, rotation, scale;
+        Vec3f scalar_translation, scalar_rotation, scalar_scale;
+        Mat4f::Decompose(affine[i], translation, rotation, scale);
+        DecomposeScalar(affine[i], scalar_translation, scalar_rotation, scalar_scale);
+        failed_checks += CheckVector("Decompose translation", i, translation, scalar_translation, 1e-5f);
+        failed_checks += CheckVector("Decompose rotation", i, rotation, scalar_rotation, 1e-4f);
+        failed_checks += CheckVector("Decompose scale", i, scale, scalar_scale, 1e-5f);
+    }
+
+    return failed_checks;
+}
+
+//
+// Timings
+//
+
+static void ReportMathTiming(const char* name, f64 simd_time, f64 scalar_time, u32 op_count)
+{
+    KINFO(
+        "[math]: %-16s %-6s %8.3f ms (%6.2f ns/op), scalar %8.3f ms (%6.2f ns/op), %.2fx",
+        name,
+        KRAFT_BENCH_MATH_SIMD_NAME,
+        simd_time * 1000.0,
+        simd_time * 1e9 / op_count,
+        scalar_time * 1000.0,
+        scalar_time * 1e9 / op_count,
+        scalar_time / simd_time
+    );
+}
+
+// Times `simd` and `scalar`, each called with the index of the input to work on. The outputs are written to memory, so
+// neither loop can be optimized away.
+template<typename SIMDFn, typename ScalarFn>
+static void TimeMathOp(const char* name, u32 count, SIMDFn simd, ScalarFn scalar)
+{
+    f64 start_time = Platform::GetAbsoluteTime();
+    for (u32 iteration = 0; iteration < KRAFT_BENCH_MATH_ITERATIONS; iteration++)
+    {
+        for (u32 i = 0; i < count; i++)
+        {
+            simd(i);
+        }
+    }
+
+    f64 simd_time = Platform::GetAbsoluteTime() - start_time;
+
+    start_time = Platform::GetAbsoluteTime();
+    for (u32 iteration = 0; iteration < KRAFT_BENCH_MATH_ITERATIONS; iteration++)
+    {
+        for (u32 i = 0; i < count; i++)
+        {
+            scalar(i);
+        }
+    }
+
+    f64 scalar_time = Platform::GetAbsoluteTime() - start_time;
+
+    ReportMathTiming(name, simd_time, scalar_time, count * KRAFT_BENCH_MATH_ITERATIONS);
+}
+
+int RunMathBenchmarks(BenchmarkOpts opts)
+{
+    ArenaAllocator* arena = CreateArena({ .ChunkSize = KRAFT_SIZE_MB(4), .Alignment = 64 });
+
+    const u32 count = KRAFT_BENCH_MATH_MATRIX_COUNT;
+    Mat4f*    dense = ArenaPushArray(arena, Mat4f, count);
+    Mat4f*    affine = ArenaPushArray(arena, Mat4f, count);
+    Vec3f*    points = ArenaPushArray(arena, Vec3f, count);
+    u32       state = 0x4B524654;
+    for (u32 i = 0; i < count; i++)
+    {
+        dense[i] = RandomMatrix(&state);
+        affine[i] = RandomAffineMatrix(&state);
+        points[i] = RandomVec3f(&state, -100.0f, 100.0f);
+    }
+
+    int failed_checks = RunMathChecks(dense, affine, points, count);
+    if (failed_checks == 0 && !opts.check_only)
+    {
+        Mat4f* out_matrices = ArenaPushArray(arena, Mat4f, count);
+        Vec3f* out_points = ArenaPushArray(arena, Vec3f, count);
+        Vec3f* out_rotations = ArenaPushArray(arena, Vec3f, count);
+        Vec3f* out_scales = ArenaPushArray(arena, Vec3f, count);
+
+        KINFO("[math]: %d iterations over %d matrices", KRAFT_BENCH_MATH_ITERATIONS, count);
+        TimeMathOp(
+            "Multiply",
+            count,
+            [&](u32 i) { out_matrices[i] = dense[i] * dense[(i + 1) % count]; },
+            [&](u32 i) { out_matrices[i] = operator*<f32>(dense[i], dense[(i + 1) % count]); }
+        );
+        TimeMathOp("Inverse", count, [&](u32 i) { out_matrices[i] = Inverse(dense[i]); }, [&](u32 i) { out_matrices[i] = Inverse<f32>(dense[i]); });
+        TimeMathOp(
+            "AffineInverse", count, [&](u32 i) { out_matrices[i] = AffineInverse(affine[i]); }, [&](u32 i) { out_matrices[i] = AffineInverse<f32>(affine[i]); }
+        );
+        TimeMathOp(
+            "TransformPoint",
+            count,
+            [&](u32 i) { out_points[i] = TransformPoint(affine[i], points[i]); },
+            [&](u32 i) { out_points[i] = TransformPoint<f32>(affine[i], points[i]); }
+        );
+        TimeMathOp(
+            "Decompose",
+            count,
+            [&](u32 i) { Mat4f::Decompose(affine[i], out_points[i], out_rotations[i], out_scales[i]); },
+            [&](u32 i) { DecomposeScalar(affine[i], out_points[i], out_rotations[i], out_scales[i]); }
+        );
+    }
+
+    DestroyArena(arena);
+    return failed_checks;
+}
@@ -0,0 +1,247 @@
+#include "kraft_benchmarks.h"
+
+#include <renderer/kraft_culling.h>
+#include <renderer/kraft_occlusion_culling.h>
+
+using namespace kraft;
+
+#define KRAFT_BENCH_CITY_BLOCKS     32 // Buildings along each side of the city
+#define KRAFT_BENCH_CITY_BLOCK_SIZE 40.0f
+#define KRAFT_BENCH_CITY_PROPS      16 // Small objects around every building
+#define KRAFT_BENCH_CITY_ITERATIONS 100
+
+// Every box occluder has the same vertex and index counts
+struct BoxOccluder
+{
+    Vec3f Vertices[8];
+    u32   Indices[36];
+};
+
+static void MakeBoxOccluder(BoxOccluder* box, const Mat4f* model_matrix, Vec3f center, Vec3f extents, r::OccluderMesh* out_mesh)
+{
+    r::BuildBoxOccluder(center, extents, box->Vertices, box->Indices);
+    *out_mesh = {
+        .Vertices = box->Vertices,
+        .Indices = box->Indices,
+        .VertexCount = 8,
+        .IndexCount = 36,
+        .ModelMatrix = model_matrix,
+    };
+}
+
+// Camera at `eye` looking down -z, with the default occlusion buffer's aspect ratio
+static Mat4f OcclusionViewProjection(Vec3f eye)
+{
+    Mat4f view = LookAt(eye, eye + Vec3f{ 0.0f, 0.0f, -1.0f }, Vec3f{ 0.0f, 1.0f, 0.0f });
+    Mat4f projection = PerspectiveMatrix(DegToRadians(60.0f), (f32)KRAFT_OCCLUSION_BUFFER_WIDTH / KRAFT_OCCLUSION_BUFFER_HEIGHT, 0.1f, 1000.0f);
+    return view * projection;
+}
+
+//
+// Checks
+//
+
+struct OcclusionCase
+{
+    const char* name;
+    Vec3f       center;
+    Vec3f       extents;
+    bool        occluded;
+};
+
+static int CheckOcclusionCases(const char* name, const r::OcclusionBuffer& buffer, const Mat4f& view_projection, const OcclusionCase* cases, u32 count)
+{
+    int failed_checks = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+        bool occluded = r::IsOccluded(buffer, view_projection, cases[i].center, cases[i].extents);
+        if (occluded != cases[i].occluded)
+        {
+            KERROR("[occlusion]: %s: %s is %s", name, cases[i].name, occluded ? "occluded" : "not occluded");
+            failed_checks++;
+        }
+    }
+
+    return failed_checks;
+}
+
+static int RunOcclusionChecks(ArenaAllocator* arena)
+{
+    int                failed_checks = 0;
+    Mat4f              identity = Mat4f(Identity);
+    Mat4f              view_projection = OcclusionViewProjection(Vec3f{ 0.0f, 0.0f, 0.0f });
+    r::OcclusionBuffer buffer = r::CreateOcclusionBuffer(arena, KRAFT_OCCLUSION_BUFFER_WIDTH, KRAFT_OCCLUSION_BUFFER_HEIGHT);
+
+    // Nothing drawn yet
+    OcclusionCase empty_cases[] = {
+        { "box in an empty buffer", { 0.0f, 0.0f, -30.0f }, { 1.0f, 1.0f, 1.0f }, false },
+    };
+    failed_checks += CheckOcclusionCases("Empty", buffer, view_projection, empty_cases, KRAFT_C_ARRAY_SIZE(empty_cases));
+
+    // A 20x20 wall 10 units in front of the camera, which hides everything within 30 units of the view axis at a
+    // distance of 30
+    BoxOccluder     wall;
+    r::OccluderMesh wall_mesh;
+    MakeBoxOccluder(&wall, &identity, { 0.0f, 0.0f, -10.0f }, { 10.0f, 10.0f, 0.5f }, &wall_mesh);
+    r::RasterizeOccluders(&buffer, view_projection, &wall_mesh, 1);
+
+    OcclusionCase wall_cases[] = {
+        { "box behind the wall", { 0.0f, 0.0f, -30.0f }, { 1.0f, 1.0f, 1.0f }, true },
+        { "box behind a corner of the wall", { 12.0f, 12.0f, -30.0f }, { 1.0f, 1.0f, 1.0f }, true },
+        { "box in front of the wall", { 0.0f, 0.0f, -5.0f }, { 1.0f, 1.0f, 1.0f }, false },
+        { "box intersecting the wall", { 0.0f, 0.0f, -10.0f }, { 1.0f, 1.0f, 1.0f }, false },
+        { "box beside the wall", { 32.0f, 0.0f, -30.0f }, { 1.0f, 1.0f, 1.0f }, false },
+        { "box wider than the wall", { 0.0f, 0.0f, -30.0f }, { 40.0f, 1.0f, 1.0f }, false },
+        { "box around the camera", { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, false },
+        { "box behind the camera", { 0.0f, 0.0f, 30.0f }, { 1.0f, 1.0f, 1.0f }, false },
+    };
+    failed_checks += CheckOcclusionCases("Wall", buffer, view_projection, wall_cases, KRAFT_C_ARRAY_SIZE(wall_cases));
+
+    // Two overlapping halves of the same wall; neither hides the box alone, so this only passes when their coverage is
+    // merged in the tiles they share
+    BoxOccluder     halves[2];
+    r::OccluderMesh half_meshes[2];
+    MakeBoxOccluder(&halves[0], &identity, { -4.5f, 0.0f, -10.0f }, { 5.5f, 10.0f, 0.5f }, &half_meshes[0]);
+    MakeBoxOccluder(&halves[1], &identity, { 4.5f, 0.0f, -10.0f }, { 5.5f, 10.0f, 0.5f }, &half_meshes[1]);
+    r::ClearOcclusionBuffer(&buffer);
+    r::RasterizeOccluders(&buffer, view_projection, half_meshes, 2);
+
+    OcclusionCase halves_cases[] = {
+        { "box behind both halves", { 0.0f, 0.0f, -30.0f }, { 8.0f, 1.0f, 1.0f }, true },
+        { "box beside both halves", { 32.0f, 0.0f, -30.0f }, { 1.0f, 1.0f, 1.0f }, false },
+    };
+    failed_checks += CheckOcclusionCases("Halves", buffer, view_projection, halves_cases, KRAFT_C_ARRAY_SIZE(halves_cases));
+
+    // The occluder's model matrix is applied, the same wall moved out of the way hides nothing
+    Mat4f moved = TranslationMatrix(Vec3f{ 100.0f, 0.0f, 0.0f });
+    MakeBoxOccluder(&wall, &moved, { 0.0f, 0.0f, -10.0f }, { 10.0f, 10.0f, 0.5f }, &wall_mesh);
+    r::ClearOcclusionBuffer(&buffer);
+    r::RasterizeOccluders(&buffer, view_projection, &wall_mesh, 1);
+
+    OcclusionCase moved_cases[] = {
+        { "box behind the moved wall's old position", { 0.0f, 0.0f, -30.0f }, { 1.0f, 1.0f, 1.0f }, false },
+    };
+    failed_checks += CheckOcclusionCases("Moved", buffer, view_projection, moved_cases, KRAFT_C_ARRAY_SIZE(moved_cases));
+
+    return failed_checks;
+}
+
+//
+// Timings
+//
+
+// A grid of buildings of random heights with props scattered around them, seen from street level down the middle of
+// the city. The buildings are both the occluders and, through their bounds, objects to test.
+static void TimeSyntheticCity(ArenaAllocator* arena)
+{
+    const u32 building_count = KRAFT_BENCH_CITY_BLOCKS * KRAFT_BENCH_CITY_BLOCKS;
+    const u32 object_count = building_count * (1 + KRAFT_BENCH_CITY_PROPS);
+
+    Mat4f              identity = Mat4f(Identity);
+    BoxOccluder*       buildings = ArenaPushArray(arena, BoxOccluder, building_count);
+    r::OccluderMesh*   occluders = ArenaPushArray(arena, r::OccluderMesh, building_count);
+    r::CullingBounds   bounds = {
+        .CenterX = ArenaPushArray(arena, f32, object_count),
+        .CenterY = ArenaPushArray(arena, f32, object_count),
+        .CenterZ = ArenaPushArray(arena, f32, object_count),
+        .ExtentX = ArenaPushArray(arena, f32, object_count),
+        .ExtentY = ArenaPushArray(arena, f32, object_count),
+        .ExtentZ = ArenaPushArray(arena, f32, object_count),
+        .Radius = ArenaPushArray(arena, f32, object_count),
+    };
+    u8* visible = ArenaPushArray(arena, u8, object_count);
+
+    u32 object_index = 0;
+    u32 state = 0x43495459;
+    auto random = [&state](f32 min, f32 max) {
+        state = state * 1664525u + 1013904223u;
+        return min + (max - min) * ((state >> 8) * (1.0f / 16777216.0f));
+    };
+
+    auto add_object = [&](Vec3f center, Vec3f extents) {
+        bounds.CenterX[object_index] = center.x;
+        bounds.CenterY[object_index] = center.y;
+        bounds.CenterZ[object_index] = center.z;
+        bounds.ExtentX[object_index] = extents.x;
+        bounds.ExtentY[object_index] = extents.y;
+        bounds.ExtentZ[object_index] = extents.z;
+        bounds.Radius[object_index] = Length(extents);
+        object_index++;
+    };
+
+    // The camera looks down the street between the two middle columns of buildings
+    const f32 city_half_width = KRAFT_BENCH_CITY_BLOCKS * KRAFT_BENCH_CITY_BLOCK_SIZE * 0.5f;
+    for (u32 z = 0; z < KRAFT_BENCH_CITY_BLOCKS; z++)
+    {
+        for (u32 x = 0; x < KRAFT_BENCH_CITY_BLOCKS; x++)
+        {
+            u32   i = z * KRAFT_BENCH_CITY_BLOCKS + x;
+            f32   height = random(10.0f, 80.0f);
+            Vec3f block = { (x + 0.5f) * KRAFT_BENCH_CITY_BLOCK_SIZE - city_half_width, 0.0f, -(z + 0.5f) * KRAFT_BENCH_CITY_BLOCK_SIZE };
+            Vec3f center = { block.x, height * 0.5f, block.z };
+            Vec3f extents = { KRAFT_BENCH_CITY_BLOCK_SIZE * 0.35f, height * 0.5f, KRAFT_BENCH_CITY_BLOCK_SIZE * 0.35f };
+            MakeBoxOccluder(&buildings[i], &identity, center, extents, &occluders[i]);
+            add_object(center, extents);
+
+            for (u32 prop = 0; prop < KRAFT_BENCH_CITY_PROPS; prop++)
+            {
+                Vec3f offset = { random(-0.5f, 0.5f) * KRAFT_BENCH_CITY_BLOCK_SIZE, 0.5f, random(-0.5f, 0.5f) * KRAFT_BENCH_CITY_BLOCK_SIZE };
+                add_object(block + offset, Vec3f{ 0.5f, 0.5f, 0.5f });
+            }
+        }
+    }
+
+    Mat4f              view_projection = OcclusionViewProjection(Vec3f{ 0.0f, 2.0f, 10.0f });
+    r::OcclusionBuffer buffer = r::CreateOcclusionBuffer(arena, KRAFT_OCCLUSION_BUFFER_WIDTH, KRAFT_OCCLUSION_BUFFER_HEIGHT);
+
+    f64 raster_time = 0.0;
+    f64 test_time = 0.0;
+    u32 occluded_count = 0;
+    for (u32 iteration = 0; iteration < KRAFT_BENCH_CITY_ITERATIONS; iteration++)
+    {
+        f64 start_time = Platform::GetAbsoluteTime();
+        r::ClearOcclusionBuffer(&buffer);
+        r::RasterizeOccluders(&buffer, view_projection, occluders, building_count);
+        raster_time += Platform::GetAbsoluteTime() - start_time;
+
+        MemSet(visible, 1, object_count);
+        start_time = Platform::GetAbsoluteTime();
+        occluded_count = r::CullOccludedBounds(buffer, view_projection, bounds, 0, object_count, visible);
+        test_time += Platform::GetAbsoluteTime() - start_time;
+    }
+
+    KINFO(
+        "[occlusion]: city of %d buildings and %d objects, %d occluded (%.1f%%), %d threads",
+        building_count,
+        object_count,
+        occluded_count,
+        occluded_count * 100.0 / object_count,
+        JobSystem::GetThreadCount()
+    );
+    KINFO(
+        "[occlusion]: %-12s %8.3f ms per frame (%6.1f ns/triangle)",
+        "Rasterize",
+        raster_time * 1000.0 / KRAFT_BENCH_CITY_ITERATIONS,
+        raster_time * 1e9 / (KRAFT_BENCH_CITY_ITERATIONS * building_count * 12.0)
+    );
+    KINFO(
+        "[occlusion]: %-12s %8.3f ms per frame (%6.1f ns/object)",
+        "Test",
+        test_time * 1000.0 / KRAFT_BENCH_CITY_ITERATIONS,
+        test_time * 1e9 / ((f64)KRAFT_BENCH_CITY_ITERATIONS * object_count)
+    );
+}
+
+int RunOcclusionBenchmarks(BenchmarkOpts opts)
+{
+    ArenaAllocator* arena = CreateArena({ .ChunkSize = KRAFT_SIZE_MB(16), .Alignment = 64 });
+
+    int failed_checks = RunOcclusionChecks(arena);
+    if (failed_checks == 0 && !opts.check_only)
+    {
+        TimeSyntheticCity(arena);
+    }
+
+    DestroyArena(arena);
+    return failed_checks;
+}
@@ -0,0 +1,222 @@
+#include "kraft_benchmarks.h"
+
+#include <containers/kraft_array.h>
+#include <core/kraft_lexer.h>
+#include <renderer/kraft_renderer_types.h>
+#include <shaderfx/kraft_shaderfx_includes.h>
+
+using namespace kraft;
+
+#define KRAFT_BENCH_SHADERFX_ITERATIONS 1000
+
+// Written next to the executable's working directory and overwritten on every run
+#define KRAFT_BENCH_SHADERFX_OUTPUT_PATH "KraftBenchmarks.shaderfx.bkfx"
+
+// An effect with vertex layouts, local and global resources, constant, storage and instance buffers, and one with a
+// compute variant, between them they touch every array in the image
+static const char* ShaderFXSources[] = {
+    "basic.kfx",
+    "gpu_culling.kfx",
+};
+
+//
+// Helpers
+//
+
+static bool ParseShaderFXSource(ArenaAllocator* arena, String8 path, shaderfx::ShaderEffect* effect)
+{
+    buffer source = fs::ReadAllBytes(arena, path);
+    if (!source.ptr || source.count == 0)
+    {
+        KERROR("[shaderfx]: Failed to read '%S'", path);
+        return false;
+    }
+
+    Lexer lexer;
+    lexer.Create(source);
+
+    shaderfx::ShaderFXParser parser;
+    if (!parser.Parse(arena, path, &lexer, effect))
+    {
+        KERROR("[shaderfx]: Failed to parse '%S' at %d:%d: %S", path, parser.ErrorLine, parser.ErrorColumn, parser.error_str);
+        return false;
+    }
+
+    return true;
+}
+
+static bool WriteBytes(String8 path, const u8* data, u64 size)
+{
+    fs::FileHandle file = {};
+    if (!fs::OpenFile(path, fs::FILE_OPEN_MODE_WRITE, true, &file))
+    {
+        KERROR("[shaderfx]: Failed to open '%S' for writing", path);
+        return false;
+    }
+
+    bool written = fs::WriteFile(&file, data, size);
+    fs::CloseFile(&file);
+
+    return written;
+}
+
+//
+// Checks
+//
+
+// ValidateShaderFX doesn't look at the code, which is what the image mostly holds
+static int CheckShaderFXCode(String8 name, const shaderfx::ShaderEffect* loaded, const shaderfx::ShaderEffect* parsed)
+{
+    for (u32 v = 0; v < parsed->variant_count; v++)
+    {
+        for (u32 j = 0; j < parsed->variants[v].shader_stage_count; j++)
+        {
+            if (!StringEqual(loaded->variants[v].shader_stages[j].code_fragment.code, parsed->variants[v].shader_stages[j].code_fragment.code))
+            {
+                KERROR("[shaderfx]: %S: the code of stage %d of variant '%S' differs after loading", name, j, parsed->variants[v].name);
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+// Writes `file` back with its image cut in half, which the loader has to reject
+static int CheckTruncatedShaderFX(ArenaAllocator* arena, String8 name, String8 path, buffer file)
+{
+    if (!WriteBytes(path, file.ptr, file.count / 2))
+        return 1;
+
+    TempArena              temp = TempBegin(arena);
+    shaderfx::ShaderEffect effect;
+    bool                   loaded = shaderfx::LoadShaderFX(temp.arena, path, &effect);
+    TempEnd(temp);
+
+    if (loaded)
+    {
+        KERROR("[shaderfx]: %S: loaded a file truncated to %llu of %llu bytes", name, file.count / 2, file.count);
+        return 1;
+    }
+
+    return 0;
+}
+
+// Points the variants of the effect past the end of the image and fixes up the content hash, so the file only gets
+// rejected if the loader checks the offsets themselves
+static int CheckCorruptedShaderFXOffset(ArenaAllocator* arena, String8 name, String8 path, buffer file)
+{
+    TempArena temp = TempBegin(arena);
+    u8*       data = ArenaPushArray(temp.arena, u8, file.count);
+    MemCpy(data, file.ptr, file.count);
+
+    shaderfx::ShaderFXBinaryHeader* header = (shaderfx::ShaderFXBinaryHeader*)data;
+    u8*                             image = data + sizeof(shaderfx::ShaderFXBinaryHeader);
+    shaderfx::ShaderEffect*         root = (shaderfx::ShaderEffect*)image;
+    root->variants = (shaderfx::VariantDefinition*)(header->image_size + KRAFT_SHADERFX_BINARY_ALIGNMENT);
+    header->content_hash = MurmurHash64(image, (int)header->image_size, KRAFT_SHADERFX_BINARY_MAGIC);
+
+    bool loaded = false;
+    if (WriteBytes(path, data, file.count))
+    {
+        shaderfx::ShaderEffect effect;
+        loaded = shaderfx::LoadShaderFX(temp.arena, path, &effect);
+    }
+
+    TempEnd(temp);
+
+    if (loaded)
+    {
+        KERROR("[shaderfx]: %S: loaded a file with an offset outside of the image", name);
+        return 1;
+    }
+
+    return 0;
+}
+
+// Parses the effect, writes it with WriteShaderFXBinary and loads it back, then checks that broken copies of the file
+// are rejected. The .bkfx files in res/shaders aren't used, they may be stale or missing.
+static int RunShaderFXChecks(ArenaAllocator* arena, String8 name)
+{
+    TempArena temp = TempBegin(arena);
+    String8   source_path = fs::PathJoin(temp.arena, String8Raw(KRAFT_BENCH_SHADERS_PATH), name);
+    String8   output_path = String8Raw(KRAFT_BENCH_SHADERFX_OUTPUT_PATH);
+
+    int                    failed_checks = 0;
+    shaderfx::ShaderEffect parsed;
+    if (!ParseShaderFXSource(temp.arena, source_path, &parsed) || !shaderfx::WriteShaderFXBinary(&parsed, output_path))
+    {
+        TempEnd(temp);
+        return 1;
+    }
+
+    buffer                 file = fs::ReadAllBytes(temp.arena, output_path, KRAFT_SHADERFX_BINARY_ALIGNMENT);
+    shaderfx::ShaderEffect loaded;
+    if (!shaderfx::LoadShaderFX(temp.arena, output_path, &loaded))
+    {
+        KERROR("[shaderfx]: %S: failed to load the effect that was just written", name);
+        TempEnd(temp);
+        return 1;
+    }
+
+    // Traps on the first difference
+    shaderfx::ValidateShaderFX(&loaded, &parsed);
+
+    failed_checks += CheckShaderFXCode(name, &loaded, &parsed);
+    failed_checks += CheckTruncatedShaderFX(temp.arena, name, output_path, file);
+    failed_checks += CheckCorruptedShaderFXOffset(temp.arena, name, output_path, file);
+
+    TempEnd(temp);
+    return failed_checks;
+}
+
+//
+// Timings
+//
+
+static void TimeLoadShaderFX(ArenaAllocator* arena, String8 name)
+{
+    TempArena temp = TempBegin(arena);
+    String8   source_path = fs::PathJoin(temp.arena, String8Raw(KRAFT_BENCH_SHADERS_PATH), name);
+    String8   output_path = String8Raw(KRAFT_BENCH_SHADERFX_OUTPUT_PATH);
+
+    shaderfx::ShaderEffect parsed;
+    if (ParseShaderFXSource(temp.arena, source_path, &parsed) && shaderfx::WriteShaderFXBinary(&parsed, output_path))
+    {
+        f64 start_time = Platform::GetAbsoluteTime();
+        for (u32 i = 0; i < KRAFT_BENCH_SHADERFX_ITERATIONS; i++)
+        {
+            TempArena              iteration = TempBegin(temp.arena);
+            shaderfx::ShaderEffect effect;
+            shaderfx::LoadShaderFX(iteration.arena, output_path, &effect);
+            TempEnd(iteration);
+        }
+
+        f64 elapsed_time = Platform::GetAbsoluteTime() - start_time;
+        KINFO("[shaderfx]: %-16S LoadShaderFX %8.3f ms (%6.2f us/load)", name, elapsed_time * 1000.0, elapsed_time * 1e6 / KRAFT_BENCH_SHADERFX_ITERATIONS);
+    }
+
+    TempEnd(temp);
+}
+
+int RunShaderFXBenchmarks(BenchmarkOpts opts)
+{
+    ArenaAllocator* arena = CreateArena({ .ChunkSize = KRAFT_SIZE_MB(4), .Alignment = 64 });
+
+    int failed_checks = 0;
+    for (u32 i = 0; i < KRAFT_C_ARRAY_SIZE(ShaderFXSources); i++)
+    {
+        failed_checks += RunShaderFXChecks(arena, String8FromCString(ShaderFXSources[i]));
+    }
+
+    if (failed_checks == 0 && !opts.check_only)
+    {
+        for (u32 i = 0; i < KRAFT_C_ARRAY_SIZE(ShaderFXSources); i++)
+        {
+            TimeLoadShaderFX(arena, String8FromCString(ShaderFXSources[i]));
+        }
+    }
+
+    DestroyArena(arena);
+    return failed_checks;
+}
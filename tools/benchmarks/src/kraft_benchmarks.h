@@ -0,0 +1,20 @@
+#pragma once
+
+#include <kraft.h>
+#include <kraft_types.h>
+
+#include <core/kraft_base_includes.h>
+#include <platform/kraft_platform_includes.h>
+
+// Every suite checks its results before timing anything; it returns the number of failed checks.
+// With `check_only` set, a suite runs its checks and skips the timings, which is what ctest runs.
+struct BenchmarkOpts
+{
+    bool check_only = false;
+};
+
+int RunJobBenchmarks(BenchmarkOpts opts);
+int RunMathBenchmarks(BenchmarkOpts opts);
+int RunOcclusionBenchmarks(BenchmarkOpts opts);
+int RunShaderFXBenchmarks(BenchmarkOpts opts);
+int RunComputeBenchmarks(BenchmarkOpts opts);
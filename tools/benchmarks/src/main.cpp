@@ -0,0 +1,92 @@
+#include "kraft_benchmarks.h"
+
+using namespace kraft;
+
+struct ApplicationState
+{};
+
+// Runs the suites named on the command line, or all of them
+int Init()
+{
+    auto&         args = kraft::Engine::GetCommandLineArgs();
+    BenchmarkOpts opts;
+    bool          run_all = true;
+    for (int i = 1; i < args.count; i++)
+    {
+        if (StringEqual(args.ptr[i], String8Raw("--check")))
+        {
+            opts.check_only = true;
+        }
+        else
+        {
+            run_all = false;
+        }
+    }
+
+    auto selected = [&](String8 suite) {
+        if (run_all)
+            return true;
+
+        for (int i = 1; i < args.count; i++)
+        {
+            if (StringEqual(args.ptr[i], suite))
+                return true;
+        }
+
+        return false;
+    };
+
+    int failed_checks = 0;
+    if (selected(String8Raw("jobs")))
+    {
+        failed_checks += RunJobBenchmarks(opts);
+    }
+
+    if (selected(String8Raw("math")))
+    {
+        failed_checks += RunMathBenchmarks(opts);
+    }
+
+    if (selected(String8Raw("occlusion")))
+    {
+        failed_checks += RunOcclusionBenchmarks(opts);
+    }
+
+    if (selected(String8Raw("shaderfx")))
+    {
+        failed_checks += RunShaderFXBenchmarks(opts);
+    }
+
+    if (selected(String8Raw("compute")))
+    {
+        failed_checks += RunComputeBenchmarks(opts);
+    }
+
+    if (failed_checks > 0)
+    {
+        KERROR("%d checks failed", failed_checks);
+    }
+
+    return failed_checks;
+}
+
+int main(int argc, char** argv)
+{
+    ThreadContext* thread_context = CreateThreadContext();
+    SetCurrentThreadContext(thread_context);
+
+    kraft::EngineConfig config = {
+        .argc = argc,
+        .argv = argv,
+        .application_name = S("KraftBenchmarks"),
+        .console_app = true,
+    };
+
+    kraft::CreateEngine(&config);
+
+    int error_count = Init();
+
+    kraft::DestroyEngine();
+
+    return error_count;
+}
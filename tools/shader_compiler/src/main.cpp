@@ -8,6 +8,11 @@
 #include <shaderc/shaderc.h>
 #include <vendor/spirv-reflect/spirv_reflect.h>
 
+// glslang's version, shaderc doesn't expose its own build at runtime
+#if __has_include(<glslang/build_info.h>)
+#include <glslang/build_info.h>
+#endif
+
 #include <core/kraft_base_includes.h>
 #include <platform/kraft_platform_includes.h>
 #include <renderer/kraft_renderer_types.h>
@@ -30,6 +35,7 @@ struct ApplicationState
 #define KRAFT_GEOMETRY_DEFINE     "GEOMETRY"
 #define KRAFT_FRAGMENT_DEFINE     "FRAGMENT"
 #define KRAFT_COMPUTE_DEFINE      "COMPUTE"
+#define KRAFT_INSTANCED_DEFINE    "KRAFT_INSTANCED"
 #define KRAFT_SHADERFX_ENABLE_VAL "1"
 
 using namespace kraft;
@@ -39,10 +45,188 @@ struct ShaderFxCompilerOpts
     bool verbose = false;
     bool write_spirv_for_shaders = false;
     bool validate = true;
+    bool bench_load = false; // Time loading the compiled effects instead of compiling
+
+    // Directory of the shader cache, empty when the cache is disabled
+    String8 cache_dir = {};
+};
+
+// A file the compiled effect was built from, along with the hash of its contents when it was compiled
+struct ShaderDependency
+{
+    String8           path;
+    u64               hash;
+    ShaderDependency* next;
 };
 
 bool CompileShaderFX(ArenaAllocator* arena, String8 InputPath, String8 OutputPath, ShaderFxCompilerOpts compiler_opts);
-bool CompileShaderFX(ArenaAllocator* arena, shaderfx::ShaderEffect* Shader, String8 OutputPath, ShaderFxCompilerOpts compiler_opts);
+bool CompileShaderFX(ArenaAllocator* arena, shaderfx::ShaderEffect* Shader, String8 OutputPath, ShaderFxCompilerOpts compiler_opts, ShaderDependency** dependencies);
+
+// One shaderc compiler per job system thread, indexed by JobSystem::GetCurrentThreadIndex()
+static shaderc_compiler_t* shaderc_compilers = nullptr;
+
+//
+// Shader cache
+//
+// Compiled effects are stored in the cache directory under a hash of the source, its path and everything about the
+// compiler that affects the output. Each entry also lists the files the source included along with their hashes, so an
+// entry is only used if none of the includes changed either. Entries are never removed, switching back to an older
+// version of a shader picks up its entry again.
+//
+
+#define KRAFT_SHADER_CACHE_MAGIC   0x4358464B // "KFXC"
+#define KRAFT_SHADER_CACHE_VERSION 1
+
+// Version of the SDK shaderc is linked from, set by the build. shaderc_get_spv_version() only reports the SPIR-V version
+// the compiler emits, which stays the same across most shaderc releases.
+#ifndef KRAFT_SHADERC_VERSION
+#define KRAFT_SHADERC_VERSION ""
+#endif
+
+#ifndef GLSLANG_VERSION_MAJOR
+#define GLSLANG_VERSION_MAJOR 0
+#define GLSLANG_VERSION_MINOR 0
+#define GLSLANG_VERSION_PATCH 0
+#endif
+
+// Hash of the compiler versions and the defines the stages are compiled with
+static u64 shader_cache_seed = 0;
+
+static void InitShaderCache()
+{
+    unsigned int spv_version, spv_revision;
+    shaderc_get_spv_version(&spv_version, &spv_revision);
+
+    const char defines[] = KRAFT_VERTEX_DEFINE KRAFT_GEOMETRY_DEFINE KRAFT_FRAGMENT_DEFINE KRAFT_COMPUTE_DEFINE KRAFT_INSTANCED_DEFINE KRAFT_SHADERFX_ENABLE_VAL;
+    const char shaderc_version[] = KRAFT_SHADERC_VERSION;
+    u64        versions[] = {
+        spv_version,           spv_revision,          GLSLANG_VERSION_MAJOR, GLSLANG_VERSION_MINOR, GLSLANG_VERSION_PATCH, KRAFT_SHADERFX_BINARY_VERSION,
+        shaderfx::GetShaderFXBinaryLayoutHash(),
+    };
+    u64 seed = MurmurHash64(defines, sizeof(defines), KRAFT_SHADER_CACHE_VERSION);
+    seed = MurmurHash64(shaderc_version, sizeof(shaderc_version), seed);
+    shader_cache_seed = MurmurHash64(versions, sizeof(versions), seed);
+}
+
+static String8 GetShaderCacheEntryPath(ArenaAllocator* arena, String8 cache_dir, String8 input_path, String8 source)
+{
+    u64 key = MurmurHash64(source.ptr, (int)source.count, MurmurHash64(input_path.ptr, (int)input_path.count, shader_cache_seed));
+    return fs::PathJoin(arena, cache_dir, StringFormat(arena, "%016llx.kfxc", key));
+}
+
+static bool ReadShaderCacheBytes(buffer data, u64* offset, void* dst, u64 size)
+{
+    if (size > data.count - *offset)
+        return false;
+
+    MemCpy(dst, data.ptr + *offset, size);
+    *offset += size;
+    return true;
+}
+
+// Writes the cached output to `output_path` if the entry exists and none of its dependencies changed
+static bool RestoreFromShaderCache(String8 entry_path, String8 output_path)
+{
+    if (!fs::FileExists(entry_path))
+        return false;
+
+    TempArena scratch = ScratchBegin(0, 0);
+    buffer    entry = fs::ReadAllBytes(scratch.arena, entry_path);
+    u64       offset = 0;
+    u32       magic = 0;
+    u32       dependency_count = 0;
+    bool      valid = ReadShaderCacheBytes(entry, &offset, &magic, sizeof(magic)) && magic == KRAFT_SHADER_CACHE_MAGIC;
+    valid = valid && ReadShaderCacheBytes(entry, &offset, &dependency_count, sizeof(dependency_count));
+    for (u32 i = 0; valid && i < dependency_count; i++)
+    {
+        u64 hash = 0;
+        u32 path_length = 0;
+        valid = ReadShaderCacheBytes(entry, &offset, &hash, sizeof(hash)) && ReadShaderCacheBytes(entry, &offset, &path_length, sizeof(path_length));
+        if (!valid || path_length > entry.count - offset)
+        {
+            valid = false;
+            break;
+        }
+
+        // Copied to null terminate it for the file functions
+        String8 path = ArenaPushString8Copy(scratch.arena, String8FromPtrAndLength(entry.ptr + offset, path_length));
+        offset += path_length;
+
+        buffer dependency = fs::ReadAllBytes(scratch.arena, path);
+        valid = dependency.ptr && MurmurHash64(dependency.ptr, (int)dependency.count, 0) == hash;
+    }
+
+    u64 output_size = 0;
+    valid = valid && ReadShaderCacheBytes(entry, &offset, &output_size, sizeof(output_size)) && output_size == entry.count - offset;
+    if (valid)
+    {
+        // Leave the output alone if it's already up to date, so its modified time doesn't change
+        String8 output = String8FromPtrAndLength(entry.ptr + offset, output_size);
+        buffer  existing = fs::FileExists(output_path) ? fs::ReadAllBytes(scratch.arena, output_path) : buffer{};
+        if (existing.count != output.count || MemCmp(existing.ptr, output.ptr, output.count) != 0)
+        {
+            fs::FileHandle file;
+            valid = fs::OpenFile(output_path, fs::FILE_OPEN_MODE_WRITE, true, &file);
+            if (valid)
+            {
+                valid = fs::WriteFile(&file, output.ptr, output.count);
+                fs::CloseFile(&file);
+            }
+        }
+    }
+
+    ScratchEnd(scratch);
+    return valid;
+}
+
+static void WriteShaderCacheEntry(String8 entry_path, String8 input_path, String8 source, ShaderDependency* dependencies, String8 output_path)
+{
+    TempArena scratch = ScratchBegin(0, 0);
+    buffer    output = fs::ReadAllBytes(scratch.arena, output_path);
+    if (!output.ptr)
+    {
+        ScratchEnd(scratch);
+        return;
+    }
+
+    // The source is a dependency like any other, so the entry notices when the file was changed after it was read
+    ShaderDependency source_dependency = {
+        .path = input_path,
+        .hash = MurmurHash64(source.ptr, (int)source.count, 0),
+        .next = dependencies,
+    };
+
+    u32 dependency_count = 0;
+    for (ShaderDependency* dependency = &source_dependency; dependency; dependency = dependency->next)
+    {
+        dependency_count++;
+    }
+
+    kraft::Buffer entry;
+    entry.Writeu32(KRAFT_SHADER_CACHE_MAGIC);
+    entry.Writeu32(dependency_count);
+    for (ShaderDependency* dependency = &source_dependency; dependency; dependency = dependency->next)
+    {
+        entry.Writeu64(dependency->hash);
+        entry.WriteString(dependency->path);
+    }
+
+    entry.Writeu64(output.count);
+    entry.Write(output.ptr, output.count);
+
+    fs::FileHandle file;
+    if (fs::OpenFile(entry_path, fs::FILE_OPEN_MODE_WRITE, true, &file))
+    {
+        fs::WriteFile(&file, (u8*)entry.Data(), entry.Length);
+        fs::CloseFile(&file);
+    }
+    else
+    {
+        KWARN("[CompileKFX]: Failed to write the cache entry '%S'", entry_path);
+    }
+
+    ScratchEnd(scratch);
+}
 
 void SpirvErrorCallback(void* userdata, const char* error)
 {
@@ -63,6 +247,19 @@ bool CompileShaderFX(ArenaAllocator* arena, String8 input_path, String8 output_p
     // Normalize path separators so resource_path is consistent regardless of invocation
     String8 clean_input_path = fs::CleanPath(arena, input_path);
 
+    // The SPIR-V files are only written when the stages are compiled, so they always skip the cache
+    String8 cache_entry_path = {};
+    if (compiler_opts.cache_dir.count > 0)
+    {
+        cache_entry_path = GetShaderCacheEntryPath(arena, compiler_opts.cache_dir, clean_input_path, file_buf);
+        if (!compiler_opts.write_spirv_for_shaders && RestoreFromShaderCache(cache_entry_path, output_path))
+        {
+            KINFO("%S is up to date", input_path);
+            ScratchEnd(scratch);
+            return true;
+        }
+    }
+
     Lexer lexer;
     lexer.Create(file_buf);
     shaderfx::ShaderFXParser Parser;
@@ -76,7 +273,8 @@ bool CompileShaderFX(ArenaAllocator* arena, String8 input_path, String8 output_p
         return false;
     }
 
-    bool result = CompileShaderFX(arena, &effect, output_path, compiler_opts);
+    ShaderDependency* dependencies = nullptr;
+    bool              result = CompileShaderFX(arena, &effect, output_path, compiler_opts, &dependencies);
 
     // Validate the effect
     if (compiler_opts.validate)
@@ -90,6 +288,11 @@ bool CompileShaderFX(ArenaAllocator* arena, String8 input_path, String8 output_p
         }
     }
 
+    if (result && cache_entry_path.count > 0)
+    {
+        WriteShaderCacheEntry(cache_entry_path, input_path, file_buf, dependencies, output_path);
+    }
+
     ScratchEnd(scratch);
 
     return result;
@@ -132,6 +335,9 @@ struct ShaderIncludeUserData
 {
     ArenaAllocator*         arena;
     shaderfx::ShaderEffect* shader;
+
+    // Every file included while compiling, see ShaderDependency
+    ShaderDependency* dependencies;
 };
 
 static shaderc_include_result* ShaderIncludeResolverFunction(void* userdata, const char* requested_src, int Type, const char* requesting_src, size_t include_depth)
@@ -143,20 +349,30 @@ static shaderc_include_result* ShaderIncludeResolverFunction(void* userdata, con
     String8 shader_dir = fs::Dirname(arena, shader->resource_path);
     String8 included_filepath = fs::PathJoin(arena, shader_dir, String8FromCString((char*)requested_src));
 
-    fs::FileHandle file;
-    KASSERT(fs::OpenFile(included_filepath, fs::FILE_OPEN_MODE_READ, true, &file));
-    u64 filesize = fs::GetFileSize(&file);
-    u8* file_buf = ArenaPushArray(arena, u8, filesize);
-    fs::ReadAllBytes(&file, &file_buf);
-
     shaderc_include_result* result = ArenaPush(arena, shaderc_include_result);
-    result->content = (const char*)file_buf;
-    result->content_length = filesize;
+    buffer                  file_buf = fs::ReadAllBytes(arena, included_filepath);
+    if (!file_buf.ptr)
+    {
+        // An empty source name tells shaderc the include failed, the content is the error message
+        String8 error = StringFormat(arena, "Failed to open '%S'", included_filepath);
+        result->content = (const char*)error.ptr;
+        result->content_length = error.count;
+        return result;
+    }
+
+    result->content = (const char*)file_buf.ptr;
+    result->content_length = file_buf.count;
 
     String8 src_name = ArenaPushString8Copy(arena, included_filepath);
     result->source_name = (char*)src_name.ptr;
     result->source_name_length = src_name.count;
 
+    ShaderDependency* dependency = ArenaPush(arena, ShaderDependency);
+    dependency->path = src_name;
+    dependency->hash = MurmurHash64(file_buf.ptr, (int)file_buf.count, 0);
+    dependency->next = include_data->dependencies;
+    include_data->dependencies = dependency;
+
     return result;
 }
 
@@ -190,215 +406,161 @@ bool VerifyResources(shaderfx::ShaderEffect* shader, shaderfx::ResourceBindingsD
     return true;
 }
 
-bool CompileShaderFX(ArenaAllocator* arena, shaderfx::ShaderEffect* shader, String8 output_path, ShaderFxCompilerOpts compiler_opts)
+// A single stage of a variant, compiled on whichever thread picks it up
+struct ShaderStageCompileTask
 {
-    // Basic verification
-    if (!VerifyResources(shader, shader->local_resources, shader->local_resource_count))
-        return false;
+    shaderfx::ShaderEffect*                        shader;
+    const shaderfx::VariantDefinition*             variant;
+    shaderfx::VariantDefinition::ShaderDefinition* shader_def;
+    ShaderFxCompilerOpts                           compiler_opts;
 
-    if (!VerifyResources(shader, shader->global_resources, shader->global_resource_count))
-        return false;
+    // Owned by the task, holds the included sources and the dependencies
+    ArenaAllocator* arena;
 
-    shaderc_compiler_t           compiler = shaderc_compiler_initialize();
+    shaderc_shader_kind          shader_kind;
     shaderc_compilation_result_t result;
-    shaderc_compile_options_t    shaderc_compile_opts;
-
-    kraft::Buffer binary_output;
-    binary_output.WriteString(shader->name);
-    binary_output.WriteString(shader->resource_path);
+    ShaderDependency*            dependencies;
+};
 
-    binary_output.Writeu32(shader->vertex_layout_count);
-    for (u32 i = 0; i < shader->vertex_layout_count; i++)
+static void CompileShaderStageJob(void* user_data)
+{
+    ShaderStageCompileTask*                        task = (ShaderStageCompileTask*)user_data;
+    const shaderfx::VariantDefinition&             variant = *task->variant;
+    shaderfx::VariantDefinition::ShaderDefinition& shader_def = *task->shader_def;
+    if (task->compiler_opts.verbose)
     {
-        binary_output.WriteString(shader->vertex_layouts[i].name);
-
-        binary_output.Writeu32(shader->vertex_layouts[i].attribute_count);
-        for (u32 j = 0; j < shader->vertex_layouts[i].attribute_count; j++)
-        {
-            binary_output.Writeu16(shader->vertex_layouts[i].attributes[j].location);
-            binary_output.Writeu16(shader->vertex_layouts[i].attributes[j].binding);
-            binary_output.Writeu16(shader->vertex_layouts[i].attributes[j].offset);
-            // binary_output.WriteRaw(&shader->vertex_layouts[i].attributes[j].format, sizeof(r::ShaderDataType));
-            binary_output.Writeu8(shader->vertex_layouts[i].attributes[j].format.UnderlyingType);
-            binary_output.Writeu16(shader->vertex_layouts[i].attributes[j].format.ArraySize);
-        }
-
-        binary_output.Writeu32(shader->vertex_layouts[i].input_binding_count);
-        for (u32 j = 0; j < shader->vertex_layouts[i].input_binding_count; j++)
-        {
-            binary_output.Writeu16(shader->vertex_layouts[i].input_bindings[j].binding);
-            binary_output.Writeu16(shader->vertex_layouts[i].input_bindings[j].stride);
-            binary_output.Writei32(shader->vertex_layouts[i].input_bindings[j].input_rate);
-        }
+        KDEBUG("Compiling variant '%S' shaderstage %d for '%S'", variant.name, shader_def.stage, task->shader->resource_path);
     }
 
-    binary_output.Writeu32(shader->local_resource_count);
-    for (u32 i = 0; i < shader->local_resource_count; i++)
+    shaderc_compile_options_t shaderc_compile_opts = shaderc_compile_options_initialize();
+    ShaderIncludeUserData     include_data = {
+        .arena = task->arena,
+        .shader = task->shader,
+    };
+    shaderc_compile_options_set_include_callbacks(shaderc_compile_opts, ShaderIncludeResolverFunction, ShaderIncludeResultReleaseFunction, &include_data);
+
+    // Pulls in the instance buffer declarations from common.glsl
+    if (variant.instance_buffer)
     {
-        binary_output.WriteString(shader->local_resources[i].name);
-        binary_output.Writeu32(shader->local_resources[i].binding_count);
-        for (u32 j = 0; j < shader->local_resources[i].binding_count; j++)
-        {
-            binary_output.WriteString(shader->local_resources[i].bindings[j].name);
-            binary_output.Writeu16(shader->local_resources[i].bindings[j].set);
-            binary_output.Writeu16(shader->local_resources[i].bindings[j].binding);
-            binary_output.Writeu16(shader->local_resources[i].bindings[j].size);
-            binary_output.Writei16(shader->local_resources[i].bindings[j].parent_index);
-            binary_output.Writei32(shader->local_resources[i].bindings[j].type);
-            binary_output.Writei32(shader->local_resources[i].bindings[j].stage);
-        }
+        shaderc_compile_options_add_macro_definition(
+            shaderc_compile_opts, KRAFT_INSTANCED_DEFINE, sizeof(KRAFT_INSTANCED_DEFINE) - 1, KRAFT_SHADERFX_ENABLE_VAL, sizeof(KRAFT_SHADERFX_ENABLE_VAL) - 1
+        );
     }
 
-    binary_output.Writeu32(shader->global_resource_count);
-    for (u32 i = 0; i < shader->global_resource_count; i++)
+    shaderc_shader_kind shader_kind;
+    switch (shader_def.stage)
     {
-        binary_output.WriteString(shader->global_resources[i].name);
-        binary_output.Writeu32(shader->global_resources[i].binding_count);
-        for (u32 j = 0; j < shader->global_resources[i].binding_count; j++)
+        case r::ShaderStageFlags::SHADER_STAGE_FLAGS_VERTEX:
         {
-            binary_output.WriteString(shader->global_resources[i].bindings[j].name);
-            binary_output.Writeu16(shader->global_resources[i].bindings[j].set);
-            binary_output.Writeu16(shader->global_resources[i].bindings[j].binding);
-            binary_output.Writeu16(shader->global_resources[i].bindings[j].size);
-            binary_output.Writei16(shader->global_resources[i].bindings[j].parent_index);
-            binary_output.Writei32(shader->global_resources[i].bindings[j].type);
-            binary_output.Writei32(shader->global_resources[i].bindings[j].stage);
+            shader_kind = shaderc_vertex_shader;
+            shaderc_compile_options_add_macro_definition(
+                shaderc_compile_opts, KRAFT_VERTEX_DEFINE, sizeof(KRAFT_VERTEX_DEFINE) - 1, KRAFT_SHADERFX_ENABLE_VAL, sizeof(KRAFT_SHADERFX_ENABLE_VAL) - 1
+            );
         }
-    }
+        break;
 
-    binary_output.Writeu32(shader->constant_buffer_count);
-    for (u32 i = 0; i < shader->constant_buffer_count; i++)
-    {
-        binary_output.WriteString(shader->constant_buffers[i].name);
-        binary_output.Writeu32(shader->constant_buffers[i].field_count);
-        for (u32 j = 0; j < shader->constant_buffers[i].field_count; j++)
+        case r::ShaderStageFlags::SHADER_STAGE_FLAGS_GEOMETRY:
         {
-            binary_output.WriteString(shader->constant_buffers[i].fields[j].name);
-            binary_output.Writei32(shader->constant_buffers[i].fields[j].stage);
-            binary_output.WriteRaw(&shader->constant_buffers[i].fields[j].type, sizeof(r::ShaderDataType));
+            shader_kind = shaderc_geometry_shader;
+            shaderc_compile_options_add_macro_definition(
+                shaderc_compile_opts, KRAFT_GEOMETRY_DEFINE, sizeof(KRAFT_GEOMETRY_DEFINE) - 1, KRAFT_SHADERFX_ENABLE_VAL, sizeof(KRAFT_SHADERFX_ENABLE_VAL) - 1
+            );
         }
-    }
+        break;
 
-    binary_output.Writeu32(shader->uniform_buffer_count);
-    for (u32 i = 0; i < shader->uniform_buffer_count; i++)
-    {
-        binary_output.WriteString(shader->uniform_buffers[i].name);
-        binary_output.Writeu32(shader->uniform_buffers[i].field_count);
-        for (u32 j = 0; j < shader->uniform_buffers[i].field_count; j++)
+        case r::ShaderStageFlags::SHADER_STAGE_FLAGS_FRAGMENT:
         {
-            binary_output.WriteString(shader->uniform_buffers[i].fields[j].name);
-            binary_output.WriteRaw(&shader->uniform_buffers[i].fields[j].type, sizeof(r::ShaderDataType));
+            shader_kind = shaderc_fragment_shader;
+            shaderc_compile_options_add_macro_definition(
+                shaderc_compile_opts, KRAFT_FRAGMENT_DEFINE, sizeof(KRAFT_FRAGMENT_DEFINE) - 1, KRAFT_SHADERFX_ENABLE_VAL, sizeof(KRAFT_SHADERFX_ENABLE_VAL) - 1
+            );
         }
-    }
+        break;
 
-    binary_output.Writeu32(shader->storage_buffer_count);
-    for (u32 i = 0; i < shader->storage_buffer_count; i++)
-    {
-        binary_output.WriteString(shader->storage_buffers[i].name);
-        binary_output.Writeu32(shader->storage_buffers[i].field_count);
-        for (u32 j = 0; j < shader->storage_buffers[i].field_count; j++)
+        case r::ShaderStageFlags::SHADER_STAGE_FLAGS_COMPUTE:
         {
-            binary_output.WriteString(shader->storage_buffers[i].fields[j].name);
-            binary_output.WriteRaw(&shader->storage_buffers[i].fields[j].type, sizeof(r::ShaderDataType));
+            shader_kind = shaderc_compute_shader;
+            shaderc_compile_options_add_macro_definition(
+                shaderc_compile_opts, KRAFT_COMPUTE_DEFINE, sizeof(KRAFT_COMPUTE_DEFINE) - 1, KRAFT_SHADERFX_ENABLE_VAL, sizeof(KRAFT_SHADERFX_ENABLE_VAL) - 1
+            );
         }
+        break;
     }
 
-    // RenderStates
-    binary_output.Writeu32(shader->render_state_count);
-    for (u32 i = 0; i < shader->render_state_count; i++)
+    shaderc_compiler_t compiler = shaderc_compilers[JobSystem::GetCurrentThreadIndex()];
+    task->shader_kind = shader_kind;
+    task->result = shaderc_compile_into_spv(compiler, (char*)shader_def.code_fragment.code.ptr, shader_def.code_fragment.code.count, shader_kind, "shader", "main", shaderc_compile_opts);
+    task->dependencies = include_data.dependencies;
+
+    shaderc_compile_options_release(shaderc_compile_opts);
+}
+
+bool CompileShaderFX(ArenaAllocator* arena, shaderfx::ShaderEffect* shader, String8 output_path, ShaderFxCompilerOpts compiler_opts, ShaderDependency** dependencies)
+{
+    // Basic verification
+    if (!VerifyResources(shader, shader->local_resources, shader->local_resource_count))
+        return false;
+
+    if (!VerifyResources(shader, shader->global_resources, shader->global_resource_count))
+        return false;
+
+    // Every stage of every variant is compiled in parallel
+    u32 task_count = 0;
+    for (u32 v = 0; v < shader->variant_count; v++)
     {
-        binary_output.WriteString(shader->render_states[i].name);
-        binary_output.Writei32(shader->render_states[i].cull_mode);
-        binary_output.Writei32(shader->render_states[i].z_test_op);
-        binary_output.Writebool(shader->render_states[i].z_write_enable);
-        binary_output.Writebool(shader->render_states[i].blend_enable);
-        binary_output.WriteRaw(&shader->render_states[i].blend_mode, sizeof(r::BlendState));
-        binary_output.Writei32(shader->render_states[i].polygon_mode);
-        binary_output.Writef32(shader->render_states[i].line_width);
+        task_count += shader->variants[v].shader_stage_count;
     }
 
-    // Variants
-    binary_output.Writeu32(shader->variant_count);
+    ShaderStageCompileTask* tasks = ArenaPushArray(arena, ShaderStageCompileTask, task_count);
+    JobDescription*         jobs = ArenaPushArray(arena, JobDescription, task_count);
+    JobCounter              counter;
+    u32                     task_index = 0;
     for (u32 v = 0; v < shader->variant_count; v++)
     {
-        const shaderfx::VariantDefinition& variant = shader->variants[v];
-        binary_output.WriteString(variant.name);
-
-        // Write offsets into shared arrays
-        binary_output.Writei64((i64)(variant.vertex_layout - &shader->vertex_layouts[0]));
-        binary_output.Writei64((i64)(shader->local_resource_count > 0 && variant.resources ? variant.resources - &shader->local_resources[0] : -1));
-        binary_output.Writei64((i64)(variant.contant_buffers - &shader->constant_buffers[0]));
-        binary_output.Writei64((i64)(variant.render_state - &shader->render_states[0]));
-
-        // Output flags
-        binary_output.Writebool(variant.has_color_output);
-        binary_output.Writebool(variant.has_depth_output);
-
-        // Compile and write shader stages for this variant
-        binary_output.Writeu32(variant.shader_stage_count);
-        for (u32 j = 0; j < variant.shader_stage_count; j++)
+        for (u32 j = 0; j < shader->variants[v].shader_stage_count; j++)
         {
-            const shaderfx::VariantDefinition::ShaderDefinition& shader_def = variant.shader_stages[j];
-            if (compiler_opts.verbose)
-            {
-                KDEBUG("Compiling variant '%S' shaderstage %d for '%S'", variant.name, shader_def.stage, shader->resource_path);
-            }
-
-            shaderc_compile_opts = shaderc_compile_options_initialize();
-            ShaderIncludeUserData user_data = {
-                .arena = arena,
-                .shader = shader,
+            ShaderStageCompileTask* task = &tasks[task_index];
+            task->shader = shader;
+            task->variant = &shader->variants[v];
+            task->shader_def = &shader->variants[v].shader_stages[j];
+            task->compiler_opts = compiler_opts;
+            task->arena = CreateArena({ .ChunkSize = KRAFT_SIZE_MB(1), .Alignment = 64 });
+
+            jobs[task_index] = {
+                .Function = CompileShaderStageJob,
+                .UserData = task,
+                .Counter = &counter,
             };
-            shaderc_compile_options_set_include_callbacks(shaderc_compile_opts, ShaderIncludeResolverFunction, ShaderIncludeResultReleaseFunction, &user_data);
-
-            shaderc_shader_kind shader_kind;
-            switch (shader_def.stage)
-            {
-                case r::ShaderStageFlags::SHADER_STAGE_FLAGS_VERTEX:
-                {
-                    shader_kind = shaderc_vertex_shader;
-                    shaderc_compile_options_add_macro_definition(
-                        shaderc_compile_opts, KRAFT_VERTEX_DEFINE, sizeof(KRAFT_VERTEX_DEFINE) - 1, KRAFT_SHADERFX_ENABLE_VAL, sizeof(KRAFT_SHADERFX_ENABLE_VAL) - 1
-                    );
-                }
-                break;
 
-                case r::ShaderStageFlags::SHADER_STAGE_FLAGS_GEOMETRY:
-                {
-                    shader_kind = shaderc_geometry_shader;
-                    shaderc_compile_options_add_macro_definition(
-                        shaderc_compile_opts, KRAFT_GEOMETRY_DEFINE, sizeof(KRAFT_GEOMETRY_DEFINE) - 1, KRAFT_SHADERFX_ENABLE_VAL, sizeof(KRAFT_SHADERFX_ENABLE_VAL) - 1
-                    );
-                }
-                break;
+            task_index++;
+        }
+    }
 
-                case r::ShaderStageFlags::SHADER_STAGE_FLAGS_FRAGMENT:
-                {
-                    shader_kind = shaderc_fragment_shader;
-                    shaderc_compile_options_add_macro_definition(
-                        shaderc_compile_opts, KRAFT_FRAGMENT_DEFINE, sizeof(KRAFT_FRAGMENT_DEFINE) - 1, KRAFT_SHADERFX_ENABLE_VAL, sizeof(KRAFT_SHADERFX_ENABLE_VAL) - 1
-                    );
-                }
-                break;
+    JobSystem::Submit(jobs, task_count);
+    JobSystem::WaitForCounter(&counter);
 
-                case r::ShaderStageFlags::SHADER_STAGE_FLAGS_COMPUTE:
-                {
-                    shader_kind = shaderc_compute_shader;
-                    shaderc_compile_options_add_macro_definition(
-                        shaderc_compile_opts, KRAFT_COMPUTE_DEFINE, sizeof(KRAFT_COMPUTE_DEFINE) - 1, KRAFT_SHADERFX_ENABLE_VAL, sizeof(KRAFT_SHADERFX_ENABLE_VAL) - 1
-                    );
-                }
-                break;
-            }
+    // Results are handled in order so the output doesn't depend on which stage finished first
+    bool success = true;
+    for (u32 i = 0; i < task_count; i++)
+    {
+        ShaderStageCompileTask*                        task = &tasks[i];
+        shaderfx::VariantDefinition::ShaderDefinition& shader_def = *task->shader_def;
+        shaderc_compilation_result_t                   result = task->result;
+        shaderc_shader_kind                            shader_kind = task->shader_kind;
+        if (shaderc_result_get_compilation_status(result) != shaderc_compilation_status_success)
+        {
+            KERROR("%d shader compilation failed with error:\n%s", shader_def.stage, shaderc_result_get_error_message(result));
+            success = false;
+        }
+        else if (success)
+        {
+            // The compiled code replaces the source in the variant
+            String8 spirv_binary = ArenaPushString8Copy(arena, String8FromPtrAndLength((u8*)shaderc_result_get_bytes(result), shaderc_result_get_length(result)));
+            shader_def.code_fragment.code = spirv_binary;
 
-            result = shaderc_compile_into_spv(compiler, (char*)shader_def.code_fragment.code.ptr, shader_def.code_fragment.code.count, shader_kind, "shader", "main", shaderc_compile_opts);
-            if (shaderc_result_get_compilation_status(result) == shaderc_compilation_status_success)
+            // Reflection dump, only with --verbose. Stages are logged in order here, after all the jobs finished
+            if (compiler_opts.verbose)
             {
-                String8 spirv_binary = String8FromPtrAndLength((u8*)shaderc_result_get_bytes(result), shaderc_result_get_length(result));
-                binary_output.Writei32(shader_def.stage);
-                binary_output.WriteString(shader_def.code_fragment.name);
-                binary_output.WriteString(spirv_binary);
-
                 SpvReflectShaderModule module;
                 SpvReflectResult       spv_reflect_result = spvReflectCreateShaderModule((size_t)shaderc_result_get_length(result), (const void*)shaderc_result_get_bytes(result), &module);
                 KASSERT(spv_reflect_result == SPV_REFLECT_RESULT_SUCCESS);
@@ -419,73 +581,167 @@ bool CompileShaderFX(ArenaAllocator* arena, shaderfx::ShaderEffect* shader, Stri
                 for (u32 set_idx = 0; set_idx < descriptor_set_count; set_idx++)
                 {
                     SpvReflectDescriptorSet* descriptor_set = descriptor_sets[set_idx];
-                    printf("Set = %d Bindings = %d\n", descriptor_set->set, descriptor_set->binding_count);
+                    KDEBUG("Set = %d Bindings = %d", descriptor_set->set, descriptor_set->binding_count);
 
                     for (u32 binding_idx = 0; binding_idx < descriptor_set->binding_count; binding_idx++)
                     {
                         SpvReflectDescriptorBinding* binding = descriptor_set->bindings[binding_idx];
-                        printf("\tBinding %d '%s' %d Type name: '%s'\n", binding->binding, binding->name, binding->descriptor_type, binding->type_description->type_name, binding->descriptor_type);
+                        KDEBUG("\tBinding %d '%s' %d Type name: '%s'", binding->binding, binding->name, binding->descriptor_type, binding->type_description->type_name);
                     }
                 }
 
                 spvReflectDestroyShaderModule(&module);
+            }
 
-                // Also write spirv file
-                if (compiler_opts.write_spirv_for_shaders)
+            // Also write spirv file
+            if (compiler_opts.write_spirv_for_shaders)
+            {
+                fs::FileHandle file_handle;
+                String8        base_dir = fs::Dirname(arena, output_path);
+                String8        extension = String8Raw(".frag.spv");
+                if (shader_kind == shaderc_vertex_shader)
+                {
+                    extension = String8Raw(".vert.spv");
+                }
+                else if (shader_kind == shaderc_compute_shader)
                 {
-                    fs::FileHandle file_handle;
-                    String8        base_dir = fs::Dirname(arena, output_path);
-                    String8        extension = (shader_kind == shaderc_vertex_shader ? String8Raw(".vert.spv") : String8Raw(".frag.spv"));
+                    extension = String8Raw(".comp.spv");
+                }
 
-                    String8 spirv_output_path = fs::PathJoin(arena, base_dir, shader->name);
-                    spirv_output_path = fs::PathJoin(arena, spirv_output_path, extension);
+                String8 spirv_output_path = fs::PathJoin(arena, base_dir, shader->name);
+                spirv_output_path = fs::PathJoin(arena, spirv_output_path, extension);
 
-                    if (fs::OpenFile(spirv_output_path, fs::FILE_OPEN_MODE_WRITE, true, &file_handle))
-                    {
-                        fs::WriteFile(&file_handle, spirv_binary.ptr, spirv_binary.count);
-                        fs::CloseFile(&file_handle);
+                if (fs::OpenFile(spirv_output_path, fs::FILE_OPEN_MODE_WRITE, true, &file_handle))
+                {
+                    fs::WriteFile(&file_handle, spirv_binary.ptr, spirv_binary.count);
+                    fs::CloseFile(&file_handle);
 
-                        KDEBUG("Wrote %S", spirv_output_path);
-                    }
-                    else
-                    {
-                        KERROR("[CompileKFX]: Failed to write spv output to file %S", output_path);
-                        return false;
-                    }
+                    KDEBUG("Wrote %S", spirv_output_path);
+                }
+                else
+                {
+                    KERROR("[CompileKFX]: Failed to write spv output to file %S", output_path);
+                    success = false;
                 }
-
-                shaderc_result_release(result);
             }
-            else
-            {
-                KERROR("%d shader compilation failed with error:\n%s", shader_def.stage, shaderc_result_get_error_message(result));
 
-                shaderc_result_release(result);
-                shaderc_compiler_release(compiler);
+            // Collect the includes, most of them are shared by every stage
+            for (ShaderDependency* dependency = task->dependencies; dependency; dependency = dependency->next)
+            {
+                bool found = false;
+                for (ShaderDependency* existing = *dependencies; existing && !found; existing = existing->next)
+                {
+                    found = StringEqual(existing->path, dependency->path);
+                }
 
-                return false;
+                if (!found)
+                {
+                    ShaderDependency* copy = ArenaPush(arena, ShaderDependency);
+                    copy->path = ArenaPushString8Copy(arena, dependency->path);
+                    copy->hash = dependency->hash;
+                    copy->next = *dependencies;
+                    *dependencies = copy;
+                }
             }
         }
+
+        shaderc_result_release(result);
+        DestroyArena(task->arena);
     }
 
-    shaderc_compiler_release(compiler);
+    if (!success)
+        return false;
 
-    fs::FileHandle file;
-    if (fs::OpenFile(output_path, fs::FILE_OPEN_MODE_WRITE, true, &file))
+    return shaderfx::WriteShaderFXBinary(shader, output_path);
+}
+
+using namespace kraft;
+
+#define KRAFT_SHADERFX_BENCH_ITERATIONS 100
+
+// Loads every compiled effect in `base_path` a number of times and reports how long loading took
+int BenchmarkLoadShaderFX(ArenaAllocator* arena, String8 base_path)
+{
+    String8* paths = nullptr;
+    u32      path_count = 0;
+    if (fs::FileExists(base_path))
     {
-        fs::WriteFile(&file, (u8*)binary_output.Data(), binary_output.Length);
-        fs::CloseFile(&file);
+        paths = ArenaPushArray(arena, String8, 1);
+        paths[path_count++] = base_path;
     }
     else
     {
-        KERROR("[CompileKFX]: Failed to write binary output to file '%S'", output_path);
-        return false;
+        fs::Directory directory = fs::ReadDir(arena, base_path);
+        paths = ArenaPushArray(arena, String8, directory.entry_count);
+        for (int i = 0; i < directory.entry_count; i++)
+        {
+            if (StringEndsWith(directory.entries[i].name, String8Raw(".bkfx")))
+            {
+                paths[path_count++] = fs::PathJoin(arena, base_path, directory.entries[i].name);
+            }
+        }
     }
 
-    return true;
+    int failed_tasks = 0;
+    f64 total_time = 0.0;
+    for (u32 i = 0; i < path_count; i++)
+    {
+        TempArena scratch = ScratchBegin(&arena, 1);
+        f64       start_time = Platform::GetAbsoluteTime();
+        bool      result = true;
+        for (u32 j = 0; j < KRAFT_SHADERFX_BENCH_ITERATIONS && result; j++)
+        {
+            TempArena              iteration = TempBegin(scratch.arena);
+            shaderfx::ShaderEffect effect;
+            result = shaderfx::LoadShaderFX(iteration.arena, paths[i], &effect);
+            TempEnd(iteration);
+        }
+
+        f64 elapsed_time = Platform::GetAbsoluteTime() - start_time;
+        ScratchEnd(scratch);
+
+        if (!result)
+        {
+            KERROR("Failed to load %S", paths[i]);
+            failed_tasks++;
+            continue;
+        }
+
+        total_time += elapsed_time;
+        KINFO("%S: %.3f ms per load", paths[i], elapsed_time * 1000.0 / KRAFT_SHADERFX_BENCH_ITERATIONS);
+    }
+
+    KSUCCESS("Loaded %d effects %d times in %.3f ms, %.3f ms per pass", path_count - failed_tasks, KRAFT_SHADERFX_BENCH_ITERATIONS, total_time * 1000.0, total_time * 1000.0 / KRAFT_SHADERFX_BENCH_ITERATIONS);
+    return failed_tasks;
 }
 
-using namespace kraft;
+// A single effect, compiled on whichever thread picks it up. Its stages are compiled in parallel as well.
+struct ShaderFXCompileTask
+{
+    String8              input_path;
+    String8              output_path;
+    ShaderFxCompilerOpts compiler_opts;
+    bool                 result;
+};
+
+static void CompileShaderFXJob(void* user_data)
+{
+    ShaderFXCompileTask* task = (ShaderFXCompileTask*)user_data;
+
+    // Jobs can run on any thread, so every effect gets an arena of its own
+    ArenaAllocator* arena = CreateArena({ .ChunkSize = KRAFT_SIZE_MB(16), .Alignment = 64 });
+    task->result = CompileShaderFX(arena, task->input_path, task->output_path, task->compiler_opts);
+    if (true == task->result)
+    {
+        KSUCCESS("Compiled %S to %S", task->input_path, task->output_path);
+    }
+    else
+    {
+        KERROR("Failed to compile %S", task->input_path);
+    }
+
+    DestroyArena(arena);
+}
 
 int Init()
 {
@@ -498,6 +754,7 @@ int Init()
 
     String8              base_path = args.ptr[1];
     ShaderFxCompilerOpts compiler_opts;
+    bool                 use_cache = true;
     for (int i = 0; i < args.count; i++)
     {
         if (StringEqual(args.ptr[i], String8Raw("--verbose")))
@@ -508,48 +765,109 @@ int Init()
         {
             compiler_opts.write_spirv_for_shaders = true;
         }
+        else if (StringEqual(args.ptr[i], String8Raw("--bench-load")))
+        {
+            compiler_opts.bench_load = true;
+        }
+        else if (StringEqual(args.ptr[i], String8Raw("--no-cache")))
+        {
+            use_cache = false;
+        }
     }
 
     int             failed_tasks = 0;
     ArenaAllocator* arena = CreateArena({ .ChunkSize = KRAFT_SIZE_MB(16), .Alignment = 64 });
 
+    if (compiler_opts.bench_load)
+    {
+        failed_tasks = BenchmarkLoadShaderFX(arena, base_path);
+        DestroyArena(arena);
+        return failed_tasks;
+    }
+
+    ShaderFXCompileTask* tasks = nullptr;
+    u32                  task_count = 0;
+    String8              shader_dir = {};
     if (fs::FileExists(base_path))
     {
-        String8 output_filepath = StringCat(arena, base_path, String8Raw(".bkfx"));
-        bool    result = CompileShaderFX(arena, base_path, output_filepath, compiler_opts);
-        if (true == result)
-        {
-            KSUCCESS("Compiled %S to %S", base_path, output_filepath);
-        }
-        else
-        {
-            KERROR("Failed to compile %S", base_path);
-            failed_tasks++;
-        }
+        tasks = ArenaPushArray(arena, ShaderFXCompileTask, 1);
+        tasks[task_count++] = {
+            .input_path = base_path,
+            .output_path = StringCat(arena, base_path, String8Raw(".bkfx")),
+        };
+
+        shader_dir = fs::Dirname(arena, base_path);
     }
     else
     {
         fs::Directory directory = fs::ReadDir(arena, base_path);
+        tasks = ArenaPushArray(arena, ShaderFXCompileTask, directory.entry_count);
         for (int i = 0; i < directory.entry_count; i++)
         {
             if (StringEndsWith(directory.entries[i].name, String8Raw(".kfx")))
             {
                 String8 shaderfx_filepath = fs::PathJoin(arena, base_path, directory.entries[i].name);
-                String8 output_filepath = StringCat(arena, shaderfx_filepath, String8Raw(".bkfx"));
-                bool    result = CompileShaderFX(arena, shaderfx_filepath, output_filepath, compiler_opts);
-                if (true == result)
-                {
-                    KSUCCESS("Compiled %S to %S", shaderfx_filepath, output_filepath);
-                }
-                else
-                {
-                    KERROR("Failed to compile %S", shaderfx_filepath);
-                    failed_tasks++;
-                }
+                tasks[task_count++] = {
+                    .input_path = shaderfx_filepath,
+                    .output_path = StringCat(arena, shaderfx_filepath, String8Raw(".bkfx")),
+                };
             }
         }
+
+        shader_dir = base_path;
+    }
+
+    if (use_cache)
+    {
+        InitShaderCache();
+        compiler_opts.cache_dir = fs::PathJoin(arena, shader_dir, String8Raw(".kfx_cache"));
+        if (!fs::MakeDirectory(compiler_opts.cache_dir))
+        {
+            KWARN("Failed to create the shader cache at %S, compiling everything", compiler_opts.cache_dir);
+            compiler_opts.cache_dir = {};
+        }
+    }
+
+    u32 thread_count = JobSystem::GetThreadCount();
+    shaderc_compilers = ArenaPushArray(arena, shaderc_compiler_t, thread_count);
+    for (u32 i = 0; i < thread_count; i++)
+    {
+        shaderc_compilers[i] = shaderc_compiler_initialize();
     }
 
+    JobDescription* jobs = ArenaPushArray(arena, JobDescription, task_count);
+    JobCounter      counter;
+    for (u32 i = 0; i < task_count; i++)
+    {
+        tasks[i].compiler_opts = compiler_opts;
+        jobs[i] = {
+            .Function = CompileShaderFXJob,
+            .UserData = &tasks[i],
+            .Counter = &counter,
+        };
+    }
+
+    f64 start_time = Platform::GetAbsoluteTime();
+    JobSystem::Submit(jobs, task_count);
+    JobSystem::WaitForCounter(&counter);
+
+    for (u32 i = 0; i < task_count; i++)
+    {
+        if (!tasks[i].result)
+        {
+            failed_tasks++;
+        }
+    }
+
+    KINFO("Compiled %d effects on %d threads in %.3f ms", task_count - failed_tasks, thread_count, (Platform::GetAbsoluteTime() - start_time) * 1000.0);
+
+    for (u32 i = 0; i < thread_count; i++)
+    {
+        shaderc_compiler_release(shaderc_compilers[i]);
+    }
+
+    shaderc_compilers = nullptr;
+
     DestroyArena(arena);
     return failed_tasks;
 }